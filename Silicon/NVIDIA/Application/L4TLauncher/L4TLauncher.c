@@ -752,14 +752,106 @@ Error:
   return Status;
 }
 
+/*
+ *
+  SetupSignatureVerification
+
+  Locate the PKCS7 Verify protocol and set up the DB/DBX certificate lists.
+  This is only done on the first call; later calls return the cached values.
+
+  @param[out]  PkcsVerifyProtocol  The PKCS7 Verify protocol to use.
+
+  @retval EFI_SUCCESS          The operation completed successfully.
+          EFI_NOT_FOUND        The allowed DB could not be set up.
+          EFI_XXX              Error status from other APIs called.
+ *
+ */
+
+STATIC
+EFI_STATUS
+SetupSignatureVerification (
+  OUT EFI_PKCS7_VERIFY_PROTOCOL **PkcsVerifyProtocol
+)
+{
+  STATIC EFI_PKCS7_VERIFY_PROTOCOL *Pkcs7Verify = NULL;
+  EFI_STATUS Status;
+
+  if (Pkcs7Verify == NULL) {
+    Status = gBS->LocateProtocol (&gEfiPkcs7VerifyProtocolGuid, NULL, (VOID **)&Pkcs7Verify);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a:Failed to locate PKCS Proto %r\n", __FUNCTION__, Status));
+      Pkcs7Verify = NULL;
+      return Status;
+    }
+  }
+
+  // Do these steps once, to locate and setup the DB/DBX certs.
+  if (AllowedDB == NULL) {
+    AllowedDB = SetupCertList (EFI_IMAGE_SECURITY_DATABASE);
+    if (AllowedDB == NULL) {
+      DEBUG ((DEBUG_ERROR, "%a:Failed to setup Allowed DB\n", __FUNCTION__));
+      return EFI_NOT_FOUND;
+    }
+  }
+
+  if (RevokedDB == NULL) {
+    RevokedDB = SetupCertList (EFI_IMAGE_SECURITY_DATABASE1);
+    if (RevokedDB == NULL) {
+        DEBUG ((DEBUG_ERROR, "%a: Revoked DB not found(Not Fatal)\n",
+                __FUNCTION__));
+    }
+  }
+
+  *PkcsVerifyProtocol = Pkcs7Verify;
+  return EFI_SUCCESS;
+}
+
+/*
+ *
+  IsSecureBootEnabled
+
+  Check whether UEFI secure boot is enabled. The variable is only read on
+  the first call, as it does not change while the launcher runs.
+
+  @retval TRUE                 Secure boot is enabled.
+          FALSE                Secure boot is not enabled.
+ *
+ */
+
+STATIC
+BOOLEAN
+IsSecureBootEnabled (
+  VOID
+)
+{
+  STATIC BOOLEAN Checked = FALSE;
+  STATIC BOOLEAN Enabled = FALSE;
+  UINT8          *SecureBootEnabled = NULL;
+
+  if (!Checked) {
+    GetVariable2 (EFI_SECURE_BOOT_ENABLE_NAME, &gEfiSecureBootEnableDisableGuid,
+                  (VOID**)&SecureBootEnabled, NULL);
+    if (SecureBootEnabled != NULL) {
+      Enabled = (*SecureBootEnabled == SECURE_BOOT_ENABLE);
+      FreePool (SecureBootEnabled);
+    }
+    Checked = TRUE;
+  }
+
+  return Enabled;
+}
+
 /*
  *
   VerifyDetachedCertificateFile
 
   Verify a file that has a detached signature.
-  For a given file name, read the file and its signature file contents in to
+  For a given file name, read its signature file and the file contents in to
   data buffers, locate the signatures in DB and DBX (optional) and pass these
   to the PKCS Verify protocol to verify the file.
+  The signature file and certificate lists are set up before the file itself
+  is read, so that a missing or unusable signature fails before a large file
+  such as an initrd is loaded.
   The function returns the FileHandle of the file it opens and optionally the
   data buffer/size with the contents of the file.
 
@@ -787,9 +879,8 @@ VerifyDetachedCertificateFile (
   OUT UINTN *DataSize OPTIONAL
 )
 {
-  UINT8 *SecureBootEnabled = NULL;
-  EFI_FILE_HANDLE  FileSigHandle;
-  CHAR16  *NewFileName;
+  EFI_FILE_HANDLE  FileSigHandle = NULL;
+  CHAR16  *NewFileName = NULL;
   VOID    *FileData = NULL;
   VOID    *FileSigData = NULL;
   UINT64   FileSize;
@@ -798,16 +889,7 @@ VerifyDetachedCertificateFile (
   EFI_PKCS7_VERIFY_PROTOCOL *PkcsVerifyProtocol;
   UINTN NewFileNameSize;
 
-  GetVariable2 (EFI_SECURE_BOOT_ENABLE_NAME, &gEfiSecureBootEnableDisableGuid,
-                (VOID**)&SecureBootEnabled, NULL);
-  if (SecureBootEnabled && (*SecureBootEnabled == SECURE_BOOT_ENABLE)) {
-    Status = OpenAndReadFileToBuffer (FsHandle, FileName, &FileData,
-                                      FileHandle, &FileSize);
-    if (EFI_ERROR (Status)) {
-      ErrorPrint(L"Error Reading %s \n", FileSize);
-      goto Exit;
-    }
-
+  if (IsSecureBootEnabled ()) {
     // The detached signature file should be <filename>.sig
     NewFileNameSize = StrSize(FileName) + StrSize(DETACHED_SIG_FILE_EXTENSION)
                       + sizeof (CHAR16);
@@ -824,31 +906,23 @@ VerifyDetachedCertificateFile (
     if (EFI_ERROR (Status)) {
       ErrorPrint(L"%a: Failed to open/read Sig file %s\n", __FUNCTION__,
                  NewFileName);
+      // OpenAndReadFileToBuffer() already released these
+      FileSigData = NULL;
+      FileSigHandle = NULL;
       goto Error;
     }
 
-    Status = gBS->LocateProtocol (&gEfiPkcs7VerifyProtocolGuid, NULL, (VOID **)&PkcsVerifyProtocol);
+    Status = SetupSignatureVerification (&PkcsVerifyProtocol);
     if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a:Failed to locate PKCS Proto %r\n", __FUNCTION__, Status));
       goto Error;
     }
 
-    // Do these steps once, to locate and setup the DB/DBX certs.
-    if (AllowedDB == NULL) {
-      AllowedDB = SetupCertList (EFI_IMAGE_SECURITY_DATABASE);
-      if (AllowedDB == NULL) {
-        DEBUG ((DEBUG_ERROR, "%a:Failed to setup Allowed DB %r\n",
-               __FUNCTION__, Status));
-        goto Error;
-      }
-    }
-
-    if (RevokedDB == NULL) {
-      RevokedDB = SetupCertList (EFI_IMAGE_SECURITY_DATABASE1);
-      if (RevokedDB == NULL) {
-          DEBUG ((DEBUG_ERROR, "%a: Revoked DB not found(Not Fatal)\n",
-                  __FUNCTION__));
-      }
+    Status = OpenAndReadFileToBuffer (FsHandle, FileName, &FileData,
+                                      FileHandle, &FileSize);
+    if (EFI_ERROR (Status)) {
+      ErrorPrint(L"Error Reading %s \n", FileName);
+      FileData = NULL;
+      goto Error;
     }
 
     Status = PkcsVerifyProtocol->VerifyBuffer (
@@ -880,18 +954,17 @@ Error:
     if (NewFileName) {
       FreePool (NewFileName);
     }
-    if (FileData && !DataBuf) {
-      FreePool (FileData);
-    } else {
+    if (!EFI_ERROR (Status) && (DataBuf != NULL)) {
       *DataBuf = FileData;
       *DataSize = FileSize;
+    } else if (FileData) {
+      FreePool (FileData);
     }
   }
   else {
     DEBUG ((DEBUG_INFO, "%a: Secure Boot is not Enabled\n", __FUNCTION__));
   }
 
-Exit:
   return Status;
 }
 
@@ -54,13 +54,15 @@ InitializeTable(
 
     if (EFI_ERROR(Status)) {
       Private->CurrentTable = NULL;
+      Private->TableCapacity = 0;
       return Status;
     }
   }
 
+  Private->TableCapacity = 0;
   Status = gBS->AllocatePool(
     EfiBootServicesData,
-    sizeof(EFI_ACPI_DESCRIPTION_HEADER),
+    AML_GENERATION_INITIAL_TABLE_SIZE,
     (VOID**)&Private->CurrentTable
   );
 
@@ -68,6 +70,7 @@ InitializeTable(
     Private->CurrentTable = NULL;
     return EFI_OUT_OF_RESOURCES;
   }
+  Private->TableCapacity = AML_GENERATION_INITIAL_TABLE_SIZE;
 
   CopyMem(Private->CurrentTable, Header, sizeof(EFI_ACPI_DESCRIPTION_HEADER));
 
@@ -195,6 +198,141 @@ GetDeviceLength(
   return EFI_SUCCESS;
 }
 
+/**
+  Make sure the current table buffer can hold at least Required bytes. The
+  buffer grows geometrically so that appending N devices costs O(N) copies in
+  total instead of reallocating the whole table for every device.
+
+  @param[in]  Private           Private data of the AML generation instance.
+  @param[in]  Required          Number of bytes the table buffer must hold.
+
+  @retval EFI_SUCCESS           The buffer is large enough.
+  @retval EFI_OUT_OF_RESOURCES  There was not enough memory to grow the buffer.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+EnsureTableCapacity(
+  IN NVIDIA_AML_GENERATION_PRIVATE_DATA *Private,
+  IN UINTN                              Required
+) {
+  EFI_STATUS                  Status;
+  UINTN                       NewCapacity;
+  EFI_ACPI_DESCRIPTION_HEADER *NewTable;
+
+  if (Required <= Private->TableCapacity) {
+    return EFI_SUCCESS;
+  }
+
+  if (Required > MAX_UINT32) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewCapacity = MAX (Private->TableCapacity, AML_GENERATION_INITIAL_TABLE_SIZE);
+  while (NewCapacity < Required) {
+    NewCapacity *= 2;
+  }
+
+  Status = gBS->AllocatePool(EfiBootServicesData, NewCapacity, (VOID**)&NewTable);
+
+  if (EFI_ERROR(Status) || NewTable == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem(NewTable, Private->CurrentTable, Private->CurrentTable->Length);
+
+  if (Private->ScopeStart != NULL) {
+    Private->ScopeStart = (UINT8*)NewTable + ((UINT8*)Private->ScopeStart - (UINT8*)Private->CurrentTable);
+  }
+  gBS->FreePool(Private->CurrentTable);
+  Private->CurrentTable = NewTable;
+  Private->TableCapacity = NewCapacity;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Validate that the given AML table contains a single Device after the header
+  and return the start and size of that Device.
+
+  @param[in]  Device            Pointer to the start of an AML table containing
+                                a single Device after the header.
+  @param[out] DeviceStart       Pointer to the start of the AML Device object.
+  @param[out] DeviceSize        Number of bytes taken up by the Device object.
+
+  @retval EFI_SUCCESS           The function completed successfully.
+  @retval EFI_INVALID_PARAMETER Device was NULL or didn't have only a single
+                                Device after the header.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+GetAppendedDevice(
+  IN  EFI_ACPI_DESCRIPTION_HEADER *Device,
+  OUT UINT8                       **DeviceStart,
+  OUT UINT32                      *DeviceSize
+) {
+  EFI_STATUS  Status;
+
+  if (Device == NULL || Device->Length < sizeof(EFI_ACPI_DESCRIPTION_HEADER) + 3) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *DeviceStart = (UINT8*)Device + sizeof(EFI_ACPI_DESCRIPTION_HEADER);
+  if (*(*DeviceStart) != AML_EXT_OP
+      || *(*DeviceStart + 1) != AML_EXT_DEVICE_OP) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = GetDeviceLength(*DeviceStart, DeviceSize);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  if (*DeviceSize != Device->Length - sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Grow the package length of the open scope section, if any, by the given
+  number of bytes.
+
+  @param[in]  Private           Private data of the AML generation instance.
+  @param[in]  AddedSize         Number of bytes added to the scope section.
+
+  @retval EFI_SUCCESS           The function completed successfully.
+  @retval EFI_INVALID_PARAMETER The new scope length is outside the AML bounds.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+GrowScopeLength(
+  IN NVIDIA_AML_GENERATION_PRIVATE_DATA *Private,
+  IN UINTN                              AddedSize
+) {
+  EFI_STATUS        Status;
+  UINT32            ScopeLength;
+  AML_SCOPE_HEADER  *ScopeHeader;
+
+  if (Private->ScopeStart == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  ScopeHeader = (AML_SCOPE_HEADER*)Private->ScopeStart;
+  Status = GetScopePackageLength(ScopeHeader, &ScopeLength);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  if (AddedSize > 0x0FFFFFFF - ScopeLength) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return SetScopePackageLength(ScopeHeader, ScopeLength + (UINT32)AddedSize);
+}
+
 /**
   Appends a device to the current AML table being generated. If there is a scope
   section that has been started, the appended device will be also be included in
@@ -222,10 +360,7 @@ AppendDevice(
   EFI_STATUS                          Status;
   UINT8                               *DeviceStart;
   UINT32                              DeviceSize;
-  UINT32                              ScopeLength;
   UINTN                               NewLength;
-  EFI_ACPI_DESCRIPTION_HEADER         *NewTable;
-  AML_SCOPE_HEADER                    *ScopeHeader;
 
   if (This == NULL || Device == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -237,55 +372,111 @@ AppendDevice(
     return EFI_NOT_READY;
   }
 
-  DeviceStart = (UINT8*)Device + sizeof(EFI_ACPI_DESCRIPTION_HEADER);
-  if (*(UINT8*)DeviceStart != AML_EXT_OP
-      || *((UINT8*)DeviceStart + 1) != AML_EXT_DEVICE_OP) {
-    return EFI_INVALID_PARAMETER;
-  }
-
-  Status = GetDeviceLength(DeviceStart, &DeviceSize);
+  Status = GetAppendedDevice(Device, &DeviceStart, &DeviceSize);
   if (EFI_ERROR(Status)) {
     return Status;
   }
 
-  if (DeviceSize != Device->Length - sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
-    return EFI_INVALID_PARAMETER;
-  }
-
   NewLength = Private->CurrentTable->Length + DeviceSize;
 
-  Status = gBS->AllocatePool(EfiBootServicesData, NewLength, (VOID**)&NewTable);
+  Status = EnsureTableCapacity(Private, NewLength);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
 
-  if (EFI_ERROR(Status) || NewTable == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  Status = GrowScopeLength(Private, DeviceSize);
+  if (EFI_ERROR(Status)) {
+    return Status;
   }
-  CopyMem(NewTable, Private->CurrentTable, Private->CurrentTable->Length);
+
   CopyMem(
-    (UINT8*)NewTable + Private->CurrentTable->Length,
+    (UINT8*)Private->CurrentTable + Private->CurrentTable->Length,
     DeviceStart,
     DeviceSize
   );
+  Private->CurrentTable->Length = NewLength;
 
-  if (Private->ScopeStart != NULL) {
-    Private->ScopeStart = (UINT8*)NewTable + ((UINT8*)Private->ScopeStart - (UINT8*)Private->CurrentTable);
+  return EFI_SUCCESS;
+}
+
+/**
+  Appends a set of devices to the current AML table being generated. All
+  devices are validated before the table is modified, so on error the table is
+  left unchanged. If there is a scope section that has been started, the
+  appended devices will also be included in the scope section.
+
+  @param[in]  This              Instance of AML generation protocol.
+  @param[in]  Devices           Array of pointers to AML tables, each containing
+                                a single Device after the header.
+  @param[in]  DeviceCount       Number of entries in Devices.
+
+  @retval EFI_SUCCESS           The function completed successfully.
+  @retval EFI_OUT_OF_RESOURCES  There was not enough memory to extend the table.
+  @retval EFI_NOT_READY         There is not currently a table being generated.
+  @retval EFI_INVALID_PARAMETER This or Devices was NULL, or one of the given
+                                AML Tables didn't have only a single Device
+                                after the header.
+**/
+EFI_STATUS
+EFIAPI
+AppendDevices(
+  IN NVIDIA_AML_GENERATION_PROTOCOL *This,
+  IN EFI_ACPI_DESCRIPTION_HEADER    **Devices,
+  IN UINTN                          DeviceCount
+) {
+  NVIDIA_AML_GENERATION_PRIVATE_DATA  *Private;
+  EFI_STATUS                          Status;
+  UINT8                               *DeviceStart;
+  UINT32                              DeviceSize;
+  UINTN                               TotalSize;
+  UINTN                               Index;
+  UINT8                               *Dest;
+
+  if (This == NULL || (Devices == NULL && DeviceCount != 0)) {
+    return EFI_INVALID_PARAMETER;
   }
-  gBS->FreePool(Private->CurrentTable);
-  Private->CurrentTable = NewTable;
-  Private->CurrentTable->Length = NewLength;
 
-  if (Private->ScopeStart != NULL) {
-    ScopeHeader = (AML_SCOPE_HEADER*)Private->ScopeStart;
-    Status = GetScopePackageLength(ScopeHeader, &ScopeLength);
-    if (EFI_ERROR(Status)) {
-      return Status;
-    }
+  Private = NVIDIA_AML_GENERATION_PRIVATE_DATA_FROM_PROTOCOL(This);
+
+  if (Private->CurrentTable == NULL) {
+    return EFI_NOT_READY;
+  }
 
-    Status = SetScopePackageLength(ScopeHeader, ScopeLength + DeviceSize);
+  // Validate every device and size the table once before copying anything
+  TotalSize = 0;
+  for (Index = 0; Index < DeviceCount; Index++) {
+    Status = GetAppendedDevice(Devices[Index], &DeviceStart, &DeviceSize);
     if (EFI_ERROR(Status)) {
       return Status;
     }
+    if (DeviceSize > MAX_UINT32 - Private->CurrentTable->Length - TotalSize) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    TotalSize += DeviceSize;
+  }
+
+  if (TotalSize == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = EnsureTableCapacity(Private, Private->CurrentTable->Length + TotalSize);
+  if (EFI_ERROR(Status)) {
+    return Status;
   }
 
+  Status = GrowScopeLength(Private, TotalSize);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Dest = (UINT8*)Private->CurrentTable + Private->CurrentTable->Length;
+  for (Index = 0; Index < DeviceCount; Index++) {
+    DeviceSize = Devices[Index]->Length - sizeof(EFI_ACPI_DESCRIPTION_HEADER);
+    CopyMem(Dest, (UINT8*)Devices[Index] + sizeof(EFI_ACPI_DESCRIPTION_HEADER), DeviceSize);
+    Dest += DeviceSize;
+  }
+  Private->CurrentTable->Length += (UINT32)TotalSize;
+
   return EFI_SUCCESS;
 }
 
@@ -317,6 +508,14 @@ GetTable(
     return EFI_NOT_READY;
   }
 
+  // Checksum is only meaningful once the table is handed out, so compute it
+  // here rather than on every append.
+  Private->CurrentTable->Checksum = 0;
+  Private->CurrentTable->Checksum = CalculateCheckSum8(
+                                      (UINT8*)Private->CurrentTable,
+                                      Private->CurrentTable->Length
+                                      );
+
   *Table = Private->CurrentTable;
 
   return EFI_SUCCESS;
@@ -352,7 +551,6 @@ StartScope(
   NVIDIA_AML_GENERATION_PRIVATE_DATA  *Private;
   EFI_STATUS                          Status;
   UINTN                               NewLength;
-  EFI_ACPI_DESCRIPTION_HEADER         *NewTable;
   AML_SCOPE_HEADER                    *ScopeHeader;
   UINTN                               ScopeNameLength;
   CHAR8                               *CurrChar;
@@ -387,15 +585,12 @@ StartScope(
 
   NewLength = Private->CurrentTable->Length + sizeof(AML_SCOPE_HEADER);
 
-  Status = gBS->AllocatePool(EfiBootServicesData, NewLength, (VOID**)&NewTable);
-
-  if (EFI_ERROR(Status) || NewTable == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  Status = EnsureTableCapacity(Private, NewLength);
+  if (EFI_ERROR(Status)) {
+    return Status;
   }
 
-  CopyMem(NewTable, Private->CurrentTable, Private->CurrentTable->Length);
-
-  ScopeHeader = (AML_SCOPE_HEADER*) ((UINT8*)NewTable + NewTable->Length);
+  ScopeHeader = (AML_SCOPE_HEADER*) ((UINT8*)Private->CurrentTable + Private->CurrentTable->Length);
 
   ScopeHeader->OpCode = AML_SCOPE_OP;
   CopyMem(ScopeHeader->Name, ScopeName, ScopeNameLength);
@@ -405,12 +600,6 @@ StartScope(
   SetScopePackageLength(ScopeHeader, sizeof(AML_SCOPE_HEADER) - 1);
 
   Private->ScopeStart = ScopeHeader;
-
-  Status = gBS->FreePool(Private->CurrentTable);
-  if (EFI_ERROR(Status)) {
-    return Status;
-  }
-  Private->CurrentTable = NewTable;
   Private->CurrentTable->Length = NewLength;
 
   return EFI_SUCCESS;
@@ -470,12 +659,14 @@ AmlGenerationDxeEntryPoint(
 
   Private->Signature = NVIDIA_AML_GENERATION_SIGNATURE;
   Private->CurrentTable = NULL;
+  Private->TableCapacity = 0;
   Private->ScopeStart = NULL;
   Private->AmlGenerationProtocol.InitializeTable = InitializeTable;
   Private->AmlGenerationProtocol.AppendDevice = AppendDevice;
   Private->AmlGenerationProtocol.GetTable = GetTable;
   Private->AmlGenerationProtocol.StartScope = StartScope;
   Private->AmlGenerationProtocol.EndScope = EndScope;
+  Private->AmlGenerationProtocol.AppendDevices = AppendDevices;
 
   Status = gBS->InstallMultipleProtocolInterfaces (
     &ImageHandle,
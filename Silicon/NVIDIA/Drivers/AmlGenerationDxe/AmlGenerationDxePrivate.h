@@ -15,6 +15,7 @@
 typedef struct {
   UINT32                          Signature;
   EFI_ACPI_DESCRIPTION_HEADER     *CurrentTable;
+  UINTN                           TableCapacity;
   VOID                            *ScopeStart;
   NVIDIA_AML_GENERATION_PROTOCOL  AmlGenerationProtocol;
 } NVIDIA_AML_GENERATION_PRIVATE_DATA;
@@ -25,6 +26,9 @@ typedef struct {
 
 #define AML_NAME_LENGTH 4
 
+// Initial size of the table buffer, grown geometrically as devices are appended
+#define AML_GENERATION_INITIAL_TABLE_SIZE SIZE_4KB
+
 #pragma pack(1)
 typedef PACKED struct {
   UINT8   OpCode;
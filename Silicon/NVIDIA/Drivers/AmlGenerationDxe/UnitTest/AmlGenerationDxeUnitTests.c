@@ -0,0 +1,611 @@
+/** @file
+  Unit tests of the AML generation driver. Builds a table with a large
+  number of devices and checks that the table grows geometrically and that
+  AppendDevice and AppendDevices generate the same table.
+
+  Tests are run using a boot services table that only provides pool
+  allocation.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+#include <IndustryStandard/Acpi10.h>
+#include <IndustryStandard/AcpiAml.h>
+
+#include <Protocol/AmlGenerationProtocol.h>
+
+#include "../AmlGenerationDxePrivate.h"
+
+#define UNIT_TEST_APP_NAME     "AmlGenerationDxe Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "0.1"
+
+#define TEST_DEVICE_COUNT      512
+#define TEST_SCOPE_NAME        "_SB_"
+#define TEST_DEVICE_HID        "NVDA1000"
+#define TEST_DEVICE_DDN        "AML generation test device 0000"
+
+#pragma pack(1)
+//
+// Device (Dxxx) {
+//   Name (_UID, xxx)
+//   Name (_HID, "NVDA1000")
+//   Name (_DDN, "AML generation test device 0000")
+// }
+//
+typedef PACKED struct {
+  EFI_ACPI_DESCRIPTION_HEADER Header;
+  UINT8                       DeviceOp[2];
+  UINT8                       PkgLength[2];
+  CHAR8                       DeviceName[AML_NAME_LENGTH];
+  UINT8                       UidNameOp;
+  CHAR8                       UidName[AML_NAME_LENGTH];
+  UINT8                       UidPrefix;
+  UINT16                      Uid;
+  UINT8                       HidNameOp;
+  CHAR8                       HidName[AML_NAME_LENGTH];
+  UINT8                       HidPrefix;
+  CHAR8                       Hid[sizeof (TEST_DEVICE_HID)];
+  UINT8                       DdnNameOp;
+  CHAR8                       DdnName[AML_NAME_LENGTH];
+  UINT8                       DdnPrefix;
+  CHAR8                       Ddn[sizeof (TEST_DEVICE_DDN)];
+} TEST_DEVICE_TABLE;
+#pragma pack()
+
+#define TEST_DEVICE_SIZE  (sizeof (TEST_DEVICE_TABLE) - sizeof (EFI_ACPI_DESCRIPTION_HEADER))
+
+EFI_STATUS
+EFIAPI
+AmlGenerationDxeEntryPoint (
+  IN EFI_HANDLE       ImageHandle,
+  IN EFI_SYSTEM_TABLE *SystemTable
+  );
+
+STATIC EFI_BOOT_SERVICES              mBootServices;
+STATIC NVIDIA_AML_GENERATION_PROTOCOL *mAmlGeneration;
+STATIC TEST_DEVICE_TABLE              *mDevices;
+STATIC EFI_ACPI_DESCRIPTION_HEADER    **mDevicePointers;
+STATIC EFI_ACPI_DESCRIPTION_HEADER    *mExpectedTable;
+STATIC UINTN                          mAllocateCount;
+STATIC BOOLEAN                        mAllocateFail;
+
+STATIC EFI_ACPI_DESCRIPTION_HEADER    mTableHeader = {
+  SIGNATURE_32 ('S', 'S', 'D', 'T'),
+  sizeof (EFI_ACPI_DESCRIPTION_HEADER),
+  2,
+  0,
+  { 'N', 'V', 'I', 'D', 'I', 'A' },
+  SIGNATURE_64 ('T', 'E', 'S', 'T', 'S', 'S', 'D', 'T'),
+  1,
+  SIGNATURE_32 ('N', 'V', 'D', 'A'),
+  1
+};
+
+/**
+  AllocatePool boot service used by the driver under test.
+
+  @param[in]  PoolType          Type of pool to allocate.
+  @param[in]  Size              Number of bytes to allocate.
+  @param[out] Buffer            Allocated buffer.
+
+  @retval EFI_SUCCESS           The buffer was allocated.
+  @retval EFI_OUT_OF_RESOURCES  Allocation failed or mAllocateFail is set.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubAllocatePool (
+  IN  EFI_MEMORY_TYPE PoolType,
+  IN  UINTN           Size,
+  OUT VOID            **Buffer
+) {
+  if (mAllocateFail) {
+    *Buffer = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mAllocateCount++;
+  *Buffer = AllocatePool(Size);
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  FreePool boot service used by the driver under test.
+
+  @param[in]  Buffer            Buffer to free.
+
+  @retval EFI_SUCCESS           The buffer was freed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubFreePool (
+  IN VOID *Buffer
+) {
+  FreePool(Buffer);
+  return EFI_SUCCESS;
+}
+
+/**
+  InstallMultipleProtocolInterfaces boot service used by the driver under
+  test. Only records the AML generation protocol instance.
+
+  @param[in, out] Handle        Handle to install the protocol on.
+  @param[in]      ...           Protocol GUID and interface pairs.
+
+  @retval EFI_SUCCESS           The protocol was recorded.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubInstallMultipleProtocolInterfaces (
+  IN OUT EFI_HANDLE *Handle,
+  ...
+) {
+  VA_LIST Args;
+
+  VA_START(Args, Handle);
+  VA_ARG(Args, EFI_GUID *);
+  mAmlGeneration = VA_ARG(Args, NVIDIA_AML_GENERATION_PROTOCOL *);
+  VA_END(Args);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Fill in the AML table of a single test device.
+
+  @param[out] Device            Device table to fill in.
+  @param[in]  Index             Index of the device.
+**/
+STATIC
+VOID
+BuildTestDevice (
+  OUT TEST_DEVICE_TABLE *Device,
+  IN  UINTN             Index
+) {
+  UINT32  PkgLength;
+
+  CopyMem(&Device->Header, &mTableHeader, sizeof (EFI_ACPI_DESCRIPTION_HEADER));
+  Device->Header.Length = sizeof (TEST_DEVICE_TABLE);
+
+  // Package length covers everything after the Device opcode bytes
+  PkgLength = TEST_DEVICE_SIZE - 2;
+  Device->DeviceOp[0] = AML_EXT_OP;
+  Device->DeviceOp[1] = AML_EXT_DEVICE_OP;
+  Device->PkgLength[0] = 0x40 | (PkgLength & 0xF);
+  Device->PkgLength[1] = (PkgLength >> 4) & 0xFF;
+  Device->DeviceName[0] = 'D';
+  Device->DeviceName[1] = '0' + ((Index / 100) % 10);
+  Device->DeviceName[2] = '0' + ((Index / 10) % 10);
+  Device->DeviceName[3] = '0' + (Index % 10);
+
+  Device->UidNameOp = AML_NAME_OP;
+  CopyMem(Device->UidName, "_UID", AML_NAME_LENGTH);
+  Device->UidPrefix = AML_WORD_PREFIX;
+  Device->Uid = (UINT16)Index;
+
+  Device->HidNameOp = AML_NAME_OP;
+  CopyMem(Device->HidName, "_HID", AML_NAME_LENGTH);
+  Device->HidPrefix = AML_STRING_PREFIX;
+  CopyMem(Device->Hid, TEST_DEVICE_HID, sizeof (TEST_DEVICE_HID));
+
+  Device->DdnNameOp = AML_NAME_OP;
+  CopyMem(Device->DdnName, "_DDN", AML_NAME_LENGTH);
+  Device->DdnPrefix = AML_STRING_PREFIX;
+  CopyMem(Device->Ddn, TEST_DEVICE_DDN, sizeof (TEST_DEVICE_DDN));
+}
+
+/**
+  Decode the package length of a scope header.
+
+  @param[in]  ScopeHeader       Scope header to decode.
+
+  @return Package length of the scope.
+**/
+STATIC
+UINT32
+ScopeLength (
+  IN AML_SCOPE_HEADER *ScopeHeader
+) {
+  return ((ScopeHeader->PkgLength >> 4) & 0x0FFFFFF0) | (ScopeHeader->PkgLength & 0xF);
+}
+
+/**
+  Start a new table with an open scope, as the platform drivers do.
+
+  @param[in]  Context           Unused.
+
+  @retval UNIT_TEST_PASSED      Setup finished successfully.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+AmlTableSetup (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS  Status;
+
+  mAllocateFail = FALSE;
+  Status = mAmlGeneration->InitializeTable(mAmlGeneration, &mTableHeader);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Status = mAmlGeneration->StartScope(mAmlGeneration, TEST_SCOPE_NAME);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  mAllocateCount = 0;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the current table holds the scope header followed by every test
+  device in order, and that the scope length and checksum are correct.
+
+  @param[in]  Table             Table returned by GetTable.
+
+  @retval UNIT_TEST_PASSED      The table is correct.
+  @retval others                The table is not correct.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckTable (
+  IN EFI_ACPI_DESCRIPTION_HEADER  *Table
+) {
+  AML_SCOPE_HEADER  *ScopeHeader;
+  UINT8             *Device;
+  UINTN             Index;
+
+  UT_ASSERT_EQUAL(
+    Table->Length,
+    sizeof (EFI_ACPI_DESCRIPTION_HEADER) + sizeof (AML_SCOPE_HEADER) + (TEST_DEVICE_COUNT * TEST_DEVICE_SIZE)
+  );
+  UT_ASSERT_EQUAL(CalculateSum8((UINT8*)Table, Table->Length), 0);
+
+  ScopeHeader = (AML_SCOPE_HEADER*)(Table + 1);
+  UT_ASSERT_EQUAL(ScopeHeader->OpCode, AML_SCOPE_OP);
+  UT_ASSERT_MEM_EQUAL(ScopeHeader->Name, TEST_SCOPE_NAME, AML_NAME_LENGTH);
+  // Scope length includes package and name bytes but not the opcode
+  UT_ASSERT_EQUAL(ScopeLength(ScopeHeader), Table->Length - sizeof (EFI_ACPI_DESCRIPTION_HEADER) - 1);
+
+  Device = (UINT8*)(ScopeHeader + 1);
+  for (Index = 0; Index < TEST_DEVICE_COUNT; Index++) {
+    UT_ASSERT_MEM_EQUAL(Device, &mDevices[Index].DeviceOp, TEST_DEVICE_SIZE);
+    Device += TEST_DEVICE_SIZE;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Append the test devices one at a time and check that the table buffer only
+  grows a logarithmic number of times.
+
+  @param[in]  Context           Unused.
+
+  @retval UNIT_TEST_PASSED      Test passed.
+  @retval others                Test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+AppendDeviceTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS                  Status;
+  EFI_ACPI_DESCRIPTION_HEADER *Table;
+  UINTN                       Index;
+  UNIT_TEST_STATUS            TestStatus;
+
+  for (Index = 0; Index < TEST_DEVICE_COUNT; Index++) {
+    Status = mAmlGeneration->AppendDevice(mAmlGeneration, mDevicePointers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR(Status);
+  }
+
+  Status = mAmlGeneration->GetTable(mAmlGeneration, &Table);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  TestStatus = CheckTable(Table);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  // Capacity doubles from AML_GENERATION_INITIAL_TABLE_SIZE
+  UT_ASSERT_TRUE(mAllocateCount <= HighBitSet32(Table->Length / AML_GENERATION_INITIAL_TABLE_SIZE) + 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Append the test devices in one call and check that the table buffer grows
+  at most once and matches the table built by AppendDevice.
+
+  @param[in]  Context           Unused.
+
+  @retval UNIT_TEST_PASSED      Test passed.
+  @retval others                Test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+AppendDevicesTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS                  Status;
+  EFI_ACPI_DESCRIPTION_HEADER *Table;
+  UINTN                       Index;
+  UNIT_TEST_STATUS            TestStatus;
+
+  // Build the reference table one device at a time
+  for (Index = 0; Index < TEST_DEVICE_COUNT; Index++) {
+    Status = mAmlGeneration->AppendDevice(mAmlGeneration, mDevicePointers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR(Status);
+  }
+  Status = mAmlGeneration->GetTable(mAmlGeneration, &Table);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  if (mExpectedTable != NULL) {
+    FreePool(mExpectedTable);
+  }
+  mExpectedTable = AllocateCopyPool(Table->Length, Table);
+  UT_ASSERT_NOT_NULL(mExpectedTable);
+
+  TestStatus = AmlTableSetup(NULL);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  Status = mAmlGeneration->AppendDevices(mAmlGeneration, mDevicePointers, TEST_DEVICE_COUNT);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Status = mAmlGeneration->GetTable(mAmlGeneration, &Table);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  UT_ASSERT_EQUAL(Table->Length, mExpectedTable->Length);
+  UT_ASSERT_MEM_EQUAL(Table, mExpectedTable, mExpectedTable->Length);
+  UT_ASSERT_TRUE(mAllocateCount <= 1);
+
+  return CheckTable(Table);
+}
+
+/**
+  Check that AppendDevices leaves the table unchanged if one of the devices
+  is not valid or the table can not grow.
+
+  @param[in]  Context           Unused.
+
+  @retval UNIT_TEST_PASSED      Test passed.
+  @retval others                Test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+AppendDevicesFailureTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS                  Status;
+  EFI_ACPI_DESCRIPTION_HEADER *Table;
+  UINT32                      Length;
+  UINT32                      Scope;
+  TEST_DEVICE_TABLE           BadDevice;
+
+  Status = mAmlGeneration->AppendDevice(mAmlGeneration, mDevicePointers[0]);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Status = mAmlGeneration->GetTable(mAmlGeneration, &Table);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Length = Table->Length;
+  Scope = ScopeLength((AML_SCOPE_HEADER*)(Table + 1));
+
+  // Device length that does not match the table length
+  CopyMem(&BadDevice, &mDevices[TEST_DEVICE_COUNT / 2], sizeof (BadDevice));
+  BadDevice.PkgLength[0]++;
+  mDevicePointers[TEST_DEVICE_COUNT / 2] = &BadDevice.Header;
+  Status = mAmlGeneration->AppendDevices(mAmlGeneration, mDevicePointers, TEST_DEVICE_COUNT);
+  mDevicePointers[TEST_DEVICE_COUNT / 2] = &mDevices[TEST_DEVICE_COUNT / 2].Header;
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
+
+  Status = mAmlGeneration->GetTable(mAmlGeneration, &Table);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(Table->Length, Length);
+  UT_ASSERT_EQUAL(ScopeLength((AML_SCOPE_HEADER*)(Table + 1)), Scope);
+
+  // Table buffer can not grow
+  mAllocateFail = TRUE;
+  Status = mAmlGeneration->AppendDevices(mAmlGeneration, mDevicePointers, TEST_DEVICE_COUNT);
+  mAllocateFail = FALSE;
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_OUT_OF_RESOURCES);
+
+  Status = mAmlGeneration->GetTable(mAmlGeneration, &Table);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(Table->Length, Length);
+  UT_ASSERT_EQUAL(ScopeLength((AML_SCOPE_HEADER*)(Table + 1)), Scope);
+  UT_ASSERT_MEM_EQUAL((UINT8*)(Table + 1) + sizeof (AML_SCOPE_HEADER), &mDevices[0].DeviceOp, TEST_DEVICE_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Install the driver under test and build the test devices.
+
+  @retval EFI_SUCCESS           Test data initialized.
+  @retval EFI_OUT_OF_RESOURCES  Not enough memory for the test data.
+**/
+STATIC
+EFI_STATUS
+InitTestData (
+  VOID
+) {
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  mBootServices.AllocatePool = StubAllocatePool;
+  mBootServices.FreePool = StubFreePool;
+  mBootServices.InstallMultipleProtocolInterfaces = StubInstallMultipleProtocolInterfaces;
+  gBS = &mBootServices;
+
+  Status = AmlGenerationDxeEntryPoint(NULL, NULL);
+  if (EFI_ERROR(Status) || mAmlGeneration == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mDevices = AllocatePool(TEST_DEVICE_COUNT * sizeof (TEST_DEVICE_TABLE));
+  mDevicePointers = AllocatePool(TEST_DEVICE_COUNT * sizeof (EFI_ACPI_DESCRIPTION_HEADER *));
+  if (mDevices == NULL || mDevicePointers == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < TEST_DEVICE_COUNT; Index++) {
+    BuildTestDevice(&mDevices[Index], Index);
+    mDevicePointers[Index] = &mDevices[Index].Header;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Clean up test data.
+**/
+STATIC
+VOID
+CleanUpTestData (
+  VOID
+) {
+  if (mDevices != NULL) {
+    FreePool(mDevices);
+  }
+
+  if (mDevicePointers != NULL) {
+    FreePool(mDevicePointers);
+  }
+
+  if (mExpectedTable != NULL) {
+    FreePool(mExpectedTable);
+  }
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  AmlGenerationDxe driver and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+) {
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      AppendTestSuite;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitTestData();
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed to initialize test data. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Start setting up the test framework for running the tests.
+  Status = InitUnitTestFramework(
+    &Fw,
+    UNIT_TEST_APP_NAME,
+    gEfiCallerBaseName,
+    UNIT_TEST_APP_VERSION
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in InitUnitTestFramework. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Populate the AML Append Unit Test Suite.
+  Status = CreateUnitTestSuite(
+    &AppendTestSuite,
+    Fw,
+    "AML Append Tests",
+    "AmlGenerationDxe.AppendTestSuite",
+    NULL,
+    NULL
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in CreateUnitTestSuite for AppendTestSuite\n")
+    );
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // AddTestCase Args:
+  //  Suite | Description
+  //  Class Name | Function
+  //  Pre | Post | Context
+  AddTestCase(AppendTestSuite, "Append Device Test",
+              "AppendDeviceTest", AppendDeviceTest,
+              AmlTableSetup, NULL, NULL);
+  AddTestCase(AppendTestSuite, "Append Devices Test",
+              "AppendDevicesTest", AppendDevicesTest,
+              AmlTableSetup, NULL, NULL);
+  AddTestCase(AppendTestSuite, "Append Devices Failure Test",
+              "AppendDevicesFailureTest", AppendDevicesFailureTest,
+              AmlTableSetup, NULL, NULL);
+
+  // Execute the tests.
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  CleanUpTestData();
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based
+  unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+BaseLibUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+) {
+  return UnitTestingEntry();
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+) {
+  return UnitTestingEntry ();
+}
@@ -17,6 +17,7 @@
 #include <Uefi/UefiMultiPhase.h>
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/FnvHashLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
 #include <IndustryStandard/Acpi10.h>
@@ -270,7 +271,8 @@ GetAmlNodeSize(
 }
 
 /**
-  Find the aml offset entry for the given path name in the given offset table.
+  Find the aml offset entry that exactly matches the given path name in the
+  given offset table.
 
   @param[in]  OffsetTable       Pointer to the start of the offset table
   @param[in]  PathName          Path name of the node in the aml table.
@@ -289,17 +291,15 @@ FindAmlOffsetEntry(
   OUT AML_OFFSET_TABLE_ENTRY  **OffsetEntry
 ) {
   UINTN Index;
-  UINTN PathLen;
 
   if (OffsetTable == NULL || PathName == NULL || OffsetEntry == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
   Index = 0;
-  // Find offset table entry associated with given SdcPathName
-  PathLen = AsciiStrLen(PathName);
+  // Find offset table entry associated with given PathName
   while (OffsetTable[Index].Pathname != NULL &&
-         AsciiStrnCmp(PathName, OffsetTable[Index].Pathname, PathLen) != 0) {
+         AsciiStrCmp(PathName, OffsetTable[Index].Pathname) != 0) {
     Index++;
   }
 
@@ -311,6 +311,193 @@ FindAmlOffsetEntry(
   return EFI_SUCCESS;
 }
 
+/**
+  Build a hash index over the path names of all registered offset tables so
+  that FindNode does not have to walk every offset table. If a path name is
+  present in more than one table, the first registered table wins to match
+  the search order of the offset tables.
+
+  @param[in]  Private           Private data of the AML patch instance.
+
+  @retval EFI_SUCCESS           The index was built.
+  @retval EFI_OUT_OF_RESOURCES  Could not allocate the index.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BuildPathIndex(
+  IN NVIDIA_AML_PATCH_PRIVATE_DATA  *Private
+) {
+  EFI_STATUS                    Status;
+  UINTN                         NumEntries;
+  UINTN                         IndexSize;
+  UINTN                         TableIndex;
+  AML_OFFSET_TABLE_ENTRY        *OffsetEntry;
+  NVIDIA_AML_PATCH_INDEX_ENTRY  *Slot;
+  UINT32                        Hash;
+  UINTN                         Probe;
+
+  NumEntries = 0;
+  for (TableIndex = 0; TableIndex < Private->NumAmlTables; TableIndex++) {
+    OffsetEntry = Private->RegisteredOffsetTables[TableIndex];
+    while (OffsetEntry != NULL && OffsetEntry->Pathname != NULL) {
+      NumEntries++;
+      OffsetEntry++;
+    }
+  }
+
+  // Keep the load factor at or below one half so probe chains stay short
+  IndexSize = AML_PATCH_MIN_INDEX_SIZE;
+  while (IndexSize < NumEntries * 2) {
+    IndexSize *= 2;
+  }
+
+  Status = gBS->AllocatePool(
+    EfiBootServicesData,
+    IndexSize * sizeof(NVIDIA_AML_PATCH_INDEX_ENTRY),
+    (VOID**)&Private->PathIndex
+  );
+  if (EFI_ERROR(Status)) {
+    Private->PathIndex = NULL;
+    Private->PathIndexSize = 0;
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ZeroMem(Private->PathIndex, IndexSize * sizeof(NVIDIA_AML_PATCH_INDEX_ENTRY));
+  Private->PathIndexSize = IndexSize;
+
+  for (TableIndex = 0; TableIndex < Private->NumAmlTables; TableIndex++) {
+    OffsetEntry = Private->RegisteredOffsetTables[TableIndex];
+    while (OffsetEntry != NULL && OffsetEntry->Pathname != NULL) {
+      Hash = CalculateFnv1aHash32(OffsetEntry->Pathname);
+      Probe = Hash & (IndexSize - 1);
+      while (TRUE) {
+        Slot = &Private->PathIndex[Probe];
+        if (Slot->OffsetEntry == NULL) {
+          Slot->Hash = Hash;
+          Slot->TableIndex = TableIndex;
+          Slot->OffsetEntry = OffsetEntry;
+          break;
+        }
+        if (Slot->Hash == Hash
+            && AsciiStrCmp(Slot->OffsetEntry->Pathname, OffsetEntry->Pathname) == 0) {
+          break;
+        }
+        Probe = (Probe + 1) & (IndexSize - 1);
+      }
+      OffsetEntry++;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Look up the offset table entry that exactly matches the given path name in
+  the path name hash index.
+
+  @param[in]  Private           Private data of the AML patch instance.
+  @param[in]  PathName          Path name of the node in the aml table.
+  @param[out] TableIndex        Index of the registered table holding the node.
+  @param[out] OffsetEntry       Offset entry of the node in the AML table.
+
+  @retval EFI_SUCCESS           The offset was found successfully.
+  @retval EFI_NOT_FOUND         The path name is not in the index.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+LookupPathIndex(
+  IN  NVIDIA_AML_PATCH_PRIVATE_DATA *Private,
+  IN  CHAR8                         *PathName,
+  OUT UINTN                         *TableIndex,
+  OUT AML_OFFSET_TABLE_ENTRY        **OffsetEntry
+) {
+  NVIDIA_AML_PATCH_INDEX_ENTRY  *Slot;
+  UINT32                        Hash;
+  UINTN                         Probe;
+
+  if (Private->PathIndex == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Hash = CalculateFnv1aHash32(PathName);
+  Probe = Hash & (Private->PathIndexSize - 1);
+  while (Private->PathIndex[Probe].OffsetEntry != NULL) {
+    Slot = &Private->PathIndex[Probe];
+    if (Slot->Hash == Hash
+        && AsciiStrCmp(Slot->OffsetEntry->Pathname, PathName) == 0) {
+      *TableIndex = Slot->TableIndex;
+      *OffsetEntry = Slot->OffsetEntry;
+      return EFI_SUCCESS;
+    }
+    Probe = (Probe + 1) & (Private->PathIndexSize - 1);
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Free the registered tables, the path name index, and the dirty table flags.
+
+  @param[in]  Private           Private data of the AML patch instance.
+**/
+STATIC
+VOID
+EFIAPI
+FreeRegisteredTables(
+  IN NVIDIA_AML_PATCH_PRIVATE_DATA  *Private
+) {
+  if (Private->RegisteredAmlTables != NULL) {
+    gBS->FreePool(Private->RegisteredAmlTables);
+    Private->RegisteredAmlTables = NULL;
+  }
+  if (Private->RegisteredOffsetTables != NULL) {
+    gBS->FreePool(Private->RegisteredOffsetTables);
+    Private->RegisteredOffsetTables = NULL;
+  }
+  if (Private->PathIndex != NULL) {
+    gBS->FreePool(Private->PathIndex);
+    Private->PathIndex = NULL;
+  }
+  if (Private->DirtyTables != NULL) {
+    gBS->FreePool(Private->DirtyTables);
+    Private->DirtyTables = NULL;
+  }
+  Private->PathIndexSize = 0;
+  Private->NumAmlTables = 0;
+  Private->TransactionActive = FALSE;
+}
+
+/**
+  Update the checksum of the given AML table after one of its nodes was
+  modified. While a patch transaction is active, the update is deferred to
+  CommitTransaction for registered tables.
+
+  @param[in]  Private           Private data of the AML patch instance.
+  @param[in]  AmlTable          AML table that was modified.
+**/
+STATIC
+VOID
+EFIAPI
+MarkTableModified(
+  IN NVIDIA_AML_PATCH_PRIVATE_DATA  *Private,
+  IN EFI_ACPI_DESCRIPTION_HEADER    *AmlTable
+) {
+  UINTN Index;
+
+  if (Private->TransactionActive && Private->DirtyTables != NULL) {
+    for (Index = 0; Index < Private->NumAmlTables; Index++) {
+      if (Private->RegisteredAmlTables[Index] == AmlTable) {
+        Private->DirtyTables[Index] = TRUE;
+        return;
+      }
+    }
+  }
+
+  AmlTable->Checksum = 0;
+  AmlTable->Checksum = CalculateCheckSum8((UINT8*)AmlTable, AmlTable->Length);
+}
+
 /**
   Register an array of AML Tables and their corresponding offset tables. These
   are the arrays that will be used to find, verify, and update nodes by the
@@ -355,6 +542,8 @@ RegisterAmlTables (
 
   Private = NVIDIA_AML_PATCH_PRIVATE_DATA_FROM_PROTOCOL(This);
 
+  FreeRegisteredTables(Private);
+
   Private->NumAmlTables = NumTables;
 
   Status = gBS->AllocatePool(
@@ -376,9 +565,7 @@ RegisterAmlTables (
   );
 
   if (EFI_ERROR(Status)) {
-    Private->NumAmlTables = 0;
-    Private->RegisteredAmlTables = NULL;
-    Private->RegisteredOffsetTables = NULL;
+    FreeRegisteredTables(Private);
     return Status;
   }
 
@@ -387,6 +574,12 @@ RegisterAmlTables (
     Private->RegisteredOffsetTables[Index] = OffsetTables[Index];
   }
 
+  // FindNode falls back to walking the offset tables if there is no index
+  Status = BuildPathIndex(Private);
+  if (EFI_ERROR(Status)) {
+    DEBUG((EFI_D_WARN, "%a: Failed to build path index: %r\n", __FUNCTION__, Status));
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -396,8 +589,8 @@ RegisterAmlTables (
 
   @param[in]  This              Instance of AML patching protocol.
   @param[in]  PathName          Ascii string containing a the path name for the
-                                desired node. The path name must appear in one
-                                of the registered offset tables.
+                                desired node. The path name must exactly match
+                                an entry of one of the registered offset tables.
   @param[out] AmlNodeInfo       Pointer to an NVIDIA_AML_NODE_INFO struct that will be
                                 populated with the AML table, offset entry, and
                                 size of the node if found.
@@ -419,8 +612,6 @@ FindNode (
   NVIDIA_AML_PATCH_PRIVATE_DATA *Private;
   UINTN                         Index;
   UINTN                         FoundSize;
-  EFI_ACPI_DESCRIPTION_HEADER   *CurrentAmlTable;
-  AML_OFFSET_TABLE_ENTRY        *CurrentOffsetTable;
   AML_OFFSET_TABLE_ENTRY        *OffsetEntry;
 
   if (This == NULL || PathName == NULL || AmlNodeInfo == NULL) {
@@ -434,29 +625,42 @@ FindNode (
     return EFI_NOT_READY;
   }
 
-  for (Index = 0; Index < Private->NumAmlTables; Index++) {
-    CurrentOffsetTable = Private->RegisteredOffsetTables[Index];
-    CurrentAmlTable = Private->RegisteredAmlTables[Index];
-    Status = FindAmlOffsetEntry(CurrentOffsetTable, PathName, &OffsetEntry);
-    if (!EFI_ERROR(Status)) {
-      AmlNodeInfo->AmlTable = CurrentAmlTable;
-      AmlNodeInfo->AmlOffsetEntry = OffsetEntry;
-      Status = GetAmlNodeSize(AmlNodeInfo, &FoundSize);
+  // Only walk the offset tables if the index could not be built
+  if (Private->PathIndex != NULL) {
+    Status = LookupPathIndex(Private, PathName, &Index, &OffsetEntry);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  } else {
+    for (Index = 0; Index < Private->NumAmlTables; Index++) {
+      Status = FindAmlOffsetEntry(
+        Private->RegisteredOffsetTables[Index],
+        PathName,
+        &OffsetEntry
+      );
       if (!EFI_ERROR(Status)) {
-        AmlNodeInfo->Size = FoundSize;
-      } else if (Status == EFI_UNSUPPORTED) {
-        // Unsupported means we can't determine size and Get/Set data.
-        // Still want to return AmlNodeInfo though because it is still
-        // possible to patch the name of the node.
-        // (Get and Set will check again to see if the opcode is supported).
-        AmlNodeInfo->Size = 0;
-        Status = EFI_SUCCESS;
+        break;
       }
-      return Status;
+    }
+    if (Index == Private->NumAmlTables) {
+      return EFI_NOT_FOUND;
     }
   }
 
-  return EFI_NOT_FOUND;
+  AmlNodeInfo->AmlTable = Private->RegisteredAmlTables[Index];
+  AmlNodeInfo->AmlOffsetEntry = OffsetEntry;
+  Status = GetAmlNodeSize(AmlNodeInfo, &FoundSize);
+  if (!EFI_ERROR(Status)) {
+    AmlNodeInfo->Size = FoundSize;
+  } else if (Status == EFI_UNSUPPORTED) {
+    // Unsupported means we can't determine size and Get/Set data.
+    // Still want to return AmlNodeInfo though because it is still
+    // possible to patch the name of the node.
+    // (Get and Set will check again to see if the opcode is supported).
+    AmlNodeInfo->Size = 0;
+    Status = EFI_SUCCESS;
+  }
+  return Status;
 }
 
 /**
@@ -592,6 +796,11 @@ SetNodeData (
 
   CopyMem(AmlDataStart, Data, Size);
 
+  MarkTableModified(
+    NVIDIA_AML_PATCH_PRIVATE_DATA_FROM_PROTOCOL(This),
+    AmlNodeInfo->AmlTable
+  );
+
   return EFI_SUCCESS;
 }
 
@@ -658,6 +867,107 @@ UpdateNodeName(
     SetMem(NameStart + NewNameLength, AML_NAME_LENGTH - NewNameLength, '_');
   }
 
+  MarkTableModified(
+    NVIDIA_AML_PATCH_PRIVATE_DATA_FROM_PROTOCOL(This),
+    AmlNodeInfo->AmlTable
+  );
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Start a patch transaction. Until the transaction is committed, SetNodeData
+  and UpdateNodeName only record which registered AML tables were modified
+  instead of recomputing the table checksum on every edit.
+
+  @param[in]  This              Instance of AML patching protocol.
+
+  @retval EFI_SUCCESS           The transaction was started.
+  @retval EFI_ALREADY_STARTED   A transaction is already in progress.
+  @retval EFI_NOT_READY         AML and offset tables have not been registered yet.
+  @retval EFI_INVALID_PARAMETER This was NULL.
+**/
+EFI_STATUS
+EFIAPI
+BeginTransaction(
+  IN NVIDIA_AML_PATCH_PROTOCOL  *This
+) {
+  EFI_STATUS                    Status;
+  NVIDIA_AML_PATCH_PRIVATE_DATA *Private;
+
+  if (This == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Private = NVIDIA_AML_PATCH_PRIVATE_DATA_FROM_PROTOCOL(This);
+
+  if (Private->RegisteredAmlTables == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  if (Private->TransactionActive) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  if (Private->DirtyTables == NULL) {
+    Status = gBS->AllocatePool(
+      EfiBootServicesData,
+      Private->NumAmlTables * sizeof(BOOLEAN),
+      (VOID**)&Private->DirtyTables
+    );
+    if (EFI_ERROR(Status)) {
+      Private->DirtyTables = NULL;
+      return Status;
+    }
+  }
+  ZeroMem(Private->DirtyTables, Private->NumAmlTables * sizeof(BOOLEAN));
+
+  Private->TransactionActive = TRUE;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Commit the current patch transaction. The checksum of every registered AML
+  table modified since BeginTransaction is recomputed once.
+
+  @param[in]  This              Instance of AML patching protocol.
+
+  @retval EFI_SUCCESS           The transaction was committed.
+  @retval EFI_NOT_STARTED       No transaction is in progress.
+  @retval EFI_INVALID_PARAMETER This was NULL.
+**/
+EFI_STATUS
+EFIAPI
+CommitTransaction(
+  IN NVIDIA_AML_PATCH_PROTOCOL  *This
+) {
+  NVIDIA_AML_PATCH_PRIVATE_DATA *Private;
+  EFI_ACPI_DESCRIPTION_HEADER   *AmlTable;
+  UINTN                         Index;
+
+  if (This == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Private = NVIDIA_AML_PATCH_PRIVATE_DATA_FROM_PROTOCOL(This);
+
+  if (!Private->TransactionActive) {
+    return EFI_NOT_STARTED;
+  }
+
+  Private->TransactionActive = FALSE;
+
+  for (Index = 0; Index < Private->NumAmlTables; Index++) {
+    if (!Private->DirtyTables[Index]) {
+      continue;
+    }
+    AmlTable = Private->RegisteredAmlTables[Index];
+    AmlTable->Checksum = 0;
+    AmlTable->Checksum = CalculateCheckSum8((UINT8*)AmlTable, AmlTable->Length);
+    Private->DirtyTables[Index] = FALSE;
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -687,11 +997,20 @@ AmlPatchDxeEntryPoint (
   }
 
   Private->Signature = NVIDIA_AML_PATCH_SIGNATURE;
+  Private->RegisteredAmlTables = NULL;
+  Private->RegisteredOffsetTables = NULL;
+  Private->NumAmlTables = 0;
+  Private->PathIndex = NULL;
+  Private->PathIndexSize = 0;
+  Private->TransactionActive = FALSE;
+  Private->DirtyTables = NULL;
   Private->AmlPatchProtocol.RegisterAmlTables = RegisterAmlTables;
   Private->AmlPatchProtocol.FindNode = FindNode;
   Private->AmlPatchProtocol.GetNodeData = GetNodeData;
   Private->AmlPatchProtocol.SetNodeData = SetNodeData;
   Private->AmlPatchProtocol.UpdateNodeName = UpdateNodeName;
+  Private->AmlPatchProtocol.BeginTransaction = BeginTransaction;
+  Private->AmlPatchProtocol.CommitTransaction = CommitTransaction;
 
   Status = gBS->InstallMultipleProtocolInterfaces (
     &ImageHandle,
@@ -12,12 +12,23 @@
 #include <Protocol/AmlPatchProtocol.h>
 #include <IndustryStandard/Acpi10.h>
 
+// Slot of the path name hash index. An empty slot has a NULL OffsetEntry.
 typedef struct {
-  UINT32                      Signature;
-  EFI_ACPI_DESCRIPTION_HEADER **RegisteredAmlTables;
-  AML_OFFSET_TABLE_ENTRY      **RegisteredOffsetTables;
-  UINTN                       NumAmlTables;
-  NVIDIA_AML_PATCH_PROTOCOL   AmlPatchProtocol;
+  UINT32                  Hash;
+  UINTN                   TableIndex;
+  AML_OFFSET_TABLE_ENTRY  *OffsetEntry;
+} NVIDIA_AML_PATCH_INDEX_ENTRY;
+
+typedef struct {
+  UINT32                        Signature;
+  EFI_ACPI_DESCRIPTION_HEADER   **RegisteredAmlTables;
+  AML_OFFSET_TABLE_ENTRY        **RegisteredOffsetTables;
+  UINTN                         NumAmlTables;
+  NVIDIA_AML_PATCH_INDEX_ENTRY  *PathIndex;
+  UINTN                         PathIndexSize;
+  BOOLEAN                       TransactionActive;
+  BOOLEAN                       *DirtyTables;
+  NVIDIA_AML_PATCH_PROTOCOL     AmlPatchProtocol;
 } NVIDIA_AML_PATCH_PRIVATE_DATA;
 
 #define NVIDIA_AML_PATCH_SIGNATURE SIGNATURE_32('A','M','L','P')
@@ -26,4 +37,7 @@ typedef struct {
 
 #define AML_NAME_LENGTH 4
 
+// Minimum number of slots in the path name hash index
+#define AML_PATCH_MIN_INDEX_SIZE  64
+
 #endif  /* __AML_PATCH_DXE_PRIVATE_H__ */
@@ -11,6 +11,7 @@
 #include "BpmpIpcPrivate.h"
 #include <Library/ArmLib.h>
 #include <Library/IoLib.h>
+#include <Library/TimerLib.h>
 
 #define BOTH_ALIGNED(a, b, align) ((((UINTN)(a) | (UINTN)(b)) & ((align) - 1)) == 0)
 
@@ -125,7 +126,93 @@ TransactionFree (
 }
 
 /**
-  This processes the next entry in the list
+  Start or stop the poll timer. Without the doorbell interrupt it only needs
+  to run while a non-blocking transaction is in flight as blocking callers
+  poll for their own response. With the interrupt it is a slow fallback that
+  runs while anything is in flight.
+
+  Must be called at TPL_NOTIFY.
+
+  @param PrivateData                    Pointer to private data.
+
+**/
+STATIC
+VOID
+UpdateTimer (
+  IN NVIDIA_BPMP_IPC_PRIVATE_DATA  *PrivateData
+  )
+{
+  BPMP_PENDING_TRANSACTION *Transaction;
+  BOOLEAN                  NeedTimer;
+  EFI_STATUS               Status;
+
+  NeedTimer = PrivateData->InFlight;
+  if (NeedTimer && !PrivateData->InterruptDriven) {
+    Transaction = BPMP_PENDING_TRANSACTION_FROM_LINK (GetFirstNode (&PrivateData->TransactionList));
+    NeedTimer = !Transaction->Blocking;
+  }
+
+  if (NeedTimer == PrivateData->TimerActive) {
+    return;
+  }
+
+  if (NeedTimer) {
+    Status = gBS->SetTimer (
+                    PrivateData->TimerEvent,
+                    TimerPeriodic,
+                    PrivateData->InterruptDriven ? BPMP_INTERRUPT_POLL_INTERVAL : BPMP_POLL_INTERVAL
+                    );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "%a: Failed to set timer:%r\r\n", __FUNCTION__, Status));
+      return;
+    }
+  } else {
+    gBS->SetTimer (
+           PrivateData->TimerEvent,
+           TimerCancel,
+           0
+           );
+  }
+  PrivateData->TimerActive = NeedTimer;
+}
+
+/**
+  Add the latency of a completed transaction to the statistics of its MRQ.
+
+  @param PrivateData                    Pointer to private data.
+  @param Transaction                    Completed transaction.
+
+**/
+STATIC
+VOID
+RecordLatency (
+  IN NVIDIA_BPMP_IPC_PRIVATE_DATA  *PrivateData,
+  IN BPMP_PENDING_TRANSACTION      *Transaction
+  )
+{
+  BPMP_MRQ_STATS *Stats;
+  UINT64         LatencyNs;
+  UINT64         LatencyUs;
+  UINTN          Bucket;
+
+  LatencyNs = GetTimeInNanoSecond (GetPerformanceCounter ()) - Transaction->StartTime;
+  LatencyUs = LatencyNs / 1000;
+  if (LatencyUs == 0) {
+    Bucket = 0;
+  } else {
+    Bucket = MIN ((UINTN)HighBitSet64 (LatencyUs) + 1, BPMP_LATENCY_BUCKETS - 1);
+  }
+
+  Stats = &PrivateData->MrqStats[MIN (Transaction->MessageRequest, BPMP_MRQ_STATS_MAX)];
+  Stats->Count++;
+  Stats->TotalNs += LatencyNs;
+  Stats->MaxNs = MAX (Stats->MaxNs, LatencyNs);
+  Stats->Histogram[Bucket]++;
+}
+
+/**
+  This writes the next queued transaction to the Tx channel, unless a
+  transaction is already in flight
 
   @param PrivateData                    Pointer to private data.
 
@@ -139,85 +226,65 @@ ProcessTransaction (
   EFI_TPL                  OldTpl;
   LIST_ENTRY               *List;
   BPMP_PENDING_TRANSACTION *Transaction;
-  UINT64                   TimerTick;
-  EFI_STATUS               Status;
-  BOOLEAN                  ListEmpty;
+  volatile IVC_FRAME       *Frame;
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
-  List = GetFirstNode (&PrivateData->TransactionList);
-  gBS->RestoreTPL (OldTpl);
 
-  //List is empty
-  if (List == &PrivateData->TransactionList) {
-    return;
-  }
-
-  Transaction = BPMP_PENDING_TRANSACTION_FROM_LINK (List);
-  if (Transaction == NULL) {
+  //Each channel only holds a single frame
+  if (PrivateData->InFlight) {
+    gBS->RestoreTPL (OldTpl);
     return;
   }
 
-  //Validate channels are empty
-  if (!ChannelFree (PrivateData->RxChannel) || !ChannelFree (PrivateData->TxChannel)) {
+  //With nothing in flight both channels are expected to be idle
+  List = GetFirstNode (&PrivateData->TransactionList);
+  while ((List != &PrivateData->TransactionList) &&
+         (!ChannelFree (PrivateData->TxChannel) ||
+          !ChannelFree (PrivateData->RxChannel))) {
     DEBUG ((EFI_D_ERROR, "%a: Channel not idle\r\n", __FUNCTION__));
     ASSERT (FALSE);
 
-    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
-    RemoveEntryList (List);
-    ListEmpty = IsListEmpty (&PrivateData->TransactionList);
-    gBS->RestoreTPL (OldTpl);
+    Transaction = BPMP_PENDING_TRANSACTION_FROM_LINK (List);
+    List = GetNextNode (&PrivateData->TransactionList, List);
+    RemoveEntryList (&Transaction->Link);
 
+    Transaction->Token->TransactionStatus = EFI_DEVICE_ERROR;
     gBS->SignalEvent (Transaction->Token->Event);
     TransactionFree (Transaction);
-
-    if (!ListEmpty) {
-      ProcessTransaction (PrivateData);
-    }
-    return;
   }
 
-  //Copy to Tx channel
-  PrivateData->TxChannel->MessageRequest = Transaction->MessageRequest;
-  PrivateData->TxChannel->Flags = IVC_FLAGS_DO_ACK;
-  MmioCopyMem ((VOID *)PrivateData->TxChannel->Data, Transaction->TxData, Transaction->TxDataSize, FALSE);
+  if (List != &PrivateData->TransactionList) {
+    Transaction = BPMP_PENDING_TRANSACTION_FROM_LINK (List);
 
-  PrivateData->TxChannel->WriteCount++;
-  ArmDataMemoryBarrier ();
-
-  PrivateData->DoorbellProtocol->RingDoorbell (
-                                   PrivateData->DoorbellProtocol,
-                                   HspDoorbellBpmp
-                                   );
-
-  //Wait for done
-  if (!Transaction->Blocking) {
-    TimerTick = BPMP_POLL_INTERVAL;
-    Status = gBS->SetTimer (
-                    PrivateData->TimerEvent,
-                    TimerPeriodic,
-                    TimerTick
-                    );
-    if (EFI_ERROR (Status)) {
-      DEBUG ((EFI_D_ERROR, "%a: Failed to set timer:%r\r\n", __FUNCTION__, Status));
+    //Copy to Tx channel
+    Frame = &PrivateData->TxChannel->Frame;
+    Frame->MessageRequest = Transaction->MessageRequest;
+    Frame->Flags = IVC_FLAGS_DO_ACK;
+    if (PrivateData->InterruptDriven) {
+      Frame->Flags |= IVC_FLAGS_RING_DOORBELL;
+    }
+    MmioCopyMem ((VOID *)Frame->Data, Transaction->TxData, Transaction->TxDataSize, FALSE);
 
-      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
-      RemoveEntryList (List);
-      ListEmpty = IsListEmpty (&PrivateData->TransactionList);
-      gBS->RestoreTPL (OldTpl);
+    //Frame contents must be visible before the count that publishes them
+    ArmDataMemoryBarrier ();
+    PrivateData->TxChannel->WriteCount++;
+    PrivateData->InFlight = TRUE;
 
-      gBS->SignalEvent (Transaction->Token->Event);
-      TransactionFree (Transaction);
+    ArmDataMemoryBarrier ();
 
-      if (!ListEmpty) {
-        ProcessTransaction (PrivateData);
-      }
-      return;
-    }
+    PrivateData->DoorbellProtocol->RingDoorbell (
+                                     PrivateData->DoorbellProtocol,
+                                     HspDoorbellBpmp
+                                     );
   }
+
+  UpdateTimer (PrivateData);
+  gBS->RestoreTPL (OldTpl);
 }
 
 /**
-  This routine is called to notify system that HspDoorbell protocol is availible.
+  This routine is called to complete the transaction in flight once its
+  response frame has arrived on the Rx channel.
 
   @param Event                      Event that was notified
   @param Context                    Pointer to private data.
@@ -234,63 +301,133 @@ BpmpIpcTimerNotify (
   EFI_TPL                       OldTpl;
   LIST_ENTRY                    *List;
   BPMP_PENDING_TRANSACTION      *Transaction;
-  BOOLEAN                       ListEmpty;
+  volatile IVC_FRAME            *Frame;
 
   if (NULL == PrivateData) {
     return;
   }
 
-  if (ChannelFree (PrivateData->RxChannel)) {
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  if (!PrivateData->InFlight || ChannelFree (PrivateData->RxChannel)) {
+    gBS->RestoreTPL (OldTpl);
     return;
   }
 
   ArmDataMemoryBarrier ();
 
-  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
   List = GetFirstNode (&PrivateData->TransactionList);
-  gBS->RestoreTPL (OldTpl);
-
-  //List is empty
-  if (List == &PrivateData->TransactionList) {
-    return;
-  }
-
   Transaction = BPMP_PENDING_TRANSACTION_FROM_LINK (List);
-  if (Transaction == NULL) {
-    return;
-  }
-
-  gBS->SetTimer (
-         PrivateData->TimerEvent,
-         TimerCancel,
-         0
-         );
+  Frame = &PrivateData->RxChannel->Frame;
 
   if (NULL != Transaction->MessageError) {
-    *Transaction->MessageError = PrivateData->RxChannel->MessageRequest;
+    *Transaction->MessageError = Frame->MessageRequest;
   }
-  if (PrivateData->RxChannel->MessageRequest != 0) {
+  if (Frame->MessageRequest != 0) {
     Transaction->Token->TransactionStatus = EFI_PROTOCOL_ERROR;
   } else {
     Transaction->Token->TransactionStatus = EFI_SUCCESS;
   }
-  MmioCopyMem (Transaction->RxData, (VOID *)PrivateData->RxChannel->Data, Transaction->RxDataSize, TRUE);
-
-  PrivateData->RxChannel->ReadCount++;
+  MmioCopyMem (Transaction->RxData, (VOID *)Frame->Data, Transaction->RxDataSize, TRUE);
 
   ArmDataMemoryBarrier ();
+  PrivateData->RxChannel->ReadCount++;
 
-  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
   RemoveEntryList (List);
-  ListEmpty = IsListEmpty (&PrivateData->TransactionList);
-  gBS->RestoreTPL (OldTpl);
+  PrivateData->InFlight = FALSE;
+  RecordLatency (PrivateData, Transaction);
 
   gBS->SignalEvent (Transaction->Token->Event);
   TransactionFree (Transaction);
 
-  if (!ListEmpty) {
-    ProcessTransaction (PrivateData);
+  gBS->RestoreTPL (OldTpl);
+
+  ProcessTransaction (PrivateData);
+}
+
+/**
+  Check that the payload of a message fits in an IVC frame.
+
+  @param TxData                         Pointer to the payload data to send
+  @param TxDataSize                     Size of the TxData buffer
+  @param RxData                         Pointer to the payload data to receive
+  @param RxDataSize                     Size of the RxData buffer
+
+  @return TRUE                          Payload is valid
+  @return FALSE                         Payload is not valid
+**/
+STATIC
+BOOLEAN
+ValidPayload (
+  IN VOID   *TxData,
+  IN UINTN  TxDataSize,
+  IN VOID   *RxData,
+  IN UINTN  RxDataSize
+  )
+{
+  return !((TxData == NULL) ||
+           (TxDataSize == 0) ||
+           (TxDataSize > IVC_DATA_SIZE_BYTES) ||
+           ((RxData != NULL) && (RxDataSize == 0)) ||
+           ((RxData == NULL) && (RxDataSize != 0)) ||
+           (RxDataSize > IVC_DATA_SIZE_BYTES));
+}
+
+/**
+  Wait for a blocking transaction to complete.
+
+  The caller spins for about twice the average latency of the MRQ, bounded by
+  BPMP_SPIN_LIMIT_NS, as most responses arrive within that window. After that
+  it sleeps until the doorbell interrupt completes the transaction, or keeps
+  polling at TIMEOUT_STALL_US intervals if it can not sleep.
+
+  @param PrivateData                    Pointer to private data.
+  @param MessageRequest                 Id of the message sent.
+  @param Event                          Event signaled on completion.
+
+  @return EFI_SUCCESS                   Transaction completed.
+  @return others                        Failed to wait for the event.
+**/
+STATIC
+EFI_STATUS
+WaitForTransaction (
+  IN NVIDIA_BPMP_IPC_PRIVATE_DATA  *PrivateData,
+  IN UINT32                        MessageRequest,
+  IN EFI_EVENT                     Event
+  )
+{
+  EFI_STATUS     Status;
+  BPMP_MRQ_STATS *Stats;
+  UINT64         SpinLimit;
+  UINT64         Start;
+  UINTN          Index;
+
+  Stats = &PrivateData->MrqStats[MIN (MessageRequest, BPMP_MRQ_STATS_MAX)];
+  SpinLimit = BPMP_SPIN_LIMIT_NS;
+  if (Stats->Count != 0) {
+    SpinLimit = MIN (DivU64x64Remainder (Stats->TotalNs, Stats->Count, NULL) * 2, SpinLimit);
+  }
+
+  Start = GetTimeInNanoSecond (GetPerformanceCounter ());
+  do {
+    BpmpIpcTimerNotify (NULL, PrivateData);
+    Status = gBS->CheckEvent (Event);
+    if (Status != EFI_NOT_READY) {
+      return Status;
+    }
+  } while ((GetTimeInNanoSecond (GetPerformanceCounter ()) - Start) < SpinLimit);
+
+  if (PrivateData->InterruptDriven &&
+      (EfiGetCurrentTpl () == TPL_APPLICATION)) {
+    return gBS->WaitForEvent (1, &Event, &Index);
   }
+
+  while (Status == EFI_NOT_READY) {
+    gBS->Stall (TIMEOUT_STALL_US);
+    BpmpIpcTimerNotify (NULL, PrivateData);
+    Status = gBS->CheckEvent (Event);
+  }
+  return Status;
 }
 
 /**
@@ -331,7 +468,6 @@ BpmpIpcCommunicate (
   EFI_TPL                      OldTpl;
   NVIDIA_BPMP_IPC_PRIVATE_DATA *PrivateData        = NULL;
   BPMP_PENDING_TRANSACTION     *PendingTransaction = NULL;
-  BOOLEAN                      NeedQueue = FALSE;
 
   if (NULL == This) {
     return EFI_INVALID_PARAMETER;
@@ -343,12 +479,7 @@ BpmpIpcCommunicate (
     return EFI_INVALID_PARAMETER;
   }
 
-  if ((TxData == NULL) ||
-      (TxDataSize == 0) ||
-      (TxDataSize > IVC_DATA_SIZE_BYTES) ||
-      ((RxData != NULL) && (RxDataSize == 0)) ||
-      ((RxData == NULL) && (RxDataSize != 0)) ||
-      (RxDataSize > IVC_DATA_SIZE_BYTES)) {
+  if (!ValidPayload (TxData, TxDataSize, RxData, RxDataSize)) {
     return EFI_INVALID_PARAMETER;
   }
 
@@ -382,31 +513,16 @@ BpmpIpcCommunicate (
   PendingTransaction->RxDataSize = RxDataSize;
   PendingTransaction->Blocking = Blocking;
   PendingTransaction->MessageError = MessageError;
+  PendingTransaction->StartTime = GetTimeInNanoSecond (GetPerformanceCounter ());
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
-  NeedQueue = IsListEmpty (&PrivateData->TransactionList);
   InsertTailList (&PrivateData->TransactionList, &PendingTransaction->Link);
   gBS->RestoreTPL (OldTpl);
 
-  if (NeedQueue) {
-    ProcessTransaction (PrivateData);
-  }
+  ProcessTransaction (PrivateData);
 
   if (Blocking) {
-    gBS->SetTimer (
-           PrivateData->TimerEvent,
-           TimerCancel,
-           0
-           );
-    Status = EFI_NOT_READY;
-    while (Status == EFI_NOT_READY) {
-      BpmpIpcTimerNotify (NULL, PrivateData);
-      Status = gBS->CheckEvent (Token->Event);
-      if (Status != EFI_NOT_READY) {
-        break;
-      }
-      gBS->Stall (TIMEOUT_STALL_US);
-    }
+    Status = WaitForTransaction (PrivateData, MessageRequest, Token->Event);
     gBS->CloseEvent (Token->Event);
     if (EFI_ERROR (Status)) {
       return Status;
@@ -417,6 +533,130 @@ BpmpIpcCommunicate (
   }
 }
 
+/**
+  This function executes a list of remote IPCs to the BPMP firmware. All
+  messages are queued at once and sent back to back as the IPC channel frees
+  up, the function returns once every message has completed.
+
+  @param[in]     This                The instance of the NVIDIA_BPMP_IPC_PROTOCOL.
+  @param[in,out] Entries             Array of messages to send, the Status and
+                                     MessageError of each entry are updated
+  @param[in]     NumberOfEntries     Number of entries in the array
+
+  @return EFI_SUCCESS               All messages completed successfully.
+  @return EFI_INVALID_PARAMETER     Entries is NULL or an entry is not valid,
+                                     no message has been sent.
+  @return EFI_DEVICE_ERROR          At least one message failed, see the entry status.
+  @return EFI_OUT_OF_RESOURCES      Failed to allocate the transactions.
+**/
+EFI_STATUS
+BpmpIpcCommunicateBatch (
+  IN     NVIDIA_BPMP_IPC_PROTOCOL     *This,
+  IN OUT NVIDIA_BPMP_IPC_BATCH_ENTRY  *Entries,
+  IN     UINTN                        NumberOfEntries
+  )
+{
+  NVIDIA_BPMP_IPC_PRIVATE_DATA *PrivateData;
+  BPMP_PENDING_TRANSACTION     *Transactions = NULL;
+  NVIDIA_BPMP_IPC_TOKEN        *Tokens = NULL;
+  EFI_EVENT                    Event = NULL;
+  EFI_STATUS                   Status;
+  EFI_TPL                      OldTpl;
+  UINTN                        Index;
+  UINT64                       StartTime;
+
+  if ((NULL == This) ||
+      ((Entries == NULL) && (NumberOfEntries != 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  PrivateData = BPMP_IPC_PRIVATE_DATA_FROM_THIS(This);
+
+  for (Index = 0; Index < NumberOfEntries; Index++) {
+    if (!ValidPayload (Entries[Index].TxData, Entries[Index].TxDataSize, Entries[Index].RxData, Entries[Index].RxDataSize)) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (NumberOfEntries == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Transactions = (BPMP_PENDING_TRANSACTION *) AllocatePool (NumberOfEntries * sizeof (BPMP_PENDING_TRANSACTION));
+  Tokens = (NVIDIA_BPMP_IPC_TOKEN *) AllocatePool (NumberOfEntries * sizeof (NVIDIA_BPMP_IPC_TOKEN));
+  if ((Transactions == NULL) || (Tokens == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
+  Status = gBS->CreateEvent (
+                  0,
+                  TPL_CALLBACK,
+                  NULL,
+                  NULL,
+                  &Event
+                  );
+  if (EFI_ERROR (Status)) {
+    goto ErrorExit;
+  }
+
+  //
+  // All entries share one event, the transactions are completed in order so
+  // the batch is done once the last entry has a status. They are marked as
+  // blocking as they are owned and freed here.
+  //
+  StartTime = GetTimeInNanoSecond (GetPerformanceCounter ());
+  for (Index = 0; Index < NumberOfEntries; Index++) {
+    Tokens[Index].Event = Event;
+    Tokens[Index].TransactionStatus = EFI_NOT_READY;
+    Entries[Index].MessageError = 0;
+
+    Transactions[Index].Signature = BPMP_PENDING_TRANSACTION_SIGNATURE;
+    Transactions[Index].Token = &Tokens[Index];
+    Transactions[Index].MessageRequest = Entries[Index].MessageRequest;
+    Transactions[Index].TxData = Entries[Index].TxData;
+    Transactions[Index].TxDataSize = Entries[Index].TxDataSize;
+    Transactions[Index].RxData = Entries[Index].RxData;
+    Transactions[Index].RxDataSize = Entries[Index].RxDataSize;
+    Transactions[Index].Blocking = TRUE;
+    Transactions[Index].MessageError = &Entries[Index].MessageError;
+    Transactions[Index].StartTime = StartTime;
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  for (Index = 0; Index < NumberOfEntries; Index++) {
+    InsertTailList (&PrivateData->TransactionList, &Transactions[Index].Link);
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  ProcessTransaction (PrivateData);
+
+  //The transactions reference memory owned here, wait for all of them
+  while (Tokens[NumberOfEntries - 1].TransactionStatus == EFI_NOT_READY) {
+    WaitForTransaction (PrivateData, Entries[NumberOfEntries - 1].MessageRequest, Event);
+  }
+
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < NumberOfEntries; Index++) {
+    Entries[Index].Status = Tokens[Index].TransactionStatus;
+    if (EFI_ERROR (Entries[Index].Status)) {
+      Status = EFI_DEVICE_ERROR;
+    }
+  }
+
+ErrorExit:
+  if (Event != NULL) {
+    gBS->CloseEvent (Event);
+  }
+  if (Tokens != NULL) {
+    FreePool (Tokens);
+  }
+  if (Transactions != NULL) {
+    FreePool (Transactions);
+  }
+  return Status;
+}
+
 /**
   This routine moves the tx state and rings the doorbell
 
@@ -589,6 +829,29 @@ HspProtocolNotify (
     return;
   }
 
+  //Complete transactions from the doorbell interrupt if it is available
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  BpmpIpcTimerNotify,
+                  PrivateData,
+                  &PrivateData->DoorbellEvent
+                  );
+  if (!EFI_ERROR (Status)) {
+    Status = PrivateData->DoorbellProtocol->RegisterNotify (
+                                              PrivateData->DoorbellProtocol,
+                                              HspDoorbellBpmp,
+                                              PrivateData->DoorbellEvent
+                                              );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_INFO, "%a: Doorbell interrupt not available, polling: %r\r\n", __FUNCTION__, Status));
+      gBS->CloseEvent (PrivateData->DoorbellEvent);
+      PrivateData->DoorbellEvent = NULL;
+    } else {
+      PrivateData->InterruptDriven = TRUE;
+    }
+  }
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &PrivateData->Controller,
                   &gNVIDIABpmpIpcProtocolGuid,
@@ -603,6 +866,52 @@ HspProtocolNotify (
   PrivateData->ProtocolInstalled = TRUE;
 }
 
+/**
+  This routine is called at ready to boot to report the BPMP latency statistics.
+
+  @param Event                      Event that was notified
+  @param Context                    Pointer to private data.
+
+**/
+VOID
+EFIAPI
+BpmpIpcReadyToBootNotify (
+  IN EFI_EVENT Event,
+  IN VOID      *Context
+  )
+{
+  NVIDIA_BPMP_IPC_PRIVATE_DATA  *PrivateData = (NVIDIA_BPMP_IPC_PRIVATE_DATA *)Context;
+  BPMP_MRQ_STATS                *Stats;
+  UINTN                         MessageRequest;
+  UINTN                         Bucket;
+
+  if (NULL == PrivateData) {
+    return;
+  }
+
+  DEBUG ((EFI_D_INFO, "BPMP MRQ latency, histogram buckets are <1us then powers of 2 in us\r\n"));
+  for (MessageRequest = 0; MessageRequest <= BPMP_MRQ_STATS_MAX; MessageRequest++) {
+    Stats = &PrivateData->MrqStats[MessageRequest];
+    if (Stats->Count == 0) {
+      continue;
+    }
+
+    DEBUG ((
+      EFI_D_INFO,
+      "MRQ %3u%a: count %lu avg %luus max %luus hist",
+      MessageRequest,
+      (MessageRequest == BPMP_MRQ_STATS_MAX) ? "+" : "",
+      Stats->Count,
+      DivU64x64Remainder (Stats->TotalNs, Stats->Count, NULL) / 1000,
+      Stats->MaxNs / 1000
+      ));
+    for (Bucket = 0; Bucket < BPMP_LATENCY_BUCKETS; Bucket++) {
+      DEBUG ((EFI_D_INFO, " %u", Stats->Histogram[Bucket]));
+    }
+    DEBUG ((EFI_D_INFO, "\r\n"));
+  }
+}
+
 /**
   This routine is called right after the .Supported() called and
   Starts the HspDoorbell protocol on the device.
@@ -628,6 +937,8 @@ BpmpIpcProtocolStart (
   NVIDIA_BPMP_IPC_PRIVATE_DATA        *PrivateData = NULL;
   EFI_ACPI_ADDRESS_SPACE_DESCRIPTOR   *Desc;
   UINTN                               ResourceCount = 0;
+  UINT64                              TxChannelSize = 0;
+  UINT64                              RxChannelSize = 0;
 
   PrivateData = AllocateZeroPool (sizeof (NVIDIA_BPMP_IPC_PRIVATE_DATA));
   if (NULL == PrivateData) {
@@ -643,6 +954,7 @@ BpmpIpcProtocolStart (
   PrivateData->TxChannel = NULL;
   PrivateData->RxChannel = NULL;
   PrivateData->BpmpIpcProtocol.Communicate = BpmpIpcCommunicate;
+  PrivateData->BpmpIpcProtocol.CommunicateBatch = BpmpIpcCommunicateBatch;
   PrivateData->Controller = Controller;
 
   Status = gBS->CreateEvent (
@@ -659,6 +971,17 @@ BpmpIpcProtocolStart (
 
   InitializeListHead (&PrivateData->TransactionList);
 
+  Status = EfiCreateEventReadyToBootEx (
+             TPL_CALLBACK,
+             BpmpIpcReadyToBootNotify,
+             PrivateData,
+             &PrivateData->ReadyToBootEvent
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Failed to create ready to boot event: %r\r\n", __FUNCTION__, Status));
+    goto ErrorExit;
+  }
+
   //
   // We only support MMIO devices, so iterate over the resources to ensure
   // that they only describe things that we can handle
@@ -673,11 +996,15 @@ BpmpIpcProtocolStart (
     //Last two resources are tx and rx, some device trees have 3 nodes and some have 2.
     if (PrivateData->TxChannel == NULL) {
       PrivateData->TxChannel = (IVC_CHANNEL *)(VOID *)Desc->AddrRangeMin;
+      TxChannelSize = Desc->AddrLen;
     } else if (PrivateData->RxChannel == NULL) {
       PrivateData->RxChannel = (IVC_CHANNEL *)(VOID *)Desc->AddrRangeMin;
+      RxChannelSize = Desc->AddrLen;
     } else {
       PrivateData->TxChannel = PrivateData->RxChannel;
+      TxChannelSize = RxChannelSize;
       PrivateData->RxChannel = (IVC_CHANNEL *)(VOID *)Desc->AddrRangeMin;
+      RxChannelSize = Desc->AddrLen;
     }
     ResourceCount++;
   }
@@ -688,6 +1015,16 @@ BpmpIpcProtocolStart (
     goto ErrorExit;
   }
 
+  //
+  // Both shared memory regions must hold the channel header and its frame
+  //
+  if ((TxChannelSize < sizeof (IVC_CHANNEL)) ||
+      (RxChannelSize < sizeof (IVC_CHANNEL))) {
+    DEBUG ((EFI_D_ERROR, "%a: IVC channel too small, Tx 0x%lx Rx 0x%lx\r\n", __FUNCTION__, TxChannelSize, RxChannelSize));
+    Status = EFI_UNSUPPORTED;
+    goto ErrorExit;
+  }
+
   PrivateData->RegisterNotifyEvent = EfiCreateProtocolNotifyEvent (
                  &gNVIDIAHspDoorbellProtocolGuid,
                  TPL_CALLBACK,
@@ -714,6 +1051,10 @@ ErrorExit:
         gBS->CloseEvent (PrivateData->RegisterNotifyEvent);
         PrivateData->RegisterNotifyEvent = NULL;
       }
+      if (NULL != PrivateData->ReadyToBootEvent) {
+        gBS->CloseEvent (PrivateData->ReadyToBootEvent);
+        PrivateData->ReadyToBootEvent = NULL;
+      }
       if (NULL != PrivateData->DoorbellProtocol) {
         gBS->CloseProtocol (
                         PrivateData->DoorbellHandle,
@@ -807,6 +1148,21 @@ BpmpIpcProtocolStop (
     PrivateData->RegisterNotifyEvent = NULL;
   }
 
+  if (NULL != PrivateData->ReadyToBootEvent) {
+    gBS->CloseEvent (PrivateData->ReadyToBootEvent);
+    PrivateData->ReadyToBootEvent = NULL;
+  }
+
+  if (NULL != PrivateData->DoorbellEvent) {
+    PrivateData->DoorbellProtocol->RegisterNotify (
+                                     PrivateData->DoorbellProtocol,
+                                     HspDoorbellBpmp,
+                                     NULL
+                                     );
+    gBS->CloseEvent (PrivateData->DoorbellEvent);
+    PrivateData->DoorbellEvent = NULL;
+  }
+
   if (NULL != PrivateData->DoorbellProtocol) {
     gBS->CloseProtocol (
                     PrivateData->DoorbellHandle,
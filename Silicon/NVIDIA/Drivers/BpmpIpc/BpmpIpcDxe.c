@@ -90,8 +90,18 @@ DeviceTreeIsSupported (
   }
 }
 
+// Must list every compatible string accepted by DeviceTreeIsSupported ()
+STATIC CONST CHAR8 *mCompatibleStrings[] = {
+  "nvidia,tegra186-hsp",
+  "nvidia,tegra194-hsp",
+  "nvidia,tegra234-hsp",
+  "nvidia,tegra186-bpmp",
+  NULL
+};
+
 NVIDIA_DEVICE_TREE_COMPATIBILITY_PROTOCOL gDeviceTreeCompatibilty = {
-    DeviceTreeIsSupported
+    DeviceTreeIsSupported,
+    mCompatibleStrings
 };
 
 /**
@@ -326,8 +336,29 @@ BpmpIpcDummyCommunicate (
   return EFI_UNSUPPORTED;
 }
 
+/**
+  This function executes a list of remote IPCs to the BPMP firmware.
+  This is a dummy version that is used if BPMP is not present.
+
+  @param[in]     This                The instance of the NVIDIA_BPMP_IPC_PROTOCOL.
+  @param[in,out] Entries             Array of messages to send
+  @param[in]     NumberOfEntries     Number of entries in the array
+
+  @return EFI_UNSUPPORTED           BPMP IPC is not supported on this system
+**/
+EFI_STATUS
+BpmpIpcDummyCommunicateBatch (
+  IN     NVIDIA_BPMP_IPC_PROTOCOL     *This,
+  IN OUT NVIDIA_BPMP_IPC_BATCH_ENTRY  *Entries,
+  IN     UINTN                        NumberOfEntries
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
 CONST NVIDIA_BPMP_IPC_PROTOCOL mBpmpDummyProtocol = {
-    BpmpIpcDummyCommunicate
+    BpmpIpcDummyCommunicate,
+    BpmpIpcDummyCommunicateBatch
 };
 /**
   Initialize the Bpmp Ipc Protocol Driver
@@ -37,6 +37,12 @@ extern EFI_COMPONENT_NAME2_PROTOCOL gBpmpIpcComponentName2;
 //Time to poll in in 100ns intervals
 #define BPMP_POLL_INTERVAL 1000 //(100us)
 
+//Time to poll in 100ns intervals when the doorbell interrupt is used
+#define BPMP_INTERRUPT_POLL_INTERVAL 100000 //(10ms)
+
+//Longest a blocking call spins before it sleeps, in nanoseconds
+#define BPMP_SPIN_LIMIT_NS 50000 //(50us)
+
 /**
   This routine is called right after the .Supported() called and
   Starts the HspDoorbell protocol on the device.
@@ -14,6 +14,17 @@
 #include <Protocol/BpmpIpc.h>
 #include <Protocol/HspDoorbell.h>
 
+#define IVC_DATA_SIZE_BYTES     120
+
+//
+// BPMP firmware lays out each IVC channel as the header followed by a
+// single frame.
+//
+typedef struct {
+  UINT32 MessageRequest;
+  UINT32 Flags;
+  UINT8  Data[IVC_DATA_SIZE_BYTES];
+} IVC_FRAME;
 
 typedef struct {
   UINT32 WriteCount;
@@ -23,9 +34,7 @@ typedef struct {
   UINT32 ReadCount;
   UINT32 ReadReserved[15];
 
-  UINT32 MessageRequest;
-  UINT32 Flags;
-  UINT8  Data[0];
+  IVC_FRAME Frame;
 } IVC_CHANNEL;
 
 typedef enum {
@@ -35,7 +44,6 @@ typedef enum {
   IvcStateMax
 } IVC_STATE;
 
-#define IVC_DATA_SIZE_BYTES     120
 #define IVC_FLAGS_DO_ACK        BIT0
 #define IVC_FLAGS_RING_DOORBELL BIT1
 //
@@ -65,10 +73,30 @@ typedef struct {
   UINTN                             RxDataSize;
   BOOLEAN                           Blocking;
   INT32                             *MessageError;
+
+  //
+  // Time the transaction was queued, in nanoseconds
+  //
+  UINT64                            StartTime;
 } BPMP_PENDING_TRANSACTION;
 
 #define BPMP_PENDING_TRANSACTION_FROM_LINK(a) CR(a, BPMP_PENDING_TRANSACTION, Link, BPMP_PENDING_TRANSACTION_SIGNATURE)
 
+//
+// Per-MRQ latency statistics, MRQs at or above BPMP_MRQ_STATS_MAX share the
+// last entry. Histogram bucket 0 counts latencies below 1us, bucket N those
+// in [2^(N-1), 2^N) us and the last bucket everything above.
+//
+#define BPMP_MRQ_STATS_MAX    128
+#define BPMP_LATENCY_BUCKETS  16
+
+typedef struct {
+  UINT64 Count;
+  UINT64 TotalNs;
+  UINT64 MaxNs;
+  UINT32 Histogram[BPMP_LATENCY_BUCKETS];
+} BPMP_MRQ_STATS;
+
 //
 // HspDoorbell driver private data structure
 //
@@ -128,14 +156,31 @@ typedef struct {
   volatile IVC_CHANNEL              *TxChannel;
 
   //
-  // Pending Transaction Linked List
+  // Pending Transaction Linked List, if InFlight is TRUE the first entry has
+  // been written to the Tx channel and is waiting for its response frame.
   //
   LIST_ENTRY                         TransactionList;
+  BOOLEAN                            InFlight;
 
   //
   // Timer event
   //
   EFI_EVENT                          TimerEvent;
+  BOOLEAN                            TimerActive;
+
+  //
+  // Event signaled by the doorbell interrupt, if InterruptDriven is TRUE
+  // BPMP rings the doorbell for each response and the timer only acts as
+  // a fallback.
+  //
+  EFI_EVENT                          DoorbellEvent;
+  BOOLEAN                            InterruptDriven;
+
+  //
+  // Latency statistics, reported at ready to boot
+  //
+  EFI_EVENT                          ReadyToBootEvent;
+  BPMP_MRQ_STATS                     MrqStats[BPMP_MRQ_STATS_MAX + 1];
 } NVIDIA_BPMP_IPC_PRIVATE_DATA;
 
 #define BPMP_IPC_PRIVATE_DATA_FROM_THIS(a) CR(a, NVIDIA_BPMP_IPC_PRIVATE_DATA, BpmpIpcProtocol, BPMP_IPC_SIGNATURE)
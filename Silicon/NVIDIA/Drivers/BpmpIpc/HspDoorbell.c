@@ -11,6 +11,8 @@
 #include "BpmpIpcDxePrivate.h"
 #include "HspDoorbellPrivate.h"
 #include <Library/IoLib.h>
+#include <Protocol/DeviceTreeNode.h>
+#include <libfdt.h>
 
 HSP_MASTER_ID DoorbellToMaster[HspDoorbellMax] = {
   HSP_MASTER_DPMU,
@@ -22,6 +24,11 @@ HSP_MASTER_ID DoorbellToMaster[HspDoorbellMax] = {
   HSP_MASTER_APE,
 };
 
+//
+// Interrupt handlers have no context, only one HSP instance services the doorbell interrupt
+//
+STATIC NVIDIA_HSP_DOORBELL_PRIVATE_DATA *mHspDoorbellInterruptData = NULL;
+
 /**
   This function allows for a remote IPC to the BPMP firmware to be executed.
 
@@ -110,7 +117,171 @@ HspDoorbellEnableChannel (
 
   return EFI_SUCCESS;
 }
+/**
+  Interrupt handler for the CCPLEX doorbell, signals the events registered
+  for the processors that rang it.
+
+  @param[in]     Source              Source of the interrupt.
+  @param[in]     SystemContext       System context at the time of the interrupt.
+**/
+STATIC
+VOID
+EFIAPI
+HspDoorbellInterruptHandler (
+  IN HARDWARE_INTERRUPT_SOURCE  Source,
+  IN EFI_SYSTEM_CONTEXT         SystemContext
+  )
+{
+  NVIDIA_HSP_DOORBELL_PRIVATE_DATA *PrivateData = mHspDoorbellInterruptData;
+  UINT32                           Pending;
+  UINTN                            Index;
 
+  if (NULL == PrivateData) {
+    return;
+  }
+
+  //Acknowledge all pending rings before dispatching them
+  Pending = MmioRead32 (PrivateData->DoorbellLocation[HspDoorbellCcplex] + HSP_DB_REG_PENDING);
+  MmioWrite32 (PrivateData->DoorbellLocation[HspDoorbellCcplex] + HSP_DB_REG_PENDING, Pending);
+
+  for (Index = 0; Index < HspDoorbellMax; Index++) {
+    if ((PrivateData->NotifyEvent[Index] != NULL) &&
+        ((Pending & (1U << DoorbellToMaster[Index])) != 0)) {
+      gBS->SignalEvent (PrivateData->NotifyEvent[Index]);
+    }
+  }
+
+  PrivateData->InterruptProtocol->EndOfInterrupt (PrivateData->InterruptProtocol, Source);
+}
+
+/**
+  This function registers an event to be signaled when the processor behind
+  the specified doorbell rings the CCPLEX doorbell.
+
+  @param[in]     This                The instance of the NVIDIA_HSP_DOORBELL_PROTOCOL.
+  @param[in]     Doorbell            Doorbell of the remote processor
+  @param[in]     Event               Event to signal, NULL to unregister
+
+  @return EFI_SUCCESS               The event has been registered.
+  @return EFI_UNSUPPORTED           The doorbell interrupt is not available.
+  @return EFI_DEVICE_ERROR          Failed to register the event.
+**/
+EFI_STATUS
+HspDoorbellRegisterNotify (
+  IN  NVIDIA_HSP_DOORBELL_PROTOCOL   *This,
+  IN  HSP_DOORBELL_ID                Doorbell,
+  IN  EFI_EVENT                      Event OPTIONAL
+  )
+{
+  NVIDIA_HSP_DOORBELL_PRIVATE_DATA *PrivateData = NULL;
+  EFI_STATUS                       Status;
+
+  PrivateData = HSP_DOORBELL_PRIVATE_DATA_FROM_THIS (This);
+
+  if (Doorbell >= HspDoorbellMax) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (!PrivateData->DoorbellInterruptValid) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((mHspDoorbellInterruptData != NULL) &&
+      (mHspDoorbellInterruptData != PrivateData)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (PrivateData->InterruptProtocol == NULL) {
+    Status = gBS->LocateProtocol (
+                    &gHardwareInterruptProtocolGuid,
+                    NULL,
+                    (VOID **) &PrivateData->InterruptProtocol
+                    );
+    if (EFI_ERROR (Status)) {
+      PrivateData->InterruptProtocol = NULL;
+      return EFI_UNSUPPORTED;
+    }
+
+    mHspDoorbellInterruptData = PrivateData;
+    Status = PrivateData->InterruptProtocol->RegisterInterruptSource (
+                                               PrivateData->InterruptProtocol,
+                                               PrivateData->DoorbellInterrupt,
+                                               HspDoorbellInterruptHandler
+                                               );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "%a: Failed to register doorbell interrupt: %r\r\n", __FUNCTION__, Status));
+      mHspDoorbellInterruptData = NULL;
+      PrivateData->InterruptProtocol = NULL;
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  PrivateData->NotifyEvent[Doorbell] = Event;
+  return EFI_SUCCESS;
+}
+
+/**
+  Locate the doorbell interrupt of the HSP device tree node.
+
+  @param[in]     Controller          Handle of the HSP device.
+  @param[out]    Interrupt           Doorbell interrupt.
+
+  @return EFI_SUCCESS               The interrupt was found.
+  @return EFI_NOT_FOUND             The node has no doorbell interrupt.
+  @return EFI_UNSUPPORTED           The doorbell interrupt is not a SPI.
+  @return others                    The device tree node is not available.
+**/
+STATIC
+EFI_STATUS
+HspDoorbellGetInterrupt (
+  IN  EFI_HANDLE                     Controller,
+  OUT HARDWARE_INTERRUPT_SOURCE      *Interrupt
+  )
+{
+  EFI_STATUS                       Status;
+  NVIDIA_DEVICE_TREE_NODE_PROTOCOL *Node;
+  CONST UINT32                     *Interrupts;
+  CONST CHAR8                      *InterruptNames;
+  INT32                            InterruptsLength;
+  INT32                            NamesLength;
+  INT32                            Size;
+  UINTN                            Index;
+
+  Status = gBS->HandleProtocol (Controller, &gNVIDIADeviceTreeNodeProtocolGuid, (VOID **)&Node);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Interrupts = (CONST UINT32 *)fdt_getprop (Node->DeviceTreeBase, Node->NodeOffset, "interrupts", &InterruptsLength);
+  InterruptNames = (CONST CHAR8 *)fdt_getprop (Node->DeviceTreeBase, Node->NodeOffset, "interrupt-names", &NamesLength);
+  if ((Interrupts == NULL) || (InterruptNames == NULL)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Index = 0;
+  while (NamesLength > 0) {
+    Size = AsciiStrSize (InterruptNames);
+    if ((Size <= 0) || (Size > NamesLength)) {
+      break;
+    }
+
+    if (0 == AsciiStrnCmp (InterruptNames, "doorbell", Size)) {
+      if (((Index + 1) * HSP_INTERRUPT_CELLS * sizeof (UINT32)) > (UINTN)InterruptsLength) {
+        break;
+      }
+      if (SwapBytes32 (Interrupts[Index * HSP_INTERRUPT_CELLS]) != HSP_INTERRUPT_TYPE_SPI) {
+        return EFI_UNSUPPORTED;
+      }
+      *Interrupt = SwapBytes32 (Interrupts[(Index * HSP_INTERRUPT_CELLS) + 1]) + HSP_INTERRUPT_SPI_OFFSET;
+      return EFI_SUCCESS;
+    }
+    NamesLength -= Size;
+    InterruptNames += Size;
+    Index++;
+  }
+
+  return EFI_NOT_FOUND;
+}
 
 /**
   This routine is called right after the .Supported() called and
@@ -148,6 +319,7 @@ HspDoorbellProtocolStart (
   PrivateData->Signature = HSP_DOORBELL_SIGNATURE;
   PrivateData->DoorbellProtocol.RingDoorbell = HspDoorbellRingDoorbell;
   PrivateData->DoorbellProtocol.EnableChannel = HspDoorbellEnableChannel;
+  PrivateData->DoorbellProtocol.RegisterNotify = HspDoorbellRegisterNotify;
 
   //First resource must be MMIO
   if ((NonDiscoverableProtocol->Resources == NULL) ||
@@ -172,6 +344,10 @@ HspDoorbellProtocolStart (
     HspBase += HSP_DOORBELL_REGION_SIZE;
   }
 
+  //Without the interrupt clients fall back to polling
+  Status = HspDoorbellGetInterrupt (Controller, &PrivateData->DoorbellInterrupt);
+  PrivateData->DoorbellInterruptValid = !EFI_ERROR (Status);
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &Controller,
                   &gNVIDIAHspDoorbellProtocolGuid,
@@ -240,6 +416,15 @@ HspDoorbellProtocolStop (
     return EFI_DEVICE_ERROR;
   }
 
+  if (mHspDoorbellInterruptData == PrivateData) {
+    PrivateData->InterruptProtocol->RegisterInterruptSource (
+                                      PrivateData->InterruptProtocol,
+                                      PrivateData->DoorbellInterrupt,
+                                      NULL
+                                      );
+    mHspDoorbellInterruptData = NULL;
+  }
+
   FreePool (PrivateData);
 
   return EFI_SUCCESS;
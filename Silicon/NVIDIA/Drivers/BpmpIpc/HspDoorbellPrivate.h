@@ -12,6 +12,7 @@
 #define __HSP_DOORBELL_PRIVATE_H__
 
 #include <Protocol/HspDoorbell.h>
+#include <Protocol/HardwareInterrupt.h>
 
 #define HSP_DIMENSIONING    0x380
 
@@ -45,6 +46,10 @@ typedef struct {
   };
 } HSP_DIMENSIONING_DATA;
 
+#define HSP_INTERRUPT_CELLS      3
+#define HSP_INTERRUPT_TYPE_SPI   0
+#define HSP_INTERRUPT_SPI_OFFSET 32
+
 #define HSP_MAILBOX_SHIFT_SIZE   15
 #define HSP_SEMAPHORE_SHIFT_SIZE 16
 
@@ -69,6 +74,18 @@ typedef struct {
   // Array of the doorbell locations
   EFI_PHYSICAL_ADDRESS              DoorbellLocation[HspDoorbellMax];
 
+  //
+  // Doorbell interrupt, valid if DoorbellInterruptValid is TRUE
+  //
+  BOOLEAN                           DoorbellInterruptValid;
+  HARDWARE_INTERRUPT_SOURCE         DoorbellInterrupt;
+  EFI_HARDWARE_INTERRUPT_PROTOCOL   *InterruptProtocol;
+
+  //
+  // Events to signal when the matching remote processor rings the CCPLEX doorbell
+  //
+  EFI_EVENT                         NotifyEvent[HspDoorbellMax];
+
 } NVIDIA_HSP_DOORBELL_PRIVATE_DATA;
 
 #define HSP_DOORBELL_PRIVATE_DATA_FROM_THIS(a) CR(a, NVIDIA_HSP_DOORBELL_PRIVATE_DATA, DoorbellProtocol, HSP_DOORBELL_SIGNATURE)
@@ -12,12 +12,286 @@
 **/
 #include <ConfigurationManagerObject.h>
 
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 
 #include <Protocol/ConfigurationManagerDataProtocol.h>
 #include <Protocol/ConfigurationManagerProtocol.h>
 
+#define REPO_INDEX_EMPTY  MAX_UINT32
+
+/** Index slot for a CmObjectId.
+
+  FirstIndex is the first repository entry with the ID and FirstNullIndex the
+  first entry with the ID and a null CmObjectToken (REPO_INDEX_EMPTY if none).
+*/
+typedef struct {
+  CM_OBJECT_ID      CmObjectId;
+  UINT32            FirstIndex;
+  UINT32            FirstNullIndex;
+} REPO_ID_INDEX_ENTRY;
+
+/** Index slot for a (CmObjectId, CmObjectToken) pair with a non-null token.
+*/
+typedef struct {
+  CM_OBJECT_ID      CmObjectId;
+  CM_OBJECT_TOKEN   CmObjectToken;
+  UINT32            RepoIndex;
+} REPO_TOKEN_INDEX_ENTRY;
+
+STATIC REPO_ID_INDEX_ENTRY     *mRepoIdIndex;
+STATIC REPO_TOKEN_INDEX_ENTRY  *mRepoTokenIndex;
+STATIC UINT32                  mRepoIndexSize;
+STATIC UINT32                  mRepoIndexedCount;
+
+// Index slots and repository entries examined so far, read by the host based
+// unit test to check that lookups stay short
+UINTN                          mRepoLookupVisits;
+
+/** Hash a (CmObjectId, Token) pair into an index of the given size.
+
+  @param [in]  CmObjectId  The Configuration Manager Object ID.
+  @param [in]  Token       The object token.
+  @param [in]  Size        Number of slots in the index, a power of two.
+
+  @return The first slot to probe.
+**/
+STATIC
+UINT32
+RepoIndexHash (
+  IN  CM_OBJECT_ID     CmObjectId,
+  IN  CM_OBJECT_TOKEN  Token,
+  IN  UINT32           Size
+  )
+{
+  UINT64  Hash;
+
+  Hash = ((UINT64)CmObjectId * 0x9E3779B97F4A7C15ULL) ^ (UINT64)Token;
+  Hash ^= Hash >> 29;
+  Hash *= 0xBF58476D1CE4E5B9ULL;
+  Hash ^= Hash >> 32;
+  return (UINT32)Hash & (Size - 1);
+}
+
+/** Find the ID index slot for the given CmObjectId.
+
+  @param [in]  CmObjectId  The Configuration Manager Object ID.
+  @param [in]  Insert      Return the empty slot where the ID belongs if the
+                           ID is not in the index yet.
+
+  @return The slot, or NULL if the ID is not present and Insert is FALSE.
+**/
+STATIC
+REPO_ID_INDEX_ENTRY *
+RepoIdIndexFind (
+  IN  CM_OBJECT_ID  CmObjectId,
+  IN  BOOLEAN       Insert
+  )
+{
+  UINT32               Slot;
+  REPO_ID_INDEX_ENTRY  *Entry;
+
+  Slot = RepoIndexHash (CmObjectId, CM_NULL_TOKEN, mRepoIndexSize);
+  while (TRUE) {
+    mRepoLookupVisits++;
+    Entry = &mRepoIdIndex[Slot];
+    if (Entry->FirstIndex == REPO_INDEX_EMPTY) {
+      return Insert ? Entry : NULL;
+    }
+    if (Entry->CmObjectId == CmObjectId) {
+      return Entry;
+    }
+    Slot = (Slot + 1) & (mRepoIndexSize - 1);
+  }
+}
+
+/** Find the token index slot for the given (CmObjectId, Token) pair.
+
+  @param [in]  CmObjectId  The Configuration Manager Object ID.
+  @param [in]  Token       The non-null object token.
+  @param [in]  Insert      Return the empty slot where the pair belongs if
+                           the pair is not in the index yet.
+
+  @return The slot, or NULL if the pair is not present and Insert is FALSE.
+**/
+STATIC
+REPO_TOKEN_INDEX_ENTRY *
+RepoTokenIndexFind (
+  IN  CM_OBJECT_ID     CmObjectId,
+  IN  CM_OBJECT_TOKEN  Token,
+  IN  BOOLEAN          Insert
+  )
+{
+  UINT32                  Slot;
+  REPO_TOKEN_INDEX_ENTRY  *Entry;
+
+  Slot = RepoIndexHash (CmObjectId, Token, mRepoIndexSize);
+  while (TRUE) {
+    mRepoLookupVisits++;
+    Entry = &mRepoTokenIndex[Slot];
+    if (Entry->RepoIndex == REPO_INDEX_EMPTY) {
+      return Insert ? Entry : NULL;
+    }
+    if ((Entry->CmObjectId == CmObjectId) && (Entry->CmObjectToken == Token)) {
+      return Entry;
+    }
+    Slot = (Slot + 1) & (mRepoIndexSize - 1);
+  }
+}
+
+/** Build the (CmObjectId, Token) index over the platform repository.
+
+  Only the first entry for each ID, the first entry for each ID without a
+  token and the first entry for each (ID, token) pair are recorded, which is
+  all NVIDIAPlatformGetObject needs to return the same entry as a linear scan.
+
+  @param [in]  PlatRepoInfo  The platform repository.
+
+  @retval EFI_SUCCESS           The index was built.
+  @retval EFI_OUT_OF_RESOURCES  The index could not be allocated.
+**/
+STATIC
+EFI_STATUS
+BuildRepositoryIndex (
+  IN  CONST EDKII_PLATFORM_REPOSITORY_INFO  * PlatRepoInfo
+  )
+{
+  UINT32                  Count;
+  UINT32                  Size;
+  UINT32                  Index;
+  REPO_ID_INDEX_ENTRY     *IdEntry;
+  REPO_TOKEN_INDEX_ENTRY  *TokenEntry;
+
+  if (mRepoIdIndex != NULL) {
+    FreePool (mRepoIdIndex);
+    mRepoIdIndex = NULL;
+  }
+  if (mRepoTokenIndex != NULL) {
+    FreePool (mRepoTokenIndex);
+    mRepoTokenIndex = NULL;
+  }
+  mRepoIndexSize = 0;
+  mRepoIndexedCount = 0;
+
+  for (Count = 0; Count < PcdGet32 (PcdConfigMgrObjMax); Count++) {
+    if (PlatRepoInfo[Count].CmObjectPtr == NULL) {
+      break;
+    }
+  }
+
+  // Keep both tables at most a quarter full so the longest probe sequence,
+  // not only the average one, stays short as the repository grows.
+  Size = 16;
+  while (Size < (Count * 4)) {
+    Size *= 2;
+  }
+
+  mRepoIdIndex = AllocatePool (Size * sizeof (REPO_ID_INDEX_ENTRY));
+  mRepoTokenIndex = AllocatePool (Size * sizeof (REPO_TOKEN_INDEX_ENTRY));
+  if ((mRepoIdIndex == NULL) || (mRepoTokenIndex == NULL)) {
+    if (mRepoIdIndex != NULL) {
+      FreePool (mRepoIdIndex);
+      mRepoIdIndex = NULL;
+    }
+    if (mRepoTokenIndex != NULL) {
+      FreePool (mRepoTokenIndex);
+      mRepoTokenIndex = NULL;
+    }
+    return EFI_OUT_OF_RESOURCES;
+  }
+  SetMem (mRepoIdIndex, Size * sizeof (REPO_ID_INDEX_ENTRY), 0xFF);
+  SetMem (mRepoTokenIndex, Size * sizeof (REPO_TOKEN_INDEX_ENTRY), 0xFF);
+  mRepoIndexSize = Size;
+
+  for (Index = 0; Index < Count; Index++) {
+    IdEntry = RepoIdIndexFind (PlatRepoInfo[Index].CmObjectId, TRUE);
+    if (IdEntry->FirstIndex == REPO_INDEX_EMPTY) {
+      IdEntry->CmObjectId = PlatRepoInfo[Index].CmObjectId;
+      IdEntry->FirstIndex = Index;
+    }
+
+    if (PlatRepoInfo[Index].CmObjectToken == CM_NULL_TOKEN) {
+      if (IdEntry->FirstNullIndex == REPO_INDEX_EMPTY) {
+        IdEntry->FirstNullIndex = Index;
+      }
+      continue;
+    }
+
+    TokenEntry = RepoTokenIndexFind (
+                   PlatRepoInfo[Index].CmObjectId,
+                   PlatRepoInfo[Index].CmObjectToken,
+                   TRUE
+                   );
+    if (TokenEntry->RepoIndex == REPO_INDEX_EMPTY) {
+      TokenEntry->CmObjectId = PlatRepoInfo[Index].CmObjectId;
+      TokenEntry->CmObjectToken = PlatRepoInfo[Index].CmObjectToken;
+      TokenEntry->RepoIndex = Index;
+    }
+  }
+
+  mRepoIndexedCount = Count;
+
+  DEBUG ((DEBUG_INFO, "%a: Indexed %u repository entries\n", __FUNCTION__, Count));
+  return EFI_SUCCESS;
+}
+
+/** Find the repository entry for a GetObject request using the index.
+
+  Returns the same entry a front to back scan of the repository would: the
+  first entry with the ID if Token is null (not found if that entry has a
+  token), otherwise the earlier of the first entry with the ID and no token
+  (an array access) and the first entry with the ID and the given token.
+
+  @param [in]  PlatRepoInfo  The platform repository.
+  @param [in]  CmObjectId    The Configuration Manager Object ID.
+  @param [in]  Token         An optional token identifying the object.
+  @param [out] RepoIndex     Index of the matching repository entry.
+
+  @retval EFI_SUCCESS    The entry was found.
+  @retval EFI_NOT_FOUND  No entry matches.
+**/
+STATIC
+EFI_STATUS
+RepositoryIndexLookup (
+  IN  CONST EDKII_PLATFORM_REPOSITORY_INFO  * PlatRepoInfo,
+  IN  CM_OBJECT_ID                            CmObjectId,
+  IN  CM_OBJECT_TOKEN                         Token,
+  OUT UINT32                                * RepoIndex
+  )
+{
+  REPO_ID_INDEX_ENTRY     *IdEntry;
+  REPO_TOKEN_INDEX_ENTRY  *TokenEntry;
+  UINT32                  Found;
+
+  IdEntry = RepoIdIndexFind (CmObjectId, FALSE);
+  if (IdEntry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (Token == CM_NULL_TOKEN) {
+    if (PlatRepoInfo[IdEntry->FirstIndex].CmObjectToken != CM_NULL_TOKEN) {
+      return EFI_NOT_FOUND;
+    }
+    *RepoIndex = IdEntry->FirstIndex;
+    return EFI_SUCCESS;
+  }
+
+  Found = IdEntry->FirstNullIndex;
+  TokenEntry = RepoTokenIndexFind (CmObjectId, Token, FALSE);
+  if ((TokenEntry != NULL) && (TokenEntry->RepoIndex < Found)) {
+    Found = TokenEntry->RepoIndex;
+  }
+
+  if (Found == REPO_INDEX_EMPTY) {
+    return EFI_NOT_FOUND;
+  }
+
+  *RepoIndex = Found;
+  return EFI_SUCCESS;
+}
+
 /** The GetObject function defines the interface implemented by the
     Configuration Manager Protocol for returning the Configuration
     Manager Objects.
@@ -46,6 +320,7 @@ NVIDIAPlatformGetObject (
   UINT32                                   Index;
   UINT32                                   ElemOffset;
   UINT32                                   ElemSize;
+  EFI_STATUS                               Status;
 
   if ((This == NULL) || (CmObject == NULL)) {
     ASSERT (This != NULL);
@@ -56,7 +331,25 @@ NVIDIAPlatformGetObject (
   PlatRepoInfo = This->PlatRepoInfo;
   ASSERT (PlatRepoInfo != NULL);
 
-  for (Index = 0; Index < PcdGet32 (PcdConfigMgrObjMax); Index++) {
+  // Entries appended to the repository after the index was built make the
+  // entry after the last indexed one non-empty, so rebuild the index then.
+  if ((mRepoIdIndex != NULL) &&
+      (mRepoIndexedCount < PcdGet32 (PcdConfigMgrObjMax)) &&
+      (PlatRepoInfo[mRepoIndexedCount].CmObjectPtr != NULL)) {
+    BuildRepositoryIndex (PlatRepoInfo);
+  }
+
+  if (mRepoIdIndex != NULL) {
+    Status = RepositoryIndexLookup (PlatRepoInfo, CmObjectId, Token, &Index);
+    if (EFI_ERROR (Status)) {
+      Index = mRepoIndexedCount;
+    }
+  } else {
+    Index = 0;
+  }
+
+  for (; Index < PcdGet32 (PcdConfigMgrObjMax); Index++) {
+    mRepoLookupVisits++;
     // If CmObjectPtr is NULL, we have reached the end of valid
     // entries, so stop looking.
     if (PlatRepoInfo[Index].CmObjectPtr == NULL) {
@@ -219,6 +512,17 @@ ConfigurationManagerDxeInitialize (
 
   NVIDIAPlatformConfigManagerProtocol.PlatRepoInfo = PlatRepoInfo;
 
+  // GetObject falls back to scanning the repository if there is no index.
+  Status = BuildRepositoryIndex (PlatRepoInfo);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((
+      DEBUG_WARN,
+      "WARNING: Failed to index Configuration Manager repository." \
+      " Status = %r\n",
+      Status
+      ));
+  }
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &ImageHandle,
                   &gEdkiiConfigurationManagerProtocolGuid,
@@ -0,0 +1,584 @@
+/** @file
+  Unit tests of the Configuration Manager driver. Checks that GetObject
+  returns the same objects through the repository index as a front to back
+  scan of the repository does, and that each lookup only examines a few
+  index slots and repository entries.
+
+  Tests are run with a repository sized by PcdConfigMgrObjMax, which the
+  test build sets well above what the platforms use, and a boot services
+  table that only provides protocol lookup and install.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+
+#include <ConfigurationManagerObject.h>
+#include <Protocol/ConfigurationManagerDataProtocol.h>
+#include <Protocol/ConfigurationManagerProtocol.h>
+
+#define UNIT_TEST_APP_NAME     "ConfigurationManagerDxe Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "0.1"
+
+// Entries in the repository, the last one is left empty as the end marker
+#define TEST_REPO_SIZE         PcdGet32 (PcdConfigMgrObjMax)
+#define TEST_REPO_ENTRIES      (TEST_REPO_SIZE - 1)
+
+#define TEST_ELEMENT_SIZE      16
+#define TEST_ELEMENT_COUNT     4
+#define TEST_OBJECT_SIZE       (TEST_ELEMENT_SIZE * TEST_ELEMENT_COUNT)
+
+// Number of pseudo random lookups, about what generating the T234 tables
+// does
+#define TEST_LOOKUP_COUNT      4096
+
+// Index slots and repository entries a single lookup may examine, whatever
+// the size of the repository
+#define TEST_MAX_LOOKUP_VISITS  16
+
+extern UINTN  mRepoLookupVisits;
+
+EFI_STATUS
+EFIAPI
+ConfigurationManagerDxeInitialize (
+  IN EFI_HANDLE          ImageHandle,
+  IN EFI_SYSTEM_TABLE  * SystemTable
+  );
+
+STATIC EFI_BOOT_SERVICES                     mBootServices;
+STATIC EDKII_CONFIGURATION_MANAGER_PROTOCOL  *mConfigManager;
+STATIC EDKII_PLATFORM_REPOSITORY_INFO        *mRepo;
+STATIC UINT8                                 *mObjectData;
+
+/**
+  LocateProtocol boot service used by the driver under test. Returns the
+  test repository as the Configuration Manager data protocol.
+
+  @param[in]  Protocol          Protocol to locate.
+  @param[in]  Registration      Unused.
+  @param[out] Interface         Returned protocol interface.
+
+  @retval EFI_SUCCESS           The test repository was returned.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+) {
+  *Interface = mRepo;
+  return EFI_SUCCESS;
+}
+
+/**
+  InstallMultipleProtocolInterfaces boot service used by the driver under
+  test. Only records the Configuration Manager protocol instance.
+
+  @param[in, out] Handle        Handle to install the protocol on.
+  @param[in]      ...           Protocol GUID and interface pairs.
+
+  @retval EFI_SUCCESS           The protocol was recorded.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubInstallMultipleProtocolInterfaces (
+  IN OUT EFI_HANDLE *Handle,
+  ...
+) {
+  VA_LIST Args;
+
+  VA_START(Args, Handle);
+  VA_ARG(Args, EFI_GUID *);
+  mConfigManager = VA_ARG(Args, EDKII_CONFIGURATION_MANAGER_PROTOCOL *);
+  VA_END(Args);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Reference GetObject that scans the repository from the start, as the
+  driver did before it had an index.
+
+  @param[in]      CmObjectId    The Configuration Manager Object ID.
+  @param[in]      Token         An optional token identifying the object.
+  @param[in, out] CmObject      Returned object descriptor.
+
+  @retval EFI_SUCCESS           Success.
+  @retval EFI_INVALID_PARAMETER Out of bounds or misaligned array access.
+  @retval EFI_NOT_FOUND         The object is not in the repository.
+**/
+STATIC
+EFI_STATUS
+LinearScanGetObject (
+  IN     CM_OBJECT_ID       CmObjectId,
+  IN     CM_OBJECT_TOKEN    Token,
+  IN OUT CM_OBJ_DESCRIPTOR  *CmObject
+) {
+  UINT32  Index;
+  UINT32  ElemOffset;
+  UINT32  ElemSize;
+
+  for (Index = 0; Index < TEST_REPO_SIZE; Index++) {
+    if (mRepo[Index].CmObjectPtr == NULL) {
+      break;
+    }
+    if (mRepo[Index].CmObjectId != CmObjectId) {
+      continue;
+    }
+    if (mRepo[Index].CmObjectToken != CM_NULL_TOKEN) {
+      if (Token == CM_NULL_TOKEN) {
+        break;
+      } else if (Token != mRepo[Index].CmObjectToken) {
+        continue;
+      }
+    }
+
+    CmObject->ObjectId = CmObjectId;
+    CmObject->Data = mRepo[Index].CmObjectPtr;
+    CmObject->Size = mRepo[Index].CmObjectSize;
+    CmObject->Count = mRepo[Index].CmObjectCount;
+
+    if (mRepo[Index].CmObjectToken == CM_NULL_TOKEN && Token != CM_NULL_TOKEN) {
+      ElemOffset = Token - (CM_OBJECT_TOKEN)CmObject->Data;
+      ElemSize = CmObject->Size / CmObject->Count;
+      if (!(ElemOffset < CmObject->Size) || (ElemOffset % ElemSize != 0)) {
+        return EFI_INVALID_PARAMETER;
+      }
+      CmObject->Data = (UINT8*)CmObject->Data + ElemOffset;
+      CmObject->Size = ElemSize;
+      CmObject->Count = 1;
+    }
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Look up an object through the driver and through the reference scan and
+  check that both return the same result, and that the driver did not
+  examine more than TEST_MAX_LOOKUP_VISITS index slots and entries.
+
+  @param[in]  CmObjectId        The Configuration Manager Object ID.
+  @param[in]  Token             An optional token identifying the object.
+
+  @retval UNIT_TEST_PASSED      Both lookups returned the same result.
+  @retval others                The lookups did not match or the driver
+                                lookup was too long.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckLookup (
+  IN CM_OBJECT_ID     CmObjectId,
+  IN CM_OBJECT_TOKEN  Token
+) {
+  EFI_STATUS         Status;
+  EFI_STATUS         ExpectedStatus;
+  CM_OBJ_DESCRIPTOR  CmObject;
+  CM_OBJ_DESCRIPTOR  Expected;
+
+  ZeroMem(&CmObject, sizeof (CmObject));
+  ZeroMem(&Expected, sizeof (Expected));
+
+  mRepoLookupVisits = 0;
+  Status = mConfigManager->GetObject(mConfigManager, CmObjectId, Token, &CmObject);
+  UT_ASSERT_TRUE(mRepoLookupVisits <= TEST_MAX_LOOKUP_VISITS);
+
+  ExpectedStatus = LinearScanGetObject(CmObjectId, Token, &Expected);
+
+  UT_ASSERT_STATUS_EQUAL(Status, ExpectedStatus);
+  if (!EFI_ERROR(Status)) {
+    UT_ASSERT_EQUAL(CmObject.ObjectId, Expected.ObjectId);
+    UT_ASSERT_EQUAL((UINTN)CmObject.Data, (UINTN)Expected.Data);
+    UT_ASSERT_EQUAL(CmObject.Size, Expected.Size);
+    UT_ASSERT_EQUAL(CmObject.Count, Expected.Count);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Look up every object of the repository by ID, by its own token, by the
+  token of each array element, and with tokens and IDs that do not match
+  anything.
+
+  @param[in]  Context           Unused.
+
+  @retval UNIT_TEST_PASSED      Test passed.
+  @retval others                Test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+IndexMatchesScanTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINT32            Index;
+  UINT32            Element;
+  CM_OBJECT_ID      CmObjectId;
+  CM_OBJECT_TOKEN   Data;
+  UNIT_TEST_STATUS  TestStatus;
+
+  for (Index = 0; Index < TEST_REPO_ENTRIES; Index++) {
+    CmObjectId = mRepo[Index].CmObjectId;
+    Data = (CM_OBJECT_TOKEN)mRepo[Index].CmObjectPtr;
+
+    TestStatus = CheckLookup(CmObjectId, CM_NULL_TOKEN);
+    if (TestStatus != UNIT_TEST_PASSED) {
+      return TestStatus;
+    }
+
+    if (mRepo[Index].CmObjectToken != CM_NULL_TOKEN) {
+      TestStatus = CheckLookup(CmObjectId, mRepo[Index].CmObjectToken);
+      if (TestStatus != UNIT_TEST_PASSED) {
+        return TestStatus;
+      }
+    }
+
+    // Array accesses, including one past the end and a misaligned one
+    for (Element = 0; Element <= TEST_ELEMENT_COUNT; Element++) {
+      TestStatus = CheckLookup(CmObjectId, Data + (Element * TEST_ELEMENT_SIZE));
+      if (TestStatus != UNIT_TEST_PASSED) {
+        return TestStatus;
+      }
+    }
+    TestStatus = CheckLookup(CmObjectId, Data + 1);
+    if (TestStatus != UNIT_TEST_PASSED) {
+      return TestStatus;
+    }
+
+    // ID that is not in the repository
+    TestStatus = CheckLookup(CmObjectId + 0x1000, mRepo[Index].CmObjectToken);
+    if (TestStatus != UNIT_TEST_PASSED) {
+      return TestStatus;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Run a stream of pseudo random lookups over the IDs and tokens of the
+  repository, as the table generators do.
+
+  @param[in]  Context           Unused.
+
+  @retval UNIT_TEST_PASSED      Test passed.
+  @retval others                Test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+RandomLookupTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINT32            Seed;
+  UINT32            Lookup;
+  UINT32            Index;
+  UINT32            Other;
+  CM_OBJECT_TOKEN   Token;
+  UNIT_TEST_STATUS  TestStatus;
+
+  Seed = 0x12345678;
+  for (Lookup = 0; Lookup < TEST_LOOKUP_COUNT; Lookup++) {
+    Seed = (Seed * 1103515245) + 12345;
+    Index = (Seed >> 8) % TEST_REPO_ENTRIES;
+    Other = (Seed >> 20) % TEST_REPO_ENTRIES;
+
+    // Mix null tokens, own tokens and tokens of other entries
+    switch (Seed & 0x3) {
+      case 0:
+        Token = CM_NULL_TOKEN;
+        break;
+      case 1:
+        Token = mRepo[Index].CmObjectToken;
+        break;
+      case 2:
+        Token = mRepo[Other].CmObjectToken;
+        break;
+      default:
+        Token = (CM_OBJECT_TOKEN)mRepo[Other].CmObjectPtr;
+        break;
+    }
+
+    TestStatus = CheckLookup(mRepo[Index].CmObjectId, Token);
+    if (TestStatus != UNIT_TEST_PASSED) {
+      return TestStatus;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that an entry added to the repository after the index was built is
+  found.
+
+  @param[in]  Context           Unused.
+
+  @retval UNIT_TEST_PASSED      Test passed.
+  @retval others                Test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+AppendedEntryTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EDKII_PLATFORM_REPOSITORY_INFO  *Entry;
+  CM_OBJ_DESCRIPTOR               CmObject;
+  UNIT_TEST_STATUS                TestStatus;
+
+  Entry = &mRepo[TEST_REPO_ENTRIES];
+  Entry->CmObjectId = CREATE_CM_OEM_OBJECT_ID (0x7F);
+  Entry->CmObjectToken = REFERENCE_TOKEN (mRepo[0]);
+  Entry->CmObjectSize = TEST_OBJECT_SIZE;
+  Entry->CmObjectCount = TEST_ELEMENT_COUNT;
+  Entry->CmObjectPtr = mObjectData;
+
+  // The first lookup after the append rebuilds the index, so it is not
+  // bounded; the ones after it are.
+  mConfigManager->GetObject(mConfigManager, Entry->CmObjectId, Entry->CmObjectToken, &CmObject);
+
+  TestStatus = CheckLookup(Entry->CmObjectId, Entry->CmObjectToken);
+  ZeroMem(Entry, sizeof (*Entry));
+
+  return TestStatus;
+}
+
+/**
+  Fill in the repository. It holds, in this order:
+   - arrays without a token, one per ID
+   - objects of a single ID, each with its own token
+   - an ID whose first entry has a token and a later one does not
+   - an ID whose first entry has no token and later ones have one
+   - a token used twice for the same ID
+   - an object with a token that is also the token of another ID
+   - OEM objects that share a token, then once the OEM IDs run out and
+     repeat, OEM objects with their own tokens
+
+  @retval EFI_SUCCESS           Test data initialized.
+  @retval EFI_OUT_OF_RESOURCES  Not enough memory for the test data.
+**/
+STATIC
+EFI_STATUS
+InitTestData (
+  VOID
+) {
+  EFI_STATUS  Status;
+  UINT32      Index;
+  UINT32      Entry;
+
+  mRepo = AllocateZeroPool(TEST_REPO_SIZE * sizeof (EDKII_PLATFORM_REPOSITORY_INFO));
+  mObjectData = AllocateZeroPool(TEST_REPO_SIZE * TEST_OBJECT_SIZE);
+  if (mRepo == NULL || mObjectData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < TEST_REPO_ENTRIES; Index++) {
+    mRepo[Index].CmObjectSize = TEST_OBJECT_SIZE;
+    mRepo[Index].CmObjectCount = TEST_ELEMENT_COUNT;
+    mRepo[Index].CmObjectPtr = mObjectData + (Index * TEST_OBJECT_SIZE);
+  }
+
+  Entry = 0;
+  for (Index = 0; Index < 12; Index++, Entry++) {
+    mRepo[Entry].CmObjectId = CREATE_CM_ARM_OBJECT_ID (EArmObjBootArchInfo + Index);
+    mRepo[Entry].CmObjectToken = CM_NULL_TOKEN;
+  }
+
+  for (Index = 0; Index < 12; Index++, Entry++) {
+    mRepo[Entry].CmObjectId = CREATE_CM_ARM_OBJECT_ID (EArmObjCmRef);
+    mRepo[Entry].CmObjectToken = REFERENCE_TOKEN (mRepo[Entry]);
+  }
+
+  mRepo[Entry].CmObjectId = CREATE_CM_ARM_OBJECT_ID (EArmObjGicItsIdentifierArray);
+  mRepo[Entry].CmObjectToken = REFERENCE_TOKEN (mRepo[Entry]);
+  Entry++;
+  mRepo[Entry].CmObjectId = CREATE_CM_ARM_OBJECT_ID (EArmObjGicItsIdentifierArray);
+  mRepo[Entry].CmObjectToken = CM_NULL_TOKEN;
+  Entry++;
+
+  mRepo[Entry].CmObjectId = CREATE_CM_ARM_OBJECT_ID (EArmObjIdMappingArray);
+  mRepo[Entry].CmObjectToken = CM_NULL_TOKEN;
+  Entry++;
+  for (Index = 0; Index < 4; Index++, Entry++) {
+    mRepo[Entry].CmObjectId = CREATE_CM_ARM_OBJECT_ID (EArmObjIdMappingArray);
+    mRepo[Entry].CmObjectToken = REFERENCE_TOKEN (mRepo[Entry]);
+  }
+
+  for (Index = 0; Index < 2; Index++, Entry++) {
+    mRepo[Entry].CmObjectId = CREATE_CM_ARM_OBJECT_ID (EArmObjSmmuInterruptArray);
+    mRepo[Entry].CmObjectToken = REFERENCE_TOKEN (mObjectData[0]);
+  }
+
+  // Remaining entries share the token of the first EArmObjCmRef entry until
+  // the 8 bit OEM object IDs wrap, after that each has its own token so every
+  // entry can still be reached
+  for (; Entry < TEST_REPO_ENTRIES; Entry++) {
+    mRepo[Entry].CmObjectId = CREATE_CM_OEM_OBJECT_ID (Entry);
+    if (Entry <= MAX_UINT8) {
+      mRepo[Entry].CmObjectToken = REFERENCE_TOKEN (mRepo[12]);
+    } else {
+      mRepo[Entry].CmObjectToken = REFERENCE_TOKEN (mRepo[Entry]);
+    }
+  }
+
+  mBootServices.LocateProtocol = StubLocateProtocol;
+  mBootServices.InstallMultipleProtocolInterfaces = StubInstallMultipleProtocolInterfaces;
+  gBS = &mBootServices;
+
+  Status = ConfigurationManagerDxeInitialize(NULL, NULL);
+  if (EFI_ERROR(Status) || mConfigManager == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Clean up test data.
+**/
+STATIC
+VOID
+CleanUpTestData (
+  VOID
+) {
+  if (mRepo != NULL) {
+    FreePool(mRepo);
+  }
+
+  if (mObjectData != NULL) {
+    FreePool(mObjectData);
+  }
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  ConfigurationManagerDxe driver and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+) {
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      GetObjectTestSuite;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitTestData();
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed to initialize test data. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Start setting up the test framework for running the tests.
+  Status = InitUnitTestFramework(
+    &Fw,
+    UNIT_TEST_APP_NAME,
+    gEfiCallerBaseName,
+    UNIT_TEST_APP_VERSION
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in InitUnitTestFramework. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Populate the GetObject Unit Test Suite.
+  Status = CreateUnitTestSuite(
+    &GetObjectTestSuite,
+    Fw,
+    "GetObject Tests",
+    "ConfigurationManagerDxe.GetObjectTestSuite",
+    NULL,
+    NULL
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in CreateUnitTestSuite for GetObjectTestSuite\n")
+    );
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // AddTestCase Args:
+  //  Suite | Description
+  //  Class Name | Function
+  //  Pre | Post | Context
+  AddTestCase(GetObjectTestSuite, "Index Matches Scan Test",
+              "IndexMatchesScanTest", IndexMatchesScanTest,
+              NULL, NULL, NULL);
+  AddTestCase(GetObjectTestSuite, "Random Lookup Test",
+              "RandomLookupTest", RandomLookupTest,
+              NULL, NULL, NULL);
+  AddTestCase(GetObjectTestSuite, "Appended Entry Test",
+              "AppendedEntryTest", AppendedEntryTest,
+              NULL, NULL, NULL);
+
+  // Execute the tests.
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  CleanUpTestData();
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based
+  unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+BaseLibUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+) {
+  return UnitTestingEntry();
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+) {
+  return UnitTestingEntry ();
+}
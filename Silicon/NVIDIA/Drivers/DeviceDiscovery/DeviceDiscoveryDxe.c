@@ -17,10 +17,12 @@
 #include <Library/IoLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/TimerLib.h>
 #include <Library/DtPlatformDtbLoaderLib.h>
 #include <libfdt.h>
 #include <Library/DxeServicesTableLib.h>
 #include <Library/DeviceDiscoveryInternalLib.h>
+#include <Library/FnvHashLib.h>
 #include <Protocol/NonDiscoverableDevice.h>
 #include <Protocol/DeviceTreeCompatibility.h>
 #include <Protocol/ClockNodeProtocol.h>
@@ -465,6 +467,66 @@ BpmpProcessResetCommand (
   return Status;
 }
 
+/**
+  This function processes a reset command for all resets of a node, the
+  commands are sent to BPMP as a single batch.
+
+  @param[in]     BpmpIpcProtocol     The instance of the NVIDIA_BPMP_IPC_PROTOCOL.
+  @param[in]     ResetNode           Reset node to process
+  @param[in]     Command             Reset command
+
+  @return EFI_SUCCESS                All resets processed.
+  @return EFI_OUT_OF_RESOURCES       Failed to allocate the batch
+  @return EFI_DEVICE_ERROR           Failed to process all resets
+**/
+EFI_STATUS
+BpmpProcessResetCommands (
+  IN NVIDIA_BPMP_IPC_PROTOCOL   *BpmpIpcProtocol,
+  IN NVIDIA_RESET_NODE_PROTOCOL *ResetNode,
+  IN MRQ_RESET_COMMANDS         Command
+  )
+{
+  EFI_STATUS                  Status;
+  UINT32                      (*Requests)[2];
+  NVIDIA_BPMP_IPC_BATCH_ENTRY *Entries;
+  UINTN                       Index;
+
+  if (BpmpIpcProtocol == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Requests = AllocatePool (ResetNode->Resets * sizeof (*Requests));
+  Entries = AllocateZeroPool (ResetNode->Resets * sizeof (NVIDIA_BPMP_IPC_BATCH_ENTRY));
+  if ((Requests == NULL) || (Entries == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
+  for (Index = 0; Index < ResetNode->Resets; Index++) {
+    Requests[Index][0] = (UINT32)Command;
+    Requests[Index][1] = ResetNode->ResetEntries[Index].ResetId;
+    Entries[Index].MessageRequest = MRQ_RESET;
+    Entries[Index].TxData = (VOID *)Requests[Index];
+    Entries[Index].TxDataSize = sizeof (Requests[Index]);
+  }
+
+  Status = BpmpIpcProtocol->CommunicateBatch (BpmpIpcProtocol, Entries, ResetNode->Resets);
+  if (Status == EFI_UNSUPPORTED) {
+    Status = EFI_SUCCESS;
+  } else if (EFI_ERROR (Status)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+ErrorExit:
+  if (Requests != NULL) {
+    FreePool (Requests);
+  }
+  if (Entries != NULL) {
+    FreePool (Entries);
+  }
+  return Status;
+}
+
 /**
   This function allows for deassert of all reset nodes.
 
@@ -481,7 +543,6 @@ DeassertAllResetNodes (
 {
   NVIDIA_BPMP_IPC_PROTOCOL *BpmpIpcProtocol = NULL;
   EFI_STATUS               Status;
-  UINTN                    Index;
 
   if (This->Resets == 0) {
     return EFI_SUCCESS;
@@ -492,13 +553,7 @@ DeassertAllResetNodes (
     return EFI_NOT_READY;
   }
 
-  for (Index = 0; Index < This->Resets; Index++) {
-    Status = BpmpProcessResetCommand (BpmpIpcProtocol, This->ResetEntries[Index].ResetId, CmdResetDeassert);
-    if (EFI_ERROR (Status)) {
-      return EFI_DEVICE_ERROR;
-    }
-  }
-  return EFI_SUCCESS;
+  return BpmpProcessResetCommands (BpmpIpcProtocol, This, CmdResetDeassert);
 }
 
 /**
@@ -517,7 +572,6 @@ AssertAllResetNodes (
 {
   NVIDIA_BPMP_IPC_PROTOCOL *BpmpIpcProtocol = NULL;
   EFI_STATUS               Status;
-  UINTN                    Index;
 
   if (This->Resets == 0) {
     return EFI_SUCCESS;
@@ -528,13 +582,7 @@ AssertAllResetNodes (
     return EFI_NOT_READY;
   }
 
-  for (Index = 0; Index < This->Resets; Index++) {
-    Status = BpmpProcessResetCommand (BpmpIpcProtocol, This->ResetEntries[Index].ResetId, CmdResetAssert);
-    if (EFI_ERROR (Status)) {
-      return EFI_DEVICE_ERROR;
-    }
-  }
-  return EFI_SUCCESS;
+  return BpmpProcessResetCommands (BpmpIpcProtocol, This, CmdResetAssert);
 }
 
 /**
@@ -553,7 +601,6 @@ ModuleResetAllResetNodes (
 {
   NVIDIA_BPMP_IPC_PROTOCOL *BpmpIpcProtocol = NULL;
   EFI_STATUS               Status;
-  UINTN                    Index;
 
   if (This->Resets == 0) {
     return EFI_SUCCESS;
@@ -564,13 +611,7 @@ ModuleResetAllResetNodes (
     return EFI_NOT_READY;
   }
 
-  for (Index = 0; Index < This->Resets; Index++) {
-    Status = BpmpProcessResetCommand (BpmpIpcProtocol, This->ResetEntries[Index].ResetId, CmdResetModule);
-    if (EFI_ERROR (Status)) {
-      return EFI_DEVICE_ERROR;
-    }
-  }
-  return EFI_SUCCESS;
+  return BpmpProcessResetCommands (BpmpIpcProtocol, This, CmdResetModule);
 }
 
 /**
@@ -760,6 +801,66 @@ GetResetNodeProtocol(
   ResetNodeProtocol[ListEntry] = &gNVIDIAResetNodeProtocolGuid;
 }
 
+/**
+  This function queries the enable state of all clocks of a node, the
+  queries are sent to BPMP as a single batch.
+
+  @param[in]     This                The instance of the NVIDIA_CLOCK_NODE_PROTOCOL.
+  @param[out]    ClockEnabled        Array of Clocks entries for the clock states
+
+  @return EFI_SUCCESS                Clock states returned.
+  @return EFI_UNSUPPORTED            BPMP-IPC protocol is not available.
+  @return EFI_OUT_OF_RESOURCES       Failed to allocate the batch
+  @return EFI_DEVICE_ERROR           Failed to get all clock states
+**/
+EFI_STATUS
+BpmpGetClockStates (
+  IN  NVIDIA_CLOCK_NODE_PROTOCOL   *This,
+  OUT UINT32                       *ClockEnabled
+  )
+{
+  NVIDIA_BPMP_IPC_PROTOCOL    *BpmpIpcProtocol = NULL;
+  EFI_STATUS                  Status;
+  UINT32                      *Requests;
+  NVIDIA_BPMP_IPC_BATCH_ENTRY *Entries;
+  UINTN                       Index;
+
+  Status = gBS->LocateProtocol (&gNVIDIABpmpIpcProtocolGuid, NULL, (VOID **)&BpmpIpcProtocol);
+  if (EFI_ERROR (Status)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Requests = AllocatePool (This->Clocks * sizeof (UINT32));
+  Entries = AllocateZeroPool (This->Clocks * sizeof (NVIDIA_BPMP_IPC_BATCH_ENTRY));
+  if ((Requests == NULL) || (Entries == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
+  for (Index = 0; Index < This->Clocks; Index++) {
+    Requests[Index] = MRQ_CLK_REQUEST (This->ClockEntries[Index].ClockId, CmdClkIsEnabled);
+    Entries[Index].MessageRequest = MRQ_CLK;
+    Entries[Index].TxData = (VOID *)&Requests[Index];
+    Entries[Index].TxDataSize = sizeof (UINT32);
+    Entries[Index].RxData = (VOID *)&ClockEnabled[Index];
+    Entries[Index].RxDataSize = sizeof (UINT32);
+  }
+
+  Status = BpmpIpcProtocol->CommunicateBatch (BpmpIpcProtocol, Entries, This->Clocks);
+  if ((Status != EFI_UNSUPPORTED) && EFI_ERROR (Status)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+ErrorExit:
+  if (Requests != NULL) {
+    FreePool (Requests);
+  }
+  if (Entries != NULL) {
+    FreePool (Entries);
+  }
+  return Status;
+}
+
 /**
   This function allows for simple enablement of all clock nodes.
 
@@ -780,6 +881,7 @@ EnableAllClockNodes (
   UINT32                        ClockId;
   BOOLEAN                       ClockStatus;
   CHAR8                         ClockName[SCMI_MAX_STR_LEN];
+  UINT32                        *ClockEnabled;
 
   if (This->Clocks == 0) {
     return EFI_SUCCESS;
@@ -790,21 +892,50 @@ EnableAllClockNodes (
     return EFI_NOT_READY;
   }
 
+  //
+  // Query all clock states in one batch, enabling still goes through the
+  // clock protocol so parent clocks are handled.
+  //
+  ClockEnabled = AllocatePool (This->Clocks * sizeof (UINT32));
+  if (ClockEnabled == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = BpmpGetClockStates (This, ClockEnabled);
+  if (Status == EFI_UNSUPPORTED) {
+    FreePool (ClockEnabled);
+    ClockEnabled = NULL;
+  } else if (EFI_ERROR (Status)) {
+    Status = EFI_DEVICE_ERROR;
+    goto ErrorExit;
+  }
+
   for (Index = 0; Index < This->Clocks; Index++) {
     ClockId = This->ClockEntries[This->Clocks - Index - 1].ClockId;
-    Status = ClockProtocol->GetClockAttributes (ClockProtocol, ClockId, &ClockStatus, ClockName);
-    if (EFI_ERROR (Status)) {
-      return EFI_DEVICE_ERROR;
+    if (ClockEnabled != NULL) {
+      ClockStatus = (ClockEnabled[This->Clocks - Index - 1] != 0);
+    } else {
+      Status = ClockProtocol->GetClockAttributes (ClockProtocol, ClockId, &ClockStatus, ClockName);
+      if (EFI_ERROR (Status)) {
+        Status = EFI_DEVICE_ERROR;
+        goto ErrorExit;
+      }
     }
     if (!ClockStatus) {
       Status = ClockProtocol->Enable (ClockProtocol, ClockId, TRUE);
       if (EFI_ERROR (Status)) {
-        return EFI_DEVICE_ERROR;
+        Status = EFI_DEVICE_ERROR;
+        goto ErrorExit;
       }
     }
   }
 
-  return EFI_SUCCESS;
+  Status = EFI_SUCCESS;
+
+ErrorExit:
+  if (ClockEnabled != NULL) {
+    FreePool (ClockEnabled);
+  }
+  return Status;
 }
 
 /**
@@ -1048,6 +1179,106 @@ DeassertPgNodes (
   return EFI_SUCCESS;
 }
 
+/**
+  This function allows for deassert of all power gate nodes. The state of
+  all power gates is queried in one batch and the ones that are off are
+  turned on in a second batch.
+
+  @param[in]     This                The instance of the NVIDIA_POWER_GATE_NODE_PROTOCOL.
+
+  @return EFI_SUCCESS                All power gates deasserted.
+  @return EFI_NOT_READY              BPMP-IPC protocol is not installed.
+  @return EFI_OUT_OF_RESOURCES       Failed to allocate the batch
+  @return EFI_DEVICE_ERROR           Failed to deassert all power gates
+**/
+EFI_STATUS
+DeassertAllPgNodes (
+  IN  NVIDIA_POWER_GATE_NODE_PROTOCOL   *This
+  )
+{
+  NVIDIA_BPMP_IPC_PROTOCOL    *BpmpIpcProtocol = NULL;
+  EFI_STATUS                  Status;
+  MRQ_PG_COMMAND_PACKET       *Requests;
+  UINT32                      *PowerGateState;
+  NVIDIA_BPMP_IPC_BATCH_ENTRY *Entries;
+  UINTN                       Index;
+  UINTN                       Count;
+  UINTN                       OffCount;
+
+  if (This->NumberOfPowerGates == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = gBS->LocateProtocol (&gNVIDIABpmpIpcProtocolGuid, NULL, (VOID **)&BpmpIpcProtocol);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_READY;
+  }
+
+  Requests = AllocatePool (This->NumberOfPowerGates * sizeof (MRQ_PG_COMMAND_PACKET));
+  PowerGateState = AllocatePool (This->NumberOfPowerGates * sizeof (UINT32));
+  Entries = AllocateZeroPool (This->NumberOfPowerGates * sizeof (NVIDIA_BPMP_IPC_BATCH_ENTRY));
+  if ((Requests == NULL) || (PowerGateState == NULL) || (Entries == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
+  Count = 0;
+  for (Index = 0; Index < This->NumberOfPowerGates; Index++) {
+    if (This->PowerGateId[Index] == MAX_UINT32) {
+      continue;
+    }
+    Requests[Count].Command = CmdPgGetState;
+    Requests[Count].PgId = This->PowerGateId[Index];
+    Requests[Count].Argument = MAX_UINT32;
+    Entries[Count].MessageRequest = MRQ_PG;
+    Entries[Count].TxData = (VOID *)&Requests[Count];
+    Entries[Count].TxDataSize = sizeof (MRQ_PG_COMMAND_PACKET);
+    Entries[Count].RxData = (VOID *)&PowerGateState[Count];
+    Entries[Count].RxDataSize = sizeof (UINT32);
+    Count++;
+  }
+
+  Status = BpmpIpcProtocol->CommunicateBatch (BpmpIpcProtocol, Entries, Count);
+  if (Status == EFI_UNSUPPORTED) {
+    Status = EFI_SUCCESS;
+    goto ErrorExit;
+  } else if (EFI_ERROR (Status)) {
+    Status = EFI_DEVICE_ERROR;
+    goto ErrorExit;
+  }
+
+  //Reuse the leading requests to turn on the power gates that are off
+  OffCount = 0;
+  for (Index = 0; Index < Count; Index++) {
+    if (PowerGateState[Index] != CmdPgStateOff) {
+      continue;
+    }
+    Requests[OffCount].Command = CmdPgSetState;
+    Requests[OffCount].PgId = Requests[Index].PgId;
+    Requests[OffCount].Argument = CmdPgStateOn;
+    Entries[OffCount].RxData = NULL;
+    Entries[OffCount].RxDataSize = 0;
+    OffCount++;
+  }
+
+  Status = BpmpIpcProtocol->CommunicateBatch (BpmpIpcProtocol, Entries, OffCount);
+  if (EFI_ERROR (Status)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+ErrorExit:
+  if (Requests != NULL) {
+    FreePool (Requests);
+  }
+  if (PowerGateState != NULL) {
+    FreePool (PowerGateState);
+  }
+  if (Entries != NULL) {
+    FreePool (Entries);
+  }
+  return Status;
+}
+
 /**
   This function allows for assert of specified power gate nodes.
 
@@ -1155,6 +1386,7 @@ GetPowerGateNodeProtocol(
   PgNode->Deassert    = DeassertPgNodes;
   PgNode->Assert      = AssertPgNodes;
   PgNode->GetState    = GetStatePgNodes;
+  PgNode->DeassertAll = DeassertAllPgNodes;
   PgNode->NumberOfPowerGates = NumberOfPgs;
   for (Index = 0; Index < PgNode->NumberOfPowerGates; Index++) {
     PgNode->PowerGateId[Index] = SwapBytes32 (PgIds[(Index *2) + 1]);
@@ -1413,6 +1645,320 @@ ErrorExit:
   return Status;
 }
 
+/**
+  Frees the compatible string to node index of the device tree.
+
+  @param[in]  Private               Pointer to the private device discovery data structure.
+
+**/
+STATIC
+VOID
+FreeCompatibleIndex (
+  IN  DEVICE_DISCOVERY_PRIVATE *Private
+  )
+{
+  if (Private->Nodes != NULL) {
+    FreePool (Private->Nodes);
+    Private->Nodes = NULL;
+  }
+  if (Private->CompatibleEntries != NULL) {
+    FreePool (Private->CompatibleEntries);
+    Private->CompatibleEntries = NULL;
+  }
+  if (Private->CompatibleBuckets != NULL) {
+    FreePool (Private->CompatibleBuckets);
+    Private->CompatibleBuckets = NULL;
+  }
+  Private->NodeCount = 0;
+}
+
+/**
+  Builds the compatible string to node index of the device tree.
+
+  The device tree is walked twice, once to size the index and once to fill it.
+  Each node gets an index in device tree order and every string of its
+  compatible property is hashed into a chained table.
+
+  @param[in]  Private               Pointer to the private device discovery data structure.
+
+  @return EFI_SUCCESS               Index built.
+  @return EFI_OUT_OF_RESOURCES      Index could not be allocated.
+
+**/
+STATIC
+EFI_STATUS
+BuildCompatibleIndex (
+  IN  DEVICE_DISCOVERY_PRIVATE *Private
+  )
+{
+  INT32                             NodeOffset;
+  UINTN                             NodeIndex;
+  UINTN                             EntryCount;
+  UINTN                             BucketCount;
+  UINTN                             Pass;
+  CONST CHAR8                       *Property;
+  INT32                             PropertySize;
+  UINTN                             Size;
+  DEVICE_DISCOVERY_COMPATIBLE_ENTRY *Entry;
+
+  Private->IndexTotalSize   = fdt_totalsize (Private->DeviceTreeBase);
+  Private->IndexStructSize  = fdt_size_dt_struct (Private->DeviceTreeBase);
+  Private->IndexStringsSize = fdt_size_dt_strings (Private->DeviceTreeBase);
+
+  EntryCount = 0;
+  NodeIndex = 0;
+  for (Pass = 0; Pass < 2; Pass++) {
+    if (Pass == 1) {
+      BucketCount = DEVICE_DISCOVERY_MIN_INDEX_BUCKETS;
+      while (BucketCount < EntryCount) {
+        BucketCount <<= 1;
+      }
+
+      Private->Nodes = AllocatePool (NodeIndex * sizeof (INT32));
+      Private->CompatibleEntries = AllocatePool (MAX (EntryCount, 1) * sizeof (DEVICE_DISCOVERY_COMPATIBLE_ENTRY));
+      Private->CompatibleBuckets = AllocatePool (BucketCount * sizeof (UINT32));
+      if ((Private->Nodes == NULL) ||
+          (Private->CompatibleEntries == NULL) ||
+          (Private->CompatibleBuckets == NULL)) {
+        FreeCompatibleIndex (Private);
+        return EFI_OUT_OF_RESOURCES;
+      }
+      SetMem (Private->CompatibleBuckets, BucketCount * sizeof (UINT32), 0xFF);
+      Private->CompatibleBucketMask = BucketCount - 1;
+      Private->NodeCount = NodeIndex;
+      EntryCount = 0;
+      NodeIndex = 0;
+    }
+
+    for (NodeOffset = fdt_next_node (Private->DeviceTreeBase, 0, NULL);
+         NodeOffset > 0;
+         NodeOffset = fdt_next_node (Private->DeviceTreeBase, NodeOffset, NULL)) {
+      Property = fdt_getprop (Private->DeviceTreeBase,
+                              NodeOffset,
+                              "compatible",
+                              &PropertySize);
+      while ((Property != NULL) && (PropertySize > 0)) {
+        Size = AsciiStrnLenS (Property, PropertySize) + 1;
+        if (Size > (UINTN)PropertySize) {
+          break;
+        }
+        if (Pass == 1) {
+          Entry = &Private->CompatibleEntries[EntryCount];
+          Entry->Hash = CalculateFnv1aHash32 (Property);
+          Entry->NodeIndex = NodeIndex;
+          Entry->Compatible = Property;
+          Entry->Next = Private->CompatibleBuckets[Entry->Hash & Private->CompatibleBucketMask];
+          Private->CompatibleBuckets[Entry->Hash & Private->CompatibleBucketMask] = EntryCount;
+        }
+        EntryCount++;
+        Property += Size;
+        PropertySize -= Size;
+      }
+
+      if (Pass == 1) {
+        Private->Nodes[NodeIndex] = NodeOffset;
+      }
+      NodeIndex++;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Rebuilds the compatible string to node index if the device tree changed
+  since it was built.
+
+  The index holds node offsets, which fixups and overlays applied to the
+  device tree move. Such changes alter the size of the device tree structure
+  or strings block.
+
+  @param[in]  Private               Pointer to the private device discovery data structure.
+
+**/
+STATIC
+VOID
+RefreshCompatibleIndex (
+  IN  DEVICE_DISCOVERY_PRIVATE *Private
+  )
+{
+  if ((Private->CompatibleEntries == NULL) ||
+      ((Private->IndexTotalSize == fdt_totalsize (Private->DeviceTreeBase)) &&
+       (Private->IndexStructSize == fdt_size_dt_struct (Private->DeviceTreeBase)) &&
+       (Private->IndexStringsSize == fdt_size_dt_strings (Private->DeviceTreeBase)))) {
+    return;
+  }
+
+  FreeCompatibleIndex (Private);
+  if (EFI_ERROR (BuildCompatibleIndex (Private))) {
+    DEBUG ((EFI_D_ERROR, "%a: Failed to rebuild compatible index.\r\n", __FUNCTION__));
+  }
+}
+
+/**
+  Adds a driver to the list of drivers a node will be offered to.
+
+  Drivers are added last handle first so that each node's list ends up in
+  driver handle order. When Candidates is NULL only the count is updated.
+
+  @param[in]      NodeHead          Per node list heads.
+  @param[in]      Candidates        Candidate storage, or NULL when sizing.
+  @param[in, out] CandidateCount    Number of candidates used.
+  @param[in]      NodeIndex         Index of the node.
+  @param[in]      HandleIndex       Index of the driver handle.
+
+**/
+STATIC
+VOID
+AddCandidate (
+  IN     UINT32                     *NodeHead,
+  IN     DEVICE_DISCOVERY_CANDIDATE *Candidates OPTIONAL,
+  IN OUT UINTN                      *CandidateCount,
+  IN     UINTN                      NodeIndex,
+  IN     UINTN                      HandleIndex
+  )
+{
+  if (Candidates == NULL) {
+    (*CandidateCount)++;
+    return;
+  }
+
+  //Node matched more than one string of this driver
+  if ((NodeHead[NodeIndex] != DEVICE_DISCOVERY_INDEX_END) &&
+      (Candidates[NodeHead[NodeIndex]].HandleIndex == HandleIndex)) {
+    return;
+  }
+
+  Candidates[*CandidateCount].HandleIndex = HandleIndex;
+  Candidates[*CandidateCount].Next = NodeHead[NodeIndex];
+  NodeHead[NodeIndex] = *CandidateCount;
+  (*CandidateCount)++;
+}
+
+/**
+  Offers device tree nodes to newly registered drivers using the compatible
+  index.
+
+  Drivers that publish their compatible strings are only offered the nodes
+  that carry one of them, other drivers are offered every node. Nodes are
+  processed in device tree order and each is offered to its drivers in handle
+  order until one accepts it, as a full walk of the device tree would.
+
+  @param[in]  Private               Pointer to the private device discovery data structure.
+  @param[in]  HandleBuffer          Handles of the new drivers.
+  @param[in]  Handles               Number of handles.
+  @param[out] Attempts              Number of node/driver pairs processed.
+
+  @return EFI_SUCCESS               Nodes processed.
+  @return EFI_OUT_OF_RESOURCES      Working storage could not be allocated.
+
+**/
+STATIC
+EFI_STATUS
+ProcessIndexedNodes (
+  IN  DEVICE_DISCOVERY_PRIVATE *Private,
+  IN  EFI_HANDLE               *HandleBuffer,
+  IN  UINTN                    Handles,
+  OUT UINTN                    *Attempts
+  )
+{
+  EFI_STATUS                                Status;
+  NVIDIA_DEVICE_TREE_COMPATIBILITY_PROTOCOL **Protocols = NULL;
+  UINT32                                    *NodeHead = NULL;
+  DEVICE_DISCOVERY_CANDIDATE                *Candidates = NULL;
+  UINTN                                     CandidateCount;
+  UINTN                                     Pass;
+  UINTN                                     HandleIndex;
+  UINTN                                     NodeIndex;
+  CONST CHAR8                               **Compatible;
+  UINT32                                    Hash;
+  UINT32                                    EntryIndex;
+  UINT32                                    CandidateIndex;
+  DEVICE_DISCOVERY_COMPATIBLE_ENTRY         *Entry;
+
+  *Attempts = 0;
+
+  Protocols = AllocateZeroPool (Handles * sizeof (NVIDIA_DEVICE_TREE_COMPATIBILITY_PROTOCOL *));
+  NodeHead = AllocatePool (MAX (Private->NodeCount, 1) * sizeof (UINT32));
+  if ((Protocols == NULL) || (NodeHead == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+  SetMem (NodeHead, Private->NodeCount * sizeof (UINT32), 0xFF);
+
+  for (HandleIndex = 0; HandleIndex < Handles; HandleIndex++) {
+    Status = gBS->HandleProtocol (HandleBuffer[HandleIndex],
+                                  &gNVIDIADeviceTreeCompatibilityProtocolGuid,
+                                  (VOID **)&Protocols[HandleIndex]);
+    if (EFI_ERROR (Status)) {
+      Protocols[HandleIndex] = NULL;
+    }
+  }
+
+  CandidateCount = 0;
+  for (Pass = 0; Pass < 2; Pass++) {
+    if (Pass == 1) {
+      Candidates = AllocatePool (MAX (CandidateCount, 1) * sizeof (DEVICE_DISCOVERY_CANDIDATE));
+      if (Candidates == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto ErrorExit;
+      }
+      CandidateCount = 0;
+    }
+
+    for (HandleIndex = Handles; HandleIndex-- > 0;) {
+      if (Protocols[HandleIndex] == NULL) {
+        continue;
+      }
+
+      if (Protocols[HandleIndex]->CompatibleStrings == NULL) {
+        for (NodeIndex = 0; NodeIndex < Private->NodeCount; NodeIndex++) {
+          AddCandidate (NodeHead, Candidates, &CandidateCount, NodeIndex, HandleIndex);
+        }
+        continue;
+      }
+
+      for (Compatible = Protocols[HandleIndex]->CompatibleStrings; *Compatible != NULL; Compatible++) {
+        Hash = CalculateFnv1aHash32 (*Compatible);
+        for (EntryIndex = Private->CompatibleBuckets[Hash & Private->CompatibleBucketMask];
+             EntryIndex != DEVICE_DISCOVERY_INDEX_END;
+             EntryIndex = Entry->Next) {
+          Entry = &Private->CompatibleEntries[EntryIndex];
+          if ((Entry->Hash == Hash) && (0 == AsciiStrCmp (Entry->Compatible, *Compatible))) {
+            AddCandidate (NodeHead, Candidates, &CandidateCount, Entry->NodeIndex, HandleIndex);
+          }
+        }
+      }
+    }
+  }
+
+  for (NodeIndex = 0; NodeIndex < Private->NodeCount; NodeIndex++) {
+    for (CandidateIndex = NodeHead[NodeIndex];
+         CandidateIndex != DEVICE_DISCOVERY_INDEX_END;
+         CandidateIndex = Candidates[CandidateIndex].Next) {
+      (*Attempts)++;
+      Status = ProcessDeviceTreeNodeWithHandle (Private,
+                                                Private->Nodes[NodeIndex],
+                                                HandleBuffer[Candidates[CandidateIndex].HandleIndex]);
+      if (!EFI_ERROR (Status)) {
+        break;
+      }
+    }
+  }
+  Status = EFI_SUCCESS;
+
+ErrorExit:
+  if (NULL != Protocols) {
+    FreePool (Protocols);
+  }
+  if (NULL != NodeHead) {
+    FreePool (NodeHead);
+  }
+  if (NULL != Candidates) {
+    FreePool (Candidates);
+  }
+  return Status;
+}
 
 /**
   Notification function that will be called each time gNVIDIADeviceTreeCompatibilityProtocolGuid
@@ -1434,6 +1980,8 @@ CompatibilityProtocolNotification(
   EFI_HANDLE               *HandleBuffer = NULL;
   UINTN                    Handles = 0;
   INT32                    NodeOffset = 0;
+  UINTN                    Attempts = 0;
+  UINT64                   StartTime;
 
   if (Context == NULL) {
     goto ErrorExit;
@@ -1452,21 +2000,42 @@ CompatibilityProtocolNotification(
     return;
   }
 
-  NodeOffset = 0;
-  do {
-    UINTN HandleIndex;
-    NodeOffset = fdt_next_node (Private->DeviceTreeBase, NodeOffset, NULL);
-    if (NodeOffset < 0) {
-      break;
-    }
+  StartTime = GetTimeInNanoSecond (GetPerformanceCounter ());
 
-    for (HandleIndex = 0; HandleIndex < Handles; HandleIndex++) {
-      Status = ProcessDeviceTreeNodeWithHandle (Private, NodeOffset, HandleBuffer[HandleIndex]);
-      if (!EFI_ERROR (Status)) {
+  RefreshCompatibleIndex (Private);
+
+  Status = EFI_NOT_READY;
+  if (Private->CompatibleEntries != NULL) {
+    Status = ProcessIndexedNodes (Private, HandleBuffer, Handles, &Attempts);
+  }
+
+  if (EFI_ERROR (Status)) {
+    //No index, offer every node to every driver
+    Attempts = 0;
+    NodeOffset = 0;
+    do {
+      UINTN HandleIndex;
+      NodeOffset = fdt_next_node (Private->DeviceTreeBase, NodeOffset, NULL);
+      if (NodeOffset < 0) {
         break;
       }
-    }
-  } while (NodeOffset > 0);
+
+      for (HandleIndex = 0; HandleIndex < Handles; HandleIndex++) {
+        Attempts++;
+        Status = ProcessDeviceTreeNodeWithHandle (Private, NodeOffset, HandleBuffer[HandleIndex]);
+        if (!EFI_ERROR (Status)) {
+          break;
+        }
+      }
+    } while (NodeOffset > 0);
+  }
+
+  DEBUG ((EFI_D_INFO, "%a: %lu drivers, %lu of up to %lu node/driver pairs processed in %lu us\r\n",
+          __FUNCTION__,
+          Handles,
+          Attempts,
+          Private->NodeCount * Handles,
+          DivU64x32 (GetTimeInNanoSecond (GetPerformanceCounter ()) - StartTime, 1000)));
 
 ErrorExit:
   if (NULL != HandleBuffer) {
@@ -1496,7 +2065,7 @@ DeviceDiscoveryDxeEntryPoint (
   DEVICE_DISCOVERY_PRIVATE *Private = NULL;
   BOOLEAN                  EventCreated = FALSE;
 
-  Private = AllocatePool (sizeof(DEVICE_DISCOVERY_PRIVATE));
+  Private = AllocateZeroPool (sizeof(DEVICE_DISCOVERY_PRIVATE));
   if (NULL == Private) {
     Status = EFI_OUT_OF_RESOURCES;
     goto ErrorExit;
@@ -1508,6 +2077,11 @@ DeviceDiscoveryDxeEntryPoint (
     goto ErrorExit;
   }
 
+  //Non-fatal, nodes are matched by walking the device tree instead
+  if (EFI_ERROR (BuildCompatibleIndex (Private))) {
+    DEBUG ((EFI_D_ERROR, "%a: Failed to build compatible index.\r\n", __FUNCTION__));
+  }
+
   Private->ProtocolNotificationEvent = EfiCreateProtocolNotifyEvent (
                                          &gNVIDIADeviceTreeCompatibilityProtocolGuid,
                                          TPL_CALLBACK,
@@ -13,12 +13,46 @@
 
 #include <PiDxe.h>
 
+#define DEVICE_DISCOVERY_INDEX_END         MAX_UINT32
+#define DEVICE_DISCOVERY_MIN_INDEX_BUCKETS  64
+
+//
+// One compatible string of one device tree node, chained by hash bucket
+//
+typedef struct {
+  UINT32       Hash;
+  UINT32       NodeIndex;
+  CONST CHAR8  *Compatible;
+  UINT32       Next;
+} DEVICE_DISCOVERY_COMPATIBLE_ENTRY;
+
+//
+// Driver to offer a node to, chained per node in driver handle order
+//
+typedef struct {
+  UINTN        HandleIndex;
+  UINT32       Next;
+} DEVICE_DISCOVERY_CANDIDATE;
+
 typedef struct {
   VOID       *DeviceTreeBase; //Address of the device tree
   UINTN      DeviceTreeSize;  //Size of device tree binary
 
   EFI_EVENT  ProtocolNotificationEvent;
   VOID       *SearchKey;
+
+  //
+  // Compatible string index of the device tree, rebuilt when the size of the
+  // device tree changes
+  //
+  UINT32                             IndexTotalSize;
+  UINT32                             IndexStructSize;
+  UINT32                             IndexStringsSize;
+  INT32                              *Nodes;          //Node offsets in device tree order
+  UINTN                              NodeCount;
+  DEVICE_DISCOVERY_COMPATIBLE_ENTRY  *CompatibleEntries;
+  UINT32                             *CompatibleBuckets;
+  UINT32                             CompatibleBucketMask;
 } DEVICE_DISCOVERY_PRIVATE;
 
 #pragma pack (1)
@@ -61,4 +95,10 @@ typedef struct {
   UINT32 Argument;
 } MRQ_PG_COMMAND_PACKET;
 
+//
+// MRQ_CLK request word, clock id in the low 24 bits and command in the high 8
+//
+#define CmdClkIsEnabled 6
+#define MRQ_CLK_REQUEST(ClockId, Command) ((((UINT32)(Command)) << 24) | ((ClockId) & 0xFFFFFF))
+
 #endif
@@ -17,6 +17,7 @@
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/NetLib.h>
+#include <Library/PcdLib.h>
 #include <Library/DmaLib.h>
 #include <Library/IoLib.h>
 #include <Library/UefiBootServicesTableLib.h>
@@ -117,6 +118,70 @@ SnpStop (
 }
 
 
+/**
+  Samples the PHY link state.
+
+  Runs periodically while the interface is initialized so that GetStatus() can
+  report MediaPresent without touching MDIO. MAC speed, duplex and clock are
+  only reprogrammed when the link state changes.
+
+  @param[in]  Event     Event whose notification function is being invoked.
+  @param[in]  Context   Pointer to the SIMPLE_NETWORK_DRIVER instance.
+
+**/
+STATIC
+VOID
+EFIAPI
+SnpLinkMonitorNotify (
+  IN  EFI_EVENT   Event,
+  IN  VOID        *Context
+  )
+{
+  SIMPLE_NETWORK_DRIVER       *Snp;
+  EFI_STATUS                  Status;
+
+  Snp = (SIMPLE_NETWORK_DRIVER *)Context;
+
+  if (EFI_ERROR (EfiAcquireLockOrFail (&Snp->Lock))) {
+    return;
+  }
+
+  if (Snp->SnpMode.State == EfiSimpleNetworkInitialized) {
+    Status = PhyLinkAdjustEmacConfig (&Snp->PhyDriver);
+    Snp->SnpMode.MediaPresent = !EFI_ERROR (Status);
+  }
+
+  EfiReleaseLock (&Snp->Lock);
+}
+
+/**
+  Stops the PHY link monitor and reports the time it spent on MDIO.
+
+  @param[in]  Snp       A pointer to the SIMPLE_NETWORK_DRIVER instance.
+
+**/
+VOID
+EFIAPI
+SnpStopLinkMonitor (
+  IN  SIMPLE_NETWORK_DRIVER   *Snp
+  )
+{
+  if (Snp->LinkMonitorEvent == NULL) {
+    return;
+  }
+
+  gBS->CloseEvent (Snp->LinkMonitorEvent);
+  Snp->LinkMonitorEvent = NULL;
+
+  DEBUG ((
+    DEBUG_INFO,
+    "SNP:PHY: %lu link checks, %lu us in MDIO\r\n",
+    Snp->PhyDriver.LinkCheckCount,
+    Snp->PhyDriver.LinkCheckTimeNs / 1000
+    ));
+}
+
+
 /**
   Resets a network adapter and allocates the transmit and receive buffers
   required by the network interface; optionally, also requests allocation of
@@ -187,6 +252,7 @@ SnpInitialize (
   if (EFI_ERROR(Status)) {
     DEBUG ((DEBUG_INFO, "SNP:DXE: Link is Down - Network Cable is not plugged in?\r\n"));
   }
+  Snp->SnpMode.MediaPresent = !EFI_ERROR (Status);
 
   // Prevent calling Auto Neg on Exit Boot Services
   if (Snp->ExitBootServiceEvent != NULL) {
@@ -197,6 +263,27 @@ SnpInitialize (
 
   osi_start_mac (Snp->MacDriver.osi_core);
 
+  // Keep MediaPresent current without sampling the PHY from GetStatus
+  if (Snp->LinkMonitorEvent == NULL) {
+    Status = gBS->CreateEvent (
+                    EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    SnpLinkMonitorNotify,
+                    Snp,
+                    &Snp->LinkMonitorEvent
+                    );
+    if (!EFI_ERROR (Status)) {
+      Status = gBS->SetTimer (Snp->LinkMonitorEvent, TimerPeriodic, SNP_LINK_MONITOR_PERIOD);
+      if (EFI_ERROR (Status)) {
+        gBS->CloseEvent (Snp->LinkMonitorEvent);
+        Snp->LinkMonitorEvent = NULL;
+      }
+    }
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "SNP:DXE: Failed to start link monitor: %r\r\n", Status));
+    }
+  }
+
   // Declare the driver as initialized
   Snp->SnpMode.State = EfiSimpleNetworkInitialized;
 
@@ -258,6 +345,9 @@ SnpReset (
 
   osi_hw_dma_deinit (Snp->MacDriver.osi_dma);
 
+  EmacDxeTxFlush (&Snp->MacDriver);
+  EmacDxeRxFlush (&Snp->MacDriver);
+
   // Initiate a PHY reset
   Status = PhySoftReset (&Snp->PhyDriver);
   if (EFI_ERROR (Status)) {
@@ -315,10 +405,15 @@ SnpShutdown (
     return EFI_NOT_STARTED;
   }
 
+  SnpStopLinkMonitor (Snp);
+
   osi_stop_mac (Snp->MacDriver.osi_core);
 
   osi_hw_dma_deinit (Snp->MacDriver.osi_dma);
 
+  EmacDxeTxFlush (&Snp->MacDriver);
+  EmacDxeRxFlush (&Snp->MacDriver);
+
   Snp->SnpMode.State = EfiSimpleNetworkStarted;
 
   return EFI_SUCCESS;
@@ -938,6 +1033,27 @@ SnpNvData (
 }
 
 
+/**
+  Reclaims all Tx descriptors the DMA has finished with.
+
+  Completed caller buffers are moved to the recycled buffer queue and any DMA
+  mappings taken for them are released.
+
+  @param Snp             A pointer to the SIMPLE_NETWORK_DRIVER instance.
+
+**/
+STATIC
+VOID
+SnpReclaimTx (
+  IN SIMPLE_NETWORK_DRIVER  *Snp
+  )
+{
+  if (osi_txring_empty (Snp->MacDriver.osi_dma, 0) == 0) {
+    osi_process_tx_completions (Snp->MacDriver.osi_dma, 0, (INT32)TX_DESC_CNT);
+  }
+}
+
+
 /**
   Reads the current interrupt status and recycled transmit buffer status from a
   network interface.
@@ -1004,15 +1120,12 @@ SnpGetStatus (
   if(IrqStat != NULL) {
     EfiAcquireLock (&Snp->Lock);
     *IrqStat = 0;
-    if ((osi_txring_empty(Snp->MacDriver.osi_dma, 0) == 0) &&
-        (Snp->MacDriver.tx_completed_buffer == NULL)) {
-      osi_process_tx_completions(Snp->MacDriver.osi_dma, 0, 1);
-    }
-    if (Snp->MacDriver.tx_completed_buffer != NULL) {
+    SnpReclaimTx (Snp);
+    if (Snp->MacDriver.tx_completed_count != 0) {
       *IrqStat |= EFI_SIMPLE_NETWORK_TRANSMIT_INTERRUPT;
     }
 
-    if (Snp->MacDriver.rx_pkt_swcx != NULL) {
+    if (Snp->MacDriver.rx_completed_count != 0) {
       *IrqStat |= EFI_SIMPLE_NETWORK_RECEIVE_INTERRUPT;
     } else {
       osi_process_rx_completions(Snp->MacDriver.osi_dma, 0, 0, &more_data_avail);
@@ -1023,23 +1136,23 @@ SnpGetStatus (
     EfiReleaseLock (&Snp->Lock);
   }
 
-  // Update the media status
-  Status = PhyLinkAdjustEmacConfig (&Snp->PhyDriver);
-  if (EFI_ERROR(Status)) {
-    Snp->SnpMode.MediaPresent = FALSE;
-  } else {
-    Snp->SnpMode.MediaPresent = TRUE;
+  // Update the media status, unless the link monitor keeps it current
+  if (Snp->LinkMonitorEvent == NULL) {
+    Status = PhyLinkAdjustEmacConfig (&Snp->PhyDriver);
+    if (EFI_ERROR(Status)) {
+      Snp->SnpMode.MediaPresent = FALSE;
+    } else {
+      Snp->SnpMode.MediaPresent = TRUE;
+    }
   }
 
   // TxBuff
   if (TxBuff != NULL) {
     EfiAcquireLock (&Snp->Lock);
-    if ((osi_txring_empty(Snp->MacDriver.osi_dma, 0) == 0) &&
-        (Snp->MacDriver.tx_completed_buffer == NULL)) {
-      osi_process_tx_completions(Snp->MacDriver.osi_dma, 0, 1);
+    if (Snp->MacDriver.tx_completed_count == 0) {
+      SnpReclaimTx (Snp);
     }
-    *TxBuff = Snp->MacDriver.tx_completed_buffer;
-    Snp->MacDriver.tx_completed_buffer = NULL;
+    *TxBuff = EmacDxeTxPopCompleted (&Snp->MacDriver);
     EfiReleaseLock (&Snp->Lock);
   }
 
@@ -1125,6 +1238,14 @@ SnpTransmit (
   struct osi_tx_ring         *tx_ring;
   struct osi_tx_swcx         *tx_swcx;
   struct osi_tx_pkt_cx       *tx_pkt_cx;
+  EFI_PHYSICAL_ADDRESS       DeviceAddress;
+  VOID                       *Mapping;
+  UINTN                      MapSize;
+  UINT32                     DescCount;
+  UINT32                     Entry;
+  UINT32                     LastEntry;
+  UINT32                     Index;
+  UINTN                      Offset;
 
   EthernetPacket = Data;
   LockAcquired = FALSE;
@@ -1156,16 +1277,11 @@ SnpTransmit (
     goto Exit;
   }
 
-  //Make sure slot is free i.e, current shadow desc. len should be 0
-  tx_swcx = tx_ring->tx_swcx + tx_ring->cur_tx_idx;
-  if (tx_swcx->len != 0) {
-    Status = EFI_NOT_READY;
-    goto Exit;
-  }
-
-  if (BuffSize > Snp->SnpMode.MaxPacketSize) {
-    DEBUG((DEBUG_ERROR, "Tx buffer size > %d\r\n", Snp->SnpMode.MaxPacketSize));
+  // Frame is limited to the MTU plus Ethernet and VLAN headers, as sized for the Tx buffers
+  if (BuffSize > osi_dma->rx_buf_len) {
+    DEBUG((DEBUG_ERROR, "Tx buffer size > %d\r\n", osi_dma->rx_buf_len));
     Status = EFI_UNSUPPORTED;
+    goto Exit;
   }
 
   // Ensure header is correct size if non-zero
@@ -1188,6 +1304,16 @@ SnpTransmit (
     goto Exit;
   }
 
+  // Make sure the whole frame fits on the ring, reclaiming finished frames if not
+  DescCount = (UINT32)((BuffSize + TX_MAX_BUFFER_LENGTH - 1) / TX_MAX_BUFFER_LENGTH);
+  if (EmacDxeTxFreeDescriptors (&Snp->MacDriver) < DescCount) {
+    SnpReclaimTx (Snp);
+    if (EmacDxeTxFreeDescriptors (&Snp->MacDriver) < DescCount) {
+      Status = EFI_NOT_READY;
+      goto Exit;
+    }
+  }
+
   if (HdrSize) {
     EthernetPacket[0] = DstAddr->Addr[0];
     EthernetPacket[1] = DstAddr->Addr[1];
@@ -1207,15 +1333,64 @@ SnpTransmit (
     EthernetPacket[12] = (*Protocol & 0xFF00) >> 8;
   }
 
-  CopyMem ((VOID *)Snp->MacDriver.tx_buffers[tx_ring->cur_tx_idx], Data, BuffSize);
-  tx_swcx->buf_phy_addr = (UINTN)Snp->MacDriver.tx_buffers[tx_ring->cur_tx_idx];
+  // Send the caller buffer in place when the DMA can reach it, bounce it otherwise
+  Entry = tx_ring->cur_tx_idx;
+  MapSize = BuffSize;
+  Status = DmaMap (MapOperationBusMasterRead, Data, &MapSize, &DeviceAddress, &Mapping);
+  if (!EFI_ERROR (Status) &&
+      ((MapSize != BuffSize) || ((DeviceAddress + BuffSize - 1) > Snp->MaxAddress))) {
+    DmaUnmap (Mapping);
+    Status = EFI_UNSUPPORTED;
+  }
+  if (EFI_ERROR (Status)) {
+    CopyMem (Snp->MacDriver.tx_buffers[Entry], Data, BuffSize);
+    DeviceAddress = (UINTN)Snp->MacDriver.tx_buffers[Entry];
+    Mapping = NULL;
+    DescCount = 1;
+  }
 
-  tx_pkt_cx->flags |= OSI_PKT_CX_CSUM;
-  tx_pkt_cx->desc_cnt = 1;
+  // Split the frame across as many descriptors as the buffer length field needs
+  Offset = 0;
+  LastEntry = Entry;
+  tx_swcx = NULL;
+  for (Index = 0; Index < DescCount; Index++) {
+    tx_swcx = tx_ring->tx_swcx + Entry;
+    tx_swcx->buf_phy_addr = DeviceAddress + Offset;
+    tx_swcx->buf_virt_addr = NULL;
+    tx_swcx->len = (UINT32)MIN (BuffSize - Offset, TX_MAX_BUFFER_LENGTH);
+    Offset += tx_swcx->len;
+    LastEntry = Entry;
+    Entry = (Entry + 1) & (TX_DESC_CNT - 1U);
+  }
+
+  // The caller buffer and its mapping are released when the last descriptor completes
   tx_swcx->buf_virt_addr = Data;
-  tx_swcx->len = BuffSize;
+  Snp->MacDriver.tx_mappings[LastEntry] = Mapping;
+
+  if (PcdGetBool (PcdEqosTxChecksumOffload)) {
+    tx_pkt_cx->flags |= OSI_PKT_CX_CSUM;
+  } else {
+    tx_pkt_cx->flags &= ~OSI_PKT_CX_CSUM;
+  }
+  tx_pkt_cx->desc_cnt = DescCount;
+
+  if (osi_hw_transmit (osi_dma, 0) != 0) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to post Tx descriptors\r\n", __FUNCTION__));
+    Entry = tx_ring->cur_tx_idx;
+    for (Index = 0; Index < DescCount; Index++) {
+      tx_swcx = tx_ring->tx_swcx + Entry;
+      tx_swcx->buf_virt_addr = NULL;
+      tx_swcx->len = 0;
+      Entry = (Entry + 1) & (TX_DESC_CNT - 1U);
+    }
+    if (Mapping != NULL) {
+      DmaUnmap (Mapping);
+      Snp->MacDriver.tx_mappings[LastEntry] = NULL;
+    }
+    Status = EFI_DEVICE_ERROR;
+    goto Exit;
+  }
 
-  osi_hw_transmit(osi_dma, 0);
   Status = EFI_SUCCESS;
 
 Exit:
@@ -1293,6 +1468,7 @@ SnpReceive (
   UINT8                      *u_char_data = Data;
   UINT32                     more_data_avail;
   BOOLEAN                    ReleasePacket;
+  EMAC_RX_COMPLETION         *Completion;
 
 
   ReleasePacket = FALSE;
@@ -1314,31 +1490,34 @@ SnpReceive (
     return EFI_ACCESS_DENIED;
   }
 
-  if (Snp->MacDriver.rx_pkt_swcx == NULL) {
-    osi_process_rx_completions(Snp->MacDriver.osi_dma, 0, 1, &more_data_avail);
+  // Harvest a batch of completions once the previous one has been consumed
+  if (Snp->MacDriver.rx_completed_count == 0) {
+    osi_process_rx_completions(Snp->MacDriver.osi_dma, 0, RX_COMPLETION_BATCH, &more_data_avail);
   }
 
-  if (Snp->MacDriver.rx_pkt_swcx == NULL) {
+  Completion = EmacDxeRxPeekCompleted (&Snp->MacDriver);
+  if (Completion == NULL) {
     Status = EFI_NOT_READY;
     goto Exit;
   }
 
-  if ((Snp->MacDriver.rxpkt_cx->flags & OSI_PKT_CX_VALID) == 0) {
+  if ((Completion->rxpkt_cx.flags & OSI_PKT_CX_VALID) == 0) {
     Status = EFI_DEVICE_ERROR;
     ReleasePacket = TRUE;
     goto Exit;
   }
 
-  if (*BuffSize < Snp->MacDriver.rxpkt_cx->pkt_len) {
-    DEBUG((DEBUG_ERROR, "Rx buffer %u < packet length %ld\n", *BuffSize, Snp->MacDriver.rxpkt_cx->pkt_len));
+  if (*BuffSize < Completion->rxpkt_cx.pkt_len) {
+    DEBUG((DEBUG_ERROR, "Rx buffer %u < packet length %ld\n", *BuffSize, Completion->rxpkt_cx.pkt_len));
     Status = EFI_BUFFER_TOO_SMALL;
     /* Indicate the needed buffer size to the stack */
-    *BuffSize = Snp->MacDriver.rxpkt_cx->pkt_len;
+    *BuffSize = Completion->rxpkt_cx.pkt_len;
     goto Exit;
   }
 
   ReleasePacket = TRUE;
-  CopyMem (Data, Snp->MacDriver.rx_pkt_swcx->buf_virt_addr ,Snp->MacDriver.rxpkt_cx->pkt_len);
+  CopyMem (Data, Completion->rx_swcx->buf_virt_addr, Completion->rxpkt_cx.pkt_len);
+  *BuffSize = Completion->rxpkt_cx.pkt_len;
 
   if (HdrSize != NULL) {
     *HdrSize = Snp->SnpMode.MediaHeaderSize;
@@ -1374,10 +1553,7 @@ SnpReceive (
 
 Exit:
   if (ReleasePacket) {
-    Snp->MacDriver.rx_pkt_swcx->flags |= OSI_RX_SWCX_BUF_VALID;
-    Snp->MacDriver.rx_pkt_swcx = NULL;
-    Snp->MacDriver.rxpkt_cx = NULL;
-    osi_rx_dma_desc_init (Snp->MacDriver.osi_dma, Snp->MacDriver.osi_dma->rx_ring[0], 0);
+    EmacDxeRxReleaseCompleted (&Snp->MacDriver);
   }
   EfiReleaseLock (&Snp->Lock);
   return Status;
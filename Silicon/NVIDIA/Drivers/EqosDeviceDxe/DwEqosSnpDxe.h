@@ -57,6 +57,7 @@ typedef struct {
   EFI_EVENT                              DeviceTreeNotifyEvent;
   EFI_EVENT                              AcpiNotifyEvent;
   EFI_EVENT                              ExitBootServiceEvent;
+  EFI_EVENT                              LinkMonitorEvent;
   CHAR8                                  DeviceTreePath[64];
 } SIMPLE_NETWORK_DRIVER;
 
@@ -70,6 +71,9 @@ extern EFI_COMPONENT_NAME2_PROTOCOL      gSnpComponentName2;
 #define ETHERNET_MAC_BROADCAST_INDEX                               1
 #define ETHERNET_MAC_MULTICAST_INDEX                               2
 
+// PHY link state sampling period while the interface is initialized
+#define SNP_LINK_MONITOR_PERIOD          EFI_TIMER_PERIOD_MILLISECONDS (500)
+
 /*---------------------------------------------------------------------------------------------------------------------
 
   UEFI-Compliant functions for EFI_SIMPLE_NETWORK_PROTOCOL
@@ -209,4 +213,16 @@ SnpCommitFilters (
   IN BOOLEAN               UpdateMCast
   );
 
+/**
+  Stops the PHY link monitor and reports the time it spent on MDIO.
+
+  @param Snp              A pointer to the SIMPLE_NETWORK_DRIVER instance.
+
+**/
+VOID
+EFIAPI
+SnpStopLinkMonitor (
+  IN SIMPLE_NETWORK_DRIVER *Snp
+  );
+
 #endif // DWEMAC_SNP_DXE_H__
@@ -18,6 +18,7 @@
 #include <Library/DmaLib.h>
 #include <Library/IoLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 
 #include "osd.h"
 #include "osi_core.h"
@@ -36,12 +37,20 @@ EmacDxeInitialization (
   UINT8                  *RxFullBuffer;
   UINT8                  *TxFullBuffer;
   UINT64                 MaxPacketSize;
+  UINT32                 Mtu;
 
   DEBUG ((DEBUG_INFO, "SNP:MAC: %a ()\r\n", __FUNCTION__));
 
-  EmacDriver->tx_completed_buffer = NULL;
-  EmacDriver->rxpkt_cx = NULL;
-  EmacDriver->rx_pkt_swcx = NULL;
+  Mtu = PcdGet32 (PcdEqosMtu);
+  if ((Mtu < OSI_DFLT_MTU_SIZE) || (Mtu > OSI_MTU_SIZE_9000)) {
+    DEBUG ((DEBUG_ERROR, "%a: unsupported MTU %u, using %u\r\n", __FUNCTION__, Mtu, OSI_DFLT_MTU_SIZE));
+    Mtu = OSI_DFLT_MTU_SIZE;
+  }
+
+  EmacDriver->tx_completed_head = 0;
+  EmacDriver->tx_completed_count = 0;
+  EmacDriver->rx_completed_head = 0;
+  EmacDriver->rx_completed_count = 0;
 
   EmacDriver->osi_core = osi_get_core ();
   if (EmacDriver->osi_core == NULL) {
@@ -65,6 +74,7 @@ EmacDxeInitialization (
   EmacDriver->osi_core->mtl_queues[0] = 0;
   EmacDriver->osi_core->dcs_en = OSI_DISABLE;
   EmacDriver->osi_core->pause_frames = OSI_PAUSE_FRAMES_DISABLE;
+  EmacDriver->osi_core->mtu = Mtu;
   EmacDriver->osi_core->rxq_prio[0] = 2;
   EmacDriver->osi_core->rxq_ctrl[0] = 2;
   EmacDriver->osi_core->osd_ops.ops_log = osd_log;
@@ -80,7 +90,7 @@ EmacDxeInitialization (
   EmacDriver->osi_dma->num_dma_chans = 1;
   EmacDriver->osi_dma->dma_chans[0] = 0;
   EmacDriver->osi_dma->mac = MacType;
-  EmacDriver->osi_dma->mtu = OSI_DFLT_MTU_SIZE;
+  EmacDriver->osi_dma->mtu = Mtu;
   EmacDriver->osi_dma->osd_ops.transmit_complete = osd_transmit_complete;
   EmacDriver->osi_dma->osd_ops.receive_packet = osd_receive_packet;
   EmacDriver->osi_dma->osd_ops.ops_log = osd_log;
@@ -166,7 +176,161 @@ EmacDxeInitialization (
   }
   for (Index = 0; Index < TX_DESC_CNT; Index++) {
     EmacDriver->tx_buffers[Index] = TxFullBuffer + (MaxPacketSize * Index);
+    EmacDriver->tx_mappings[Index] = NULL;
   }
 
   return Status;
 }
+
+UINT32
+EFIAPI
+EmacDxeTxFreeDescriptors (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  struct osi_tx_ring     *TxRing;
+  UINT32                 Used;
+
+  TxRing = EmacDriver->osi_dma->tx_ring[0];
+  Used = (TxRing->cur_tx_idx - TxRing->clean_idx) & (TX_DESC_CNT - 1U);
+  Used += EmacDriver->tx_completed_count;
+  if (Used >= TX_DESC_USABLE) {
+    return 0;
+  }
+
+  return TX_DESC_USABLE - Used;
+}
+
+VOID
+EFIAPI
+EmacDxeTxPushCompleted (
+  IN  EMAC_DRIVER   *EmacDriver,
+  IN  VOID          *Buffer
+  )
+{
+  UINT32                 Tail;
+
+  if (EmacDriver->tx_completed_count >= TX_DESC_CNT) {
+    DEBUG ((DEBUG_ERROR, "%a: recycled Tx queue full\r\n", __FUNCTION__));
+    return;
+  }
+
+  Tail = (EmacDriver->tx_completed_head + EmacDriver->tx_completed_count) & (TX_DESC_CNT - 1U);
+  EmacDriver->tx_completed_buffers[Tail] = Buffer;
+  EmacDriver->tx_completed_count++;
+}
+
+VOID *
+EFIAPI
+EmacDxeTxPopCompleted (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  VOID                   *Buffer;
+
+  if (EmacDriver->tx_completed_count == 0) {
+    return NULL;
+  }
+
+  Buffer = EmacDriver->tx_completed_buffers[EmacDriver->tx_completed_head];
+  EmacDriver->tx_completed_head = (EmacDriver->tx_completed_head + 1) & (TX_DESC_CNT - 1U);
+  EmacDriver->tx_completed_count--;
+
+  return Buffer;
+}
+
+VOID
+EFIAPI
+EmacDxeTxFlush (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  UINTN                  Index;
+
+  for (Index = 0; Index < TX_DESC_CNT; Index++) {
+    if (EmacDriver->tx_mappings[Index] != NULL) {
+      DmaUnmap (EmacDriver->tx_mappings[Index]);
+      EmacDriver->tx_mappings[Index] = NULL;
+    }
+  }
+
+  EmacDriver->tx_completed_head = 0;
+  EmacDriver->tx_completed_count = 0;
+}
+
+VOID
+EFIAPI
+EmacDxeRxPushCompleted (
+  IN  EMAC_DRIVER           *EmacDriver,
+  IN  struct osi_rx_swcx    *RxSwcx,
+  IN  struct osi_rx_pkt_cx  *RxPktCx
+  )
+{
+  EMAC_RX_COMPLETION     *Completion;
+  UINT32                 Tail;
+
+  if (EmacDriver->rx_completed_count >= RX_DESC_CNT) {
+    DEBUG ((DEBUG_ERROR, "%a: Rx completion queue full\r\n", __FUNCTION__));
+    return;
+  }
+
+  Tail = (EmacDriver->rx_completed_head + EmacDriver->rx_completed_count) & (RX_DESC_CNT - 1U);
+  Completion = &EmacDriver->rx_completions[Tail];
+  Completion->rx_swcx = RxSwcx;
+  CopyMem (&Completion->rxpkt_cx, RxPktCx, sizeof (Completion->rxpkt_cx));
+  EmacDriver->rx_completed_count++;
+}
+
+EMAC_RX_COMPLETION *
+EFIAPI
+EmacDxeRxPeekCompleted (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  if (EmacDriver->rx_completed_count == 0) {
+    return NULL;
+  }
+
+  return &EmacDriver->rx_completions[EmacDriver->rx_completed_head];
+}
+
+VOID
+EFIAPI
+EmacDxeRxReleaseCompleted (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  struct osi_rx_ring     *RxRing;
+  UINT32                 Index;
+
+  if (EmacDriver->rx_completed_count == 0) {
+    return;
+  }
+
+  EmacDriver->rx_completions[EmacDriver->rx_completed_head].rx_swcx->flags |= OSI_RX_SWCX_BUF_VALID;
+  EmacDriver->rx_completed_head = (EmacDriver->rx_completed_head + 1) & (RX_DESC_CNT - 1U);
+  EmacDriver->rx_completed_count--;
+  if (EmacDriver->rx_completed_count != 0) {
+    return;
+  }
+
+  // Descriptors skipped by the DMA layer (dropped or context) keep their buffer
+  RxRing = EmacDriver->osi_dma->rx_ring[0];
+  for (Index = RxRing->refill_idx; Index != RxRing->cur_rx_idx; Index = (Index + 1) & (RX_DESC_CNT - 1U)) {
+    if ((RxRing->rx_swcx[Index].flags & OSI_RX_SWCX_REUSE) != 0) {
+      RxRing->rx_swcx[Index].flags |= OSI_RX_SWCX_BUF_VALID;
+    }
+  }
+
+  osi_rx_dma_desc_init (EmacDriver->osi_dma, RxRing, 0);
+}
+
+VOID
+EFIAPI
+EmacDxeRxFlush (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  EmacDriver->rx_completed_head = 0;
+  EmacDriver->rx_completed_count = 0;
+}
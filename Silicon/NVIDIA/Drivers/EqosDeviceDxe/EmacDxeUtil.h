@@ -17,13 +17,31 @@
 #include "osi_core.h"
 #include "osi_dma.h"
 
+// Largest buffer a single Tx descriptor can carry (TDES2 buffer 1 length)
+#define TX_MAX_BUFFER_LENGTH          0x3FFFU
+
+// Usable Tx descriptors; one slot stays empty to tell a full ring from an empty one
+#define TX_DESC_USABLE                (TX_DESC_CNT - 1U)
+
+// Rx completions harvested from the ring per pass
+#define RX_COMPLETION_BATCH           64
+
+typedef struct {
+  struct osi_rx_swcx          *rx_swcx;
+  struct osi_rx_pkt_cx        rxpkt_cx;
+} EMAC_RX_COMPLETION;
+
 typedef struct {
   struct osi_core_priv_data   *osi_core;
   struct osi_dma_priv_data    *osi_dma;
   void                        *tx_buffers[TX_DESC_CNT];
-  void                        *tx_completed_buffer;
-  struct osi_rx_pkt_cx        *rxpkt_cx;
-  struct osi_rx_swcx          *rx_pkt_swcx;
+  void                        *tx_mappings[TX_DESC_CNT];
+  void                        *tx_completed_buffers[TX_DESC_CNT];
+  UINT32                      tx_completed_head;
+  UINT32                      tx_completed_count;
+  EMAC_RX_COMPLETION          rx_completions[RX_DESC_CNT];
+  UINT32                      rx_completed_head;
+  UINT32                      rx_completed_count;
   } EMAC_DRIVER;
 
 EFI_STATUS
@@ -34,4 +52,123 @@ EmacDxeInitialization (
   IN  UINT32                  MacType
   );
 
+/**
+  Returns the number of Tx descriptors that can still be posted.
+
+  Descriptors whose frames have completed but have not been handed back to the
+  caller are counted as used, so the recycled buffer queue can never overflow.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+
+  @return Number of free Tx descriptors
+
+**/
+UINT32
+EFIAPI
+EmacDxeTxFreeDescriptors (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
+/**
+  Queues a transmitted caller buffer on the recycled buffer queue.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+  @param  Buffer                  Caller buffer passed to Transmit()
+
+**/
+VOID
+EFIAPI
+EmacDxeTxPushCompleted (
+  IN  EMAC_DRIVER             *EmacDriver,
+  IN  VOID                    *Buffer
+  );
+
+/**
+  Removes the oldest transmitted caller buffer from the recycled buffer queue.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+
+  @return Caller buffer, or NULL if no transmit has completed
+
+**/
+VOID *
+EFIAPI
+EmacDxeTxPopCompleted (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
+/**
+  Drops all pending transmits.
+
+  Releases the DMA mappings of frames still on the Tx ring and empties the
+  recycled buffer queue. Must be called with the Tx DMA stopped.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+
+**/
+VOID
+EFIAPI
+EmacDxeTxFlush (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
+/**
+  Queues a received frame on the Rx completion queue.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+  @param  RxSwcx                  Software context of the descriptor holding the frame
+  @param  RxPktCx                 Packet context reported by the DMA
+
+**/
+VOID
+EFIAPI
+EmacDxeRxPushCompleted (
+  IN  EMAC_DRIVER             *EmacDriver,
+  IN  struct osi_rx_swcx      *RxSwcx,
+  IN  struct osi_rx_pkt_cx    *RxPktCx
+  );
+
+/**
+  Returns the oldest received frame without removing it from the queue.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+
+  @return Oldest completion, or NULL if nothing has been received
+
+**/
+EMAC_RX_COMPLETION *
+EFIAPI
+EmacDxeRxPeekCompleted (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
+/**
+  Hands the oldest received frame's buffer back to the DMA.
+
+  Descriptors are given back to the hardware in one pass once the completion
+  queue drains, so the Rx tail pointer is written once per batch.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+
+**/
+VOID
+EFIAPI
+EmacDxeRxReleaseCompleted (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
+/**
+  Drops all received frames that have not been read yet.
+
+  Must be called with the Rx DMA stopped.
+
+  @param  EmacDriver              Pointer to the EMAC driver
+
+**/
+VOID
+EFIAPI
+EmacDxeRxFlush (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
 #endif // EMAC_DXE_UTIL_H__
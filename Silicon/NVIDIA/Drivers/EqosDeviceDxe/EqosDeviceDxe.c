@@ -470,7 +470,7 @@ DeviceDiscoveryNotify (
       return EFI_DEVICE_ERROR;
     }
 
-    SnpMode->MaxPacketSize = Snp->MacDriver.osi_dma->rx_buf_len;         // Preamble + SOF + Ether Frame (with VLAN tag +4bytes)
+    SnpMode->MaxPacketSize = Snp->MacDriver.osi_dma->mtu;
 
     //Set PHY driver defaults will override as needed
     Snp->PhyDriver.PhyAddress = PHY_DEFAULT_ADDRESS;
@@ -563,6 +563,7 @@ DeviceDiscoveryNotify (
     }
 
     Snp = INSTANCE_FROM_SNP_THIS(SnpProtocol);
+    SnpStopLinkMonitor (Snp);
     gBS->CloseEvent (Snp->DeviceTreeNotifyEvent);
     gBS->CloseEvent (Snp->AcpiNotifyEvent);
     gBS->CloseEvent (Snp->ExitBootServiceEvent);
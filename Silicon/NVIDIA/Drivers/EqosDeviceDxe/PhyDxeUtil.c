@@ -256,11 +256,15 @@ PhyLinkAdjustEmacConfig (
 {
   EFI_STATUS   Status;
   UINT64       ClockRate;
+  UINT64       StartTime;
 
   Status = EFI_SUCCESS;
 
+  StartTime = GetTimeInNanoSecond (GetPerformanceCounter ());
   PhyDriver->CheckAutoNeg (PhyDriver);
   PhyDriver->DetectLink (PhyDriver);
+  PhyDriver->LinkCheckTimeNs += GetTimeInNanoSecond (GetPerformanceCounter ()) - StartTime;
+  PhyDriver->LinkCheckCount++;
 
   if (PhyDriver->PhyOldLink != PhyDriver->PhyCurrentLink) {
     if (PhyDriver->PhyCurrentLink == LINK_UP) {
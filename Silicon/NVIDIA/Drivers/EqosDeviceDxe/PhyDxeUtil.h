@@ -56,6 +56,8 @@ struct _PHY_DRIVER{
   UINT32                      PhyAddress;
   UINT32                      ResetDelay;
   UINT32                      PostResetDelay;
+  UINT64                      LinkCheckCount;
+  UINT64                      LinkCheckTimeNs;
 };
 
 #define PHY_AUTONEG_IDLE      0
@@ -11,6 +11,7 @@
 #include <Library/DebugLib.h>
 #include <Library/TimerLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/DmaLib.h>
 
 /**
  * @brief osd_usleep_range - sleep in micro seconds
@@ -94,9 +95,8 @@ void osd_receive_packet(void *priv, struct osi_rx_ring *rxring, unsigned int cha
 			unsigned int dma_buf_len, struct osi_rx_pkt_cx *rxpkt_cx,
 			struct osi_rx_swcx *rx_pkt_swcx){
 	EMAC_DRIVER *EmacDriver = (EMAC_DRIVER *)priv;
-	EmacDriver->rx_pkt_swcx = rx_pkt_swcx;
 	rx_pkt_swcx->flags |= OSI_RX_SWCX_PROCESSED;
-	EmacDriver->rxpkt_cx = rxpkt_cx;
+	EmacDxeRxPushCompleted (EmacDriver, rx_pkt_swcx, rxpkt_cx);
 }
 
 /**
@@ -125,7 +125,18 @@ void osd_receive_packet(void *priv, struct osi_rx_ring *rxring, unsigned int cha
 void osd_transmit_complete(void *priv, void *buffer, unsigned long dmaaddr,
 			   unsigned int len, struct osi_txdone_pkt_cx *txdone_pkt_cx){
 	EMAC_DRIVER *EmacDriver = (EMAC_DRIVER *)priv;
-	EmacDriver->tx_completed_buffer = buffer;
+	unsigned int entry = EmacDriver->osi_dma->tx_ring[0]->clean_idx;
+
+	/* Mapping is kept on the last descriptor of a zero-copy frame */
+	if (EmacDriver->tx_mappings[entry] != NULL) {
+		DmaUnmap (EmacDriver->tx_mappings[entry]);
+		EmacDriver->tx_mappings[entry] = NULL;
+	}
+
+	/* Only the last descriptor of a frame carries the caller buffer */
+	if (buffer != NULL) {
+		EmacDxeTxPushCompleted (EmacDriver, buffer);
+	}
 }
 
 /**.printf function callback */
@@ -476,7 +476,6 @@ FvbEraseBlocks (
   EFI_LBA     LastBlock;
   UINT64      FvbOffset;
   UINT64      FvbBufferSize;
-  UINTN       Index;
 
   if (EfiAtRuntime()) {
     return EFI_UNSUPPORTED;
@@ -536,23 +535,23 @@ FvbEraseBlocks (
     FvbBufferSize = MultU64x32 (NumOfLba, BlockSize);
     SetMem(Private->VariablePartition + FvbOffset, FvbBufferSize, 0xFF);
 
-    for (Index = 0; Index < NumOfLba; Index++) {
-      Status = Private->BlockIo->WriteBlocks (Private->BlockIo,
-                                              Private->BlockIo->Media->MediaId,
-                                              Private->PartitionStartingLBA + StartingLba + Index,
-                                              BlockSize,
-                                              Private->VariablePartition + FvbOffset + (Index * BlockSize));
-      if (EFI_ERROR(Status)) {
-        DEBUG ((EFI_D_ERROR, "%a: FVB write failed. Recovered FVB could be corrupt.\n", __FUNCTION__));
-        ASSERT (FALSE);
-        Private->BlockIo->ReadBlocks(Private->BlockIo,
-                                     Private->BlockIo->Media->MediaId,
-                                     Private->PartitionStartingLBA + StartingLba + Index,
-                                     BlockSize,
-                                     Private->VariablePartition + FvbOffset + (Index * BlockSize));
-        Status = EFI_DEVICE_ERROR;
-        break;
-      }
+    // Write the whole range with one request. EFI_ERASE_BLOCK_PROTOCOL is not
+    // used as the content of erased blocks is media defined and FVB requires
+    // erased bytes to read back as 0xFF.
+    Status = Private->BlockIo->WriteBlocks (Private->BlockIo,
+                                            Private->BlockIo->Media->MediaId,
+                                            Private->PartitionStartingLBA + StartingLba,
+                                            FvbBufferSize,
+                                            Private->VariablePartition + FvbOffset);
+    if (EFI_ERROR(Status)) {
+      DEBUG ((EFI_D_ERROR, "%a: FVB write failed. Recovered FVB could be corrupt.\n", __FUNCTION__));
+      ASSERT (FALSE);
+      Private->BlockIo->ReadBlocks(Private->BlockIo,
+                                   Private->BlockIo->Media->MediaId,
+                                   Private->PartitionStartingLBA + StartingLba,
+                                   FvbBufferSize,
+                                   Private->VariablePartition + FvbOffset);
+      Status = EFI_DEVICE_ERROR;
     }
   } while (!EFI_ERROR(Status));
   VA_END (Args);
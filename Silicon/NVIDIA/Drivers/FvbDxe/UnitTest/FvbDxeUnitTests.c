@@ -42,6 +42,22 @@ STATIC UINT8 *TestBuffer;
 
 STATIC GUID ZeroGuid = {0, 0, 0, {0, 0, 0, 0, 0, 0, 0, 0}};
 
+/**
+  Get the number of blocks written to the flash stub since the last call.
+
+  @return Number of WriteBlocks calls that reached the flash stub.
+**/
+STATIC
+UINTN
+GetFlashWriteCount (
+  VOID
+) {
+  FLASH_STUB_IO_COUNTS  IoCounts;
+
+  FlashStubGetIoCounts(Private->BlockIo, &IoCounts);
+  return IoCounts.Writes;
+}
+
 // RW_TEST_CONTEXT fields:
 //  Lba
 //  Offset
@@ -880,6 +896,7 @@ FvbEraseBlocksTestSetup(
   SetMem(TestBuffer, BLOCK_SIZE, (UINT8)0xFF);
   ZeroMem(TestFlashStorage, BLOCK_SIZE * NUM_BLOCKS);
   ZeroMem(TestVariablePartition, BLOCK_SIZE * NUM_BLOCKS);
+  GetFlashWriteCount();
 
   return UNIT_TEST_PASSED;
 }
@@ -916,6 +933,7 @@ FvbEraseBlocksFailureTest(
   UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
   UT_ASSERT_TRUE(IsZeroBuffer(TestVariablePartition, NUM_BLOCKS * BLOCK_SIZE));
   UT_ASSERT_TRUE(IsZeroBuffer(TestFlashStorage, NUM_BLOCKS * BLOCK_SIZE));
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 0);
 
   // Check completely invalid LBA start entry
   Status = Private->FvbInstance.EraseBlocks(
@@ -927,6 +945,7 @@ FvbEraseBlocksFailureTest(
   UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
   UT_ASSERT_TRUE(IsZeroBuffer(TestVariablePartition, NUM_BLOCKS * BLOCK_SIZE));
   UT_ASSERT_TRUE(IsZeroBuffer(TestFlashStorage, NUM_BLOCKS * BLOCK_SIZE));
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 0);
 
   // Check completely invalid num blocks entry
   Status = Private->FvbInstance.EraseBlocks(
@@ -938,6 +957,7 @@ FvbEraseBlocksFailureTest(
   UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
   UT_ASSERT_TRUE(IsZeroBuffer(TestVariablePartition, NUM_BLOCKS * BLOCK_SIZE));
   UT_ASSERT_TRUE(IsZeroBuffer(TestFlashStorage, NUM_BLOCKS * BLOCK_SIZE));
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 0);
 
   // Check when part of LBA range is valid
   Status = Private->FvbInstance.EraseBlocks(
@@ -949,6 +969,7 @@ FvbEraseBlocksFailureTest(
   UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
   UT_ASSERT_TRUE(IsZeroBuffer(TestVariablePartition, NUM_BLOCKS * BLOCK_SIZE));
   UT_ASSERT_TRUE(IsZeroBuffer(TestFlashStorage, NUM_BLOCKS * BLOCK_SIZE));
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 0);
 
   // Check when one LBA range is valid but the other is not
   Status = Private->FvbInstance.EraseBlocks(
@@ -961,6 +982,7 @@ FvbEraseBlocksFailureTest(
   UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
   UT_ASSERT_TRUE(IsZeroBuffer(TestVariablePartition, NUM_BLOCKS * BLOCK_SIZE));
   UT_ASSERT_TRUE(IsZeroBuffer(TestFlashStorage, NUM_BLOCKS * BLOCK_SIZE));
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 0);
 
   // Check failure without EFI_LBA_LIST_TERMINATOR
   Status = Private->FvbInstance.EraseBlocks(
@@ -971,6 +993,7 @@ FvbEraseBlocksFailureTest(
   UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
   UT_ASSERT_TRUE(IsZeroBuffer(TestVariablePartition, NUM_BLOCKS * BLOCK_SIZE));
   UT_ASSERT_TRUE(IsZeroBuffer(TestFlashStorage, NUM_BLOCKS * BLOCK_SIZE));
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 0);
 
   return UNIT_TEST_PASSED;
 }
@@ -1006,6 +1029,8 @@ FvbEraseBlocksSuccessEdgeTest(
     EFI_LBA_LIST_TERMINATOR
   );
   UT_ASSERT_STATUS_EQUAL(Status, EFI_SUCCESS);
+  // One device write per range
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 2);
   // Make sure in between blocks are still 0 (not cleared)
   UT_ASSERT_TRUE(IsZeroBuffer(
     TestVariablePartition + BLOCK_SIZE,
@@ -1061,6 +1086,8 @@ FvbEraseBlocksSuccessGeneralTest(
     EFI_LBA_LIST_TERMINATOR
   );
   UT_ASSERT_STATUS_EQUAL(Status, EFI_SUCCESS);
+  // A multi block range is erased with a single device write
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 1);
   // Make sure first block and remaining blocks are still 0 (not cleared)
   UT_ASSERT_TRUE(IsZeroBuffer(TestVariablePartition, BLOCK_SIZE));
   UT_ASSERT_TRUE(IsZeroBuffer(TestFlashStorage, BLOCK_SIZE));
@@ -1093,6 +1120,49 @@ FvbEraseBlocksSuccessGeneralTest(
   return UNIT_TEST_PASSED;
 }
 
+/**
+  Tests that EraseBlocks issues one device write for the whole partition.
+
+  Assumes FvbEraseBlocksTestSetup was called before this test.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FvbEraseBlocksSuccessFullTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  Status = Private->FvbInstance.EraseBlocks(
+    &Private->FvbInstance,
+    (EFI_LBA) 0,
+    (UINTN) NUM_BLOCKS,
+    EFI_LBA_LIST_TERMINATOR
+  );
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL(GetFlashWriteCount(), 1);
+  for (Index = 0; Index < NUM_BLOCKS; Index++) {
+    UT_ASSERT_MEM_EQUAL(
+      TestBuffer,
+      TestVariablePartition + BLOCK_SIZE * Index,
+      BLOCK_SIZE
+    );
+    UT_ASSERT_MEM_EQUAL(
+      TestBuffer,
+      TestFlashStorage + BLOCK_SIZE * Index,
+      BLOCK_SIZE
+    );
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
 /**
   Tests that InitializeFvAndVariableStoreHeaders
   checks for invalid inputs correctly.
@@ -1953,6 +2023,10 @@ UnitTestingEntry(
               "FvbEraseBlocksSuccessGeneralTest",
               FvbEraseBlocksSuccessGeneralTest,
               FvbEraseBlocksTestSetup, NULL, NULL);
+  AddTestCase(FvbEraseBlocksTestSuite, "EraseBlocks Success Full Tests",
+              "FvbEraseBlocksSuccessFullTest",
+              FvbEraseBlocksSuccessFullTest,
+              FvbEraseBlocksTestSetup, NULL, NULL);
 
   // Populate the Fvb Fv Header Unit Test Suite.
   Status = CreateUnitTestSuite (
@@ -11,6 +11,9 @@
 
 #include <FvbPrivate.h>
 
+STATIC NVIDIA_FVB_WRITE_CACHE          *mFvbWriteCache;
+STATIC EFI_RESET_NOTIFICATION_PROTOCOL *mFvbResetNotify;
+
 /**
   The GetAttributes() function retrieves the attributes and
   current settings of the block.
@@ -292,6 +295,202 @@ FvbRead (
   return LbaBoundaryCrossed ? EFI_BAD_BUFFER_SIZE : Status;
 }
 
+/**
+  Block the delayed flush while the write cache is being modified.
+
+  @param Cache  Write cache to lock
+
+  @return The TPL to pass to FvbWriteCacheUnlock.
+
+**/
+STATIC
+EFI_TPL
+FvbWriteCacheLock (
+  IN NVIDIA_FVB_WRITE_CACHE *Cache
+  )
+{
+  EFI_TPL OldTpl;
+
+  // Without a flush timer nothing can preempt the cache.
+  if (Cache->FlushEvent == NULL) {
+    return TPL_HIGH_LEVEL;
+  }
+
+  OldTpl = EfiGetCurrentTpl ();
+  if (OldTpl < TPL_NOTIFY) {
+    gBS->RaiseTPL (TPL_NOTIFY);
+  }
+  return OldTpl;
+}
+
+/**
+  Release the lock taken with FvbWriteCacheLock.
+
+  @param Cache  Write cache to unlock
+  @param OldTpl Value returned by FvbWriteCacheLock
+
+**/
+STATIC
+VOID
+FvbWriteCacheUnlock (
+  IN NVIDIA_FVB_WRITE_CACHE *Cache,
+  IN EFI_TPL                OldTpl
+  )
+{
+  if (OldTpl < TPL_NOTIFY) {
+    gBS->RestoreTPL (OldTpl);
+  }
+}
+
+/**
+  Write all queued updates to the flash. Caller must hold the cache lock.
+
+  @param Cache              Write cache to flush
+
+  @retval EFI_SUCCESS       All queued updates are on the flash.
+  @retval EFI_DEVICE_ERROR  A flash write failed.
+
+**/
+STATIC
+EFI_STATUS
+FvbFlushWriteCacheLocked (
+  IN NVIDIA_FVB_WRITE_CACHE *Cache
+  )
+{
+  EFI_STATUS                   Status;
+  UINTN                        Index;
+  NVIDIA_FVB_WRITE_CACHE_ENTRY *Entry;
+
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < Cache->NumEntries; Index++) {
+    Entry = &Cache->Entries[Index];
+    if (!EFI_ERROR (Status)) {
+      Status = Cache->NorFlashProtocol->Write (Cache->NorFlashProtocol,
+                                               Cache->PartitionOffset + Entry->Offset,
+                                               Entry->Size,
+                                               Cache->PartitionData + Entry->Offset);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((EFI_D_ERROR, "%a: FVB write failed. Recovered FVB could be corrupt.\n", __FUNCTION__));
+        ASSERT (FALSE);
+      }
+    }
+
+    // Keep the mirror in sync with whatever did not make it to the flash.
+    if (EFI_ERROR (Status)) {
+      Cache->NorFlashProtocol->Read (Cache->NorFlashProtocol,
+                                     Cache->PartitionOffset + Entry->Offset,
+                                     Entry->Size,
+                                     Cache->PartitionData + Entry->Offset);
+    }
+  }
+  Cache->NumEntries = 0;
+
+  return EFI_ERROR (Status) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+/**
+  Write all queued variable store updates to the flash.
+
+  @param Cache              Write cache to flush
+
+  @retval EFI_SUCCESS       All queued updates are on the flash.
+  @retval EFI_DEVICE_ERROR  A flash write failed. The mirror was re-read from
+                            the flash for every update that was dropped.
+
+**/
+EFI_STATUS
+FvbFlushWriteCache (
+  IN NVIDIA_FVB_WRITE_CACHE *Cache
+  )
+{
+  EFI_STATUS Status;
+  EFI_TPL    OldTpl;
+
+  OldTpl = FvbWriteCacheLock (Cache);
+  Status = FvbFlushWriteCacheLocked (Cache);
+  FvbWriteCacheUnlock (Cache, OldTpl);
+
+  return Status;
+}
+
+/**
+  Update the mirror and queue the range for a later flash write.
+
+  A write that directly follows the last queued write within the same sector
+  is merged into it. A write that overlaps anything already queued flushes
+  the cache first so the flash never sees a later update before an earlier
+  one.
+
+  @param Cache              Write cache
+  @param Offset             Offset within the partition
+  @param Size               Number of bytes, must not cross a sector
+  @param Buffer             Data to write
+
+  @retval EFI_SUCCESS       The data is in the mirror and queued.
+  @retval EFI_DEVICE_ERROR  Flushing earlier updates failed. Nothing was
+                            queued.
+
+**/
+STATIC
+EFI_STATUS
+FvbWriteCacheQueue (
+  IN NVIDIA_FVB_WRITE_CACHE *Cache,
+  IN UINT32                 Offset,
+  IN UINT32                 Size,
+  IN UINT8                  *Buffer
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_TPL                      OldTpl;
+  UINTN                        Index;
+  NVIDIA_FVB_WRITE_CACHE_ENTRY *Entry;
+  BOOLEAN                      Merge;
+  BOOLEAN                      Flush;
+
+  OldTpl = FvbWriteCacheLock (Cache);
+
+  Merge = FALSE;
+  Flush = (Cache->NumEntries == FVB_WRITE_CACHE_ENTRIES);
+  for (Index = 0; Index < Cache->NumEntries; Index++) {
+    Entry = &Cache->Entries[Index];
+    if ((Offset < (Entry->Offset + Entry->Size)) &&
+        (Entry->Offset < (Offset + Size))) {
+      Flush = TRUE;
+      break;
+    }
+  }
+
+  if (!Flush && (Cache->NumEntries != 0)) {
+    Entry = &Cache->Entries[Cache->NumEntries - 1];
+    Merge = ((Entry->Offset + Entry->Size) == Offset) &&
+            ((Entry->Offset / Cache->BlockSize) == (Offset / Cache->BlockSize));
+  }
+
+  if (Flush) {
+    Status = FvbFlushWriteCacheLocked (Cache);
+    if (EFI_ERROR (Status)) {
+      goto Exit;
+    }
+  }
+
+  CopyMem (Cache->PartitionData + Offset, Buffer, Size);
+  if (Merge) {
+    Cache->Entries[Cache->NumEntries - 1].Size += Size;
+  } else {
+    Cache->Entries[Cache->NumEntries].Offset = Offset;
+    Cache->Entries[Cache->NumEntries].Size = Size;
+    Cache->NumEntries++;
+    if ((Cache->NumEntries == 1) && (Cache->FlushEvent != NULL)) {
+      gBS->SetTimer (Cache->FlushEvent, TimerRelative, FVB_WRITE_CACHE_FLUSH_DELAY);
+    }
+  }
+  Status = EFI_SUCCESS;
+
+Exit:
+  FvbWriteCacheUnlock (Cache, OldTpl);
+  return Status;
+}
+
 /**
   Writes the specified number of bytes from the input buffer to the block.
 
@@ -407,8 +606,24 @@ FvbWrite (
     LbaBoundaryCrossed = TRUE;
   }
 
-  //Modify FVB
   FvbOffset = MultU64x32 (Lba, BlockSize) + Offset;
+
+  // Variable store updates are written back from the mirror later
+  if ((Private->PartitionData != NULL) && (Private->WriteCache != NULL)) {
+    Status = FvbWriteCacheQueue (Private->WriteCache, FvbOffset, *NumBytes, Buffer);
+    return (!EFI_ERROR(Status) && LbaBoundaryCrossed) ? EFI_BAD_BUFFER_SIZE : Status;
+  }
+
+  // FTW spare and working block updates record FTW progress, so every
+  // variable store update issued before them must be on the flash first.
+  if (Private->WriteCache != NULL) {
+    Status = FvbFlushWriteCache (Private->WriteCache);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  //Modify FVB
   if (Private->PartitionData != NULL) {
     CopyMem(Private->PartitionData + FvbOffset, Buffer, *NumBytes);
   }
@@ -505,9 +720,6 @@ FvbEraseBlocks (
 
   Private = NVIDIA_FVB_PRIVATE_DATA_FROM_FVB_PROTOCOL(This);
 
-  //If no blocks are passed in return should be invalid parameter.
-  Status = EFI_INVALID_PARAMETER;
-
   BlockSize = Private->FlashAttributes.BlockSize;
   LastBlock = (Private->PartitionSize / Private->FlashAttributes.BlockSize) - 1;
 
@@ -537,6 +749,17 @@ FvbEraseBlocks (
   } while (TRUE);
   VA_END (Args);
 
+  // Queued updates were issued before the erase and must land first
+  if (Private->WriteCache != NULL) {
+    Status = FvbFlushWriteCache (Private->WriteCache);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  //If no blocks are passed in return should be invalid parameter.
+  Status = EFI_INVALID_PARAMETER;
+
   //
   // To get here, all must be ok, so start erasing
   //
@@ -944,6 +1167,111 @@ InitializeWorkSpaceHeader (
   }
 }
 
+/**
+  Flush the variable store write cache once it has been dirty for
+  FVB_WRITE_CACHE_FLUSH_DELAY.
+
+  @param[in]    Event   The Event that is being processed
+  @param[in]    Context Write cache
+**/
+STATIC
+VOID
+EFIAPI
+FvbWriteCacheTimerNotify (
+  IN EFI_EVENT        Event,
+  IN VOID             *Context
+  )
+{
+  FvbFlushWriteCache ((NVIDIA_FVB_WRITE_CACHE *)Context);
+}
+
+/**
+  Flush the variable store write cache before the system resets.
+
+  @param[in]  ResetType         The type of reset to perform.
+  @param[in]  ResetStatus       The status code for the reset.
+  @param[in]  DataSize          The size, in bytes, of ResetData.
+  @param[in]  ResetData         Optional reset data.
+**/
+STATIC
+VOID
+EFIAPI
+FvbResetNotify (
+  IN EFI_RESET_TYPE           ResetType,
+  IN EFI_STATUS               ResetStatus,
+  IN UINTN                    DataSize,
+  IN VOID                     *ResetData OPTIONAL
+  )
+{
+  if (mFvbWriteCache != NULL) {
+    FvbFlushWriteCache (mFvbWriteCache);
+  }
+}
+
+/**
+  Register FvbResetNotify once the reset notification protocol is available.
+
+  @param[in]    Event   The Event that is being processed
+  @param[in]    Context Event Context
+**/
+STATIC
+VOID
+EFIAPI
+FvbResetNotificationInstalled (
+  IN EFI_EVENT        Event,
+  IN VOID             *Context
+  )
+{
+  EFI_STATUS Status;
+
+  Status = gBS->LocateProtocol (&gEfiResetNotificationProtocolGuid,
+                                NULL,
+                                (VOID **)&mFvbResetNotify);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Status = mFvbResetNotify->RegisterResetNotify (mFvbResetNotify, FvbResetNotify);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to register reset notification (%r)\r\n", __FUNCTION__, Status));
+    mFvbResetNotify = NULL;
+  }
+  gBS->CloseEvent (Event);
+}
+
+/**
+  Flush the variable store write cache and switch every FVB instance to
+  write-through before the OS takes over. No memory is allocated or freed.
+
+  @param[in]    Event   The Event that is being processed
+  @param[in]    Context Array of FVB_TO_CREATE FVB instances
+**/
+STATIC
+VOID
+EFIAPI
+FvbExitBootServicesNotify (
+  IN EFI_EVENT        Event,
+  IN VOID             *Context
+  )
+{
+  NVIDIA_FVB_PRIVATE_DATA *FvpData;
+  UINTN                   Index;
+
+  FvpData = (NVIDIA_FVB_PRIVATE_DATA *)Context;
+  if (mFvbWriteCache != NULL) {
+    FvbFlushWriteCache (mFvbWriteCache);
+  }
+
+  for (Index = 0; Index < FVB_TO_CREATE; Index++) {
+    FvpData[Index].WriteCache = NULL;
+  }
+  //
+  // FvbResetNotify stays registered, as unregistering it would free pool
+  // during ExitBootServices. It does nothing once the cache is gone.
+  //
+  mFvbWriteCache = NULL;
+}
+
 /**
   Initialize the FVB Driver
 
@@ -973,6 +1301,10 @@ FVBInitialize (
   VOID                        *FtwSpareBuffer;
   VOID                        *FtwWorkingBuffer;
   EFI_RT_PROPERTIES_TABLE     *RtProperties;
+  NVIDIA_FVB_WRITE_CACHE      *WriteCache;
+  EFI_EVENT                   ExitBootServicesEvent;
+  EFI_EVENT                   ResetNotificationEvent;
+  VOID                        *Registration;
 
 
   if (PcdGetBool(PcdEmuVariableNvModeEnable)) {
@@ -1069,6 +1401,9 @@ FVBInitialize (
   ASSERT (FtwSize > VariableSize);
 
   //Build FVB instances
+  WriteCache = NULL;
+  ExitBootServicesEvent = NULL;
+  ResetNotificationEvent = NULL;
   FvpData = NULL;
   FvpData = AllocateRuntimeZeroPool (sizeof (NVIDIA_FVB_PRIVATE_DATA) * FVB_TO_CREATE);
   if (FvpData == NULL) {
@@ -1193,6 +1528,55 @@ FVBInitialize (
     }
   }
 
+  //Enable write-back of variable store updates until ExitBootServices
+  WriteCache = AllocateZeroPool (sizeof (NVIDIA_FVB_WRITE_CACHE));
+  if (WriteCache == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to allocate write cache\r\n", __FUNCTION__));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+  WriteCache->NorFlashProtocol = NorFlashProtocol;
+  WriteCache->PartitionData = FvpData[FVB_VARIABLE_INDEX].PartitionData;
+  WriteCache->PartitionOffset = FvpData[FVB_VARIABLE_INDEX].PartitionOffset;
+  WriteCache->BlockSize = NorFlashAttributes.BlockSize;
+
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                             TPL_CALLBACK,
+                             FvbWriteCacheTimerNotify,
+                             WriteCache,
+                             &WriteCache->FlushEvent);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to create write cache flush event\r\n", __FUNCTION__));
+    goto Exit;
+  }
+
+  Status = gBS->CreateEventEx (EVT_NOTIFY_SIGNAL,
+                               TPL_NOTIFY,
+                               FvbExitBootServicesNotify,
+                               FvpData,
+                               &gEfiEventExitBootServicesGuid,
+                               &ExitBootServicesEvent);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to create exit boot services event\r\n", __FUNCTION__));
+    goto Exit;
+  }
+
+  ResetNotificationEvent = EfiCreateProtocolNotifyEvent (&gEfiResetNotificationProtocolGuid,
+                                                         TPL_CALLBACK,
+                                                         FvbResetNotificationInstalled,
+                                                         NULL,
+                                                         &Registration);
+  if (ResetNotificationEvent == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to create reset notification event\r\n", __FUNCTION__));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  mFvbWriteCache = WriteCache;
+  for (Index = 0; Index < FVB_TO_CREATE; Index++) {
+    FvpData[Index].WriteCache = WriteCache;
+  }
+
   Status = gBS->InstallMultipleProtocolInterfaces (&gImageHandle,
                                                    &gEdkiiNvVarStoreFormattedGuid,
                                                    NULL,
@@ -1213,6 +1597,19 @@ FVBInitialize (
 Exit:
 
   if (EFI_ERROR (Status)) {
+    if (ResetNotificationEvent != NULL) {
+      gBS->CloseEvent (ResetNotificationEvent);
+    }
+    if (ExitBootServicesEvent != NULL) {
+      gBS->CloseEvent (ExitBootServicesEvent);
+    }
+    if (WriteCache != NULL) {
+      if (WriteCache->FlushEvent != NULL) {
+        gBS->CloseEvent (WriteCache->FlushEvent);
+      }
+      FreePool (WriteCache);
+    }
+    mFvbWriteCache = NULL;
     for (Index = 0; Index < FVB_TO_CREATE; Index++) {
       if (FvpData[Index].FvbVirtualAddrChangeEvent != NULL) {
         gBS->CloseEvent(FvpData[Index].FvbVirtualAddrChangeEvent);
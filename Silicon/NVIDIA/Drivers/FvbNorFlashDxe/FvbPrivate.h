@@ -28,6 +28,7 @@
 
 #include <Protocol/FirmwareVolumeBlock.h>
 #include <Protocol/NorFlash.h>
+#include <Protocol/ResetNotification.h>
 #include <Uefi/UefiGpt.h>
 
 #include <Guid/VariableFormat.h>
@@ -37,6 +38,30 @@
 #define UEFI_VARIABLE_PARTITION_NAME L"uefi_variables"
 #define FTW_PARTITION_NAME L"uefi_ftw"
 
+//
+// Write-back cache for the variable store mirror. Writes are queued in the
+// order they were issued; an entry never spans a sector and entries never
+// overlap, so flushing them in order leaves the flash in a state that the
+// write-through driver could also have produced.
+//
+#define FVB_WRITE_CACHE_ENTRIES     32
+#define FVB_WRITE_CACHE_FLUSH_DELAY EFI_TIMER_PERIOD_MILLISECONDS (50)
+
+typedef struct {
+  UINT32                              Offset;
+  UINT32                              Size;
+} NVIDIA_FVB_WRITE_CACHE_ENTRY;
+
+typedef struct {
+  NVIDIA_NOR_FLASH_PROTOCOL           *NorFlashProtocol;
+  UINT8                               *PartitionData;
+  UINT32                              PartitionOffset;
+  UINT32                              BlockSize;
+  EFI_EVENT                           FlushEvent;
+  UINTN                               NumEntries;
+  NVIDIA_FVB_WRITE_CACHE_ENTRY        Entries[FVB_WRITE_CACHE_ENTRIES];
+} NVIDIA_FVB_WRITE_CACHE;
+
 typedef struct {
   UINT32                              Signature;
   NVIDIA_NOR_FLASH_PROTOCOL           *NorFlashProtocol;
@@ -48,6 +73,7 @@ typedef struct {
   EFI_PHYSICAL_ADDRESS                PartitionAddress;
   EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL FvbProtocol;
   EFI_HANDLE                          Handle;
+  NVIDIA_FVB_WRITE_CACHE              *WriteCache;
 } NVIDIA_FVB_PRIVATE_DATA;
 
 #define NVIDIA_FVB_SIGNATURE SIGNATURE_32('N','F','V','B')
@@ -61,4 +87,19 @@ typedef struct {
 
 #define FVB_ERASED_BYTE 0xFF
 
+/**
+  Write all queued variable store updates to the flash.
+
+  @param Cache              Write cache to flush
+
+  @retval EFI_SUCCESS       All queued updates are on the flash.
+  @retval EFI_DEVICE_ERROR  A flash write failed. The mirror was re-read from
+                            the flash for every update that was dropped.
+
+**/
+EFI_STATUS
+FvbFlushWriteCache (
+  IN NVIDIA_FVB_WRITE_CACHE *Cache
+  );
+
 #endif
@@ -0,0 +1,89 @@
+/** @file
+  Unit test definitions for the NOR flash Fvb driver.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _FVB_NOR_FLASH_DXE_TEST_PRIVATE_H_
+#define _FVB_NOR_FLASH_DXE_TEST_PRIVATE_H_
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#include <Library/FlashStubLib.h>
+
+// So that we can reference FvbPrivate declarations
+#include "../FvbPrivate.h"
+
+// Fvb Functions we want to test
+
+/**
+  Reads the specified number of bytes into a buffer from the specified block.
+
+  @param This     Indicates the EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL instance.
+  @param Lba      The starting logical block index from which to read.
+  @param Offset   Offset into the block at which to begin reading.
+  @param NumBytes Pointer to a UINTN. At entry, *NumBytes contains the total
+                  size of the buffer. At exit, *NumBytes contains the total
+                  number of bytes read.
+  @param Buffer   Pointer to a caller-allocated buffer that will be used to
+                  hold the data that is read.
+
+**/
+EFI_STATUS
+EFIAPI
+FvbRead (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL   *This,
+  IN        EFI_LBA                               Lba,
+  IN        UINTN                                 Offset,
+  IN OUT    UINTN                                 *NumBytes,
+  IN OUT    UINT8                                 *Buffer
+);
+
+/**
+  Writes the specified number of bytes from the input buffer to the block.
+
+  @param This     Indicates the EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL instance.
+  @param Lba      The starting logical block index to write to.
+  @param Offset   Offset into the block at which to begin writing.
+  @param NumBytes The pointer to a UINTN. At entry, *NumBytes contains the
+                  total size of the buffer. At exit, *NumBytes contains the
+                  total number of bytes actually written.
+  @param Buffer   The pointer to a caller-allocated buffer that contains the
+                  source for the write.
+
+**/
+EFI_STATUS
+EFIAPI
+FvbWrite (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL   *This,
+  IN        EFI_LBA                               Lba,
+  IN        UINTN                                 Offset,
+  IN OUT    UINTN                                 *NumBytes,
+  IN        UINT8                                 *Buffer
+);
+
+/**
+  Erases and initializes a firmware volume block.
+
+  @param This   Indicates the EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL instance.
+  @param ...    The variable argument list is a list of tuples. Each tuple
+                describes a range of LBAs to erase. The list is terminated
+                with an EFI_LBA_LIST_TERMINATOR.
+
+**/
+EFI_STATUS
+EFIAPI
+FvbEraseBlocks (
+  IN CONST EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL *This,
+  ...
+);
+
+#endif
@@ -0,0 +1,570 @@
+/** @file
+  Unit tests of the NOR flash Fvb driver. Primarily tests the
+  variable store write cache, counting the device operations that
+  reach the flash and checking that queued updates are flushed at
+  the expected barriers.
+
+  Tests are run using a NOR flash stub.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#include <Library/FlashStubLib.h>
+
+#include <FvbNorFlashDxeTestPrivate.h>
+
+#define UNIT_TEST_APP_NAME     "FvbNorFlashDxe Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "0.1"
+
+#define BLOCK_SIZE      512
+#define VARIABLE_BLOCKS 4
+#define WORK_BLOCKS     2
+#define NUM_BLOCKS      (VARIABLE_BLOCKS + WORK_BLOCKS)
+#define WRITE_SIZE      16
+
+STATIC NVIDIA_NOR_FLASH_PROTOCOL  *NorFlash;
+STATIC NVIDIA_FVB_PRIVATE_DATA    *VariableFvb;
+STATIC NVIDIA_FVB_PRIVATE_DATA    *WorkFvb;
+STATIC NVIDIA_FVB_WRITE_CACHE     *WriteCache;
+STATIC UINT8                      *TestFlashStorage;
+STATIC UINT8                      *TestVariablePartition;
+STATIC UINT8                      *TestBuffer;
+
+/**
+  Write Size bytes of Value to the variable store FVB.
+
+  @param Offset   Offset from the start of the variable partition
+  @param Size     Number of bytes to write
+  @param Value    Byte value to write
+
+  @return Status returned by FvbWrite.
+**/
+STATIC
+EFI_STATUS
+WriteVariableFvb (
+  IN UINTN  Offset,
+  IN UINTN  Size,
+  IN UINT8  Value
+) {
+  SetMem(TestBuffer, Size, Value);
+  return VariableFvb->FvbProtocol.Write(
+    &VariableFvb->FvbProtocol,
+    Offset / BLOCK_SIZE,
+    Offset % BLOCK_SIZE,
+    &Size,
+    TestBuffer
+  );
+}
+
+/**
+  Get the device operations issued since the last call.
+
+  @return Pointer to a static FLASH_STUB_IO_COUNTS.
+**/
+STATIC
+FLASH_STUB_IO_COUNTS *
+GetIoCounts (
+  VOID
+) {
+  STATIC FLASH_STUB_IO_COUNTS IoCounts;
+
+  NorFlashStubGetIoCounts(NorFlash, &IoCounts);
+  return &IoCounts;
+}
+
+/**
+  Performs setup for the write cache tests.
+
+  Erases the flash and the in-memory mirror, empties the write cache and
+  resets the device operation counters.
+
+  @param Context            Not used by this function
+
+  @retval UNIT_TEST_PASSED  Setup finished successfully.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteCacheTestSetup(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  SetMem(TestFlashStorage, NUM_BLOCKS * BLOCK_SIZE, FVB_ERASED_BYTE);
+  SetMem(TestVariablePartition, VARIABLE_BLOCKS * BLOCK_SIZE, FVB_ERASED_BYTE);
+  ZeroMem(WriteCache->Entries, sizeof(WriteCache->Entries));
+  WriteCache->NumEntries = 0;
+  VariableFvb->WriteCache = WriteCache;
+  WorkFvb->WriteCache = WriteCache;
+  GetIoCounts();
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that sequential writes within a sector are held back and then
+  written with a single device write when the cache is flushed.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteCacheCoalesceTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINTN   Index;
+
+  for (Index = 0; Index < 4; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(Index * WRITE_SIZE, WRITE_SIZE, 0x55));
+  }
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 0);
+  UT_ASSERT_EQUAL(WriteCache->NumEntries, 1);
+
+  // The mirror is up to date, the flash is not yet
+  SetMem(TestBuffer, 4 * WRITE_SIZE, 0x55);
+  UT_ASSERT_MEM_EQUAL(TestVariablePartition, TestBuffer, 4 * WRITE_SIZE);
+  UT_ASSERT_EQUAL(TestFlashStorage[0], FVB_ERASED_BYTE);
+
+  UT_ASSERT_NOT_EFI_ERROR(FvbFlushWriteCache(WriteCache));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 1);
+  UT_ASSERT_MEM_EQUAL(TestFlashStorage, TestVariablePartition, VARIABLE_BLOCKS * BLOCK_SIZE);
+
+  // Nothing left to flush
+  UT_ASSERT_NOT_EFI_ERROR(FvbFlushWriteCache(WriteCache));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a write overlapping a queued write flushes the queue first,
+  so the update reaches the flash after the data it overwrites.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteCacheOverlapTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  // Header followed by data, then a state update inside the header
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(0, WRITE_SIZE, 0x7F));
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(WRITE_SIZE, WRITE_SIZE, 0x55));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 0);
+
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(1, 1, 0x3F));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 1);
+  UT_ASSERT_EQUAL(TestFlashStorage[0], 0x7F);
+  UT_ASSERT_EQUAL(TestFlashStorage[1], 0x7F);
+  UT_ASSERT_EQUAL(TestFlashStorage[WRITE_SIZE], 0x55);
+
+  UT_ASSERT_NOT_EFI_ERROR(FvbFlushWriteCache(WriteCache));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 1);
+  UT_ASSERT_EQUAL(TestFlashStorage[1], 0x3F);
+  UT_ASSERT_MEM_EQUAL(TestFlashStorage, TestVariablePartition, VARIABLE_BLOCKS * BLOCK_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that adjacent writes in different sectors are not merged.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteCacheSectorBoundaryTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(BLOCK_SIZE - WRITE_SIZE, WRITE_SIZE, 0x55));
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(BLOCK_SIZE, WRITE_SIZE, 0x55));
+  UT_ASSERT_EQUAL(WriteCache->NumEntries, 2);
+
+  UT_ASSERT_NOT_EFI_ERROR(FvbFlushWriteCache(WriteCache));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 2);
+  UT_ASSERT_MEM_EQUAL(TestFlashStorage, TestVariablePartition, VARIABLE_BLOCKS * BLOCK_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a full cache is flushed before another range is queued.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteCacheFullTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINTN   Index;
+
+  // Leave a gap between writes so that none of them are merged
+  for (Index = 0; Index < FVB_WRITE_CACHE_ENTRIES; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(Index * 2 * WRITE_SIZE, WRITE_SIZE, 0x55));
+  }
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 0);
+
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(Index * 2 * WRITE_SIZE, WRITE_SIZE, 0x55));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, FVB_WRITE_CACHE_ENTRIES);
+  UT_ASSERT_EQUAL(WriteCache->NumEntries, 1);
+
+  UT_ASSERT_NOT_EFI_ERROR(FvbFlushWriteCache(WriteCache));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 1);
+  UT_ASSERT_MEM_EQUAL(TestFlashStorage, TestVariablePartition, VARIABLE_BLOCKS * BLOCK_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a write to the FTW working block flushes queued variable store
+  updates before it is written.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteCacheFtwBarrierTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS  Status;
+  UINTN       NumBytes;
+
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(0, WRITE_SIZE, 0x55));
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 0);
+
+  NumBytes = WRITE_SIZE;
+  SetMem(TestBuffer, NumBytes, 0x33);
+  Status = WorkFvb->FvbProtocol.Write(
+    &WorkFvb->FvbProtocol,
+    0,
+    0,
+    &NumBytes,
+    TestBuffer
+  );
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 2);
+  UT_ASSERT_EQUAL(WriteCache->NumEntries, 0);
+  UT_ASSERT_EQUAL(TestFlashStorage[0], 0x55);
+  UT_ASSERT_EQUAL(TestFlashStorage[VARIABLE_BLOCKS * BLOCK_SIZE], 0x33);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that EraseBlocks flushes queued updates before erasing.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteCacheEraseBarrierTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS            Status;
+  FLASH_STUB_IO_COUNTS  *IoCounts;
+
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(0, WRITE_SIZE, 0x55));
+  UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(BLOCK_SIZE, WRITE_SIZE, 0x55));
+
+  Status = VariableFvb->FvbProtocol.EraseBlocks(
+    &VariableFvb->FvbProtocol,
+    (EFI_LBA) 1,
+    (UINTN) 1,
+    EFI_LBA_LIST_TERMINATOR
+  );
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  IoCounts = GetIoCounts();
+  UT_ASSERT_EQUAL(IoCounts->Writes, 2);
+  UT_ASSERT_EQUAL(IoCounts->Erases, 1);
+  UT_ASSERT_EQUAL(WriteCache->NumEntries, 0);
+  UT_ASSERT_EQUAL(TestFlashStorage[0], 0x55);
+  UT_ASSERT_EQUAL(TestFlashStorage[BLOCK_SIZE], FVB_ERASED_BYTE);
+  UT_ASSERT_MEM_EQUAL(TestFlashStorage, TestVariablePartition, VARIABLE_BLOCKS * BLOCK_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that without a write cache every write reaches the flash.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteThroughTest(
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINTN   Index;
+
+  VariableFvb->WriteCache = NULL;
+  WorkFvb->WriteCache = NULL;
+
+  for (Index = 0; Index < 4; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR(WriteVariableFvb(Index * WRITE_SIZE, WRITE_SIZE, 0x55));
+  }
+  UT_ASSERT_EQUAL(GetIoCounts()->Writes, 4);
+  UT_ASSERT_MEM_EQUAL(TestFlashStorage, TestVariablePartition, VARIABLE_BLOCKS * BLOCK_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize one FVB instance on the NOR flash stub.
+
+  @param Private          FVB instance to initialize
+  @param PartitionData    In-memory mirror, or NULL
+  @param PartitionOffset  Offset of the partition on the flash
+  @param PartitionSize    Size of the partition
+**/
+STATIC
+VOID
+InitFvbInstance(
+  IN NVIDIA_FVB_PRIVATE_DATA  *Private,
+  IN UINT8                    *PartitionData,
+  IN UINT32                   PartitionOffset,
+  IN UINT32                   PartitionSize
+) {
+  Private->Signature = NVIDIA_FVB_SIGNATURE;
+  Private->NorFlashProtocol = NorFlash;
+  NorFlash->GetAttributes(NorFlash, &Private->FlashAttributes);
+  Private->PartitionData = PartitionData;
+  Private->PartitionOffset = PartitionOffset;
+  Private->PartitionSize = PartitionSize;
+  Private->PartitionAddress = (UINTN)PartitionData;
+  Private->FvbProtocol.Read = FvbRead;
+  Private->FvbProtocol.Write = FvbWrite;
+  Private->FvbProtocol.EraseBlocks = FvbEraseBlocks;
+  Private->FvbProtocol.ParentHandle = NULL;
+}
+
+/**
+  Initializes data that will be used for the Fvb tests.
+
+  Allocates space for flash storage, the in-memory variable partition, and
+  a buffer used for testing. Sets up a NOR flash stub, a variable store FVB
+  and an FTW working block FVB that share one write cache.
+**/
+STATIC
+VOID
+InitTestData(
+  VOID
+) {
+  TestFlashStorage = AllocatePool(NUM_BLOCKS * BLOCK_SIZE);
+  TestVariablePartition = AllocatePool(VARIABLE_BLOCKS * BLOCK_SIZE);
+  TestBuffer = AllocatePool(BLOCK_SIZE);
+  VariableFvb = AllocateZeroPool(sizeof(NVIDIA_FVB_PRIVATE_DATA));
+  WorkFvb = AllocateZeroPool(sizeof(NVIDIA_FVB_PRIVATE_DATA));
+  WriteCache = AllocateZeroPool(sizeof(NVIDIA_FVB_WRITE_CACHE));
+
+  NorFlashStubInitialize(
+    TestFlashStorage,
+    NUM_BLOCKS * BLOCK_SIZE,
+    BLOCK_SIZE,
+    &NorFlash
+  );
+
+  InitFvbInstance(VariableFvb, TestVariablePartition, 0, VARIABLE_BLOCKS * BLOCK_SIZE);
+  InitFvbInstance(WorkFvb, NULL, VARIABLE_BLOCKS * BLOCK_SIZE, WORK_BLOCKS * BLOCK_SIZE);
+
+  WriteCache->NorFlashProtocol = NorFlash;
+  WriteCache->PartitionData = TestVariablePartition;
+  WriteCache->PartitionOffset = 0;
+  WriteCache->BlockSize = BLOCK_SIZE;
+  WriteCache->FlushEvent = NULL;
+}
+
+/**
+  Cleans up the data used by the Fvb tests.
+**/
+STATIC
+VOID
+CleanUpTestData(
+  VOID
+) {
+  if (NorFlash != NULL) {
+    NorFlashStubDestroy(NorFlash);
+    NorFlash = NULL;
+  }
+
+  if (WriteCache != NULL) {
+    FreePool(WriteCache);
+  }
+
+  if (WorkFvb != NULL) {
+    FreePool(WorkFvb);
+  }
+
+  if (VariableFvb != NULL) {
+    FreePool(VariableFvb);
+  }
+
+  if (TestFlashStorage != NULL) {
+    FreePool(TestFlashStorage);
+  }
+
+  if (TestVariablePartition != NULL) {
+    FreePool(TestVariablePartition);
+  }
+
+  if (TestBuffer != NULL) {
+    FreePool(TestBuffer);
+  }
+}
+
+/**
+  Initialze the unit test framework, suite, and unit tests for the
+  NOR flash Fvb driver and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry(
+  VOID
+) {
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      WriteCacheTestSuite;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  InitTestData();
+
+  // Start setting up the test framework for running the tests.
+  Status = InitUnitTestFramework(
+    &Fw,
+    UNIT_TEST_APP_NAME,
+    gEfiCallerBaseName,
+    UNIT_TEST_APP_VERSION
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in InitUnitTestFramework. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Populate the Fvb Write Cache Unit Test Suite.
+  Status = CreateUnitTestSuite(
+    &WriteCacheTestSuite,
+    Fw,
+    "Fvb Write Cache Tests",
+    "FvbNorFlashDxe.WriteCacheTestSuite",
+    NULL,
+    NULL
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in CreateUnitTestSuite for WriteCacheTestSuite\n")
+    );
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // AddTestCase Args:
+  //  Suite | Description
+  //  Class Name | Function
+  //  Pre | Post | Context
+  AddTestCase(WriteCacheTestSuite, "Sequential Writes Coalesce Test",
+              "WriteCacheCoalesceTest", WriteCacheCoalesceTest,
+              WriteCacheTestSetup, NULL, NULL);
+  AddTestCase(WriteCacheTestSuite, "Overlapping Write Flush Test",
+              "WriteCacheOverlapTest", WriteCacheOverlapTest,
+              WriteCacheTestSetup, NULL, NULL);
+  AddTestCase(WriteCacheTestSuite, "Sector Boundary Test",
+              "WriteCacheSectorBoundaryTest", WriteCacheSectorBoundaryTest,
+              WriteCacheTestSetup, NULL, NULL);
+  AddTestCase(WriteCacheTestSuite, "Full Cache Flush Test",
+              "WriteCacheFullTest", WriteCacheFullTest,
+              WriteCacheTestSetup, NULL, NULL);
+  AddTestCase(WriteCacheTestSuite, "FTW Write Barrier Test",
+              "WriteCacheFtwBarrierTest", WriteCacheFtwBarrierTest,
+              WriteCacheTestSetup, NULL, NULL);
+  AddTestCase(WriteCacheTestSuite, "EraseBlocks Barrier Test",
+              "WriteCacheEraseBarrierTest", WriteCacheEraseBarrierTest,
+              WriteCacheTestSetup, NULL, NULL);
+  AddTestCase(WriteCacheTestSuite, "Write Through Test",
+              "WriteThroughTest", WriteThroughTest,
+              WriteCacheTestSetup, NULL, NULL);
+
+  // Execute the tests.
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  CleanUpTestData();
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based
+  unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+BaseLibUnitTestAppEntry(
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+) {
+  return UnitTestingEntry();
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main(
+  int argc,
+  char *argv[]
+) {
+  return UnitTestingEntry ();
+}
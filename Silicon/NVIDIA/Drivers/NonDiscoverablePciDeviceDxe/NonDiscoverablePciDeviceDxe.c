@@ -224,6 +224,8 @@ NonDiscoverablePciDeviceStop (
   gBS->CloseProtocol (DeviceHandle, &gEdkiiNonDiscoverableDeviceProtocolGuid,
          This->DriverBindingHandle, DeviceHandle);
 
+  ReleasePciIoMapPool (Dev);
+
   FreePool (Dev);
 
   return EFI_SUCCESS;
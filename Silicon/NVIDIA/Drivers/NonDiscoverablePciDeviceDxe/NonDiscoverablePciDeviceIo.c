@@ -20,12 +20,45 @@
 #include <PlatformToDriverStructures.h>
 
 typedef struct {
+  LIST_ENTRY                      Link;
   EFI_PHYSICAL_ADDRESS            AllocAddress;
+  UINTN                           AllocPages;
   VOID                            *HostAddress;
   EFI_PCI_IO_PROTOCOL_OPERATION   Operation;
   UINTN                           NumberOfBytes;
 } NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO;
 
+//
+// Cache of GCD memory space descriptors found to be cacheable by
+// NonCoherentPciIoMap(). Streaming mappings that hit one of these ranges are
+// bounced without another GCD lookup. Since bouncing is always correct for
+// streaming DMA, a stale entry can only cost performance; the cache is still
+// flushed whenever this driver changes memory space attributes.
+//
+#define CACHEABLE_RANGE_CACHE_SIZE  4
+
+typedef struct {
+  EFI_PHYSICAL_ADDRESS            BaseAddress;
+  UINT64                          Length;
+} CACHEABLE_RANGE;
+
+STATIC CACHEABLE_RANGE  mCacheableRanges[CACHEABLE_RANGE_CACHE_SIZE];
+STATIC UINTN            mCacheableRangeNext;
+
+/**
+  Drop all entries from the cacheable range cache.
+
+**/
+STATIC
+VOID
+FlushCacheableRangeCache (
+  VOID
+  )
+{
+  ZeroMem (mCacheableRanges, sizeof (mCacheableRanges));
+  mCacheableRangeNext = 0;
+}
+
 /**
   Get the resource associated with BAR number 'BarIndex'.
 
@@ -969,6 +1002,7 @@ NonCoherentPciIoFreeBuffer (
 
   RemoveEntryList (&Alloc->List);
 
+  FlushCacheableRangeCache ();
   Status = gDS->SetMemorySpaceAttributes (
                   (EFI_PHYSICAL_ADDRESS)(UINTN)HostAddress,
                   EFI_PAGES_TO_SIZE (Pages),
@@ -1079,6 +1113,7 @@ NonCoherentPciIoAllocateBuffer (
   //
   InsertHeadList (&Dev->UncachedAllocationList, &Alloc->List);
 
+  FlushCacheableRangeCache ();
   Status = gDS->SetMemorySpaceAttributes (
                   (EFI_PHYSICAL_ADDRESS)(UINTN)AllocAddress,
                   EFI_PAGES_TO_SIZE (Pages),
@@ -1109,6 +1144,268 @@ FreeBuffer:
   return Status;
 }
 
+/**
+  Check whether the host address refers to cacheable memory, in which case
+  a non-coherent mapping of it has to be bounced.
+
+  @param  HostAddress           The system memory address to check.
+  @param  UseCache              Whether the cacheable range cache may be used.
+
+  @retval TRUE                  The memory is cacheable or its attributes are unknown.
+  @retval FALSE                 The memory is mapped uncached.
+
+**/
+STATIC
+BOOLEAN
+IsCacheableHostAddress (
+  IN  VOID                        *HostAddress,
+  IN  BOOLEAN                     UseCache
+  )
+{
+  EFI_PHYSICAL_ADDRESS            Address;
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR GcdDescriptor;
+  EFI_STATUS                      Status;
+  UINTN                           Index;
+
+  Address = (EFI_PHYSICAL_ADDRESS)(UINTN)HostAddress;
+
+  if (UseCache) {
+    for (Index = 0; Index < CACHEABLE_RANGE_CACHE_SIZE; Index++) {
+      if (mCacheableRanges[Index].Length != 0 &&
+          Address >= mCacheableRanges[Index].BaseAddress &&
+          Address - mCacheableRanges[Index].BaseAddress < mCacheableRanges[Index].Length) {
+        return TRUE;
+      }
+    }
+  }
+
+  Status = gDS->GetMemorySpaceDescriptor (Address, &GcdDescriptor);
+  if (EFI_ERROR (Status)) {
+    return TRUE;
+  }
+
+  if ((GcdDescriptor.Attributes & (EFI_MEMORY_WB|EFI_MEMORY_WT)) == 0) {
+    return FALSE;
+  }
+
+  mCacheableRanges[mCacheableRangeNext].BaseAddress = GcdDescriptor.BaseAddress;
+  mCacheableRanges[mCacheableRangeNext].Length = GcdDescriptor.Length;
+  mCacheableRangeNext = (mCacheableRangeNext + 1) % CACHEABLE_RANGE_CACHE_SIZE;
+  return TRUE;
+}
+
+/**
+  Get a map info structure, reusing one released by Unmap() if possible.
+
+  @param  Dev                   Point to the NON_DISCOVERABLE_PCI_DEVICE instance.
+
+  @return The map info structure, or NULL if out of resources.
+
+**/
+STATIC
+NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO *
+AcquireMapInfo (
+  IN  NON_DISCOVERABLE_PCI_DEVICE *Dev
+  )
+{
+  NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO  *MapInfo;
+
+  if (!IsListEmpty (&Dev->FreeMapInfoList)) {
+    MapInfo = BASE_CR (GetFirstNode (&Dev->FreeMapInfoList),
+                NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO, Link);
+    RemoveEntryList (&MapInfo->Link);
+    Dev->FreeMapInfoCount--;
+  } else {
+    MapInfo = AllocatePool (sizeof *MapInfo);
+    if (MapInfo == NULL) {
+      return NULL;
+    }
+  }
+
+  MapInfo->AllocAddress = 0;
+  MapInfo->AllocPages = 0;
+  return MapInfo;
+}
+
+/**
+  Get the bounce buffer size class for the given number of pages.
+
+  @param  Pages                 The number of pages needed.
+
+  @return The size class, or NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES if the
+          buffer is too large to be pooled.
+
+**/
+STATIC
+UINTN
+GetBounceClass (
+  IN  UINTN                       Pages
+  )
+{
+  UINTN                           Class;
+
+  for (Class = 0; Class < NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES; Class++) {
+    if (Pages <= ((UINTN)1 << Class)) {
+      break;
+    }
+  }
+  return Class;
+}
+
+/**
+  Get a map info structure with a bounce buffer of at least the given number
+  of pages, reusing a pooled bounce buffer if possible.
+
+  @param  This                  A pointer to the EFI_PCI_IO_PROTOCOL instance.
+  @param  Pages                 The number of pages needed.
+  @param  MapInfo               The resulting map info structure.
+
+  @retval EFI_SUCCESS           The bounce buffer was acquired.
+  @retval other                 The bounce buffer could not be allocated.
+
+**/
+STATIC
+EFI_STATUS
+AcquireBounceMapInfo (
+  IN  EFI_PCI_IO_PROTOCOL                   *This,
+  IN  UINTN                                 Pages,
+  OUT NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO  **MapInfo
+  )
+{
+  NON_DISCOVERABLE_PCI_DEVICE           *Dev;
+  NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO  *Info;
+  UINTN                                 Class;
+  VOID                                  *AllocAddress;
+  EFI_STATUS                            Status;
+
+  Dev = NON_DISCOVERABLE_PCI_DEVICE_FROM_PCI_IO(This);
+
+  Class = GetBounceClass (Pages);
+  if (Class < NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES) {
+    while (!IsListEmpty (&Dev->BounceBufferList[Class])) {
+      Info = BASE_CR (GetFirstNode (&Dev->BounceBufferList[Class]),
+               NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO, Link);
+      RemoveEntryList (&Info->Link);
+      Dev->BounceBufferCount[Class]--;
+
+      //
+      // A buffer pooled while dual address cycle was enabled may be above
+      // 4 GB; it cannot be used once the attribute has been cleared.
+      //
+      if ((Dev->Attributes & EFI_PCI_IO_ATTRIBUTE_DUAL_ADDRESS_CYCLE) == 0 &&
+          Info->AllocAddress + EFI_PAGES_TO_SIZE (Info->AllocPages) > SIZE_4GB) {
+        NonCoherentPciIoFreeBuffer (This, Info->AllocPages,
+          (VOID *)(UINTN)Info->AllocAddress);
+        FreePool (Info);
+        continue;
+      }
+
+      *MapInfo = Info;
+      return EFI_SUCCESS;
+    }
+    Pages = (UINTN)1 << Class;
+  }
+
+  Info = AcquireMapInfo (Dev);
+  if (Info == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = NonCoherentPciIoAllocateBuffer (This, AllocateAnyPages,
+             EfiBootServicesData, Pages, &AllocAddress,
+             EFI_PCI_ATTRIBUTE_MEMORY_WRITE_COMBINE);
+  if (EFI_ERROR (Status)) {
+    FreePool (Info);
+    return Status;
+  }
+
+  Info->AllocAddress = (EFI_PHYSICAL_ADDRESS)(UINTN)AllocAddress;
+  Info->AllocPages = Pages;
+  *MapInfo = Info;
+  return EFI_SUCCESS;
+}
+
+/**
+  Release a map info structure, and its bounce buffer if it has one, to the
+  device pools. Anything the pools have no room for is freed.
+
+  @param  This                  A pointer to the EFI_PCI_IO_PROTOCOL instance.
+  @param  MapInfo               The map info structure to release.
+
+**/
+STATIC
+VOID
+ReleaseMapInfo (
+  IN  EFI_PCI_IO_PROTOCOL                   *This,
+  IN  NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO  *MapInfo
+  )
+{
+  NON_DISCOVERABLE_PCI_DEVICE           *Dev;
+  UINTN                                 Class;
+
+  Dev = NON_DISCOVERABLE_PCI_DEVICE_FROM_PCI_IO(This);
+
+  if (MapInfo->AllocAddress != 0) {
+    Class = GetBounceClass (MapInfo->AllocPages);
+    if (Class < NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES &&
+        MapInfo->AllocPages == ((UINTN)1 << Class) &&
+        Dev->BounceBufferCount[Class] < NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASS_DEPTH) {
+      InsertHeadList (&Dev->BounceBufferList[Class], &MapInfo->Link);
+      Dev->BounceBufferCount[Class]++;
+      return;
+    }
+
+    NonCoherentPciIoFreeBuffer (This, MapInfo->AllocPages,
+      (VOID *)(UINTN)MapInfo->AllocAddress);
+    MapInfo->AllocAddress = 0;
+    MapInfo->AllocPages = 0;
+  }
+
+  if (Dev->FreeMapInfoCount < NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO_DEPTH) {
+    InsertHeadList (&Dev->FreeMapInfoList, &MapInfo->Link);
+    Dev->FreeMapInfoCount++;
+    return;
+  }
+
+  FreePool (MapInfo);
+}
+
+/**
+  Free the map info structures and bounce buffers kept for reuse by the
+  PciIo Map() implementation.
+
+  @param  Dev               Point to NON_DISCOVERABLE_PCI_DEVICE instance.
+
+**/
+VOID
+ReleasePciIoMapPool (
+  NON_DISCOVERABLE_PCI_DEVICE     *Dev
+  )
+{
+  NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO  *MapInfo;
+  UINTN                                 Class;
+
+  for (Class = 0; Class < NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES; Class++) {
+    while (!IsListEmpty (&Dev->BounceBufferList[Class])) {
+      MapInfo = BASE_CR (GetFirstNode (&Dev->BounceBufferList[Class]),
+                  NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO, Link);
+      RemoveEntryList (&MapInfo->Link);
+      NonCoherentPciIoFreeBuffer (&Dev->PciIo, MapInfo->AllocPages,
+        (VOID *)(UINTN)MapInfo->AllocAddress);
+      FreePool (MapInfo);
+    }
+    Dev->BounceBufferCount[Class] = 0;
+  }
+
+  while (!IsListEmpty (&Dev->FreeMapInfoList)) {
+    MapInfo = BASE_CR (GetFirstNode (&Dev->FreeMapInfoList),
+                NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO, Link);
+    RemoveEntryList (&MapInfo->Link);
+    FreePool (MapInfo);
+  }
+  Dev->FreeMapInfoCount = 0;
+}
+
 /**
   Provides the PCI controller-specific addresses needed to access system memory.
 
@@ -1144,8 +1441,6 @@ NonCoherentPciIoMap (
   EFI_STATUS                            Status;
   NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO  *MapInfo;
   UINTN                                 AlignMask;
-  VOID                                  *AllocAddress;
-  EFI_GCD_MEMORY_SPACE_DESCRIPTOR       GcdDescriptor;
   BOOLEAN                               Bounce;
 
   if (HostAddress   == NULL ||
@@ -1161,15 +1456,6 @@ NonCoherentPciIoMap (
     return EFI_INVALID_PARAMETER;
   }
 
-  MapInfo = AllocatePool (sizeof *MapInfo);
-  if (MapInfo == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
-  MapInfo->HostAddress = HostAddress;
-  MapInfo->Operation = Operation;
-  MapInfo->NumberOfBytes = *NumberOfBytes;
-
   Dev = NON_DISCOVERABLE_PCI_DEVICE_FROM_PCI_IO(This);
 
   //
@@ -1196,14 +1482,11 @@ NonCoherentPciIoMap (
     case EfiPciIoOperationBusMasterCommonBuffer:
       //
       // Check whether the host address refers to an uncached mapping.
+      // Common buffers always get a fresh lookup, since bouncing them is
+      // not possible.
       //
-      Status = gDS->GetMemorySpaceDescriptor (
-                      (EFI_PHYSICAL_ADDRESS)(UINTN)HostAddress,
-                      &GcdDescriptor);
-      if (EFI_ERROR (Status) ||
-          (GcdDescriptor.Attributes & (EFI_MEMORY_WB|EFI_MEMORY_WT)) != 0) {
-        Bounce = TRUE;
-      }
+      Bounce = IsCacheableHostAddress (HostAddress,
+                 Operation != EfiPciIoOperationBusMasterCommonBuffer);
       break;
 
     default:
@@ -1213,23 +1496,24 @@ NonCoherentPciIoMap (
 
   if (Bounce) {
     if (Operation == EfiPciIoOperationBusMasterCommonBuffer) {
-      Status = EFI_DEVICE_ERROR;
-      goto FreeMapInfo;
+      return EFI_DEVICE_ERROR;
     }
 
-    Status = NonCoherentPciIoAllocateBuffer (This, AllocateAnyPages,
-               EfiBootServicesData, EFI_SIZE_TO_PAGES (MapInfo->NumberOfBytes),
-               &AllocAddress, EFI_PCI_ATTRIBUTE_MEMORY_WRITE_COMBINE);
+    Status = AcquireBounceMapInfo (This, EFI_SIZE_TO_PAGES (*NumberOfBytes),
+               &MapInfo);
     if (EFI_ERROR (Status)) {
-      goto FreeMapInfo;
+      return Status;
     }
-    MapInfo->AllocAddress = (EFI_PHYSICAL_ADDRESS)(UINTN)AllocAddress;
     if (Operation == EfiPciIoOperationBusMasterRead) {
-      gBS->CopyMem (AllocAddress, HostAddress, *NumberOfBytes);
+      gBS->CopyMem ((VOID *)(UINTN)MapInfo->AllocAddress, HostAddress,
+             *NumberOfBytes);
     }
     *DeviceAddress = MapInfo->AllocAddress;
   } else {
-    MapInfo->AllocAddress = 0;
+    MapInfo = AcquireMapInfo (Dev);
+    if (MapInfo == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
     *DeviceAddress = (EFI_PHYSICAL_ADDRESS)(UINTN)HostAddress;
 
     //
@@ -1246,13 +1530,12 @@ NonCoherentPciIoMap (
             *NumberOfBytes, EfiCpuFlushTypeWriteBack);
   }
 
+  MapInfo->HostAddress = HostAddress;
+  MapInfo->Operation = Operation;
+  MapInfo->NumberOfBytes = *NumberOfBytes;
+
   *Mapping = MapInfo;
   return EFI_SUCCESS;
-
-FreeMapInfo:
-  FreePool (MapInfo);
-
-  return Status;
 }
 
 /**
@@ -1281,16 +1564,13 @@ NonCoherentPciIoUnmap (
   MapInfo = Mapping;
   if (MapInfo->AllocAddress != 0) {
     //
-    // We are using a bounce buffer: copy back the data if necessary,
-    // and free the buffer.
+    // We are using a bounce buffer: copy back the data if necessary.
+    // The buffer is returned to the device pool below.
     //
     if (MapInfo->Operation == EfiPciIoOperationBusMasterWrite) {
       gBS->CopyMem (MapInfo->HostAddress, (VOID *)(UINTN)MapInfo->AllocAddress,
              MapInfo->NumberOfBytes);
     }
-    NonCoherentPciIoFreeBuffer (This,
-      EFI_SIZE_TO_PAGES (MapInfo->NumberOfBytes),
-      (VOID *)(UINTN)MapInfo->AllocAddress);
   } else {
     //
     // We are *not* using a bounce buffer: if this is a bus master write,
@@ -1303,7 +1583,7 @@ NonCoherentPciIoUnmap (
               MapInfo->NumberOfBytes, EfiCpuFlushTypeInvalidate);
     }
   }
-  FreePool (MapInfo);
+  ReleaseMapInfo (This, MapInfo);
   return EFI_SUCCESS;
 }
 
@@ -1742,6 +2022,10 @@ InitializePciIoProtocol (
   INTN                                Idx;
 
   InitializeListHead (&Dev->UncachedAllocationList);
+  InitializeListHead (&Dev->FreeMapInfoList);
+  for (Idx = 0; Idx < NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES; Idx++) {
+    InitializeListHead (&Dev->BounceBufferList[Idx]);
+  }
 
   Dev->ConfigSpace.Hdr.VendorId = PCI_ID_VENDOR_UNKNOWN;
   Dev->ConfigSpace.Hdr.DeviceId = PCI_ID_DEVICE_DONTCARE;
@@ -39,6 +39,19 @@
 #define PCI_ID_DEVICE_DONTCARE        0x0000
 #define PCI_ID_DEVICE_T234_DISP       0x2294
 
+//
+// Bounce buffers of 1 << n pages, n < NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES,
+// are kept for reuse after Unmap(), up to the given number per size class.
+// Larger bounce buffers are freed on Unmap().
+//
+#define NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES      5
+#define NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASS_DEPTH  4
+
+//
+// Number of unused map info structures kept for reuse after Unmap()
+//
+#define NON_DISCOVERABLE_PCI_DEVICE_MAP_INFO_DEPTH      16
+
 extern EFI_CPU_ARCH_PROTOCOL      *mCpu;
 
 typedef struct {
@@ -99,6 +112,17 @@ typedef struct {
   //
   LIST_ENTRY                UncachedAllocationList;
   //
+  // Map info structures released by Unmap(), kept for reuse by Map()
+  //
+  LIST_ENTRY                FreeMapInfoList;
+  UINTN                     FreeMapInfoCount;
+  //
+  // Bounce buffers released by Unmap(), with their map info structures,
+  // kept for reuse by Map(). One list per size class.
+  //
+  LIST_ENTRY                BounceBufferList[NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES];
+  UINTN                     BounceBufferCount[NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES];
+  //
   // Unique ID for this device instance: needed so that we can report unique
   // segment/bus/device number for each device instance. Note that this number
   // may change when disconnecting/reconnecting the driver.
@@ -119,6 +143,18 @@ InitializePciIoProtocol (
   EFI_HANDLE                      ControllerHandle
   );
 
+/**
+  Free the map info structures and bounce buffers kept for reuse by the
+  PciIo Map() implementation.
+
+  @param  Dev               Point to NON_DISCOVERABLE_PCI_DEVICE instance.
+
+**/
+VOID
+ReleasePciIoMapPool (
+  NON_DISCOVERABLE_PCI_DEVICE     *Dev
+  );
+
 extern EFI_COMPONENT_NAME_PROTOCOL gComponentName;
 extern EFI_COMPONENT_NAME2_PROTOCOL gComponentName2;
 
@@ -0,0 +1,861 @@
+/** @file
+  Unit tests of the non-coherent PciIo Map() and Unmap() of the
+  non-discoverable PCI device driver. Checks when mappings are bounced, that
+  bounce buffers and map info structures are reused, and benchmarks map and
+  unmap throughput.
+
+  Tests are run using a boot services table that only provides page
+  allocation, the DXE services table stub and a CPU arch protocol stub that
+  counts cache flushes.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DxeServicesTableLib.h>
+#include <Library/DxeServicesTableStubLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+#include <IndustryStandard/Acpi.h>
+
+#include "../NonDiscoverablePciDeviceIo.h"
+
+#include <time.h>
+
+#define UNIT_TEST_APP_NAME     "NonDiscoverablePciDeviceDxe Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "0.1"
+
+#define TEST_DMA_ALIGNMENT          64
+#define TEST_BUFFER_PAGES           64
+#define TEST_BUFFER_SIZE            EFI_PAGES_TO_SIZE (TEST_BUFFER_PAGES)
+
+// More one page mappings than a bounce buffer size class keeps
+#define TEST_POOL_MAPPINGS          (NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASS_DEPTH + 2)
+// Pages of a bounce buffer that is too large to be pooled
+#define TEST_UNPOOLED_PAGES         ((1 << NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASSES) + 4)
+
+#define TEST_BENCHMARK_ITERATIONS   10000
+
+typedef struct {
+  CONST CHAR8                     *Name;
+  EFI_PCI_IO_PROTOCOL_OPERATION   Operation;
+  UINTN                           Offset;
+  UINTN                           Bytes;
+  BOOLEAN                         Pooled;
+} TEST_BENCHMARK_CASE;
+
+STATIC CONST TEST_BENCHMARK_CASE mBenchmarkCases[] = {
+  { "4KB aligned read",            EfiPciIoOperationBusMasterRead,  0, SIZE_4KB,                                   TRUE  },
+  { "512B unaligned read",         EfiPciIoOperationBusMasterRead,  8, 512,                                        TRUE  },
+  { "16KB unaligned write",        EfiPciIoOperationBusMasterWrite, 8, SIZE_16KB,                                  TRUE  },
+  { "Unpooled unaligned read",     EfiPciIoOperationBusMasterRead,  8, EFI_PAGES_TO_SIZE (TEST_UNPOOLED_PAGES),    FALSE },
+};
+
+STATIC EFI_BOOT_SERVICES            mBootServices;
+STATIC EFI_CPU_ARCH_PROTOCOL        mCpuStub;
+STATIC NON_DISCOVERABLE_DEVICE      mDevice;
+STATIC EFI_ACPI_END_TAG_DESCRIPTOR  mDeviceResources;
+STATIC NON_DISCOVERABLE_PCI_DEVICE  *mDev;
+STATIC EFI_PCI_IO_PROTOCOL          *mPciIo;
+STATIC UINT8                        *mBuffer;
+STATIC UINTN                        mAllocatePagesCount;
+STATIC EFI_ALLOCATE_TYPE            mAllocatePagesType;
+STATIC UINTN                        mFlushCount;
+
+/**
+  Stub of gBS->AllocatePages. Memory below a maximum address cannot be
+  requested from the host, so such allocations fail if the host places the
+  pages above it.
+
+  @param  Type                  The type of allocation to perform.
+  @param  MemoryType            The type of memory to allocate.
+  @param  Pages                 The number of contiguous 4 KB pages to allocate.
+  @param  Memory                Maximum address for AllocateMaxAddress, and
+                                the allocated pages on return.
+
+  @retval EFI_SUCCESS           The pages were allocated.
+  @retval EFI_OUT_OF_RESOURCES  The pages could not be allocated.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubAllocatePages (
+  IN     EFI_ALLOCATE_TYPE     Type,
+  IN     EFI_MEMORY_TYPE       MemoryType,
+  IN     UINTN                 Pages,
+  IN OUT EFI_PHYSICAL_ADDRESS  *Memory
+) {
+  VOID  *Buffer;
+
+  mAllocatePagesCount++;
+  mAllocatePagesType = Type;
+
+  Buffer = AllocatePages(Pages);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if ((Type == AllocateMaxAddress) &&
+      ((UINTN)Buffer + EFI_PAGES_TO_SIZE (Pages) - 1 > *Memory)) {
+    FreePages(Buffer, Pages);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Memory = (UINTN)Buffer;
+  return EFI_SUCCESS;
+}
+
+/**
+  Stub of gBS->CopyMem.
+
+  @param  Destination           The destination buffer.
+  @param  Source                The source buffer.
+  @param  Length                Number of bytes to copy.
+**/
+STATIC
+VOID
+EFIAPI
+StubCopyMem (
+  IN VOID   *Destination,
+  IN VOID   *Source,
+  IN UINTN  Length
+) {
+  CopyMem(Destination, Source, Length);
+}
+
+/**
+  Stub of gBS->LocateProtocol. No protocols are installed, so the display
+  device gets no DCB image.
+
+  @retval EFI_NOT_FOUND         The protocol was not found.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+) {
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Stub of mCpu->FlushDataCache that counts the flushes.
+
+  @retval EFI_SUCCESS           The cache was flushed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubFlushDataCache (
+  IN EFI_CPU_ARCH_PROTOCOL  *This,
+  IN EFI_PHYSICAL_ADDRESS   Start,
+  IN UINT64                 Length,
+  IN EFI_CPU_FLUSH_TYPE     FlushType
+) {
+  mFlushCount++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the number of page allocations and GCD calls made so far.
+
+  @return Number of page allocations plus GCD lookups and changes.
+**/
+STATIC
+UINTN
+TestGetAllocatorCalls (
+  VOID
+) {
+  UINTN GetDescriptorCalls;
+  UINTN SetAttributesCalls;
+
+  DxeServicesTableStubGetCallCounts(&GetDescriptorCalls, &SetAttributesCalls);
+  return mAllocatePagesCount + GetDescriptorCalls + SetAttributesCalls;
+}
+
+/**
+  Get the attributes that the GCD map has for an address.
+
+  @param  Address               The address to look up.
+
+  @return The memory space attributes, or 0 if the lookup failed.
+**/
+STATIC
+UINT64
+TestGetAttributes (
+  IN EFI_PHYSICAL_ADDRESS  Address
+) {
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR Descriptor;
+
+  if (EFI_ERROR (gDS->GetMemorySpaceDescriptor(Address, &Descriptor))) {
+    return 0;
+  }
+
+  return Descriptor.Attributes;
+}
+
+/**
+  Host time in microseconds, for benchmarking.
+
+  @return Processor time used by the test, in microseconds.
+**/
+STATIC
+UINT64
+HostTimeUs (
+  VOID
+) {
+  return ((UINT64)clock() * 1000000) / CLOCKS_PER_SEC;
+}
+
+/**
+  Set up a non-coherent device with 64-bit DMA for a test.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            The device was set up.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The device could not be set up.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+PciIoTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS  Status;
+
+  DxeServicesTableStubReset();
+  mAllocatePagesCount = 0;
+  mFlushCount = 0;
+
+  mDev = AllocateZeroPool(sizeof (*mDev));
+  if (mDev == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  mDev->Signature = NON_DISCOVERABLE_PCI_DEVICE_SIG;
+  mDev->Device = &mDevice;
+  InitializePciIoProtocol(mDev, NULL);
+  mPciIo = &mDev->PciIo;
+
+  Status = mPciIo->Attributes(mPciIo, EfiPciIoAttributeOperationEnable,
+                              EFI_PCI_IO_ATTRIBUTE_DUAL_ADDRESS_CYCLE, NULL);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Release the pools of the test device and free it.
+
+  @param Context                      Not used by this function
+**/
+STATIC
+VOID
+EFIAPI
+PciIoTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  if (mDev != NULL) {
+    ReleasePciIoMapPool(mDev);
+    FreePool(mDev);
+    mDev = NULL;
+    mPciIo = NULL;
+  }
+}
+
+/**
+  Tests that aligned streaming mappings and mappings of uncached memory use
+  the host buffer, and that cacheable memory cannot be a common buffer.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+DirectMapTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  VOID                  *Mapping;
+  VOID                  *FirstMapping;
+  VOID                  *Uncached;
+  UINTN                 Bytes;
+
+  // Aligned streaming DMA only needs cache maintenance
+  Bytes = SIZE_4KB;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, (UINTN)mBuffer);
+  UT_ASSERT_EQUAL(mFlushCount, 1);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+  UT_ASSERT_EQUAL(mFlushCount, 1);
+
+  // The map info structure released by Unmap() is reused
+  FirstMapping = Mapping;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterWrite, mBuffer, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, (UINTN)mBuffer);
+  UT_ASSERT_EQUAL((UINTN)Mapping, (UINTN)FirstMapping);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+  UT_ASSERT_EQUAL(mFlushCount, 3);
+
+  // Memory from AllocateBuffer() is uncached, so it is never bounced
+  Status = mPciIo->AllocateBuffer(mPciIo, AllocateAnyPages, EfiBootServicesData, 1,
+                                  &Uncached, 0);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(TestGetAttributes((UINTN)Uncached), EFI_MEMORY_UC);
+
+  Bytes = 100;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterWrite, (UINT8 *)Uncached + 1,
+                       &Bytes, &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, (UINTN)Uncached + 1);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+
+  Bytes = SIZE_4KB;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterCommonBuffer, Uncached,
+                       &Bytes, &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, (UINTN)Uncached);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterCommonBuffer, mBuffer,
+                       &Bytes, &DeviceAddress, &Mapping);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_DEVICE_ERROR);
+
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->FreeBuffer(mPciIo, 1, Uncached));
+  UT_ASSERT_EQUAL(DxeServicesTableStubGetRangeCount(), 1);
+  UT_ASSERT_EQUAL(mAllocatePagesCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that bounced mappings copy the data in the right direction and that
+  the bounce buffer is write combined and reused.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BounceTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  EFI_PHYSICAL_ADDRESS  BounceAddress;
+  VOID                  *Mapping;
+  UINTN                 Bytes;
+  UINTN                 Index;
+
+  for (Index = 0; Index < TEST_BUFFER_SIZE; Index++) {
+    mBuffer[Index] = (UINT8)(Index ^ 0x5a);
+  }
+
+  // Bus master read: the device sees the host data
+  Bytes = 5000;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                       &BounceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(Bytes, 5000);
+  UT_ASSERT_NOT_EQUAL(BounceAddress, (UINTN)mBuffer + 1);
+  UT_ASSERT_MEM_EQUAL((VOID *)(UINTN)BounceAddress, mBuffer + 1, Bytes);
+  UT_ASSERT_EQUAL(TestGetAttributes(BounceAddress), EFI_MEMORY_WC);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+
+  // Bus master write: the host sees the device data after Unmap()
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterWrite, mBuffer + 1, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, BounceAddress);
+  SetMem((VOID *)(UINTN)DeviceAddress, Bytes, 0xa5);
+  UT_ASSERT_EQUAL(mBuffer[1], 1 ^ 0x5a);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+
+  UT_ASSERT_EQUAL(mBuffer[0], 0x5a);
+  for (Index = 1; Index <= Bytes; Index++) {
+    UT_ASSERT_EQUAL(mBuffer[Index], 0xa5);
+  }
+  UT_ASSERT_EQUAL(mBuffer[Bytes + 1], (UINT8)((Bytes + 1) ^ 0x5a));
+
+  UT_ASSERT_EQUAL(mAllocatePagesCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests the bounce buffer size classes and pool depth, and that the pools
+  are released with the memory space attributes restored.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+PoolTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  EFI_PHYSICAL_ADDRESS  BounceAddress;
+  VOID                  *Mappings[TEST_POOL_MAPPINGS];
+  UINTN                 Bytes;
+  UINTN                 Index;
+  UINTN                 Round;
+  UINTN                 Calls;
+
+  // Three and four pages share the four page size class
+  Bytes = EFI_PAGES_TO_SIZE (3) - 1;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                       &BounceAddress, &Mappings[0]);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mappings[0]));
+
+  Bytes = EFI_PAGES_TO_SIZE (4);
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                       &DeviceAddress, &Mappings[0]);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, BounceAddress);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mappings[0]));
+  UT_ASSERT_EQUAL(mAllocatePagesCount, 1);
+
+  // Only so many buffers of a size class are kept
+  mAllocatePagesCount = 0;
+  for (Round = 0; Round < 2; Round++) {
+    for (Index = 0; Index < TEST_POOL_MAPPINGS; Index++) {
+      Bytes = 100;
+      Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead,
+                           mBuffer + EFI_PAGES_TO_SIZE (Index) + 1, &Bytes,
+                           &DeviceAddress, &Mappings[Index]);
+      UT_ASSERT_NOT_EFI_ERROR(Status);
+      UT_ASSERT_NOT_EQUAL(DeviceAddress, (UINTN)mBuffer + EFI_PAGES_TO_SIZE (Index) + 1);
+    }
+    for (Index = 0; Index < TEST_POOL_MAPPINGS; Index++) {
+      UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mappings[Index]));
+    }
+  }
+  UT_ASSERT_EQUAL(mAllocatePagesCount,
+                  2 * TEST_POOL_MAPPINGS - NON_DISCOVERABLE_PCI_DEVICE_BOUNCE_CLASS_DEPTH);
+
+  // Buffers larger than the largest size class are not kept
+  mAllocatePagesCount = 0;
+  for (Round = 0; Round < 2; Round++) {
+    Bytes = EFI_PAGES_TO_SIZE (TEST_UNPOOLED_PAGES);
+    Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                         &DeviceAddress, &Mappings[0]);
+    UT_ASSERT_NOT_EFI_ERROR(Status);
+    UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mappings[0]));
+  }
+  UT_ASSERT_EQUAL(mAllocatePagesCount, 2);
+
+  // Once the pools are filled, mappings need no allocations or GCD calls
+  for (Round = 0; Round < 2; Round++) {
+    Calls = TestGetAllocatorCalls();
+    for (Index = 0; Index < TEST_POOL_MAPPINGS * 4; Index++) {
+      Bytes = 100 + Index * 500;
+      Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterWrite, mBuffer + 1, &Bytes,
+                           &DeviceAddress, &Mappings[0]);
+      UT_ASSERT_NOT_EFI_ERROR(Status);
+      UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mappings[0]));
+    }
+  }
+  UT_ASSERT_EQUAL(TestGetAllocatorCalls(), Calls);
+
+  // Releasing the pools restores the attributes of every bounce buffer
+  UT_ASSERT_NOT_EQUAL(DxeServicesTableStubGetRangeCount(), 1);
+  ReleasePciIoMapPool(mDev);
+  UT_ASSERT_EQUAL(DxeServicesTableStubGetRangeCount(), 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that the cacheable range cache is dropped when the driver changes
+  memory space attributes, and that common buffers do not use it.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CacheableRangeTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  VOID                  *Mapping;
+  VOID                  *Uncached;
+  UINTN                 Bytes;
+  UINTN                 GetDescriptorCalls;
+  UINTN                 Calls;
+  UINTN                 Index;
+
+  // An unaligned mapping of cacheable memory is bounced and its range cached.
+  // The second mapping reuses the bounce buffer, so the entry is kept.
+  for (Index = 0; Index < 2; Index++) {
+    Bytes = 100;
+    Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                         &DeviceAddress, &Mapping);
+    UT_ASSERT_NOT_EFI_ERROR(Status);
+    UT_ASSERT_NOT_EQUAL(DeviceAddress, (UINTN)mBuffer + 1);
+    UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+  }
+
+  // The uncached allocation splits the cached range, so it must not be
+  // bounced because of a stale cache entry
+  Status = mPciIo->AllocateBuffer(mPciIo, AllocateAnyPages, EfiBootServicesData, 1,
+                                  &Uncached, 0);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  Bytes = 100;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, (UINT8 *)Uncached + 1,
+                       &Bytes, &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, (UINTN)Uncached + 1);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+
+  // Repeated streaming mappings of cacheable memory hit the cache
+  Bytes = 100;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+
+  Calls = TestGetAllocatorCalls();
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+  UT_ASSERT_EQUAL(TestGetAllocatorCalls(), Calls);
+
+  // A common buffer gets a fresh lookup, even if the attributes were changed
+  // behind the driver's back
+  Status = gDS->SetMemorySpaceAttributes((UINTN)mBuffer, TEST_BUFFER_SIZE, EFI_MEMORY_UC);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  DxeServicesTableStubGetCallCounts(&GetDescriptorCalls, NULL);
+  Bytes = SIZE_4KB;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterCommonBuffer, mBuffer, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(DeviceAddress, (UINTN)mBuffer);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+  DxeServicesTableStubGetCallCounts(&Calls, NULL);
+  UT_ASSERT_EQUAL(Calls, GetDescriptorCalls + 1);
+
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->FreeBuffer(mPciIo, 1, Uncached));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a pooled bounce buffer above 4GB is not used once dual address
+  cycle has been disabled.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+  @retval UNIT_TEST_SKIPPED           The host allocated the buffer below 4GB.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+DualAddressCycleTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  VOID                  *Mapping;
+  UINTN                 Bytes;
+
+  Bytes = 100;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+  if (DeviceAddress + SIZE_4KB <= SIZE_4GB) {
+    return UNIT_TEST_SKIPPED;
+  }
+
+  Status = mPciIo->Attributes(mPciIo, EfiPciIoAttributeOperationDisable,
+                              EFI_PCI_IO_ATTRIBUTE_DUAL_ADDRESS_CYCLE, NULL);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  // The pooled buffer is freed and a new one is requested below 4GB, which
+  // the host cannot provide
+  mAllocatePagesCount = 0;
+  Status = mPciIo->Map(mPciIo, EfiPciIoOperationBusMasterRead, mBuffer + 1, &Bytes,
+                       &DeviceAddress, &Mapping);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_EQUAL(mAllocatePagesCount, 1);
+  UT_ASSERT_EQUAL(mAllocatePagesType, AllocateMaxAddress);
+  UT_ASSERT_EQUAL(DxeServicesTableStubGetRangeCount(), 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Benchmarks Map() and Unmap() pairs. The times are logged, not checked,
+  since they depend on the host. Pooled cases must not allocate or call GCD
+  services once warmed up.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST TEST_BENCHMARK_CASE *Case;
+  EFI_STATUS                Status;
+  EFI_PHYSICAL_ADDRESS      DeviceAddress;
+  VOID                      *Mapping;
+  UINTN                     Bytes;
+  UINTN                     CaseIndex;
+  UINTN                     Index;
+  UINTN                     Calls;
+  UINT64                    Start;
+  UINT64                    Time;
+
+  for (CaseIndex = 0; CaseIndex < ARRAY_SIZE (mBenchmarkCases); CaseIndex++) {
+    Case = &mBenchmarkCases[CaseIndex];
+
+    // Warm up the pools and the cacheable range cache. Allocating a bounce
+    // buffer drops the cache, so the second round fills it again.
+    for (Index = 0; Index < 2; Index++) {
+      Bytes = Case->Bytes;
+      Status = mPciIo->Map(mPciIo, Case->Operation, mBuffer + Case->Offset, &Bytes,
+                           &DeviceAddress, &Mapping);
+      UT_ASSERT_NOT_EFI_ERROR(Status);
+      UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+    }
+
+    Calls = TestGetAllocatorCalls();
+    Start = HostTimeUs();
+    for (Index = 0; Index < TEST_BENCHMARK_ITERATIONS; Index++) {
+      Bytes = Case->Bytes;
+      Status = mPciIo->Map(mPciIo, Case->Operation, mBuffer + Case->Offset, &Bytes,
+                           &DeviceAddress, &Mapping);
+      UT_ASSERT_NOT_EFI_ERROR(Status);
+      UT_ASSERT_NOT_EFI_ERROR(mPciIo->Unmap(mPciIo, Mapping));
+    }
+    Time = HostTimeUs() - Start;
+    Calls = TestGetAllocatorCalls() - Calls;
+
+    UT_LOG_INFO("%a: %lu ns per Map() and Unmap(), %u allocator calls per 1000\n",
+                Case->Name, (Time * 1000) / TEST_BENCHMARK_ITERATIONS,
+                (UINT32)((Calls * 1000) / TEST_BENCHMARK_ITERATIONS));
+
+    if (Case->Pooled) {
+      UT_ASSERT_EQUAL(Calls, 0);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the boot services, CPU arch protocol and test device.
+
+  @retval EFI_SUCCESS           The test data was initialized.
+  @retval EFI_OUT_OF_RESOURCES  The test buffer could not be allocated.
+**/
+STATIC
+EFI_STATUS
+InitTestData (
+  VOID
+) {
+  mBootServices.AllocatePages = StubAllocatePages;
+  mBootServices.CopyMem = StubCopyMem;
+  mBootServices.LocateProtocol = StubLocateProtocol;
+  gBS = &mBootServices;
+
+  mCpuStub.FlushDataCache = StubFlushDataCache;
+  mCpuStub.DmaBufferAlignment = TEST_DMA_ALIGNMENT;
+  mCpu = &mCpuStub;
+
+  mDeviceResources.Desc = ACPI_END_TAG_DESCRIPTOR;
+  mDevice.Type = &gNVIDIANonDiscoverableT234DisplayDeviceGuid;
+  mDevice.DmaType = NonDiscoverableDeviceDmaTypeNonCoherent;
+  mDevice.Initialize = NULL;
+  mDevice.Resources = (EFI_ACPI_ADDRESS_SPACE_DESCRIPTOR *)&mDeviceResources;
+
+  mBuffer = AllocatePages(TEST_BUFFER_PAGES);
+  if (mBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Free the test data.
+**/
+STATIC
+VOID
+CleanUpTestData (
+  VOID
+) {
+  if (mBuffer != NULL) {
+    FreePages(mBuffer, TEST_BUFFER_PAGES);
+    mBuffer = NULL;
+  }
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  non-coherent PciIo mapping and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+) {
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      MapTestSuite;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitTestData();
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed to initialize test data. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Start setting up the test framework for running the tests.
+  Status = InitUnitTestFramework(
+    &Fw,
+    UNIT_TEST_APP_NAME,
+    gEfiCallerBaseName,
+    UNIT_TEST_APP_VERSION
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in InitUnitTestFramework. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Populate the Non-Coherent Map Unit Test Suite.
+  Status = CreateUnitTestSuite(
+    &MapTestSuite,
+    Fw,
+    "Non-Coherent Map Tests",
+    "NonDiscoverablePciDeviceDxe.MapTestSuite",
+    NULL,
+    NULL
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in CreateUnitTestSuite for MapTestSuite\n")
+    );
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // AddTestCase Args:
+  //  Suite | Description
+  //  Class Name | Function
+  //  Pre | Post | Context
+  AddTestCase(MapTestSuite, "Direct Map Test",
+              "DirectMapTest", DirectMapTest,
+              PciIoTestSetup, PciIoTestCleanup, NULL);
+  AddTestCase(MapTestSuite, "Bounce Test",
+              "BounceTest", BounceTest,
+              PciIoTestSetup, PciIoTestCleanup, NULL);
+  AddTestCase(MapTestSuite, "Pool Test",
+              "PoolTest", PoolTest,
+              PciIoTestSetup, PciIoTestCleanup, NULL);
+  AddTestCase(MapTestSuite, "Cacheable Range Test",
+              "CacheableRangeTest", CacheableRangeTest,
+              PciIoTestSetup, PciIoTestCleanup, NULL);
+  AddTestCase(MapTestSuite, "Dual Address Cycle Test",
+              "DualAddressCycleTest", DualAddressCycleTest,
+              PciIoTestSetup, PciIoTestCleanup, NULL);
+  AddTestCase(MapTestSuite, "Benchmark Test",
+              "BenchmarkTest", BenchmarkTest,
+              PciIoTestSetup, PciIoTestCleanup, NULL);
+
+  // Execute the tests.
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  CleanUpTestData();
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based
+  unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+BaseLibUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+) {
+  return UnitTestingEntry();
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+) {
+  return UnitTestingEntry ();
+}
@@ -68,6 +68,7 @@ ReadNorFlashRegister (
     return EFI_INVALID_PARAMETER;
   }
 
+  ZeroMem (&Packet, sizeof (Packet));
   Packet.TxBuf = Cmd;
   Packet.RxBuf = Resp;
   Packet.TxLen = CmdSize;
@@ -166,6 +167,7 @@ ConfigureNorFlashWriteEnLatch (
   Cmd = Enable ? NOR_WREN_ENABLE : NOR_WREN_DISABLE;
   Cmp = Enable ? NOR_SR1_WEL_BMSK : 0;
 
+  ZeroMem (&Packet, sizeof (Packet));
   Packet.TxBuf = &Cmd;
   Packet.RxBuf = NULL;
   Packet.TxLen = sizeof(Cmd);
@@ -209,6 +211,229 @@ ConfigureNorFlashWriteEnLatch (
 }
 
 
+/**
+  Enable quad mode in NOR Flash
+
+  Set the quad enable bit as described by the quad enable requirements
+  field of the SFDP basic parameter table.
+
+  @param[in] Private               Driver's private data
+  @param[in] QuadEnableRequirement Quad enable requirement from SFDP
+
+  @retval EFI_SUCCESS              Operation successful.
+  @retval EFI_UNSUPPORTED          Quad enable method not supported.
+  @retval others                   Error occurred
+**/
+EFI_STATUS
+EnableNorFlashQuadMode (
+  IN NOR_FLASH_PRIVATE_DATA *Private,
+  IN UINT8                  QuadEnableRequirement
+)
+{
+  EFI_STATUS              Status;
+  UINT8                   RegCmd;
+  UINT8                   Resp;
+  UINT8                   Cmd[2];
+  QSPI_TRANSACTION_PACKET Packet;
+
+  if (Private == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (QuadEnableRequirement == NOR_SFDP_QER_NONE) {
+    return EFI_SUCCESS;
+  }
+
+  if (QuadEnableRequirement != NOR_SFDP_QER_SR1_BIT6) {
+    return EFI_UNSUPPORTED;
+  }
+
+  RegCmd = NOR_READ_SR1;
+  Status = ReadNorFlashRegister (Private, &RegCmd, sizeof (RegCmd), &Resp);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Could not read NOR flash status 1 register.\n", __FUNCTION__));
+    return Status;
+  }
+
+  if ((Resp & NOR_SR1_QE_BMSK) != 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = ConfigureNorFlashWriteEnLatch (Private, TRUE);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Could not enable NOR flash WREN.\n", __FUNCTION__));
+    return Status;
+  }
+
+  Cmd[0] = NOR_WRITE_SR1;
+  Cmd[1] = Resp | NOR_SR1_QE_BMSK;
+
+  ZeroMem (&Packet, sizeof (Packet));
+  Packet.TxBuf = Cmd;
+  Packet.TxLen = sizeof (Cmd);
+  Packet.RxBuf = NULL;
+  Packet.RxLen = 0;
+  Packet.WaitCycles = 0;
+
+  Status = Private->QspiController->PerformTransaction (Private->QspiController, &Packet);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Could not write NOR flash status 1 register.\n", __FUNCTION__));
+    return Status;
+  }
+
+  Status = WaitNorFlashWriteComplete (Private);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Could not complete NOR flash write.\n", __FUNCTION__));
+    return Status;
+  }
+
+  Status = ConfigureNorFlashWriteEnLatch (Private, FALSE);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Could not disable NOR flash WREN.\n", __FUNCTION__));
+    return Status;
+  }
+
+  Status = ReadNorFlashRegister (Private, &RegCmd, sizeof (RegCmd), &Resp);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Could not read NOR flash status 1 register.\n", __FUNCTION__));
+    return Status;
+  }
+
+  if ((Resp & NOR_SR1_QE_BMSK) == 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Get the size of an erase type from the SFDP basic parameter table
+
+  @param[in] SFDPParamBasicTbl             SFDP basic parameter table
+  @param[in] SFDPParamBasicTblSize         Size of SFDP basic parameter table
+  @param[in] EraseType                     Index of the erase type
+
+  @retval Size of the erase type in bytes, or 0 if the erase type is
+          unsupported or not present in the table.
+**/
+UINT32
+GetNorFlashEraseTypeSize (
+  IN NOR_SFDP_PARAM_BASIC_TBL *SFDPParamBasicTbl,
+  IN UINT32                   SFDPParamBasicTblSize,
+  IN UINT32                   EraseType
+)
+{
+  // Erase types 1 and 2 are in one DWORD, 3 and 4 in the next.
+  if (!NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize,
+                               NOR_SFDP_BSC_DWORD_ERASE_TYPES + (EraseType / 2)) ||
+      (SFDPParamBasicTbl->EraseType[EraseType].Size == 0)) {
+    return 0;
+  }
+
+  return 1 << SFDPParamBasicTbl->EraseType[EraseType].Size;
+}
+
+
+/**
+  Select NOR Flash read mode
+
+  Pick the fastest of the 1-4-4, 1-1-4, 1-2-2 and 1-1-2 read modes that is
+  supported by the flash and by the bus width wired on the board. The 4 byte
+  address variant of the read command must also be supported. Modes whose
+  parameters are not present in a short basic parameter table are treated as
+  unsupported. If none are usable, the single bit fast read already
+  programmed is left in place.
+
+  @param[in] Private                       Driver's private data
+  @param[in] SFDPParamBasicTbl             SFDP basic parameter table
+  @param[in] SFDPParamBasicTblSize         Size of SFDP basic parameter table
+  @param[in] SFDPParam4ByteInstructionTbl  SFDP 4 byte instruction table
+**/
+VOID
+SelectNorFlashReadMode (
+  IN NOR_FLASH_PRIVATE_DATA   *Private,
+  IN NOR_SFDP_PARAM_BASIC_TBL *SFDPParamBasicTbl,
+  IN UINT32                   SFDPParamBasicTblSize,
+  IN NOR_SFDP_PARAM_4BI_TBL   *SFDPParam4ByteInstructionTbl
+)
+{
+  EFI_STATUS                   Status;
+  NOR_FLASH_PRIVATE_ATTRIBUTES *Attributes;
+  BOOLEAN                      QuadIOUsable;
+  BOOLEAN                      QuadOutputUsable;
+
+  Attributes = &Private->PrivateFlashAttributes;
+
+  QuadIOUsable = NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize, NOR_SFDP_BSC_DWORD_QUAD_READ) &&
+                 SFDPParamBasicTbl->QuadIOSupported &&
+                 SFDPParam4ByteInstructionTbl->ReadCmdEC;
+  QuadOutputUsable = NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize, NOR_SFDP_BSC_DWORD_QUAD_READ) &&
+                     SFDPParamBasicTbl->QuadOutputSupported &&
+                     SFDPParam4ByteInstructionTbl->ReadCmd6C;
+
+  // Only set QE when one of the quad read modes will be selected.
+  if ((Private->MaxBusWidth >= QspiBusWidthQuad) &&
+      (QuadIOUsable || QuadOutputUsable)) {
+    // Quad enable requirements are only described from JESD216B onwards.
+    if (NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize, NOR_SFDP_BSC_DWORD_QER)) {
+      Status = EnableNorFlashQuadMode (Private, SFDPParamBasicTbl->QuadEnableRequirements);
+    } else {
+      Status = EFI_UNSUPPORTED;
+    }
+
+    if (!EFI_ERROR (Status)) {
+      if (QuadIOUsable) {
+        Attributes->ReadCmd = NOR_FAST_READ_QUAD_IO_CMD;
+        Attributes->ReadWaitCycles = SFDPParamBasicTbl->QuadIODummyCycles +
+                                     SFDPParamBasicTbl->QuadIOModeCycles;
+        Attributes->ReadAddressWidth = QspiBusWidthQuad;
+        Attributes->ReadDataWidth = QspiBusWidthQuad;
+        goto Done;
+      }
+
+      if (QuadOutputUsable) {
+        Attributes->ReadCmd = NOR_FAST_READ_QUAD_OUT_CMD;
+        Attributes->ReadWaitCycles = SFDPParamBasicTbl->QuadOutputDummyCycles +
+                                     SFDPParamBasicTbl->QuadOutputModeCycles;
+        Attributes->ReadAddressWidth = QspiBusWidthSingle;
+        Attributes->ReadDataWidth = QspiBusWidthQuad;
+        goto Done;
+      }
+    } else {
+      DEBUG ((EFI_D_INFO, "%a: NOR flash quad mode unavailable: %r\n", __FUNCTION__, Status));
+    }
+  }
+
+  if ((Private->MaxBusWidth >= QspiBusWidthDual) &&
+      NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize, NOR_SFDP_BSC_DWORD_DUAL_READ)) {
+    if (SFDPParamBasicTbl->DualIOSupported &&
+        SFDPParam4ByteInstructionTbl->ReadCmdBC) {
+      Attributes->ReadCmd = NOR_FAST_READ_DUAL_IO_CMD;
+      Attributes->ReadWaitCycles = SFDPParamBasicTbl->DualIODummyCycles +
+                                   SFDPParamBasicTbl->DualIOModeCycles;
+      Attributes->ReadAddressWidth = QspiBusWidthDual;
+      Attributes->ReadDataWidth = QspiBusWidthDual;
+      goto Done;
+    }
+
+    if (SFDPParamBasicTbl->DualOutputSupported &&
+        SFDPParam4ByteInstructionTbl->ReadCmd3C) {
+      Attributes->ReadCmd = NOR_FAST_READ_DUAL_OUT_CMD;
+      Attributes->ReadWaitCycles = SFDPParamBasicTbl->DualOutputDummyCycles +
+                                   SFDPParamBasicTbl->DualOutputModeCycles;
+      Attributes->ReadAddressWidth = QspiBusWidthSingle;
+      Attributes->ReadDataWidth = QspiBusWidthDual;
+      goto Done;
+    }
+  }
+
+Done:
+  DEBUG ((EFI_D_INFO, "%a: NOR flash read command 0x%x, wait cycles %u.\n",
+          __FUNCTION__, Attributes->ReadCmd, Attributes->ReadWaitCycles));
+}
+
+
 /**
   Read NOR Flash's SFDP
 
@@ -244,6 +469,8 @@ ReadNorFlashSFDP (
   NOR_SFDP_PARAM_SECTOR_REGION     *SFDPParamSectorTblFirstRegion;
   UINT8                            NumRegions;
   UINT32                           MemoryDensity;
+  UINT32                           EraseSize;
+  UINT32                           Index;
   QSPI_TRANSACTION_PACKET          Packet;
 
   if (Private == NULL) {
@@ -266,6 +493,7 @@ ReadNorFlashSFDP (
   Cmd[0] = NOR_READ_SFDP_CMD;
 
   ZeroMem (&SFDPHeader, sizeof (SFDPHeader));
+  ZeroMem (&Packet, sizeof (Packet));
 
   Packet.TxBuf = Cmd;
   Packet.RxBuf = &SFDPHeader;
@@ -340,6 +568,12 @@ ReadNorFlashSFDP (
   Cmd[0] = NOR_READ_SFDP_CMD;
 
   SFDPParamBasicTblSize = SFDPParamBasicTblHeader->ParamTblLen * sizeof (UINT32);
+  if (!NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize, NOR_SFDP_BSC_DWORD_DENSITY)) {
+    DEBUG ((EFI_D_ERROR, "%a: NOR flash's SFDP parameter table too short.\n", __FUNCTION__));
+    Status = EFI_UNSUPPORTED;
+    goto ErrorExit;
+  }
+
   SFDPParamBasicTbl = AllocateZeroPool (SFDPParamBasicTblSize);
   if (SFDPParamBasicTbl == NULL) {
     Status = EFI_OUT_OF_RESOURCES;
@@ -384,6 +618,12 @@ ReadNorFlashSFDP (
   Cmd[0] = NOR_READ_SFDP_CMD;
 
   SFDPParam4ByteInstructionTblSize = SFDPParam4ByteInstructionTblHeader->ParamTblLen * sizeof (UINT32);
+  if (!NOR_SFDP_TBL_HAS_DWORD (SFDPParam4ByteInstructionTblSize, NOR_SFDP_4BI_DWORD_ERASE_CMDS)) {
+    DEBUG ((EFI_D_ERROR, "%a: NOR flash's SFDP 4 byte instruction parameter table too short.\n", __FUNCTION__));
+    Status = EFI_UNSUPPORTED;
+    goto ErrorExit;
+  }
+
   SFDPParam4ByteInstructionTbl = AllocateZeroPool (SFDPParam4ByteInstructionTblSize);
   if (SFDPParam4ByteInstructionTbl == NULL) {
     Status = EFI_OUT_OF_RESOURCES;
@@ -427,12 +667,23 @@ ReadNorFlashSFDP (
   }
 
   // Find fast read dummy cycles.
-  if (SFDPParamBasicTbl->DualIOInstruction != NOR_DUAL_IO_UNSUPPORTED) {
+  if (NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize, NOR_SFDP_BSC_DWORD_DUAL_READ) &&
+      (SFDPParamBasicTbl->DualIOInstruction != NOR_DUAL_IO_UNSUPPORTED)) {
     Private->PrivateFlashAttributes.ReadWaitCycles = SFDPParamBasicTbl->DualIODummyCycles;
   } else {
     Private->PrivateFlashAttributes.ReadWaitCycles = NOR_SFDP_FAST_READ_DEF_WAIT;
   }
 
+  // Default to single bit fast read and upgrade to the widest read mode
+  // supported by both the flash and the board wiring.
+  Private->PrivateFlashAttributes.ReadCmd = NOR_FAST_READ_DATA_CMD;
+  Private->PrivateFlashAttributes.ReadAddressWidth = QspiBusWidthSingle;
+  Private->PrivateFlashAttributes.ReadDataWidth = QspiBusWidthSingle;
+  SelectNorFlashReadMode (Private,
+                          SFDPParamBasicTbl,
+                          SFDPParamBasicTblSize,
+                          SFDPParam4ByteInstructionTbl);
+
   // If uniform 4K erase is supported, use that mode.
   if (SFDPParamBasicTbl->EraseSupport4KB == NOR_SFDP_4KB_ERS_SUPPORTED &&
       SFDPParamBasicTbl->EraseInstruction4KB != NOR_SFDP_4KB_ERS_UNSUPPORTED) {
@@ -464,6 +715,12 @@ ReadNorFlashSFDP (
     Cmd[0] = NOR_READ_SFDP_CMD;
 
     SFDPParamSectorTblSize = SFDPParamSectorTblHeader->ParamTblLen * sizeof (UINT32);
+    if (SFDPParamSectorTblSize == 0) {
+      DEBUG ((EFI_D_ERROR, "%a: NOR flash's SFDP sector parameter table empty.\n", __FUNCTION__));
+      Status = EFI_UNSUPPORTED;
+      goto ErrorExit;
+    }
+
     SFDPParamSectorTbl = AllocateZeroPool (SFDPParamSectorTblSize);
     if (SFDPParamSectorTbl == NULL) {
       Status = EFI_OUT_OF_RESOURCES;
@@ -483,6 +740,7 @@ ReadNorFlashSFDP (
     }
 
     // From sector map parameter table, locate the map descriptor
+    NumRegions = 0;
     Count = 0;
     while (Count < SFDPParamSectorTblHeader->ParamTblLen) {
       if (!SFDPParamSectorTbl[Count].MapDescriptor) {
@@ -498,7 +756,8 @@ ReadNorFlashSFDP (
       }
     }
 
-    if (Count >=  SFDPParamSectorTblHeader->ParamTblLen) {
+    // The map descriptor is followed by NumRegions + 1 region DWORDs.
+    if ((Count + NumRegions) >= SFDPParamSectorTblHeader->ParamTblLen) {
       DEBUG ((EFI_D_ERROR, "%a: Could not find compatible NOR flash's SFDP sector parameter mapping table.\n", __FUNCTION__));
       Status = EFI_UNSUPPORTED;
       goto ErrorExit;
@@ -517,7 +776,8 @@ ReadNorFlashSFDP (
     }
 
     for (Count = 0; Count < NOR_SFDP_ERASE_COUNT; Count++) {
-      if (SFDPParamSectorTblRegion->EraseTypeSupported & (1 << Count)) {
+      if ((SFDPParamSectorTblRegion->EraseTypeSupported & (1 << Count)) &&
+          (GetNorFlashEraseTypeSize (SFDPParamBasicTbl, SFDPParamBasicTblSize, Count) != 0)) {
         break;
       }
     }
@@ -528,11 +788,14 @@ ReadNorFlashSFDP (
       goto ErrorExit;
     }
 
-    Private->PrivateFlashAttributes.FlashAttributes.BlockSize = 1 << SFDPParamBasicTbl->EraseType[Count].Size;
+    Private->PrivateFlashAttributes.FlashAttributes.BlockSize = GetNorFlashEraseTypeSize (SFDPParamBasicTbl,
+                                                                                          SFDPParamBasicTblSize,
+                                                                                          Count);
 
     // Out of the regions found in the map, first region is the one used for hybrid.
     for (Count = 0; Count < NOR_SFDP_ERASE_COUNT; Count++) {
-      if (SFDPParamSectorTblFirstRegion->EraseTypeSupported & (1 << Count)) {
+      if ((SFDPParamSectorTblFirstRegion->EraseTypeSupported & (1 << Count)) &&
+          (GetNorFlashEraseTypeSize (SFDPParamBasicTbl, SFDPParamBasicTblSize, Count) != 0)) {
         break;
       }
     }
@@ -545,13 +808,15 @@ ReadNorFlashSFDP (
 
     Private->PrivateFlashAttributes.HybridMemoryDensity = (SFDPParamSectorTblFirstRegion->RegionSize + 1) *
                                                                           NOR_SFDP_ERASE_REGION_SIZE;
-    Private->PrivateFlashAttributes.HybridBlockSize = 1 << SFDPParamBasicTbl->EraseType[Count].Size;
+    Private->PrivateFlashAttributes.HybridBlockSize = GetNorFlashEraseTypeSize (SFDPParamBasicTbl,
+                                                                               SFDPParamBasicTblSize,
+                                                                               Count);
   }
 
   // Look up 4 byte uniform erase command based on the block size.
   for (Count = 0; Count < NOR_SFDP_ERASE_COUNT; Count++) {
     if (Private->PrivateFlashAttributes.FlashAttributes.BlockSize ==
-         (1 << SFDPParamBasicTbl->EraseType[Count].Size)) {
+         GetNorFlashEraseTypeSize (SFDPParamBasicTbl, SFDPParamBasicTblSize, Count)) {
       break;
     }
   }
@@ -570,12 +835,36 @@ ReadNorFlashSFDP (
 
   Private->PrivateFlashAttributes.UniformEraseCmd = SFDPParam4ByteInstructionTbl->EraseInstruction[Count];
 
+  // Record all erase types at least as large as the uniform block size,
+  // largest first, so that aligned ranges can be erased with fewer commands.
+  // Flashes with a hybrid region only use the uniform erase command.
+  if (Private->PrivateFlashAttributes.HybridMemoryDensity == 0) {
+    for (Count = 0; Count < NOR_SFDP_ERASE_COUNT; Count++) {
+      EraseSize = GetNorFlashEraseTypeSize (SFDPParamBasicTbl, SFDPParamBasicTblSize, Count);
+      if ((EraseSize == 0) ||
+          !(SFDPParam4ByteInstructionTbl->EraseTypeSupported & (1 << Count)) ||
+          (EraseSize < Private->PrivateFlashAttributes.FlashAttributes.BlockSize)) {
+        continue;
+      }
+
+      Index = Private->PrivateFlashAttributes.NumEraseTypes;
+      while ((Index > 0) &&
+             (Private->PrivateFlashAttributes.EraseTypes[Index - 1].Size < EraseSize)) {
+        Private->PrivateFlashAttributes.EraseTypes[Index] = Private->PrivateFlashAttributes.EraseTypes[Index - 1];
+        Index--;
+      }
+      Private->PrivateFlashAttributes.EraseTypes[Index].Size = EraseSize;
+      Private->PrivateFlashAttributes.EraseTypes[Index].Command = SFDPParam4ByteInstructionTbl->EraseInstruction[Count];
+      Private->PrivateFlashAttributes.NumEraseTypes++;
+    }
+  }
+
   // Look up 4 byte hybrid erase command based on the block size if uniform block size
   // is not already 4KB.
   if (Private->PrivateFlashAttributes.FlashAttributes.BlockSize != SIZE_4KB) {
     for (Count = 0; Count < NOR_SFDP_ERASE_COUNT; Count++) {
       if (Private->PrivateFlashAttributes.HybridBlockSize ==
-           (1 << SFDPParamBasicTbl->EraseType[Count].Size)) {
+           GetNorFlashEraseTypeSize (SFDPParamBasicTbl, SFDPParamBasicTblSize, Count)) {
         break;
       }
     }
@@ -595,9 +884,9 @@ ReadNorFlashSFDP (
     Private->PrivateFlashAttributes.HybridEraseCmd = SFDPParam4ByteInstructionTbl->EraseInstruction[Count];
   }
 
-  // If basic parameter table size is more than NOR_SFDP_PRM_TBL_LEN_JESD216,
+  // If basic parameter table has the page size DWORD (JESD216A onwards),
   // read page size from the table. Otherwise default to NOR_SFDP_WRITE_DEF_PAGE
-  if (SFDPParamBasicTblSize > NOR_SFDP_PRM_TBL_LEN_JESD216) {
+  if (NOR_SFDP_TBL_HAS_DWORD (SFDPParamBasicTblSize, NOR_SFDP_BSC_DWORD_PAGE_SIZE)) {
     Private->PrivateFlashAttributes.PageSize = 1 << SFDPParamBasicTbl->PageSize;
     // Override page size for newer flashes
     if (Private->PrivateFlashAttributes.PageSize > NOR_SFDP_WRITE_DEF_PAGE) {
@@ -717,13 +1006,18 @@ NorFlashRead(
     Private->CommandBuffer[Count] = (Offset & (0xFF << AddressShift)) >> AddressShift;
     AddressShift += 8;
   }
-  Private->CommandBuffer[0] = NOR_FAST_READ_DATA_CMD;
+  Private->CommandBuffer[0] = Private->PrivateFlashAttributes.ReadCmd;
 
+  ZeroMem (&Packet, sizeof (Packet));
   Packet.TxBuf = Private->CommandBuffer;
   Packet.TxLen = CmdSize;
   Packet.RxBuf = Buffer;
   Packet.RxLen = Size;
   Packet.WaitCycles = Private->PrivateFlashAttributes.ReadWaitCycles;
+  Packet.CommandLen = NOR_CMD_SIZE;
+  Packet.CommandWidth = QspiBusWidthSingle;
+  Packet.TxWidth = Private->PrivateFlashAttributes.ReadAddressWidth;
+  Packet.RxWidth = Private->PrivateFlashAttributes.ReadDataWidth;
 
   Status = Private->QspiController->PerformTransaction (Private->QspiController, &Packet);
   if (EFI_ERROR(Status)) {
@@ -815,6 +1109,10 @@ NorFlashErase(
   UINT64                  MemoryDensity;
   UINT32                  BlockSize;
   UINT8                   EraseCmd;
+  UINT8                   Command;
+  UINT32                  EraseSize;
+  UINT32                  Index;
+  NOR_FLASH_ERASE_TYPE    *EraseType;
 
   if (This == NULL ||
       NumLba == 0) {
@@ -861,8 +1159,27 @@ NorFlashErase(
 
   CmdSize = NOR_CMD_SIZE + NOR_ADDR_SIZE;
   ZeroMem (Private->CommandBuffer, CmdSize);
+  ZeroMem (&Packet, sizeof (Packet));
+
+  Block = Lba;
+  while (Block < (Lba + NumLba)) {
+    Offset = Block * BlockSize;
+
+    // Use the largest erase type that is aligned and fits in the range.
+    Command = EraseCmd;
+    EraseSize = BlockSize;
+    if (!Hybrid) {
+      for (Index = 0; Index < Private->PrivateFlashAttributes.NumEraseTypes; Index++) {
+        EraseType = &Private->PrivateFlashAttributes.EraseTypes[Index];
+        if (((Offset & (EraseType->Size - 1)) == 0) &&
+            (((Lba + NumLba - Block) * BlockSize) >= EraseType->Size)) {
+          Command = EraseType->Command;
+          EraseSize = EraseType->Size;
+          break;
+        }
+      }
+    }
 
-  for (Block = Lba; Block < (Lba + NumLba); Block++) {
     Status = ConfigureNorFlashWriteEnLatch (Private, TRUE);
     if (EFI_ERROR(Status)) {
       DEBUG ((EFI_D_ERROR, "%a: Could not enable NOR flash WREN.\n", __FUNCTION__));
@@ -870,12 +1187,11 @@ NorFlashErase(
     }
 
     AddressShift = 0;
-    Offset = Block * BlockSize;
     for (Count = (CmdSize - 1); Count > 0; Count--) {
       Private->CommandBuffer[Count] = (Offset & (0xFF << AddressShift)) >> AddressShift;
       AddressShift += 8;
     }
-    Private->CommandBuffer[0] = EraseCmd;
+    Private->CommandBuffer[0] = Command;
 
     Packet.TxBuf = Private->CommandBuffer;
     Packet.TxLen = CmdSize;
@@ -900,6 +1216,8 @@ NorFlashErase(
       DEBUG ((EFI_D_ERROR, "%a: Could not enable NOR flash WREN.\n", __FUNCTION__));
       goto ErrorExit;
     }
+
+    Block += EraseSize / BlockSize;
   }
 
   DEBUG ((EFI_D_INFO, "%a: Successfully erased data from NOR flash.\n", __FUNCTION__));
@@ -1025,6 +1343,7 @@ NorFlashWriteSinglePage(
 
   CmdSize = NOR_CMD_SIZE + NOR_ADDR_SIZE;
   ZeroMem (Private->CommandBuffer, CmdSize + Size);
+  ZeroMem (&Packet, sizeof (Packet));
   Status = ConfigureNorFlashWriteEnLatch (Private, TRUE);
   if (EFI_ERROR(Status)) {
     DEBUG ((EFI_D_ERROR, "%a: Could not enable NOR flash WREN.\n", __FUNCTION__));
@@ -1071,9 +1390,101 @@ ErrorExit:
 }
 
 
+/**
+  Check whether programming data over existing flash contents changes it.
+
+  Programming can only clear bits, so the flash contents only change where
+  a bit that is set in flash is cleared in the data.
+
+  @param[in] Existing              Current flash contents
+  @param[in] Data                  Data to be programmed
+  @param[in] Size                  Number of bytes to compare
+
+  @retval TRUE                     Programming would change flash contents.
+  @retval FALSE                    Programming can be skipped.
+**/
+BOOLEAN
+NorFlashProgramNeeded (
+  IN CONST UINT8               *Existing,
+  IN CONST UINT8               *Data,
+  IN UINT32                    Size
+)
+{
+  UINT32 Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    if ((Existing[Index] & Data[Index]) != Existing[Index]) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
+/**
+  Check whether data can be written to a range of NOR Flash.
+
+  Reads back the range and classifies it as unchanged, programmable without
+  an erase (only 1 to 0 bit transitions needed) or needing an erase.
+
+  @param[in]  Private              Driver's private data
+  @param[in]  Offset               Offset of the range in flash
+  @param[in]  Size                 Number of bytes in the range
+  @param[in]  Data                 Data to be written to the range
+  @param[out] State                State of the range
+
+  @retval EFI_SUCCESS              Operation successful.
+  @retval others                   Error occurred
+**/
+EFI_STATUS
+NorFlashCheckRange (
+  IN  NOR_FLASH_PRIVATE_DATA   *Private,
+  IN  UINT32                   Offset,
+  IN  UINT32                   Size,
+  IN  CONST UINT8              *Data,
+  OUT NOR_FLASH_BLOCK_STATE    *State
+)
+{
+  EFI_STATUS Status;
+  UINT32     ChunkSize;
+  UINT32     Index;
+
+  *State = NorFlashBlockUnchanged;
+
+  while (Size > 0) {
+    ChunkSize = MIN (Size, NOR_READ_BACK_BUFFER_SIZE);
+    Status = NorFlashRead (&Private->NorFlashProtocol, Offset, ChunkSize, Private->ReadBackBuffer);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+
+    for (Index = 0; Index < ChunkSize; Index++) {
+      if (Private->ReadBackBuffer[Index] == Data[Index]) {
+        continue;
+      }
+      if ((Private->ReadBackBuffer[Index] & Data[Index]) != Data[Index]) {
+        *State = NorFlashBlockNeedsErase;
+        return EFI_SUCCESS;
+      }
+      *State = NorFlashBlockProgrammable;
+    }
+
+    Offset += ChunkSize;
+    Data += ChunkSize;
+    Size -= ChunkSize;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Write data to NOR Flash.
 
+  The flash contents are read back first and pages where programming would
+  not change anything are skipped.
+
   @param[in] This                  Instance to protocol
   @param[in] Offset                Offset to write to
   @param[in] Size                  Number of bytes to write
@@ -1095,6 +1506,9 @@ NorFlashWrite(
   UINT32                  FlashDensity;
   UINT32                  PageSize;
   UINT32                  BytesToWrite;
+  UINT32                  ChunkSize;
+  UINT32                  ChunkOffset;
+  UINT8                   *Data;
 
   if (This == NULL ||
       Buffer == NULL ||
@@ -1110,33 +1524,117 @@ NorFlashWrite(
     return EFI_INVALID_PARAMETER;
   }
 
-  // Writes need to be confined in a page.
+  Data = Buffer;
   PageSize = Private->PrivateFlashAttributes.PageSize;
   while (Size > 0) {
-    // Calculate offset and size within the page
-    BytesToWrite = PageSize - (Offset & (PageSize - 1));
-    if (BytesToWrite > Size) {
-      BytesToWrite = Size;
-    }
-    Status = NorFlashWriteSinglePage (This, Offset, BytesToWrite, Buffer);
+    // Read back a chunk of flash to skip pages that would not change.
+    ChunkSize = MIN (Size, NOR_READ_BACK_BUFFER_SIZE);
+    Status = NorFlashRead (This, Offset, ChunkSize, Private->ReadBackBuffer);
     if (EFI_ERROR(Status)) {
-      DEBUG ((EFI_D_ERROR, "%a: Could not write data to NOR flash.\n", __FUNCTION__));
+      DEBUG ((EFI_D_ERROR, "%a: Could not read back data from NOR flash.\n", __FUNCTION__));
       return Status;
     }
-    Buffer = (UINT8 *)Buffer + BytesToWrite;
-    Offset += BytesToWrite;
-    Size -= BytesToWrite;
+
+    // Writes need to be confined in a page.
+    ChunkOffset = 0;
+    while (ChunkOffset < ChunkSize) {
+      // Calculate offset and size within the page
+      BytesToWrite = PageSize - ((Offset + ChunkOffset) & (PageSize - 1));
+      if (BytesToWrite > (ChunkSize - ChunkOffset)) {
+        BytesToWrite = ChunkSize - ChunkOffset;
+      }
+      if (NorFlashProgramNeeded (&Private->ReadBackBuffer[ChunkOffset], &Data[ChunkOffset], BytesToWrite)) {
+        Status = NorFlashWriteSinglePage (This, Offset + ChunkOffset, BytesToWrite, &Data[ChunkOffset]);
+        if (EFI_ERROR(Status)) {
+          DEBUG ((EFI_D_ERROR, "%a: Could not write data to NOR flash.\n", __FUNCTION__));
+          return Status;
+        }
+      }
+      ChunkOffset += BytesToWrite;
+    }
+
+    Data += ChunkSize;
+    Offset += ChunkSize;
+    Size -= ChunkSize;
   }
 
   DEBUG ((EFI_D_INFO, "%a: Successfully wrote data to NOR flash.\n", __FUNCTION__));
 
-  return Status;
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Erase and program blocks of NOR Flash.
+
+  Erases the range using the largest erase commands available and then
+  programs all pages that are not left in the erased state.
+
+  @param[in] Private               Driver's private data
+  @param[in] Lba                   Logical block to start from
+  @param[in] NumLba                Number of blocks
+  @param[in] Buffer                Address to write data from
+
+  @retval EFI_SUCCESS              Operation successful.
+  @retval others                   Error occurred
+**/
+EFI_STATUS
+NorFlashEraseAndProgram (
+  IN NOR_FLASH_PRIVATE_DATA    *Private,
+  IN UINT32                    Lba,
+  IN UINT32                    NumLba,
+  IN UINT8                     *Buffer
+)
+{
+  EFI_STATUS Status;
+  UINT32     PageSize;
+  UINT32     Offset;
+  UINT32     Size;
+  UINT32     Index;
+  BOOLEAN    Erased;
+
+  Status = NorFlashErase (&Private->NorFlashProtocol, Lba, NumLba, FALSE);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: Could not erase NOR flash.\n", __FUNCTION__));
+    return Status;
+  }
+
+  PageSize = Private->PrivateFlashAttributes.PageSize;
+  Offset = Lba * Private->PrivateFlashAttributes.FlashAttributes.BlockSize;
+  Size = NumLba * Private->PrivateFlashAttributes.FlashAttributes.BlockSize;
+  while (Size > 0) {
+    Erased = TRUE;
+    for (Index = 0; Index < PageSize; Index++) {
+      if (Buffer[Index] != 0xFF) {
+        Erased = FALSE;
+        break;
+      }
+    }
+
+    if (!Erased) {
+      Status = NorFlashWriteSinglePage (&Private->NorFlashProtocol, Offset, PageSize, Buffer);
+      if (EFI_ERROR(Status)) {
+        DEBUG ((EFI_D_ERROR, "%a: Could not write data to NOR flash.\n", __FUNCTION__));
+        return Status;
+      }
+    }
+
+    Buffer += PageSize;
+    Offset += PageSize;
+    Size -= PageSize;
+  }
+
+  return EFI_SUCCESS;
 }
 
 
 /**
   Write data to NOR Flash.
 
+  Each block is compared against the flash first. Unchanged blocks are
+  skipped, blocks that only need bits cleared are programmed without an
+  erase, and consecutive blocks that need an erase are erased together.
+
   @param[in] This                  Instance to protocol
   @param[in] MediaId               Media ID for the device
   @param[in] Lba                   Logical block to start writing from
@@ -1157,10 +1655,12 @@ NorFlashWriteBlock(
 {
   EFI_STATUS              Status;
   NOR_FLASH_PRIVATE_DATA  *Private;
-  UINT32                  StartPage;
-  UINT32                  NumPages;
-  UINT32                  PageSize;
   UINT32                  BlockSize;
+  UINT32                  NumBlocks;
+  UINT32                  Block;
+  UINT32                  EraseStart;
+  UINT32                  EraseCount;
+  NOR_FLASH_BLOCK_STATE   State;
   UINT8                   *Data;
 
   if (This == NULL ||
@@ -1174,28 +1674,63 @@ NorFlashWriteBlock(
     return EFI_MEDIA_CHANGED;
   }
 
-  Status = NorFlashErase (&Private->NorFlashProtocol,
-                          Lba,
-                          BufferSize / Private->PrivateFlashAttributes.FlashAttributes.BlockSize,
-                          FALSE);
-
   BlockSize = Private->PrivateFlashAttributes.FlashAttributes.BlockSize;
-  PageSize = Private->PrivateFlashAttributes.PageSize;
-  StartPage = (BlockSize / PageSize) * Lba;
-  NumPages = BufferSize / PageSize;
+  if ((BufferSize % BlockSize) != 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  NumBlocks = BufferSize / BlockSize;
+  if ((Lba + NumBlocks) >
+      (Private->PrivateFlashAttributes.FlashAttributes.MemoryDensity / BlockSize)) {
+    return EFI_INVALID_PARAMETER;
+  }
 
   Data = Buffer;
-  while (NumPages > 0) {
-    Status = NorFlashWriteSinglePage (&Private->NorFlashProtocol,
-                                      StartPage *  BufferSize / Private->PrivateFlashAttributes.PageSize,
-                                      PageSize,
-                                      Data);
-    if (EFI_ERROR(Status)) {
-      return Status;
+  Status = EFI_SUCCESS;
+  State = NorFlashBlockUnchanged;
+  EraseStart = 0;
+  EraseCount = 0;
+  for (Block = 0; Block <= NumBlocks; Block++) {
+    if (Block < NumBlocks) {
+      Status = NorFlashCheckRange (Private,
+                                   (Lba + Block) * BlockSize,
+                                   BlockSize,
+                                   &Data[Block * BlockSize],
+                                   &State);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+
+      // Collect consecutive blocks that need an erase.
+      if (State == NorFlashBlockNeedsErase) {
+        if (EraseCount == 0) {
+          EraseStart = Block;
+        }
+        EraseCount++;
+        continue;
+      }
+    }
+
+    if (EraseCount != 0) {
+      Status = NorFlashEraseAndProgram (Private,
+                                        Lba + EraseStart,
+                                        EraseCount,
+                                        &Data[EraseStart * BlockSize]);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      EraseCount = 0;
+    }
+
+    if ((Block < NumBlocks) && (State == NorFlashBlockProgrammable)) {
+      Status = NorFlashWrite (&Private->NorFlashProtocol,
+                              (Lba + Block) * BlockSize,
+                              BlockSize,
+                              &Data[Block * BlockSize]);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
     }
-    StartPage++;
-    NumPages--;
-    Data += PageSize;
   }
 
   return Status;
@@ -1262,6 +1797,63 @@ CheckNorFlashCompatibility(
   return EFI_UNSUPPORTED;
 }
 
+/**
+  Get NOR flash bus width from device tree.
+
+  Looks up the spi-rx-bus-width property of the flash subnode of the QSPI
+  node. Defaults to single bit if the property is not present.
+
+  @param[in]   Controller          The handle of the QSPI controller.
+
+  @retval QSPI_BUS_WIDTH           Widest bus width wired for the flash.
+**/
+QSPI_BUS_WIDTH
+GetNorFlashBusWidth (
+  IN EFI_HANDLE                Controller
+)
+{
+  EFI_STATUS                       Status;
+  NVIDIA_DEVICE_TREE_NODE_PROTOCOL *DeviceTreeNode;
+  INTN                             Offset;
+  CONST UINT32                     *Property;
+  INT32                            Length;
+
+  DeviceTreeNode = NULL;
+  Status = gBS->HandleProtocol (Controller,
+                                &gNVIDIADeviceTreeNodeProtocolGuid,
+                                (VOID **)&DeviceTreeNode);
+  if (EFI_ERROR (Status)) {
+    return QspiBusWidthSingle;
+  }
+
+  Offset = fdt_subnode_offset (DeviceTreeNode->DeviceTreeBase,
+                               DeviceTreeNode->NodeOffset,
+                               "flash@0");
+  if (Offset < 0) {
+    Offset = fdt_subnode_offset (DeviceTreeNode->DeviceTreeBase,
+                                 DeviceTreeNode->NodeOffset,
+                                 "spiflash@0");
+  }
+
+  if (Offset < 0) {
+    return QspiBusWidthSingle;
+  }
+
+  Property = fdt_getprop (DeviceTreeNode->DeviceTreeBase, Offset, "spi-rx-bus-width", &Length);
+  if ((Property == NULL) || (Length != sizeof (UINT32))) {
+    return QspiBusWidthSingle;
+  }
+
+  switch (SwapBytes32 (*Property)) {
+  case 4:
+    return QspiBusWidthQuad;
+  case 2:
+    return QspiBusWidthDual;
+  default:
+    return QspiBusWidthSingle;
+  }
+}
+
 /**
   Fixup internal data so that EFI can be call in virtual mode.
   Call the passed in Child Notify event and convert any pointers in
@@ -1281,6 +1873,7 @@ NorVirtualNotifyEvent (
 
   Private = (NOR_FLASH_PRIVATE_DATA *)Context;
   EfiConvertPointer (0x0, (VOID**)&Private->CommandBuffer);
+  EfiConvertPointer (0x0, (VOID**)&Private->ReadBackBuffer);
   EfiConvertPointer (0x0, (VOID**)&Private->QspiController->PerformTransaction);
   EfiConvertPointer (0x0, (VOID**)&Private->QspiController);
   return;
@@ -1436,6 +2029,7 @@ NorFlashDxeDriverBindingStart (
   Private->Signature = NOR_FLASH_SIGNATURE;
   Private->QspiControllerHandle = Controller;
   Private->QspiController = QspiInstance;
+  Private->MaxBusWidth = GetNorFlashBusWidth (Controller);
 
   // Read NOR flash's SFDP
   Status = ReadNorFlashSFDP (Private);
@@ -1463,6 +2057,13 @@ NorFlashDxeDriverBindingStart (
     goto ErrorExit;
   }
 
+  // Allocate Read Back Buffer
+  Private->ReadBackBuffer = AllocateRuntimeZeroPool (NOR_READ_BACK_BUFFER_SIZE);
+  if (Private->ReadBackBuffer == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
   // Get Parent's device path.
   Status = gBS->HandleProtocol (Controller,
                                 &gEfiDevicePathProtocolGuid,
@@ -1601,6 +2202,9 @@ ErrorExit:
       if (Private->CommandBuffer != NULL) {
         FreePool (Private->CommandBuffer);
       }
+      if (Private->ReadBackBuffer != NULL) {
+        FreePool (Private->ReadBackBuffer);
+      }
       FreePool (Private);
     }
     gBS->CloseProtocol (Controller,
@@ -1693,6 +2297,9 @@ NorFlashDxeDriverBindingStop (
     if (Private->CommandBuffer != NULL) {
       FreePool (Private->CommandBuffer);
     }
+    if (Private->ReadBackBuffer != NULL) {
+      FreePool (Private->ReadBackBuffer);
+    }
     FreePool (Private);
   }
 
@@ -39,6 +39,8 @@
 #define TIMEOUT                       100
 
 #define NOR_READ_SR1                  0x5
+#define NOR_WRITE_SR1                 0x1
+#define NOR_SR1_QE_BMSK               0x40
 #define NOR_SR1_WEL_BMSK              0x2
 #define NOR_SR1_WIP_BMSK              0x1
 #define NOR_SR1_WEL_RETRY_CNT         2000
@@ -49,6 +51,10 @@
 
 #define NOR_WRITE_DATA_CMD            0x12
 #define NOR_FAST_READ_DATA_CMD        0x0C
+#define NOR_FAST_READ_DUAL_OUT_CMD    0x3C
+#define NOR_FAST_READ_DUAL_IO_CMD     0xBC
+#define NOR_FAST_READ_QUAD_OUT_CMD    0x6C
+#define NOR_FAST_READ_QUAD_IO_CMD     0xEC
 #define NOR_WREN_DISABLE              0x4
 #define NOR_WREN_ENABLE               0x6
 
@@ -59,13 +65,26 @@
 #define NOR_SFDP_PRM_TBL_BSC_HDR_LSB  0x0
 #define NOR_SFDP_PRM_TBL_SEC_HDR_LSB  0x81
 #define NOR_SFDP_PRM_TBL_4BI_HDR_LSB  0x84
-#define NOR_SFDP_PRM_TBL_LEN_JESD216  36
+
+// DWORDs of the SFDP parameter tables, numbered from 1 as in JESD216
+#define NOR_SFDP_BSC_DWORD_DENSITY      2
+#define NOR_SFDP_BSC_DWORD_QUAD_READ    3
+#define NOR_SFDP_BSC_DWORD_DUAL_READ    4
+#define NOR_SFDP_BSC_DWORD_ERASE_TYPES  8
+#define NOR_SFDP_BSC_DWORD_PAGE_SIZE    11
+#define NOR_SFDP_BSC_DWORD_QER          15
+#define NOR_SFDP_4BI_DWORD_ERASE_CMDS   2
+
+#define NOR_SFDP_TBL_HAS_DWORD(TblSize, Dword)  ((TblSize) >= ((Dword) * sizeof (UINT32)))
 
 #define NOR_SFDP_4KB_ERS_SUPPORTED    0x1
 #define NOR_SFDP_4KB_ERS_UNSUPPORTED  0xFF
 
 #define NOR_DUAL_IO_UNSUPPORTED       0xFF
 
+#define NOR_SFDP_QER_NONE             0x0
+#define NOR_SFDP_QER_SR1_BIT6         0x2
+
 #define NOR_SFDP_ERASE_COUNT          4
 
 #define NOR_SFDP_WRITE_DEF_PAGE       256
@@ -74,6 +93,8 @@
 
 #define NOR_SFDP_FAST_READ_DEF_WAIT   8
 
+#define NOR_READ_BACK_BUFFER_SIZE     SIZE_4KB
+
 #pragma pack(1)
 typedef struct {
   UINT32                           SFDPSignature;
@@ -104,10 +125,23 @@ typedef struct {
   UINT8                            EraseSupport4KB:2;
   UINT8                            Reserved:6;
   UINT8                            EraseInstruction4KB;
-  UINT16                           Reserved2;
+  BOOLEAN                          DualOutputSupported:1;
+  UINT8                            Reserved2:3;
+  BOOLEAN                          DualIOSupported:1;
+  BOOLEAN                          QuadIOSupported:1;
+  BOOLEAN                          QuadOutputSupported:1;
+  UINT8                            Reserved2b:1;
+  UINT8                            Reserved2c;
   UINT32                           MemoryDensity;
-  UINT32                           Reserved3;
-  UINT16                           Reserved4;
+  UINT8                            QuadIODummyCycles:5;
+  UINT8                            QuadIOModeCycles:3;
+  UINT8                            QuadIOInstruction;
+  UINT8                            QuadOutputDummyCycles:5;
+  UINT8                            QuadOutputModeCycles:3;
+  UINT8                            QuadOutputInstruction;
+  UINT8                            DualOutputDummyCycles:5;
+  UINT8                            DualOutputModeCycles:3;
+  UINT8                            DualOutputInstruction;
   UINT8                            DualIODummyCycles:5;
   UINT8                            DualIOModeCycles:3;
   UINT8                            DualIOInstruction;
@@ -119,13 +153,24 @@ typedef struct {
   UINT8                            Reserved9:4;
   UINT8                            PageSize:4;
   UINT32                           Reserved10:24;
+  UINT32                           Reserved11;
+  UINT32                           Reserved12;
+  UINT32                           Reserved13;
+  UINT16                           Reserved14;
+  UINT8                            Reserved15:4;
+  UINT8                            QuadEnableRequirements:3;
+  UINT8                            Reserved16:1;
+  UINT8                            Reserved17;
 } NOR_SFDP_PARAM_BASIC_TBL;
 
 
 typedef struct {
   BOOLEAN                          Reserved:1;
   BOOLEAN                          ReadCmd0C:1;
-  UINT8                            Reserved2:4;
+  BOOLEAN                          ReadCmd3C:1;
+  BOOLEAN                          ReadCmdBC:1;
+  BOOLEAN                          ReadCmd6C:1;
+  BOOLEAN                          ReadCmdEC:1;
   BOOLEAN                          WriteCmd12:1;
   UINT8                            Reserved3:2;
   UINT8                            EraseTypeSupported:4;
@@ -151,14 +196,32 @@ typedef struct {
 #pragma pack()
 
 
+typedef struct {
+  UINT32                           Size;
+  UINT8                            Command;
+} NOR_FLASH_ERASE_TYPE;
+
+
+typedef enum {
+  NorFlashBlockUnchanged,
+  NorFlashBlockProgrammable,
+  NorFlashBlockNeedsErase
+} NOR_FLASH_BLOCK_STATE;
+
+
 typedef struct {
   NOR_FLASH_ATTRIBUTES             FlashAttributes;
   UINT8                            UniformEraseCmd;
   UINT8                            HybridEraseCmd;
   UINT32                           PageSize;
+  UINT8                            ReadCmd;
   UINT8                            ReadWaitCycles;
+  QSPI_BUS_WIDTH                   ReadAddressWidth;
+  QSPI_BUS_WIDTH                   ReadDataWidth;
   UINT64                           HybridMemoryDensity;
   UINT32                           HybridBlockSize;
+  NOR_FLASH_ERASE_TYPE             EraseTypes[NOR_SFDP_ERASE_COUNT];
+  UINT8                            NumEraseTypes;
 } NOR_FLASH_PRIVATE_ATTRIBUTES;
 
 
@@ -172,11 +235,13 @@ typedef struct {
   EFI_BLOCK_IO_PROTOCOL            BlockIoProtocol;
   EFI_ERASE_BLOCK_PROTOCOL         EraseBlockProtocol;
   NVIDIA_QSPI_CONTROLLER_PROTOCOL  *QspiController;
+  QSPI_BUS_WIDTH                   MaxBusWidth;
   EFI_DEVICE_PATH_PROTOCOL         *ParentDevicePath;
   EFI_DEVICE_PATH_PROTOCOL         *NorFlashDevicePath;
   NOR_FLASH_PRIVATE_ATTRIBUTES     PrivateFlashAttributes;
   EFI_EVENT                        VirtualAddrChangeEvent;
   UINT8                            *CommandBuffer;
+  UINT8                            *ReadBackBuffer;
 } NOR_FLASH_PRIVATE_DATA;
 
 
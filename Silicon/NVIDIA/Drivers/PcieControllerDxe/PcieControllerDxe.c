@@ -46,6 +46,8 @@ NVIDIA_COMPATIBILITY_MAPPING gDeviceCompatibilityMap[] = {
     { NULL, NULL }
 };
 
+/* Controllers that still hold PERST# asserted, see ReleasePendingPerst () */
+STATIC LIST_ENTRY mPerstPendingList = INITIALIZE_LIST_HEAD_VARIABLE (mPerstPendingList);
 
 STATIC ACPI_HID_DEVICE_PATH mPciRootBridgeDevicePathNode = {
   {
@@ -322,6 +324,112 @@ ConfigureAtu (
   AtuWrite (Private, Index, TEGRA_PCIE_ATU_CR2, TEGRA_PCIE_ATU_ENABLE);
 }
 
+/**
+ * Configures an outbound ATU window and remembers it, so that it can be
+ * programmed again after the core has been reset
+ *
+ * @param Private    - Private data structure
+ * @param Index      - ATU Index
+ * @param Type       - Memory Type
+ * @param CpuAddress - Address to map to
+ * @param PciAddress - Device Address
+ * @param Size       - Size of the region
+ */
+STATIC
+VOID
+ConfigureWindowAtu (
+    IN PCIE_CONTROLLER_PRIVATE  *Private,
+    IN UINT8                    Index,
+    IN UINT8                    Type,
+    IN UINT64                   CpuAddress,
+    IN UINT64                   PciAddress,
+    IN UINT64                   Size
+    )
+{
+  Private->AtuWindows[Index].Valid      = TRUE;
+  Private->AtuWindows[Index].Type       = Type;
+  Private->AtuWindows[Index].CpuAddress = CpuAddress;
+  Private->AtuWindows[Index].PciAddress = PciAddress;
+  Private->AtuWindows[Index].Size       = Size;
+
+  ConfigureAtu (Private, Index, Type, CpuAddress, PciAddress, Size);
+}
+
+/**
+ * Programs the outbound ATU windows again after a core reset cleared them
+ *
+ * @param Private    - Private data structure
+ */
+STATIC
+VOID
+RestoreWindowAtus (
+    IN PCIE_CONTROLLER_PRIVATE  *Private
+    )
+{
+  UINT8 Index;
+
+  for (Index = 0; Index < PCIE_ATU_REGION_COUNT; Index++) {
+    if (Private->AtuWindows[Index].Valid) {
+      ConfigureAtu (Private,
+                    Index,
+                    Private->AtuWindows[Index].Type,
+                    Private->AtuWindows[Index].CpuAddress,
+                    Private->AtuWindows[Index].PciAddress,
+                    Private->AtuWindows[Index].Size);
+    }
+  }
+}
+
+/**
+ * Points the configuration ATU region at a bus/device/function
+ *
+ * The window base, limit and enable never change, so once the region has
+ * been programmed only the target and type registers are rewritten, and
+ * only when they differ from what the region already holds.
+ *
+ * @param Private    - Private data structure
+ * @param Type       - CFG0 or CFG1
+ * @param Target     - Bus/device/function encoded for the ATU
+ */
+STATIC
+VOID
+ConfigureCfgAtu (
+    IN PCIE_CONTROLLER_PRIVATE  *Private,
+    IN UINT8                    Type,
+    IN UINT32                   Target
+    )
+{
+  if (!Private->CfgAtuValid) {
+    ConfigureAtu (Private,
+                  PCIE_ATU_REGION_INDEX0,
+                  Type,
+                  Private->ConfigurationSpace,
+                  Target,
+                  Private->ConfigurationSize);
+    Private->CfgAtuValid = TRUE;
+  } else {
+    if (Private->CfgAtuTarget == Target && Private->CfgAtuType == Type) {
+      return;
+    }
+    if (Private->CfgAtuTarget != Target) {
+      AtuWrite (Private, PCIE_ATU_REGION_INDEX0, TEGRA_PCIE_ATU_LOWER_TARGET, Target);
+    }
+    if (Private->CfgAtuType != Type) {
+      AtuWrite (Private, PCIE_ATU_REGION_INDEX0, TEGRA_PCIE_ATU_CR1, Type | TEGRA_PCIE_ATU_INCREASE_REGION_SIZE);
+    }
+  }
+
+  Private->CfgAtuType = Type;
+  Private->CfgAtuTarget = Target;
+  Private->CfgAtuProgramCount++;
+}
+
+STATIC
+EFI_STATUS
+WaitForLinkUp (
+  IN PCIE_CONTROLLER_PRIVATE *Private
+  );
+
 /**
   PCI configuration space access.
 
@@ -352,13 +460,22 @@ PcieConfigurationAccess (
   UINT64                                       ConfigAddress;
   UINT32                                       Register;
   UINT8                                        Length;
+  UINT64                                       StartTicks;
 
   //
   // Read Pci configuration space
   //
   Private = PCIE_CONTROLLER_PRIVATE_DATA_FROM_THIS (This);
+  StartTicks = GetPerformanceCounter ();
   CopyMem (&PciAddress, &Address, sizeof (PciAddress));
 
+  if (Private->LinkTrainingPending) {
+    Status = WaitForLinkUp (Private);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
   if (PciAddress.ExtendedRegister == 0) {
     Register = PciAddress.Register;
   } else {
@@ -404,12 +521,9 @@ PcieConfigurationAccess (
             AtuType = TEGRA_PCIE_ATU_TYPE_CFG1;
           }
           ConfigAddress = Private->ConfigurationSpace;
-          ConfigureAtu (Private,
-                        PCIE_ATU_REGION_INDEX0,
-                        AtuType,
-                        ConfigAddress,
-                        PCIE_ATU_BUS (PciAddress.Bus) | PCIE_ATU_DEV (PciAddress.Device) | PCIE_ATU_FUNC (PciAddress.Function),
-                        Private->ConfigurationSize);
+          ConfigureCfgAtu (Private,
+                           AtuType,
+                           PCIE_ATU_BUS (PciAddress.Bus) | PCIE_ATU_DEV (PciAddress.Device) | PCIE_ATU_FUNC (PciAddress.Function));
         }
       }
 
@@ -443,6 +557,9 @@ PcieConfigurationAccess (
       Status = EFI_SUCCESS;
     }
   }
+
+  Private->ConfigAccessCount++;
+  Private->ConfigAccessTicks += GetPerformanceCounter () - StartTicks;
   return Status;
 }
 
@@ -496,6 +613,69 @@ PcieConfigurationWrite (
   return PcieConfigurationAccess (This, FALSE, Width, Address, Buffer);
 }
 
+/**
+  Stalls until the performance counter reaches the given time.
+
+  @param[in] Deadline  Time, in nanoseconds, to wait for.
+**/
+STATIC
+VOID
+WaitUntil (
+  IN UINT64 Deadline
+  )
+{
+  UINT64 Now;
+
+  Now = GetTimeInNanoSecond (GetPerformanceCounter ());
+  if (Now < Deadline) {
+    MicroSecondDelay (DivU64x32 (Deadline - Now + 999, 1000));
+  }
+}
+
+/**
+  Releases PERST# on every controller that PrepareHost () left holding it.
+
+  Controllers are started one after another, so instead of each of them
+  waiting out T_PVPERL on its own, PERST# is kept asserted until a root bridge
+  is first used, and then released on all of them after a single wait for
+  the slot that was powered last.
+**/
+STATIC
+VOID
+ReleasePendingPerst (
+  VOID
+  )
+{
+  LIST_ENTRY              *Link;
+  PCIE_CONTROLLER_PRIVATE *Private;
+  UINT64                  Deadline;
+  UINT32                  val;
+
+  Deadline = 0;
+  for (Link = GetFirstNode (&mPerstPendingList);
+       !IsNull (&mPerstPendingList, Link);
+       Link = GetNextNode (&mPerstPendingList, Link)) {
+    Private = PCIE_CONTROLLER_PRIVATE_DATA_FROM_PERST_LINK (Link);
+    Deadline = MAX (Deadline, Private->SlotPowerOnTime + PCIE_T_PVPERL_NS);
+  }
+
+  WaitUntil (Deadline);
+
+  while (!IsListEmpty (&mPerstPendingList)) {
+    Link = GetFirstNode (&mPerstPendingList);
+    Private = PCIE_CONTROLLER_PRIVATE_DATA_FROM_PERST_LINK (Link);
+    RemoveEntryList (Link);
+    Private->PerstPending = FALSE;
+
+    /* de-assert RST */
+    val = MmioRead32 (Private->ApplSpace + 0x0);
+    val |= (0x1);
+    MmioWrite32 (Private->ApplSpace + 0x0, val);
+
+    Private->PerstDeassertTime = GetTimeInNanoSecond (GetPerformanceCounter ());
+  }
+}
+
 STATIC
 EFI_STATUS
 EFIAPI
@@ -673,6 +853,9 @@ PrepareHost (
     return Status;
   }
 
+  /* Core may have been reset, forget what the config ATU region held */
+  Private->CfgAtuValid = FALSE;
+
   /* Apply PERST# to endpoint and go for link up */
   /* Assert PEX_RST */
   val = MmioRead32 (Private->ApplSpace + 0x0);
@@ -686,12 +869,17 @@ PrepareHost (
   val |= (0x1 << 7);
   MmioWrite32 (Private->ApplSpace + 0x4, val);
 
-  /* de-assert RST */
-  val = MmioRead32 (Private->ApplSpace + 0x0);
-  val |= (0x1);
-  MmioWrite32 (Private->ApplSpace + 0x0, val);
-
-  MicroSecondDelay(200000);
+  /*
+   * PERST# is de-asserted by ReleasePendingPerst () once T_PVPERL has passed
+   * for every controller, and link training is finished by WaitForLinkUp (),
+   * so that the controllers wait and train in parallel rather than one after
+   * another.
+   */
+  if (!Private->PerstPending) {
+    Private->PerstPending = TRUE;
+    InsertTailList (&mPerstPendingList, &Private->PerstPendingLink);
+  }
+  Private->LinkTrainingPending = TRUE;
 
   return EFI_SUCCESS;
 }
@@ -894,7 +1082,72 @@ InitializeController (
     return Status;
   }
 
-  if (!CheckLinkUp(Private)) {
+  return EFI_SUCCESS;
+}
+
+/**
+  Polls the data link layer of a controller until it reports active or the
+  link training time allowed after PERST# de-assertion expires.
+
+  @param[in] Private  Controller private data.
+
+  @retval TRUE   The data link layer is active.
+  @retval FALSE  The link did not come up in time.
+**/
+STATIC
+BOOLEAN
+PollLinkUp (
+  IN PCIE_CONTROLLER_PRIVATE *Private
+  )
+{
+  UINT64 Deadline;
+
+  Deadline = Private->PerstDeassertTime + PCIE_LINK_UP_TIMEOUT_NS;
+  while (TRUE) {
+    if ((MmioRead32 (Private->DbiBase + PCI_EXP_LNKCTL_STATUS) & PCI_EXP_LNKCTL_STATUS_DLL_ACTIVE) != 0) {
+      return TRUE;
+    }
+    if (GetTimeInNanoSecond (GetPerformanceCounter ()) >= Deadline) {
+      return FALSE;
+    }
+    MicroSecondDelay (PCIE_LINK_POLL_INTERVAL_US);
+  }
+}
+
+/**
+  Second phase of controller bring-up: releases PERST# and waits for the link
+  that was started by PrepareHost () to train.
+
+  This is deferred until the root bridge is first used, by which time every
+  controller has been started, so PERST# is released on all of them at once
+  and their training times overlap instead of adding up.
+
+  @param[in] Private  Controller private data.
+
+  @retval EFI_SUCCESS  Link training finished, Private->LinkUp holds the result.
+  @retval others       The controller could not be reset for a retry.
+**/
+STATIC
+EFI_STATUS
+WaitForLinkUp (
+  IN PCIE_CONTROLLER_PRIVATE *Private
+  )
+{
+  EFI_STATUS Status;
+  UINT32     val;
+  UINT32     Index;
+  UINT32     Count;
+  UINT64     StartTime;
+
+  if (!Private->LinkTrainingPending) {
+    return EFI_SUCCESS;
+  }
+  Private->LinkTrainingPending = FALSE;
+
+  ReleasePendingPerst ();
+  StartTime = Private->PerstDeassertTime;
+
+  if (!PollLinkUp (Private)) {
     UINT32 tmp;
     UINT32 offset;
 
@@ -959,16 +1212,38 @@ InitializeController (
     val &= ~PCI_DLF_EXCHANGE_ENABLE;
     MmioWrite32 (Private->DbiBase + offset + PCI_DLF_CAP, val);
 
-    Status = PrepareHost(Private, ControllerHandle, DeviceTreeNode);
+    /*
+     * The core reset also cleared the IO and MEM windows programmed from the
+     * ranges property at binding start, PrepareHost () redoes the rest of the
+     * DBI setup.
+     */
+    RestoreWindowAtus (Private);
+
+    Status = PrepareHost(Private, Private->ControllerHandle, NULL);
     if (EFI_ERROR (Status)) {
       DEBUG ((EFI_D_ERROR, "Unable to Prepare Host controller (%r)\r\n", Status));
       return Status;
     }
 
-    CheckLinkUp(Private);
+    Private->LinkTrainingPending = FALSE;
+    ReleasePendingPerst ();
+    PollLinkUp (Private);
   }
 
 exit:
+  if (CheckLinkUp (Private)) {
+    /*
+     * The link may have come up well before the first access, so this is an
+     * upper bound on the training time.
+     */
+    DEBUG ((EFI_D_INFO, "PCIe Controller-%d link trained within %lu ms\r\n",
+           Private->CtrlId,
+           DivU64x32 (GetTimeInNanoSecond (GetPerformanceCounter ()) - StartTime, 1000000)));
+  }
+
+  /* Give the endpoint its reset recovery time before it sees config requests */
+  WaitUntil (Private->PerstDeassertTime + PCIE_T_RESET_READY_NS);
+
   return EFI_SUCCESS;
 }
 
@@ -1013,12 +1288,18 @@ BOOLEAN
 TegraPcieTryLinkL2 (PCIE_CONTROLLER_PRIVATE *Private)
 {
   UINT32 val;
+  UINT32 Index;
 
   val = MmioRead32 (Private->ApplSpace + APPL_RADM_STATUS);
   val |= APPL_PM_XMT_TURNOFF_STATE;
   MmioWrite32 (Private->ApplSpace + APPL_RADM_STATUS, val);
 
-  MicroSecondDelay(10000);
+  for (Index = 0; Index < PCIE_LINK_L2_TIMEOUT_US; Index += PCIE_LINK_POLL_INTERVAL_US) {
+    val = MmioRead32 (Private->ApplSpace + APPL_DEBUG);
+    if (val & APPL_DEBUG_PM_LINKST_IN_L2_LAT)
+          return 0;
+    MicroSecondDelay (PCIE_LINK_POLL_INTERVAL_US);
+  }
 
   val = MmioRead32 (Private->ApplSpace + APPL_DEBUG);
   if (val & APPL_DEBUG_PM_LINKST_IN_L2_LAT)
@@ -1027,11 +1308,27 @@ TegraPcieTryLinkL2 (PCIE_CONTROLLER_PRIVATE *Private)
         return 1;
 }
 
+STATIC
+BOOLEAN
+TegraPcieLinkInDetect (PCIE_CONTROLLER_PRIVATE *Private)
+{
+  UINT32 data;
+
+  data = MmioRead32 (Private->ApplSpace + APPL_DEBUG);
+  return (((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_QUIET) ||
+          ((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_ACT) ||
+          ((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_PRE_DETECT_QUIET) ||
+          ((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_WAIT));
+}
+
 STATIC
 VOID
 TegraPciePMETurnOff (PCIE_CONTROLLER_PRIVATE *Private)
 {
   UINT32 data;
+  UINT32 Index;
+
+  WaitForLinkUp (Private);
 
   if (!Private->LinkUp) {
     DEBUG ((EFI_D_INFO, "PCIe Controller-%d Link is not UP\r\n",
@@ -1057,15 +1354,14 @@ TegraPciePMETurnOff (PCIE_CONTROLLER_PRIVATE *Private)
     data &= ~APPL_PINMUX_PEX_RST;
     MmioWrite32 (Private->ApplSpace + APPL_PINMUX, data);
 
-    MicroSecondDelay(120000);
+    for (Index = 0; Index < PCIE_LINK_DETECT_TIMEOUT_US; Index += PCIE_LINK_POLL_INTERVAL_US) {
+      if (TegraPcieLinkInDetect (Private)) {
+        break;
+      }
+      MicroSecondDelay (PCIE_LINK_POLL_INTERVAL_US);
+    }
 
-    data = MmioRead32 (Private->ApplSpace + APPL_DEBUG);
-    if (!(
-          ((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_QUIET) ||
-          ((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_ACT) ||
-          ((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_PRE_DETECT_QUIET) ||
-          ((data & APPL_DEBUG_LTSSM_STATE_MASK) == LTSSM_STATE_DETECT_WAIT))
-         ) {
+    if (!TegraPcieLinkInDetect (Private)) {
             DEBUG ((EFI_D_ERROR, "Link didn't go to detect state as well\r\n"));
     }
 
@@ -1175,11 +1471,21 @@ OnExitBootServices (
   IN      VOID                              *Context
   )
 {
-  EFI_STATUS Status;
-  VOID       *Rsdp = NULL;
+  EFI_STATUS              Status;
+  VOID                    *Rsdp = NULL;
+  PCIE_CONTROLLER_PRIVATE *Private = (PCIE_CONTROLLER_PRIVATE *)Context;
 
   gBS->CloseEvent (Event);
 
+  /* Endpoints behind root bridges that were never used are still in reset */
+  ReleasePendingPerst ();
+
+  DEBUG ((EFI_D_INFO, "PCIe Controller-%d: %lu config accesses in %lu us, %lu ATU updates\r\n",
+         Private->CtrlId,
+         Private->ConfigAccessCount,
+         DivU64x32 (GetTimeInNanoSecond (Private->ConfigAccessTicks), 1000),
+         Private->CfgAtuProgramCount));
+
   //Only Uninitialize if ACPI is not installed.
   Status = EfiGetSystemConfigurationTable (&gEfiAcpiTableGuid, &Rsdp);
   if (EFI_ERROR (Status)) {
@@ -1403,8 +1709,11 @@ DeviceDiscoveryNotify (
       DEBUG ((EFI_D_INFO, "Failed to find 12v slot supply regulator\n"));
     }
 
-    /* Spec defined T_PVPERL delay (100ms) after enabling power to the slot */
-    MicroSecondDelay(100000);
+    /*
+     * Spec defined T_PVPERL delay (100ms) after enabling power to the slot is
+     * enforced by ReleasePendingPerst () right before PERST# is de-asserted.
+     */
+    Private->SlotPowerOnTime = GetTimeInNanoSecond (GetPerformanceCounter ());
 
     if (Private->CtrlId == 5 && Private->IsT194) {
       ConfigureSidebandSignals(Private);
@@ -1571,24 +1880,24 @@ DeviceDiscoveryNotify (
         RootBridge->Io.Base = DeviceAddress;
         RootBridge->Io.Limit = Limit;
         RootBridge->Io.Translation = Translation;
-        ConfigureAtu (Private,
-                      PCIE_ATU_REGION_INDEX1,
-                      TEGRA_PCIE_ATU_TYPE_IO,
-                      HostAddress,
-                      DeviceAddress,
-                      Size);
+        ConfigureWindowAtu (Private,
+                            PCIE_ATU_REGION_INDEX1,
+                            TEGRA_PCIE_ATU_TYPE_IO,
+                            HostAddress,
+                            DeviceAddress,
+                            Size);
       } else if ((Space == PCIE_DEVICETREE_SPACE_MEM32) &&
                  (Limit < SIZE_4GB)) {
         ASSERT (RootBridge->Mem.Base == MAX_UINT64);
         RootBridge->Mem.Base = DeviceAddress;
         RootBridge->Mem.Limit = Limit;
         RootBridge->Mem.Translation = Translation;
-        ConfigureAtu (Private,
-                      PCIE_ATU_REGION_INDEX2,
-                      TEGRA_PCIE_ATU_TYPE_MEM,
-                      HostAddress,
-                      DeviceAddress,
-                      Size);
+        ConfigureWindowAtu (Private,
+                            PCIE_ATU_REGION_INDEX2,
+                            TEGRA_PCIE_ATU_TYPE_MEM,
+                            HostAddress,
+                            DeviceAddress,
+                            Size);
       } else if ((((Space == PCIE_DEVICETREE_SPACE_MEM32) &&
                  (Limit >= SIZE_4GB)) ||
                  (Space == PCIE_DEVICETREE_SPACE_MEM64))) {
@@ -1596,12 +1905,12 @@ DeviceDiscoveryNotify (
         RootBridge->MemAbove4G.Base = DeviceAddress;
         RootBridge->MemAbove4G.Limit = Limit;
         RootBridge->MemAbove4G.Translation = Translation;
-        ConfigureAtu (Private,
-                      PCIE_ATU_REGION_INDEX3,
-                      TEGRA_PCIE_ATU_TYPE_MEM,
-                      HostAddress,
-                      DeviceAddress,
-                      Size);
+        ConfigureWindowAtu (Private,
+                            PCIE_ATU_REGION_INDEX3,
+                            TEGRA_PCIE_ATU_TYPE_MEM,
+                            HostAddress,
+                            DeviceAddress,
+                            Size);
       } else {
         DEBUG ((EFI_D_ERROR, "PCIe Controller: Unknown region 0x%08x 0x%016llx-0x%016llx T 0x%016llx\r\n", Flags, DeviceAddress, Limit, Translation));
         ASSERT (FALSE);
@@ -1654,6 +1963,9 @@ DeviceDiscoveryNotify (
         FreePool (RootBridge);
       }
       if (Private != NULL) {
+        if (Private->PerstPending) {
+          RemoveEntryList (&Private->PerstPendingLink);
+        }
         FreePool (Private);
       }
     }
@@ -23,6 +23,29 @@
 
 #define PCIE_CLOCK_RESET_NAME_LENGTH 16
 
+/* Spec defined T_PVPERL: slot power stable to PERST# de-assertion */
+#define PCIE_T_PVPERL_NS                  (100ULL * 1000 * 1000)
+/* Minimum time from PERST# de-assertion to the first configuration request */
+#define PCIE_T_RESET_READY_NS             (100ULL * 1000 * 1000)
+/* Time allowed for the link to train after PERST# de-assertion */
+#define PCIE_LINK_UP_TIMEOUT_NS           (200ULL * 1000 * 1000)
+#define PCIE_LINK_POLL_INTERVAL_US        1000
+/* Time allowed for the link to enter L2 after PME_Turn_Off */
+#define PCIE_LINK_L2_TIMEOUT_US           10000
+/* Time allowed for the LTSSM to return to detect after PERST# assertion */
+#define PCIE_LINK_DETECT_TIMEOUT_US       120000
+
+/* Number of outbound ATU regions the driver programs */
+#define PCIE_ATU_REGION_COUNT             4
+
+typedef struct {
+  BOOLEAN                                          Valid;
+  UINT8                                            Type;
+  UINT64                                           CpuAddress;
+  UINT64                                           PciAddress;
+  UINT64                                           Size;
+} PCIE_ATU_WINDOW;
+
 #define PCIE_CONTROLLER_SIGNATURE SIGNATURE_32('P','C','I','E')
 typedef struct {
   //
@@ -54,12 +77,42 @@ typedef struct {
   UINT32                                           PcieCapOffset;
   UINT32                                           ASPML1SSCapOffset;
   BOOLEAN                                          LinkUp;
+  BOOLEAN                                          LinkTrainingPending;
+  UINT64                                           SlotPowerOnTime;
+  UINT64                                           PerstDeassertTime;
+
+  //
+  // Set while PERST# is held asserted, the controller is then on the list
+  // of controllers whose PERST# is released together
+  //
+  BOOLEAN                                          PerstPending;
+  LIST_ENTRY                                       PerstPendingLink;
+
+  //
+  // Target currently programmed into the configuration ATU region (T194)
+  //
+  BOOLEAN                                          CfgAtuValid;
+  UINT8                                            CfgAtuType;
+  UINT32                                           CfgAtuTarget;
+
+  //
+  // IO and MEM windows from the ranges property, restored after a core reset
+  //
+  PCIE_ATU_WINDOW                                  AtuWindows[PCIE_ATU_REGION_COUNT];
+
+  //
+  // Configuration access statistics, reported at ExitBootServices
+  //
+  UINT64                                           ConfigAccessCount;
+  UINT64                                           ConfigAccessTicks;
+  UINT64                                           CfgAtuProgramCount;
   BOOLEAN                                          IsT194;
   BOOLEAN                                          IsT234;
   BOOLEAN                                          EnableSRNS;
   BOOLEAN                                          EnableExtREFCLK;
 } PCIE_CONTROLLER_PRIVATE;
 #define PCIE_CONTROLLER_PRIVATE_DATA_FROM_THIS(a) CR(a, PCIE_CONTROLLER_PRIVATE, PcieRootBridgeConfigurationIo, PCIE_CONTROLLER_SIGNATURE)
+#define PCIE_CONTROLLER_PRIVATE_DATA_FROM_PERST_LINK(a) CR(a, PCIE_CONTROLLER_PRIVATE, PerstPendingLink, PCIE_CONTROLLER_SIGNATURE)
 
 #define PCI_CFG_SPACE_SIZE                                      256
 #define PCI_CFG_SPACE_EXP_SIZE                                  4096
@@ -17,6 +17,7 @@
 #include <Library/DeviceDiscoveryDriverLib.h>
 #include <Library/DxeServicesTableLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/DmaLib.h>
 #include <Library/UefiRuntimeLib.h>
 #include <Protocol/ClockNodeProtocol.h>
 #include <Protocol/ArmScmiClock2Protocol.h>
@@ -26,6 +27,8 @@
 
 #define QSPI_CONTROLLER_SIGNATURE SIGNATURE_32('Q','S','P','I')
 
+#define QSPI_DMA_BUFFER_SIZE      SIZE_64KB
+
 
 typedef struct {
   UINT32                          Signature;
@@ -33,6 +36,9 @@ typedef struct {
   NVIDIA_QSPI_CONTROLLER_PROTOCOL QspiControllerProtocol;
   EFI_EVENT                       VirtualAddrChangeEvent;
   BOOLEAN                         WaitCyclesSupported;
+  BOOLEAN                         DmaSupported;
+  QSPI_DMA_BUFFER                 DmaBuffer;
+  VOID                            *DmaMapping;
 } QSPI_CONTROLLER_PRIVATE_DATA;
 
 
@@ -87,7 +93,20 @@ QspiControllerPerformTransaction(
     return EFI_UNSUPPORTED;
   }
 
-  return QspiPerformTransaction (Private->QspiBaseAddress, Packet);
+  // Dual and quad transfers are only available on QSPI controllers.
+  if (!Private->WaitCyclesSupported &&
+      ((Packet->CommandWidth != QspiBusWidthSingle) ||
+       (Packet->TxWidth != QspiBusWidthSingle) ||
+       (Packet->RxWidth != QspiBusWidthSingle))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  // DMA buffer device address is not valid after virtual address change.
+  if (Private->DmaSupported && !EfiAtRuntime ()) {
+    return QspiPerformTransaction (Private->QspiBaseAddress, Packet, &Private->DmaBuffer);
+  }
+
+  return QspiPerformTransaction (Private->QspiBaseAddress, Packet, NULL);
 }
 
 
@@ -110,6 +129,7 @@ VirtualNotifyEvent (
 
   Private = (QSPI_CONTROLLER_PRIVATE_DATA *)Context;
   EfiConvertPointer (0x0, (VOID**)&Private->QspiBaseAddress);
+  Private->DmaSupported = FALSE;
   return;
 }
 
@@ -176,6 +196,96 @@ SetSpiFrequency (
 }
 
 
+/**
+  Allocate DMA buffer for the qspi controller.
+
+  Only controllers with an internal DMA engine are supported, others keep
+  using PIO transfers.
+
+  @param[in]    DeviceTreeNode  Interface to controller's DTB entry
+  @param[in]    Private         Controller private data
+
+  @retval EFI_SUCCESS              Operation successful.
+  @retval EFI_UNSUPPORTED          Controller does not support DMA.
+  @retval others                   Error occurred
+
+**/
+EFI_STATUS
+QspiAllocateDmaBuffer (
+  IN CONST NVIDIA_DEVICE_TREE_NODE_PROTOCOL *DeviceTreeNode,
+  IN QSPI_CONTROLLER_PRIVATE_DATA           *Private
+)
+{
+  EFI_STATUS           Status;
+  VOID                 *HostAddress;
+  UINTN                NumberOfBytes;
+  EFI_PHYSICAL_ADDRESS DeviceAddress;
+
+  if ((DeviceTreeNode == NULL) ||
+      ((fdt_node_check_compatible (DeviceTreeNode->DeviceTreeBase,
+                                   DeviceTreeNode->NodeOffset,
+                                   "nvidia,tegra234-qspi") != 0) &&
+       (fdt_node_check_compatible (DeviceTreeNode->DeviceTreeBase,
+                                   DeviceTreeNode->NodeOffset,
+                                   "nvidia,tegra23x-qspi") != 0))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = DmaAllocateAlignedBuffer (EfiRuntimeServicesData,
+                                     EFI_SIZE_TO_PAGES (QSPI_DMA_BUFFER_SIZE),
+                                     sizeof (UINT32),
+                                     &HostAddress);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: DmaAllocateAlignedBuffer Failed: %r\n", __FUNCTION__, Status));
+    return Status;
+  }
+
+  NumberOfBytes = QSPI_DMA_BUFFER_SIZE;
+  Status = DmaMap (MapOperationBusMasterCommonBuffer,
+                   HostAddress,
+                   &NumberOfBytes,
+                   &DeviceAddress,
+                   &Private->DmaMapping);
+  if (EFI_ERROR (Status) || (NumberOfBytes != QSPI_DMA_BUFFER_SIZE)) {
+    DEBUG ((DEBUG_ERROR, "%a: DmaMap Failed: %r\n", __FUNCTION__, Status));
+    if (!EFI_ERROR (Status)) {
+      DmaUnmap (Private->DmaMapping);
+      Status = EFI_OUT_OF_RESOURCES;
+    }
+    DmaFreeBuffer (EFI_SIZE_TO_PAGES (QSPI_DMA_BUFFER_SIZE), HostAddress);
+    return Status;
+  }
+
+  Private->DmaBuffer.HostAddress = HostAddress;
+  Private->DmaBuffer.DeviceAddress = DeviceAddress;
+  Private->DmaBuffer.Size = QSPI_DMA_BUFFER_SIZE;
+  Private->DmaSupported = TRUE;
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Free DMA buffer of the qspi controller.
+
+  @param[in]    Private         Controller private data
+
+**/
+VOID
+QspiFreeDmaBuffer (
+  IN QSPI_CONTROLLER_PRIVATE_DATA *Private
+)
+{
+  if (!Private->DmaSupported) {
+    return;
+  }
+
+  DmaUnmap (Private->DmaMapping);
+  DmaFreeBuffer (EFI_SIZE_TO_PAGES (QSPI_DMA_BUFFER_SIZE), Private->DmaBuffer.HostAddress);
+  Private->DmaSupported = FALSE;
+}
+
+
 /**
   Callback that will be invoked at various phases of the driver initialization
 
@@ -282,6 +392,11 @@ DeviceDiscoveryNotify (
       DEBUG ((EFI_D_ERROR, "QSPI Initialization Failed.\n"));
       goto ErrorExit;
     }
+    if (WaitCyclesSupported) {
+      // DMA is optional, PIO is used if it is not available.
+      Status = QspiAllocateDmaBuffer (DeviceTreeNode, Private);
+      DEBUG ((DEBUG_INFO, "%a: QSPI DMA %r\n", __FUNCTION__, Status));
+    }
     Private->QspiControllerProtocol.PerformTransaction = QspiControllerPerformTransaction;
 
     Status = gBS->CreateEventEx (EVT_NOTIFY_SIGNAL,
@@ -320,6 +435,7 @@ DeviceDiscoveryNotify (
     }
 
     gBS->CloseEvent (Private->VirtualAddrChangeEvent);
+    QspiFreeDmaBuffer (Private);
     break;
   default:
     return EFI_SUCCESS;
@@ -327,6 +443,7 @@ DeviceDiscoveryNotify (
 
 ErrorExit:
   if (Private != NULL) {
+    QspiFreeDmaBuffer (Private);
     FreePool (Private);
   }
 
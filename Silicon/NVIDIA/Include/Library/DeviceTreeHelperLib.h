@@ -48,6 +48,20 @@ SetDeviceTreePointer (
   IN  UINTN     DeviceTreeSize
 );
 
+/**
+  Discard the cached node index of the device tree
+
+  The index is rebuilt on next use. Changes that alter the size of the device
+  tree are detected automatically, callers that modify it in place without
+  changing its size must call this.
+
+**/
+VOID
+EFIAPI
+InvalidateDeviceTreeCache (
+  VOID
+  );
+
 /**
   Returns the enabled nodes that match the compatible string
 
@@ -115,6 +129,26 @@ GetDeviceTreeHandle (
   OUT UINT32       *Handle
   );
 
+/**
+  Returns the handle for the node with a specific phandle
+
+  @param  Phandle         - Phandle of the node
+  @param  NodeHandle      - NodeHandle
+
+  @retval EFI_SUCCESS           - Operation successful
+  @retval EFI_INVALID_PARAMETER - Phandle is invalid
+  @retval EFI_INVALID_PARAMETER - NodeHandle is NULL
+  @retval EFI_NOT_FOUND         - No node has this phandle
+  @retval EFI_DEVICE_ERROR      - Other Errors
+
+**/
+EFI_STATUS
+EFIAPI
+GetDeviceTreeHandleByPhandle (
+  IN  UINT32       Phandle,
+  OUT UINT32       *Handle
+  );
+
 /**
   Returns information about the registers of a given device tree node
 
@@ -0,0 +1,34 @@
+/** @file
+
+Display update progress stub definitions.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _DISPLAY_UPDATE_PROGRESS_STUB_LIB_H_
+#define _DISPLAY_UPDATE_PROGRESS_STUB_LIB_H_
+
+#include <Uefi.h>
+
+// Progress reported to the stub
+typedef struct {
+  UINTN     Updates;
+  UINTN     Completion;
+  BOOLEAN   WentBackwards;
+} DISPLAY_UPDATE_PROGRESS_STUB_STATE;
+
+/**
+  Get and reset the progress recorded by the stub.
+
+  @param  State                 Progress reported since the last call.
+**/
+VOID
+EFIAPI
+DisplayUpdateProgressStubGetState (
+  OUT DISPLAY_UPDATE_PROGRESS_STUB_STATE  *State
+);
+
+#endif
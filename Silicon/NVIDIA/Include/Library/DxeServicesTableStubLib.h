@@ -0,0 +1,60 @@
+/** @file
+
+DXE services table stub definitions.
+
+The stub provides gDS with a simulated GCD memory space map, so code that
+looks up and changes memory space attributes can be run in host based tests.
+The map starts out as a single range of system memory covering the whole
+address space, with UC, WC, WT and WB capabilities and WB attributes.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _DXE_SERVICES_TABLE_STUB_LIB_H_
+#define _DXE_SERVICES_TABLE_STUB_LIB_H_
+
+#include <PiDxe.h>
+
+#define DXE_SERVICES_TABLE_STUB_MAX_RANGES  256
+
+/**
+  Point gDS at the stub, reset the memory space map to a single range of
+  system memory and clear the call counts.  Must be called before gDS is
+  used.
+**/
+VOID
+EFIAPI
+DxeServicesTableStubReset (
+  VOID
+);
+
+/**
+  Get the number of ranges in the memory space map.  Adjacent ranges with
+  the same capabilities and attributes are merged, so a map that had all of
+  its attribute changes undone has a single range.
+
+  @return Number of ranges.
+**/
+UINTN
+EFIAPI
+DxeServicesTableStubGetRangeCount (
+  VOID
+);
+
+/**
+  Get the number of gDS calls made since the stub was last reset.
+
+  @param  GetDescriptorCalls    Number of GetMemorySpaceDescriptor() calls.
+  @param  SetAttributesCalls    Number of SetMemorySpaceAttributes() calls.
+**/
+VOID
+EFIAPI
+DxeServicesTableStubGetCallCounts (
+  OUT UINTN  *GetDescriptorCalls  OPTIONAL,
+  OUT UINTN  *SetAttributesCalls  OPTIONAL
+);
+
+#endif
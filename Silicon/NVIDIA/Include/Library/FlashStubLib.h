@@ -13,6 +13,14 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Uefi.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/NorFlash.h>
+
+// Number of device operations issued to a flash stub
+typedef struct {
+  UINTN   Reads;
+  UINTN   Writes;
+  UINTN   Erases;
+} FLASH_STUB_IO_COUNTS;
 
 /**
   Initialize the Flash Stub.
@@ -54,6 +62,22 @@ FlashStubDestroy (
   IN EFI_BLOCK_IO_PROTOCOL  *BlockIo
 );
 
+/**
+  Get and reset the number of device operations issued to the flash stub.
+
+  @param  BlockIo               BlockIo protocol of the flash stub.
+  @param  IoCounts              Operations issued since the last call.
+
+  @retval EFI_SUCCESS           IoCounts was filled in.
+  @retval EFI_INVALID_PARAMETER BlockIo or IoCounts was NULL
+**/
+EFI_STATUS
+EFIAPI
+FlashStubGetIoCounts (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  OUT FLASH_STUB_IO_COUNTS   *IoCounts
+);
+
 /**
   Initialize the Flash Stub.
 
@@ -94,4 +118,61 @@ FaultyFlashStubDestroy (
   IN EFI_BLOCK_IO_PROTOCOL  *BlockIo
 );
 
+/**
+  Initialize the NOR Flash Stub.
+
+  Writes only clear bits, like a real NOR device, and erases set every
+  byte of the erased blocks to 0xFF.
+
+  @param  Buffer                Pointer to the starting address for the flash
+                                stub's memory.
+  @param  BufferSize            BufferSize of the flash stub.
+  @param  BlockSize             Erase block size of the flash stub.
+  @param  NorFlash              Pointer to the initialized NorFlash interface
+                                returned back to the user.
+
+  @retval EFI_SUCCESS           Initialization succeeded.
+  @retval EFI_OUT_OF_RESOURCES  Internal memory allocation failed.
+  @retval EFI_BAD_BUFFER_SIZE   BufferSize or BlockSize was 0,
+                                or if BufferSize was not a multiple of BlockSize
+  @retval EFI_INVALID_PARAMETER Buffer or NorFlash was NULL
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubInitialize (
+  IN  VOID                       *Buffer,
+  IN  UINTN                      BufferSize,
+  IN  UINT32                     BlockSize,
+  OUT NVIDIA_NOR_FLASH_PROTOCOL  **NorFlash
+);
+
+/**
+  Clean up the space used by the NOR flash stub if necessary.
+
+  @param  NorFlash    NorFlash protocol of the flash stub.
+
+  @retval EFI_SUCCESS Clean up was successful.
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubDestroy (
+  IN NVIDIA_NOR_FLASH_PROTOCOL  *NorFlash
+);
+
+/**
+  Get and reset the number of device operations issued to the NOR flash stub.
+
+  @param  NorFlash              NorFlash protocol of the flash stub.
+  @param  IoCounts              Operations issued since the last call.
+
+  @retval EFI_SUCCESS           IoCounts was filled in.
+  @retval EFI_INVALID_PARAMETER NorFlash or IoCounts was NULL
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubGetIoCounts (
+  IN  NVIDIA_NOR_FLASH_PROTOCOL  *NorFlash,
+  OUT FLASH_STUB_IO_COUNTS       *IoCounts
+);
+
 #endif
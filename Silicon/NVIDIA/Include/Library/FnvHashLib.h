@@ -0,0 +1,32 @@
+/** @file
+
+  FnvHashLib provides FNV-1a hashing of strings for hash indexes
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __FNV_HASH_LIB_H__
+#define __FNV_HASH_LIB_H__
+
+#include <Uefi/UefiBaseType.h>
+
+/**
+  Calculates the 32-bit FNV-1a hash of a Null-terminated ASCII string.
+
+  The hash is not cryptographic, it is meant for hash indexes of path names,
+  compatible strings and the like.
+
+  @param[in]  String               A pointer to a Null-terminated ASCII string.
+
+  @return the 32-bit FNV-1a hash of the string.
+**/
+UINT32
+EFIAPI
+CalculateFnv1aHash32 (
+  IN CONST CHAR8  *String
+);
+
+#endif
@@ -0,0 +1,152 @@
+/** @file
+
+FwImage stub definitions.
+
+The stub provides FwImageLib over simulated FW partitions with an A and a B
+copy of each image, so FW update code can be run in host based tests. Boot
+chain A is active, so writes go to the B copy unless a partition is forced.
+Every Read() and Write() is recorded in an operation log.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _FW_IMAGE_STUB_LIB_H_
+#define _FW_IMAGE_STUB_LIB_H_
+
+#include <Uefi.h>
+#include <Library/BootChainInfoLib.h>
+#include <Protocol/FwImageProtocol.h>
+
+#define FW_IMAGE_STUB_ACTIVE_BOOT_CHAIN   BOOT_CHAIN_A
+#define FW_IMAGE_STUB_MAX_IMAGES          16
+#define FW_IMAGE_STUB_MAX_OPERATIONS      1024
+
+typedef enum {
+  FwImageStubRead,
+  FwImageStubWrite
+} FW_IMAGE_STUB_OPERATION_TYPE;
+
+// One Read() or Write() issued to a FwImage stub
+typedef struct {
+  CONST CHAR16                  *ImageName;
+  FW_IMAGE_STUB_OPERATION_TYPE  Type;
+  UINT64                        Offset;
+  UINTN                         Bytes;
+  UINTN                         Flags;
+  UINTN                         BootChain;
+} FW_IMAGE_STUB_OPERATION;
+
+/**
+  Add a FwImage to the stub.  Both partitions of the image are zero filled.
+  FwImageGetProtocolArray() returns the images in the order they were added.
+
+  @param  Name                  Name of the image.
+  @param  Bytes                 Size of each partition of the image.
+  @param  BlockSize             Block size of the image.
+
+  @retval EFI_SUCCESS           The image was added.
+  @retval EFI_OUT_OF_RESOURCES  The stub is full or an allocation failed.
+  @retval EFI_INVALID_PARAMETER Name was NULL, or Bytes or BlockSize was 0.
+**/
+EFI_STATUS
+EFIAPI
+FwImageStubAddImage (
+  IN CONST CHAR16  *Name,
+  IN UINTN         Bytes,
+  IN UINT32        BlockSize
+);
+
+/**
+  Remove all images from the stub and clear the operation log.
+**/
+VOID
+EFIAPI
+FwImageStubDestroy (
+  VOID
+);
+
+/**
+  Get the contents of one partition of an image.
+
+  @param  Name                  Name of the image.
+  @param  BootChain             BOOT_CHAIN_A or BOOT_CHAIN_B.
+
+  @return Partition contents, or NULL if the image does not exist.
+**/
+UINT8 *
+EFIAPI
+FwImageStubGetPartitionData (
+  IN CONST CHAR16  *Name,
+  IN UINTN         BootChain
+);
+
+/**
+  Corrupt the data written to an image.  The byte at Offset is stored
+  inverted by any later Write() that covers it, while Write() still
+  reports success.
+
+  @param  Name                  Name of the image.
+  @param  Offset                Offset of the byte to corrupt, or MAX_UINTN
+                                to stop corrupting the image.
+**/
+VOID
+EFIAPI
+FwImageStubSetWriteCorruption (
+  IN CONST CHAR16  *Name,
+  IN UINTN         Offset
+);
+
+/**
+  Fail the writes to an image.  Any later Write() that covers the byte at
+  Offset returns Status without changing the image.
+
+  @param  Name                  Name of the image.
+  @param  Offset                Offset of the byte whose writes fail, or
+                                MAX_UINTN to stop failing writes.
+  @param  Status                Error status for Write() to return.
+**/
+VOID
+EFIAPI
+FwImageStubSetWriteFailure (
+  IN CONST CHAR16  *Name,
+  IN UINTN         Offset,
+  IN EFI_STATUS    Status
+);
+
+/**
+  Get the number of operations in the operation log.
+
+  @return Number of Read() and Write() calls since the log was cleared.
+**/
+UINTN
+EFIAPI
+FwImageStubGetOperationCount (
+  VOID
+);
+
+/**
+  Get an operation from the operation log.
+
+  @param  Index                 Index of the operation.
+
+  @return Operation, or NULL if Index is past the end of the log.
+**/
+CONST FW_IMAGE_STUB_OPERATION *
+EFIAPI
+FwImageStubGetOperation (
+  IN UINTN  Index
+);
+
+/**
+  Clear the operation log.
+**/
+VOID
+EFIAPI
+FwImageStubClearOperations (
+  VOID
+);
+
+#endif
@@ -10,15 +10,44 @@
 #define __QSPI_CONTROLLER_LIB_H__
 
 
+typedef enum {
+  QspiBusWidthSingle = 0,
+  QspiBusWidthDual,
+  QspiBusWidthQuad,
+  QspiBusWidthMax
+} QSPI_BUS_WIDTH;
+
+
+//
+// The first CommandLen bytes of TxBuf are sent using CommandWidth and
+// the rest of TxBuf is sent using TxWidth. This allows a transaction
+// such as a 1-4-4 read to send the opcode on a single line and the
+// address on all four. A CommandLen of 0 sends all of TxBuf using TxWidth.
+//
 typedef struct {
-  VOID   *TxBuf;
-  UINT32  TxLen;
-  VOID   *RxBuf;
-  UINT32  RxLen;
-  UINT8   WaitCycles;
+  VOID            *TxBuf;
+  UINT32          TxLen;
+  VOID            *RxBuf;
+  UINT32          RxLen;
+  UINT8           WaitCycles;
+  UINT32          CommandLen;
+  QSPI_BUS_WIDTH  CommandWidth;
+  QSPI_BUS_WIDTH  TxWidth;
+  QSPI_BUS_WIDTH  RxWidth;
 } QSPI_TRANSACTION_PACKET;
 
 
+//
+// DMA capable buffer used to bounce data for DMA transfers. HostAddress is
+// the CPU view and DeviceAddress the controller view of the same memory.
+//
+typedef struct {
+  VOID                  *HostAddress;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  UINT32                Size;
+} QSPI_DMA_BUFFER;
+
+
 /**
   Initialize the QSPI Driver
 
@@ -48,8 +77,18 @@ QspiInitialize (
   only TX needs to be done without any RX. Also, if RX or TX buffer addresses
   are not NULL, their respective sizes cannot be 0.
 
+  The command portion of the TX buffer, the rest of the TX buffer and the RX
+  buffer can each use a different bus width to support multi I/O transfers.
+
+  If a DMA buffer is provided, large transfers are done through DMA using
+  that buffer while short phases such as commands still use PIO. A
+  transaction that only receives data through DMA is retried using PIO if it
+  fails, transactions that transmit data through DMA are not retried as the
+  slave may already have acted on part of the data.
+
   @param  QspiBaseAddress          Base Address for QSPI Controller in use.
   @param  Packet                   QSPI transaction context
+  @param  DmaBuffer                Optional DMA buffer. PIO only if NULL.
 
   @retval EFI_SUCCESS              Transaction successful.
   @retval Others                   Transaction failed.
@@ -57,7 +96,8 @@ QspiInitialize (
 EFI_STATUS
 QspiPerformTransaction (
   IN EFI_PHYSICAL_ADDRESS    QspiBaseAddress,
-  IN QSPI_TRANSACTION_PACKET *Packet
+  IN QSPI_TRANSACTION_PACKET *Packet,
+  IN QSPI_DMA_BUFFER         *DmaBuffer OPTIONAL
 );
 
 
@@ -0,0 +1,119 @@
+/** @file
+
+QSPI controller stub definitions.
+
+The stub provides the IoLib MMIO accessors for a simulated QSPI controller
+with a simple SPI NOR device attached to CS0, so QspiControllerLib can be
+run in host based tests.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _QSPI_CONTROLLER_STUB_LIB_H_
+#define _QSPI_CONTROLLER_STUB_LIB_H_
+
+#include <Uefi.h>
+#include <Library/QspiControllerLib.h>
+
+// Commands understood by the simulated NOR device. Both take a 3 byte
+// big endian address after the opcode.
+#define QSPI_STUB_CMD_READ           0x03
+#define QSPI_STUB_CMD_PAGE_PROGRAM   0x02
+#define QSPI_STUB_ADDRESS_BYTES      3
+
+// Controller view of DMA buffers returned by QspiControllerStubAllocateDmaBuffer
+#define QSPI_STUB_DMA_DEVICE_ADDRESS 0x123400000ULL
+
+// Number of transfers started on a controller stub
+typedef struct {
+  UINTN   PioTransfers;
+  UINTN   DmaTransfers;
+} QSPI_STUB_TRANSFER_COUNTS;
+
+/**
+  Initialize the QSPI controller stub.
+
+  @param  Flash                 Storage of the simulated NOR device.
+  @param  FlashSize             Size of the simulated NOR device.
+  @param  QspiBaseAddress       Base address to pass to QspiControllerLib.
+
+  @retval EFI_SUCCESS           Initialization succeeded.
+  @retval EFI_OUT_OF_RESOURCES  Internal memory allocation failed.
+  @retval EFI_INVALID_PARAMETER Flash or QspiBaseAddress was NULL.
+**/
+EFI_STATUS
+EFIAPI
+QspiControllerStubInitialize (
+  IN  UINT8                 *Flash,
+  IN  UINTN                 FlashSize,
+  OUT EFI_PHYSICAL_ADDRESS  *QspiBaseAddress
+);
+
+/**
+  Clean up the QSPI controller stub and its DMA buffer.
+**/
+VOID
+EFIAPI
+QspiControllerStubDestroy (
+  VOID
+);
+
+/**
+  Allocate the DMA buffer of the QSPI controller stub.
+
+  The device address of the buffer is QSPI_STUB_DMA_DEVICE_ADDRESS, which
+  is above 4GB so that both DMA address registers are used. DMA to any
+  other address is treated as a bus error and never completes.
+
+  @param  Size                  Size of the DMA buffer.
+  @param  DmaBuffer             DMA buffer description to fill in.
+
+  @retval EFI_SUCCESS           DmaBuffer was filled in.
+  @retval EFI_OUT_OF_RESOURCES  The buffer could not be allocated.
+**/
+EFI_STATUS
+EFIAPI
+QspiControllerStubAllocateDmaBuffer (
+  IN  UINT32           Size,
+  OUT QSPI_DMA_BUFFER  *DmaBuffer
+);
+
+/**
+  Make DMA transfers started from now on stall and never complete.
+
+  @param  Fail                  TRUE to stall DMA transfers.
+**/
+VOID
+EFIAPI
+QspiControllerStubSetDmaFailure (
+  IN BOOLEAN  Fail
+);
+
+/**
+  Read a controller register without side effects.
+
+  @param  Offset                Register offset.
+
+  @return Register value.
+**/
+UINT32
+EFIAPI
+QspiControllerStubGetRegister (
+  IN UINTN  Offset
+);
+
+/**
+  Get and reset the number of transfers started on the controller stub.
+
+  @param  Counts                Transfers started since the last call.
+**/
+VOID
+EFIAPI
+QspiControllerStubGetTransferCounts (
+  OUT QSPI_STUB_TRANSFER_COUNTS  *Counts
+);
+
+#endif
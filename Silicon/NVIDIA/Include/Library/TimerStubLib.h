@@ -0,0 +1,49 @@
+/** @file
+
+Timer stub definitions.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _TIMER_STUB_LIB_H_
+#define _TIMER_STUB_LIB_H_
+
+#include <Uefi.h>
+
+/**
+  Get the simulated time, in nanoseconds, that has passed through delays
+  since the timer stub was last reset.
+
+  @return Simulated time in nanoseconds.
+**/
+UINT64
+EFIAPI
+TimerStubGetTime (
+  VOID
+);
+
+/**
+  Advance the simulated time without a delay call, e.g. to model the
+  duration of a simulated device operation.
+
+  @param  NanoSeconds           Nanoseconds to advance the time by.
+**/
+VOID
+EFIAPI
+TimerStubAdvance (
+  IN UINT64  NanoSeconds
+);
+
+/**
+  Reset the simulated time to 0.
+**/
+VOID
+EFIAPI
+TimerStubReset (
+  VOID
+);
+
+#endif
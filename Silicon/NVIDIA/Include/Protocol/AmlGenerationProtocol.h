@@ -64,7 +64,35 @@ EFI_STATUS
 );
 
 /**
-  Return a pointer to the current table being generated.
+  Appends a set of devices to the current AML table being generated. All
+  devices are validated before the table is modified, so on error the table is
+  left unchanged. If there is a scope section that has been started, the
+  appended devices will also be included in the scope section.
+
+  @param[in]  This              Instance of AML generation protocol.
+  @param[in]  Devices           Array of pointers to AML tables, each containing
+                                a single Device after the header.
+  @param[in]  DeviceCount       Number of entries in Devices.
+
+  @retval EFI_SUCCESS           The function completed successfully.
+  @retval EFI_OUT_OF_RESOURCES  There was not enough memory to extend the table.
+  @retval EFI_NOT_READY         There is not currently a table being generated.
+  @retval EFI_INVALID_PARAMETER This or Devices was NULL, or one of the given
+                                AML Tables didn't have only a single Device
+                                after the header.
+**/
+typedef
+EFI_STATUS
+(EFIAPI * NVIDIA_AML_GENERATION_APPEND_DEVICES)(
+  IN NVIDIA_AML_GENERATION_PROTOCOL *This,
+  IN EFI_ACPI_DESCRIPTION_HEADER    **Devices,
+  IN UINTN                          DeviceCount
+);
+
+/**
+  Return a pointer to the current table being generated. The table length and
+  checksum are finalized before the pointer is returned. The table remains
+  owned by the protocol and may move if more devices are appended.
 
   @param[in]  This              Instance of AML generation protocol.
   @param[out] Table             Returned pointer to the current table.
@@ -129,6 +157,7 @@ struct _NVIDIA_AML_GENERATION_PROTOCOL {
   NVIDIA_AML_GENERATION_GET_TABLE         GetTable;
   NVIDIA_AML_GENERATION_START_SCOPE       StartScope;
   NVIDIA_AML_GENERATION_END_SCOPE         EndScope;
+  NVIDIA_AML_GENERATION_APPEND_DEVICES    AppendDevices;
 };
 
 #endif  /* __AML_GENERATION_PROTOCOL_H__ */
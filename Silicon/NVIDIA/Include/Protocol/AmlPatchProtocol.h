@@ -79,12 +79,16 @@ EFI_STATUS
 
 /**
   Find the AML Node for the given path name. Will use the registered AML Tables
-  and offset tables to search for a node with the given path name.
+  and offset tables to search for a node with the given path name. Only an
+  offset table entry whose path name exactly matches the given path name is
+  returned; a path name that is only a prefix of an entry, such as the path of
+  a parent scope, is not found. If the same path name is in more than one
+  offset table, the entry of the first registered table is returned.
 
   @param[in]  This              Instance of AML patching protocol.
   @param[in]  PathName          Ascii string containing a the path name for the
-                                desired node. The path name must appear in one
-                                of the registered offset tables.
+                                desired node. The path name must exactly match
+                                an entry of one of the registered offset tables.
   @param[out] AmlNodeInfo       Pointer to an NVIDIA_AML_NODE_INFO struct that will be
                                 populated with the AML table, offset entry, and
                                 size of the node if found.
@@ -193,6 +197,40 @@ EFI_STATUS
   IN CHAR8                      *NewName
 );
 
+/**
+  Start a patch transaction. Until the transaction is committed, SetNodeData
+  and UpdateNodeName only record which registered AML tables were modified
+  instead of recomputing the table checksum on every edit.
+
+  @param[in]  This              Instance of AML patching protocol.
+
+  @retval EFI_SUCCESS           The transaction was started.
+  @retval EFI_ALREADY_STARTED   A transaction is already in progress.
+  @retval EFI_NOT_READY         AML and offset tables have not been registered yet.
+  @retval EFI_INVALID_PARAMETER This was NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI * NVIDIA_AML_PATCH_BEGIN_TRANSACTION) (
+  IN NVIDIA_AML_PATCH_PROTOCOL  *This
+);
+
+/**
+  Commit the current patch transaction. The checksum of every registered AML
+  table modified since BeginTransaction is recomputed once.
+
+  @param[in]  This              Instance of AML patching protocol.
+
+  @retval EFI_SUCCESS           The transaction was committed.
+  @retval EFI_NOT_STARTED       No transaction is in progress.
+  @retval EFI_INVALID_PARAMETER This was NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI * NVIDIA_AML_PATCH_COMMIT_TRANSACTION) (
+  IN NVIDIA_AML_PATCH_PROTOCOL  *This
+);
+
 // NVIDIA_AML_PATCH_PROTOCOL protocol structure.
 struct _NVIDIA_AML_PATCH_PROTOCOL {
   NVIDIA_AML_PATCH_REGISTER_TABLES  RegisterAmlTables;
@@ -200,6 +238,8 @@ struct _NVIDIA_AML_PATCH_PROTOCOL {
   NVIDIA_AML_PATCH_GET_NODE_DATA    GetNodeData;
   NVIDIA_AML_PATCH_SET_NODE_DATA    SetNodeData;
   NVIDIA_AML_PATCH_UPDATE_NODE_NAME UpdateNodeName;
+  NVIDIA_AML_PATCH_BEGIN_TRANSACTION  BeginTransaction;
+  NVIDIA_AML_PATCH_COMMIT_TRANSACTION CommitTransaction;
 };
 
 #endif  /* __AML_PATCH_PROTOCOL_H__ */
@@ -113,10 +113,66 @@ EFI_STATUS
   IN  INT32                      *MessageError OPTIONAL
   );
 
+typedef struct {
+
+  ///
+  /// Id of the message to send
+  ///
+  UINT32                  MessageRequest;
+
+  ///
+  /// Payload data to send and its size
+  ///
+  VOID                    *TxData;
+  UINTN                   TxDataSize;
+
+  ///
+  /// Buffer for the payload data to receive and its size, may be NULL and 0
+  ///
+  VOID                    *RxData;
+  UINTN                   RxDataSize;
+
+  ///
+  /// On return, the BPMP error code of the message
+  ///
+  INT32                   MessageError;
+
+  ///
+  /// On return, the status of the message
+  ///
+  EFI_STATUS              Status;
+
+} NVIDIA_BPMP_IPC_BATCH_ENTRY;
+
+/**
+  This function executes a list of remote IPCs to the BPMP firmware. All
+  messages are queued at once and sent back to back as the IPC channel frees
+  up, the function returns once every message has completed.
+
+  @param[in]     This                The instance of the NVIDIA_BPMP_IPC_PROTOCOL.
+  @param[in,out] Entries             Array of messages to send, the Status and
+                                     MessageError of each entry are updated
+  @param[in]     NumberOfEntries     Number of entries in the array
+
+  @return EFI_SUCCESS               All messages completed successfully.
+  @return EFI_INVALID_PARAMETER     Entries is NULL or an entry is not valid,
+                                     no message has been sent.
+  @return EFI_DEVICE_ERROR          At least one message failed, see the entry status.
+  @return EFI_UNSUPPORTED           BPMP IPC is not supported on this system
+**/
+typedef
+EFI_STATUS
+(EFIAPI *BPMP_IPC_COMMUNICATE_BATCH) (
+  IN     NVIDIA_BPMP_IPC_PROTOCOL     *This,
+  IN OUT NVIDIA_BPMP_IPC_BATCH_ENTRY  *Entries,
+  IN     UINTN                        NumberOfEntries
+  );
+
 /// NVIDIA_BPMP_IPC_PROTOCOL protocol structure.
 struct _NVIDIA_BPMP_IPC_PROTOCOL {
 
-  BPMP_IPC_COMMUNICATE  Communicate;
+  BPMP_IPC_COMMUNICATE        Communicate;
+  BPMP_IPC_COMMUNICATE_BATCH  CommunicateBatch;
 
 };
 
@@ -56,6 +56,13 @@ struct _NVIDIA_DEVICE_TREE_COMPATIBILITY_PROTOCOL {
 
   DEVICE_TREE_COMPATIBILITY_SUPPORTED  Supported;
 
+  ///
+  /// Optional NULL terminated list of the compatible strings this instance
+  /// supports. When present, Supported() is only called for nodes that
+  /// carry one of them; when NULL it is called for every node.
+  ///
+  CONST CHAR8                          **CompatibleStrings;
+
 };
 
 extern EFI_GUID gNVIDIADeviceTreeCompatibilityProtocolGuid;
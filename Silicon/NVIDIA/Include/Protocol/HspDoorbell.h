@@ -67,13 +67,32 @@ EFI_STATUS
   IN  NVIDIA_HSP_DOORBELL_PROTOCOL   *This,
   IN  HSP_DOORBELL_ID                Doorbell
   );
+/**
+  This function registers an event to be signaled when the processor behind
+  the specified doorbell rings the CCPLEX doorbell.
+
+  @param[in]     This                The instance of the NVIDIA_HSP_DOORBELL_PROTOCOL.
+  @param[in]     Doorbell            Doorbell of the remote processor
+  @param[in]     Event               Event to signal, NULL to unregister
 
+  @return EFI_SUCCESS               The event has been registered.
+  @return EFI_UNSUPPORTED           The doorbell interrupt is not available.
+  @return EFI_DEVICE_ERROR          Failed to register the event.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *HSP_DOORBELL_REGISTER_NOTIFY) (
+  IN  NVIDIA_HSP_DOORBELL_PROTOCOL   *This,
+  IN  HSP_DOORBELL_ID                Doorbell,
+  IN  EFI_EVENT                      Event OPTIONAL
+  );
 
 /// NVIDIA_BPMP_IPC_PROTOCOL protocol structure.
 struct _NVIDIA_HSP_DOORBELL_PROTOCOL {
 
-  HSP_DOORBELL_RING_DOORBELL  RingDoorbell;
-  HSP_DOORBELL_ENABLE_CHANNEL EnableChannel;
+  HSP_DOORBELL_RING_DOORBELL   RingDoorbell;
+  HSP_DOORBELL_ENABLE_CHANNEL  EnableChannel;
+  HSP_DOORBELL_REGISTER_NOTIFY RegisterNotify;
 
 };
 
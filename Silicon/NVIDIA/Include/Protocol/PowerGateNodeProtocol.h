@@ -82,12 +82,28 @@ EFI_STATUS
   OUT UINT32                            *PowerGateState
   );
 
+/**
+  This function allows for deassert of all power gate nodes.
+
+  @param[in]     This                The instance of the NVIDIA_POWER_GATE_NODE_PROTOCOL.
+
+  @return EFI_SUCCESS                All powergates deasserted.
+  @return EFI_NOT_READY              BPMP-IPC protocol is not installed.
+  @return EFI_DEVICE_ERROR           Failed to deassert all powergates
+**/
+typedef
+EFI_STATUS
+(EFIAPI *POWER_GATE_NODE_DEASSERT_ALL) (
+  IN  NVIDIA_POWER_GATE_NODE_PROTOCOL   *This
+  );
+
 /// NVIDIA_RESET_NODE_PROTOCOL protocol structure.
 struct _NVIDIA_POWER_GATE_NODE_PROTOCOL {
 
   POWER_GATE_NODE_DEASSERT     Deassert;
   POWER_GATE_NODE_ASSERT       Assert;
   POWER_GATE_NODE_GET_STATE    GetState;
+  POWER_GATE_NODE_DEASSERT_ALL DeassertAll;
   UINT32                       NumberOfPowerGates;
   UINT32                       PowerGateId[1];
 };
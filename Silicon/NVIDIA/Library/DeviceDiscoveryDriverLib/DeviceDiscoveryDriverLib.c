@@ -16,6 +16,7 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
 #include <Library/IoLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/DeviceDiscoveryDriverLib.h>
 #include <libfdt.h>
 
@@ -218,7 +219,6 @@ DeviceDiscoveryBindingStart (
   NVIDIA_POWER_GATE_NODE_PROTOCOL   *PgProtocol = NULL;
   NVIDIA_COMPATIBILITY_MAPPING      *MappingNode = gDeviceCompatibilityMap;
   NVIDIA_DEVICE_TREE_NODE_PROTOCOL  *Node = NULL;
-  UINTN                             Index;
   NVIDIA_DEVICE_DISCOVERY_CONTEXT   *DeviceDiscoveryContext = NULL;
 
   //
@@ -262,12 +262,10 @@ DeviceDiscoveryBindingStart (
       goto ErrorExit;
     }
 
-    for (Index = 0; Index < PgProtocol->NumberOfPowerGates; Index++) {
-      Status = PgProtocol->Deassert (PgProtocol, PgProtocol->PowerGateId[Index]);
-      if (EFI_ERROR (Status)) {
-        DEBUG ((EFI_D_ERROR, "%a, failed to deassert Pg %x: %r\r\n",__FUNCTION__,PgProtocol->PowerGateId[Index],Status));
-        goto ErrorExit;
-      }
+    Status = PgProtocol->DeassertAll (PgProtocol);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "%a, failed to deassert Pgs %r\r\n",__FUNCTION__,Status));
+      goto ErrorExit;
     }
   }
 
@@ -583,9 +581,43 @@ DeviceTreeIsSupported (
 }
 
 STATIC NVIDIA_DEVICE_TREE_COMPATIBILITY_PROTOCOL gDeviceTreeCompatibilty = {
-    DeviceTreeIsSupported
+    DeviceTreeIsSupported,
+    NULL
 };
 
+/**
+  Publishes the compatible strings of gDeviceCompatibilityMap in the device
+  tree compatibility protocol, so device discovery only offers this driver
+  the nodes that carry one of them.
+
+  Failing to allocate the list is not fatal, every node is offered instead.
+
+**/
+STATIC
+VOID
+DeviceTreeSetCompatibleStrings (
+  VOID
+  )
+{
+  UINTN       Count;
+  UINTN       Index;
+  CONST CHAR8 **CompatibleStrings;
+
+  for (Count = 0; gDeviceCompatibilityMap[Count].Compatibility != NULL; Count++);
+
+  CompatibleStrings = AllocatePool ((Count + 1) * sizeof (CONST CHAR8 *));
+  if (CompatibleStrings == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    CompatibleStrings[Index] = gDeviceCompatibilityMap[Index].Compatibility;
+  }
+  CompatibleStrings[Count] = NULL;
+
+  gDeviceTreeCompatibilty.CompatibleStrings = CompatibleStrings;
+}
+
 /**
   Initialize the Device Discovery Driver
 
@@ -639,6 +671,8 @@ DeviceDiscoveryDriverInitialize (
     return Status;
   }
 
+  DeviceTreeSetCompatibleStrings ();
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &mDriverBindingProtocol.DriverBindingHandle,
                   &gNVIDIADeviceTreeCompatibilityProtocolGuid,
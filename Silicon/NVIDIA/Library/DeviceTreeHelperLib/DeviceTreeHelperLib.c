@@ -9,13 +9,342 @@
 #include <PiDxe.h>
 
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/DeviceTreeHelperLib.h>
 #include <Library/DtPlatformDtbLoaderLib.h>
+#include <Library/FnvHashLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <libfdt.h>
 
+#define DEVICE_TREE_CACHE_END          MAX_UINT32
+#define DEVICE_TREE_CACHE_MAX_DEPTH    32
+#define DEVICE_TREE_CACHE_MIN_BUCKETS  64
+
+//
+// Lookups done by walking the device tree before the node index is built, so
+// that modules making only a few lookups do not pay for building it
+//
+#define DEVICE_TREE_CACHE_MIN_QUERIES  8
+
+//
+// Node in device tree order, with the cell sizes of its parent. Negative cell
+// sizes are not cached and are looked up in the device tree.
+//
+typedef struct {
+  INT32        Offset;
+  INT32        ParentAddressCells;
+  INT32        ParentSizeCells;
+} DEVICE_TREE_CACHE_NODE;
+
+//
+// Compatible string of an enabled node, chained by hash bucket in device
+// tree order
+//
+typedef struct {
+  UINT32       Hash;
+  UINT32       NodeIndex;
+  CONST CHAR8  *Compatible;
+  UINT32       Next;
+} DEVICE_TREE_CACHE_COMPATIBLE;
+
+//
+// Phandle of a node, chained by bucket
+//
+typedef struct {
+  UINT32       Phandle;
+  UINT32       NodeIndex;
+  UINT32       Next;
+} DEVICE_TREE_CACHE_PHANDLE;
+
+typedef struct {
+  //
+  // Device tree the index was built from
+  //
+  VOID                          *DeviceTree;
+  UINT32                        TotalSize;
+  UINT32                        StructSize;
+  UINT32                        StringsSize;
+
+  DEVICE_TREE_CACHE_NODE        *Nodes;
+  UINTN                         NodeCount;
+  DEVICE_TREE_CACHE_COMPATIBLE  *Compatibles;
+  UINT32                        *CompatibleBuckets;
+  DEVICE_TREE_CACHE_PHANDLE     *Phandles;
+  UINT32                        *PhandleBuckets;
+  UINT32                        BucketMask;
+} DEVICE_TREE_CACHE;
+
 STATIC VOID   *LocalDeviceTree = NULL;
 STATIC UINTN  LocalDeviceTreeSize = 0;
+STATIC DEVICE_TREE_CACHE  *mDeviceTreeCache = NULL;
+STATIC UINTN              mDeviceTreeQueryCount = 0;
+
+/**
+  Discard the cached node index of the device tree
+
+  The index is rebuilt on next use. Changes that alter the size of the device
+  tree are detected automatically, callers that modify it in place without
+  changing its size must call this.
+
+**/
+VOID
+EFIAPI
+InvalidateDeviceTreeCache (
+  VOID
+  )
+{
+  if (mDeviceTreeCache == NULL) {
+    return;
+  }
+
+  if (mDeviceTreeCache->Nodes != NULL) {
+    FreePool (mDeviceTreeCache->Nodes);
+  }
+  if (mDeviceTreeCache->Compatibles != NULL) {
+    FreePool (mDeviceTreeCache->Compatibles);
+  }
+  if (mDeviceTreeCache->CompatibleBuckets != NULL) {
+    FreePool (mDeviceTreeCache->CompatibleBuckets);
+  }
+  if (mDeviceTreeCache->Phandles != NULL) {
+    FreePool (mDeviceTreeCache->Phandles);
+  }
+  if (mDeviceTreeCache->PhandleBuckets != NULL) {
+    FreePool (mDeviceTreeCache->PhandleBuckets);
+  }
+  FreePool (mDeviceTreeCache);
+  mDeviceTreeCache = NULL;
+}
+
+/**
+  Build the node index of a device tree
+
+  The device tree is walked twice, once to size the index and once to fill
+  it. The hash chains are linked last entry first so that they list nodes in
+  device tree order.
+
+  @param  DeviceTree        - Base address of the device tree.
+
+  @return Index, or NULL if it could not be allocated
+
+**/
+STATIC
+DEVICE_TREE_CACHE *
+BuildDeviceTreeCache (
+  IN VOID  *DeviceTree
+  )
+{
+  DEVICE_TREE_CACHE  *Cache;
+  INT32              CellStack[DEVICE_TREE_CACHE_MAX_DEPTH][2];
+  INT32              Offset;
+  INT32              Depth;
+  UINTN              Pass;
+  UINTN              NodeCount;
+  UINTN              CompatibleCount;
+  UINTN              PhandleCount;
+  UINTN              BucketCount;
+  UINTN              Index;
+  UINT32             Bucket;
+  UINT32             Phandle;
+  CONST CHAR8        *Property;
+  INT32              PropertySize;
+  UINTN              Size;
+  BOOLEAN            Enabled;
+
+  Cache = AllocateZeroPool (sizeof (DEVICE_TREE_CACHE));
+  if (Cache == NULL) {
+    return NULL;
+  }
+  Cache->DeviceTree  = DeviceTree;
+  Cache->TotalSize   = fdt_totalsize (DeviceTree);
+  Cache->StructSize  = fdt_size_dt_struct (DeviceTree);
+  Cache->StringsSize = fdt_size_dt_strings (DeviceTree);
+
+  NodeCount = 0;
+  CompatibleCount = 0;
+  PhandleCount = 0;
+  for (Pass = 0; Pass < 2; Pass++) {
+    if (Pass == 1) {
+      BucketCount = DEVICE_TREE_CACHE_MIN_BUCKETS;
+      while (BucketCount < MAX (CompatibleCount, PhandleCount)) {
+        BucketCount <<= 1;
+      }
+      Cache->BucketMask = BucketCount - 1;
+
+      Cache->Nodes = AllocatePool (MAX (NodeCount, 1) * sizeof (DEVICE_TREE_CACHE_NODE));
+      Cache->Compatibles = AllocatePool (MAX (CompatibleCount, 1) * sizeof (DEVICE_TREE_CACHE_COMPATIBLE));
+      Cache->CompatibleBuckets = AllocatePool (BucketCount * sizeof (UINT32));
+      Cache->Phandles = AllocatePool (MAX (PhandleCount, 1) * sizeof (DEVICE_TREE_CACHE_PHANDLE));
+      Cache->PhandleBuckets = AllocatePool (BucketCount * sizeof (UINT32));
+      if ((Cache->Nodes == NULL) ||
+          (Cache->Compatibles == NULL) ||
+          (Cache->CompatibleBuckets == NULL) ||
+          (Cache->Phandles == NULL) ||
+          (Cache->PhandleBuckets == NULL)) {
+        //Let the invalidate path free what was allocated
+        mDeviceTreeCache = Cache;
+        InvalidateDeviceTreeCache ();
+        return NULL;
+      }
+      SetMem (Cache->CompatibleBuckets, BucketCount * sizeof (UINT32), 0xFF);
+      SetMem (Cache->PhandleBuckets, BucketCount * sizeof (UINT32), 0xFF);
+
+      Cache->NodeCount = NodeCount;
+      NodeCount = 0;
+      CompatibleCount = 0;
+      PhandleCount = 0;
+    }
+
+    Depth = 0;
+    for (Offset = 0; Offset >= 0; Offset = fdt_next_node (DeviceTree, Offset, &Depth)) {
+      if (Pass == 1) {
+        Cache->Nodes[NodeCount].Offset = Offset;
+        Cache->Nodes[NodeCount].ParentAddressCells = -1;
+        Cache->Nodes[NodeCount].ParentSizeCells = -1;
+        if (Depth < DEVICE_TREE_CACHE_MAX_DEPTH) {
+          CellStack[Depth][0] = fdt_address_cells (DeviceTree, Offset);
+          CellStack[Depth][1] = fdt_size_cells (DeviceTree, Offset);
+          if (Depth > 0) {
+            Cache->Nodes[NodeCount].ParentAddressCells = CellStack[Depth - 1][0];
+            Cache->Nodes[NodeCount].ParentSizeCells = CellStack[Depth - 1][1];
+          }
+        }
+      }
+
+      Phandle = fdt_get_phandle (DeviceTree, Offset);
+      if ((Phandle != 0) && (Phandle != MAX_UINT32)) {
+        if (Pass == 1) {
+          Cache->Phandles[PhandleCount].Phandle = Phandle;
+          Cache->Phandles[PhandleCount].NodeIndex = NodeCount;
+        }
+        PhandleCount++;
+      }
+
+      Property = fdt_getprop (DeviceTree, Offset, "status", NULL);
+      Enabled = (Property == NULL) || (AsciiStrCmp (Property, "okay") == 0);
+
+      Property = fdt_getprop (DeviceTree, Offset, "compatible", &PropertySize);
+      while (Enabled && (Property != NULL) && (PropertySize > 0)) {
+        Size = AsciiStrnLenS (Property, PropertySize) + 1;
+        if (Size > (UINTN)PropertySize) {
+          break;
+        }
+        if (Pass == 1) {
+          Cache->Compatibles[CompatibleCount].Hash = CalculateFnv1aHash32 (Property);
+          Cache->Compatibles[CompatibleCount].NodeIndex = NodeCount;
+          Cache->Compatibles[CompatibleCount].Compatible = Property;
+        }
+        CompatibleCount++;
+        Property += Size;
+        PropertySize -= Size;
+      }
+
+      NodeCount++;
+    }
+  }
+
+  for (Index = CompatibleCount; Index-- > 0;) {
+    Bucket = Cache->Compatibles[Index].Hash & Cache->BucketMask;
+    Cache->Compatibles[Index].Next = Cache->CompatibleBuckets[Bucket];
+    Cache->CompatibleBuckets[Bucket] = Index;
+  }
+
+  for (Index = PhandleCount; Index-- > 0;) {
+    Bucket = Cache->Phandles[Index].Phandle & Cache->BucketMask;
+    Cache->Phandles[Index].Next = Cache->PhandleBuckets[Bucket];
+    Cache->PhandleBuckets[Bucket] = Index;
+  }
+
+  return Cache;
+}
+
+/**
+  Return the node index of a device tree
+
+  The index is only built once DEVICE_TREE_CACHE_MIN_QUERIES lookups have
+  been done without it.
+
+  @param  DeviceTree        - Base address of the device tree.
+
+  @return Index, or NULL if the device tree must be walked
+
+**/
+STATIC
+DEVICE_TREE_CACHE *
+GetDeviceTreeCache (
+  IN VOID  *DeviceTree
+  )
+{
+  if ((mDeviceTreeCache != NULL) &&
+      ((mDeviceTreeCache->DeviceTree != DeviceTree) ||
+       (mDeviceTreeCache->TotalSize != fdt_totalsize (DeviceTree)) ||
+       (mDeviceTreeCache->StructSize != fdt_size_dt_struct (DeviceTree)) ||
+       (mDeviceTreeCache->StringsSize != fdt_size_dt_strings (DeviceTree)))) {
+    InvalidateDeviceTreeCache ();
+  }
+
+  if (mDeviceTreeCache == NULL) {
+    if (mDeviceTreeQueryCount < DEVICE_TREE_CACHE_MIN_QUERIES) {
+      mDeviceTreeQueryCount++;
+      return NULL;
+    }
+    mDeviceTreeCache = BuildDeviceTreeCache (DeviceTree);
+  }
+
+  return mDeviceTreeCache;
+}
+
+/**
+  Return the cached parent cell sizes of a node
+
+  @param  DeviceTree        - Base address of the device tree.
+  @param  NodeOffset        - Offset of the node.
+  @param  AddressCells      - #address-cells of the parent.
+  @param  SizeCells         - #size-cells of the parent.
+
+**/
+STATIC
+VOID
+GetParentCells (
+  IN  VOID   *DeviceTree,
+  IN  INT32  NodeOffset,
+  OUT INT32  *AddressCells,
+  OUT INT32  *SizeCells
+  )
+{
+  DEVICE_TREE_CACHE  *Cache;
+  UINTN              Low;
+  UINTN              High;
+  UINTN              Middle;
+
+  Cache = GetDeviceTreeCache (DeviceTree);
+  if (Cache != NULL) {
+    //Nodes are in device tree order, so sorted by offset
+    Low = 0;
+    High = Cache->NodeCount;
+    while (Low < High) {
+      Middle = (Low + High) / 2;
+      if (Cache->Nodes[Middle].Offset < NodeOffset) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+
+    if ((Low < Cache->NodeCount) &&
+        (Cache->Nodes[Low].Offset == NodeOffset) &&
+        (Cache->Nodes[Low].ParentAddressCells >= 0) &&
+        (Cache->Nodes[Low].ParentSizeCells >= 0)) {
+      *AddressCells = Cache->Nodes[Low].ParentAddressCells;
+      *SizeCells = Cache->Nodes[Low].ParentSizeCells;
+      return;
+    }
+  }
+
+  *AddressCells  = fdt_address_cells (DeviceTree, fdt_parent_offset(DeviceTree, NodeOffset));
+  *SizeCells     = fdt_size_cells (DeviceTree, fdt_parent_offset(DeviceTree, NodeOffset));
+}
 
 /**
   Set the base address and size of the device tree
@@ -34,6 +363,8 @@ SetDeviceTreePointer (
 {
   LocalDeviceTree = DeviceTree;
   LocalDeviceTreeSize = DeviceTreeSize;
+  InvalidateDeviceTreeCache ();
+  mDeviceTreeQueryCount = 0;
 }
 
 /**
@@ -93,6 +424,10 @@ GetMatchingEnabledDeviceTreeNodes (
   UINTN      DeviceTreeSize;
   INT32      Offset;
   CONST VOID *Property;
+  DEVICE_TREE_CACHE *Cache;
+  UINT32     Hash;
+  UINT32     Index;
+  UINT32     LastNodeIndex;
 
   if ((CompatibleString == NULL) ||
       (NumberOfNodes == NULL)    ||
@@ -107,20 +442,40 @@ GetMatchingEnabledDeviceTreeNodes (
   }
 
   DeviceCount = 0;
-  Offset = fdt_node_offset_by_compatible(DeviceTree, -1, CompatibleString);
-  while (Offset != -FDT_ERR_NOTFOUND) {
-    Property = fdt_getprop (DeviceTree,
-                            Offset,
-                            "status",
-                            NULL);
-    if ((Property == NULL) ||
-        (AsciiStrCmp (Property, "okay") == 0)) {
+  Cache = GetDeviceTreeCache (DeviceTree);
+  if (Cache != NULL) {
+    Hash = CalculateFnv1aHash32 (CompatibleString);
+    LastNodeIndex = DEVICE_TREE_CACHE_END;
+    for (Index = Cache->CompatibleBuckets[Hash & Cache->BucketMask];
+         Index != DEVICE_TREE_CACHE_END;
+         Index = Cache->Compatibles[Index].Next) {
+      if ((Cache->Compatibles[Index].Hash != Hash) ||
+          (Cache->Compatibles[Index].NodeIndex == LastNodeIndex) ||
+          (AsciiStrCmp (Cache->Compatibles[Index].Compatible, CompatibleString) != 0)) {
+        continue;
+      }
+      LastNodeIndex = Cache->Compatibles[Index].NodeIndex;
       if (DeviceCount < *NumberOfNodes) {
-        NodeHandleArray[DeviceCount] = (UINT32)Offset;
+        NodeHandleArray[DeviceCount] = (UINT32)Cache->Nodes[LastNodeIndex].Offset;
       }
       DeviceCount++;
     }
-    Offset = fdt_node_offset_by_compatible(DeviceTree, Offset, CompatibleString);
+  } else {
+    Offset = fdt_node_offset_by_compatible(DeviceTree, -1, CompatibleString);
+    while (Offset != -FDT_ERR_NOTFOUND) {
+      Property = fdt_getprop (DeviceTree,
+                              Offset,
+                              "status",
+                              NULL);
+      if ((Property == NULL) ||
+          (AsciiStrCmp (Property, "okay") == 0)) {
+        if (DeviceCount < *NumberOfNodes) {
+          NodeHandleArray[DeviceCount] = (UINT32)Offset;
+        }
+        DeviceCount++;
+      }
+      Offset = fdt_node_offset_by_compatible(DeviceTree, Offset, CompatibleString);
+    }
   }
 
   OriginalSize = *NumberOfNodes;
@@ -227,6 +582,66 @@ GetDeviceTreeHandle (
   return EFI_SUCCESS;
 }
 
+/**
+  Returns the handle for the node with a specific phandle
+
+  @param  Phandle         - Phandle of the node
+  @param  NodeHandle      - NodeHandle
+
+  @retval EFI_SUCCESS           - Operation successful
+  @retval EFI_INVALID_PARAMETER - Phandle is invalid
+  @retval EFI_INVALID_PARAMETER - NodeHandle is NULL
+  @retval EFI_NOT_FOUND         - No node has this phandle
+  @retval EFI_DEVICE_ERROR      - Other Errors
+
+**/
+EFI_STATUS
+EFIAPI
+GetDeviceTreeHandleByPhandle (
+  IN  UINT32       Phandle,
+  OUT UINT32       *Handle
+  )
+{
+  EFI_STATUS        Status;
+  VOID              *DeviceTree;
+  UINTN             DeviceTreeSize;
+  DEVICE_TREE_CACHE *Cache;
+  UINT32            Index;
+  INT32             NodeOffset;
+
+  if ((Handle == NULL) ||
+      (Phandle == 0) ||
+      (Phandle == MAX_UINT32)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = GetDeviceTreePointer (&DeviceTree, &DeviceTreeSize);
+  if (EFI_ERROR (Status)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Cache = GetDeviceTreeCache (DeviceTree);
+  if (Cache != NULL) {
+    for (Index = Cache->PhandleBuckets[Phandle & Cache->BucketMask];
+         Index != DEVICE_TREE_CACHE_END;
+         Index = Cache->Phandles[Index].Next) {
+      if (Cache->Phandles[Index].Phandle == Phandle) {
+        *Handle = (UINT32)Cache->Nodes[Cache->Phandles[Index].NodeIndex].Offset;
+        return EFI_SUCCESS;
+      }
+    }
+    return EFI_NOT_FOUND;
+  }
+
+  NodeOffset = fdt_node_offset_by_phandle (DeviceTree, Phandle);
+  if (NodeOffset < 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Handle = (UINT32)NodeOffset;
+  return EFI_SUCCESS;
+}
+
 /**
   Returns information about the registers of a given device tree node
 
@@ -275,8 +690,7 @@ GetDeviceTreeRegisters (
     return Status;
   }
 
-  AddressCells  = fdt_address_cells (DeviceTree, fdt_parent_offset(DeviceTree, NodeOffset));
-  SizeCells     = fdt_size_cells (DeviceTree, fdt_parent_offset(DeviceTree, NodeOffset));
+  GetParentCells (DeviceTree, NodeOffset, &AddressCells, &SizeCells);
 
   if ((AddressCells > 2) ||
       (AddressCells == 0) ||
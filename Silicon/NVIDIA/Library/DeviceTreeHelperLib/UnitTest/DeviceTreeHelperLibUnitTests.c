@@ -0,0 +1,1012 @@
+/** @file
+  Unit tests of the DeviceTreeHelperLib. Runs the helpers against a device
+  tree laid out like a Tegra234 DTB, checks them against direct libfdt
+  lookups and benchmarks them against the libfdt walks they replace.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DeviceTreeHelperLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+#include <libfdt.h>
+
+#include <time.h>
+
+#define UNIT_TEST_APP_NAME     "DeviceTreeHelperLib Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "0.1"
+
+// Room is left after the tree so that tests can add nodes to it
+#define TEST_DEVICE_TREE_SIZE       SIZE_256KB
+
+#define TEST_GIC_PHANDLE            1
+#define TEST_FIRST_DEVICE_PHANDLE   2
+
+#define TEST_CPU_COUNT              12
+#define TEST_OPP_TABLE_COUNT        3
+#define TEST_OPP_COUNT              64
+#define TEST_THERMAL_ZONE_COUNT     48
+#define TEST_TRIP_COUNT             4
+
+#define TEST_BENCHMARK_ITERATIONS   200
+
+#define TEST_COMPATIBLE(String)     String, sizeof (String)
+
+typedef struct {
+  CONST CHAR8  *Name;
+  CONST CHAR8  *Compatible;
+  UINTN        CompatibleSize;
+  BOOLEAN      Enabled;
+  UINT64       Base[2];
+  UINT64       Size[2];
+  UINT32       Interrupt;
+} TEST_DEVICE;
+
+typedef struct {
+  CONST CHAR8        *Path;
+  UINT32             AddressCells;
+  UINT32             SizeCells;
+  CONST TEST_DEVICE  *Devices;
+  UINTN              DeviceCount;
+} TEST_BUS;
+
+// Devices on /bus@0, which has one address and one size cell.  Unused
+// register regions have a size of 0.
+STATIC CONST TEST_DEVICE mBusDevices[] = {
+  { "gpio@2200000",   TEST_COMPATIBLE ("nvidia,tegra234-gpio"),                            TRUE,  { 0x2200000, 0x2210000 }, { 0x10000, 0x10000 }, 288 },
+  { "serial@3100000", TEST_COMPATIBLE ("nvidia,tegra234-uart\0nvidia,tegra20-uart"),       TRUE,  { 0x3100000 },            { 0x10000 },          112 },
+  { "serial@3110000", TEST_COMPATIBLE ("nvidia,tegra234-uart\0nvidia,tegra20-uart"),       FALSE, { 0x3110000 },            { 0x10000 },          113 },
+  { "serial@3130000", TEST_COMPATIBLE ("nvidia,tegra234-uart\0nvidia,tegra20-uart"),       TRUE,  { 0x3130000 },            { 0x10000 },          115 },
+  { "i2c@3160000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        TRUE,  { 0x3160000 },            { 0x100 },            25  },
+  { "i2c@3180000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        TRUE,  { 0x3180000 },            { 0x100 },            27  },
+  { "i2c@3190000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        FALSE, { 0x3190000 },            { 0x100 },            28  },
+  { "i2c@31b0000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        TRUE,  { 0x31b0000 },            { 0x100 },            29  },
+  { "i2c@31c0000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        TRUE,  { 0x31c0000 },            { 0x100 },            30  },
+  { "i2c@31e0000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        FALSE, { 0x31e0000 },            { 0x100 },            31  },
+  { "mmc@3400000",    TEST_COMPATIBLE ("nvidia,tegra234-sdhci\0nvidia,tegra186-sdhci"),    FALSE, { 0x3400000 },            { 0x20000 },          62  },
+  { "mmc@3460000",    TEST_COMPATIBLE ("nvidia,tegra234-sdhci\0nvidia,tegra186-sdhci"),    TRUE,  { 0x3460000 },            { 0x20000 },          63  },
+  { "ufshci@2500000", TEST_COMPATIBLE ("nvidia,tegra234-ufshc"),                           FALSE, { 0x2500000, 0x2510000 }, { 0x4000, 0x1000 },   44  },
+  { "i2c@c240000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        TRUE,  { 0xc240000 },            { 0x100 },            26  },
+  { "i2c@c250000",    TEST_COMPATIBLE ("nvidia,tegra234-i2c\0nvidia,tegra194-i2c"),        TRUE,  { 0xc250000 },            { 0x100 },            32  },
+  { "rtc@c2a0000",    TEST_COMPATIBLE ("nvidia,tegra234-rtc\0nvidia,tegra20-rtc"),         TRUE,  { 0xc2a0000 },            { 0x10000 },          10  },
+};
+
+// Devices under the root node, which has two address and two size cells
+STATIC CONST TEST_DEVICE mRootDevices[] = {
+  { "pcie@14100000",  TEST_COMPATIBLE ("nvidia,tegra234-pcie"),                            TRUE,  { 0x14100000, 0x3000000000 }, { 0x20000, 0x40000 }, 45  },
+  { "pcie@14120000",  TEST_COMPATIBLE ("nvidia,tegra234-pcie"),                            FALSE, { 0x14120000, 0x3200000000 }, { 0x20000, 0x40000 }, 47  },
+  { "pcie@14140000",  TEST_COMPATIBLE ("nvidia,tegra234-pcie"),                            TRUE,  { 0x14140000, 0x3400000000 }, { 0x20000, 0x40000 }, 49  },
+  { "pcie@14160000",  TEST_COMPATIBLE ("nvidia,tegra234-pcie"),                            TRUE,  { 0x14160000, 0x3600000000 }, { 0x20000, 0x40000 }, 51  },
+  { "pcie@141a0000",  TEST_COMPATIBLE ("nvidia,tegra234-pcie"),                            FALSE, { 0x141a0000, 0x2800000000 }, { 0x20000, 0x40000 }, 55  },
+  { "ethernet@6800000", TEST_COMPATIBLE ("nvidia,tegra234-mgbe"),                        TRUE,  { 0x6800000 },                { 0x10000 },          384 },
+};
+
+STATIC CONST TEST_BUS mTestBuses[] = {
+  { "/bus@0", 1, 1, mBusDevices,  ARRAY_SIZE (mBusDevices)  },
+  { "",       2, 2, mRootDevices, ARRAY_SIZE (mRootDevices) },
+};
+
+typedef struct {
+  CONST CHAR8  *Compatible;
+  UINT32       EnabledNodes;
+} TEST_COMPATIBLE_QUERY;
+
+// Compatible strings that are queried, including ones that only match a
+// second compatible string, only disabled nodes, or nothing at all
+STATIC CONST TEST_COMPATIBLE_QUERY mTestCompatibles[] = {
+  { "nvidia,tegra234-gpio",     1                    },
+  { "nvidia,tegra234-uart",     2                    },
+  { "nvidia,tegra20-uart",      2                    },
+  { "nvidia,tegra234-i2c",      6                    },
+  { "nvidia,tegra194-i2c",      6                    },
+  { "nvidia,tegra234-sdhci",    1                    },
+  { "nvidia,tegra186-sdhci",    1                    },
+  { "nvidia,tegra234-ufshc",    0                    },
+  { "nvidia,tegra20-rtc",       1                    },
+  { "nvidia,tegra234-pcie",     3                    },
+  { "nvidia,tegra234-mgbe",     1                    },
+  { "nvidia,tegra234-bpmp",     1                    },
+  { "nvidia,tegra234-unknown",  0                    },
+  { "arm,gic-v3",               1                    },
+  { "arm,cortex-a78",           TEST_CPU_COUNT       },
+  { "operating-points-v2",      TEST_OPP_TABLE_COUNT },
+  { "simple-bus",               1                    },
+};
+
+STATIC VOID   *mDeviceTree;
+STATIC UINTN  mDeviceCount;
+
+/**
+  Add a property of 32 bit cells to the node being built.
+
+  @param Fdt      Device tree being built
+  @param Name     Name of the property
+  @param Cells    Cells of the property in CPU byte order
+  @param Count    Number of cells
+
+  @return 0 on success, or a libfdt error.
+**/
+STATIC
+INT32
+FixtureAddCells (
+  IN VOID          *Fdt,
+  IN CONST CHAR8   *Name,
+  IN CONST UINT32  *Cells,
+  IN UINTN         Count
+) {
+  UINT32  Property[8];
+  UINTN   Index;
+
+  if (Count > ARRAY_SIZE (Property)) {
+    return -FDT_ERR_BADVALUE;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    Property[Index] = cpu_to_fdt32 (Cells[Index]);
+  }
+
+  return fdt_property(Fdt, Name, Property, Count * sizeof (UINT32));
+}
+
+/**
+  Add a node of a test device to the device tree being built.
+
+  @param Fdt            Device tree being built
+  @param Bus            Bus the device is on
+  @param Device         Device to add
+  @param Phandle        Phandle of the device
+
+  @return 0 on success, or a libfdt error.
+**/
+STATIC
+INT32
+FixtureAddDevice (
+  IN VOID               *Fdt,
+  IN CONST TEST_BUS     *Bus,
+  IN CONST TEST_DEVICE  *Device,
+  IN UINT32             Phandle
+) {
+  STATIC CONST CHAR8  RegNames[] = "base\0extra";
+  UINT32              Reg[8];
+  UINT32              Interrupts[3];
+  UINTN               Cells;
+  UINTN               Region;
+  UINTN               Regions;
+  INT32               Err;
+
+  Cells = 0;
+  Regions = (Device->Size[1] != 0) ? 2 : 1;
+  for (Region = 0; Region < Regions; Region++) {
+    if (Bus->AddressCells == 2) {
+      Reg[Cells++] = (UINT32)RShiftU64 (Device->Base[Region], 32);
+    }
+    Reg[Cells++] = (UINT32)Device->Base[Region];
+    if (Bus->SizeCells == 2) {
+      Reg[Cells++] = (UINT32)RShiftU64 (Device->Size[Region], 32);
+    }
+    Reg[Cells++] = (UINT32)Device->Size[Region];
+  }
+
+  // GIC_SPI, interrupt number, IRQ_TYPE_LEVEL_HIGH
+  Interrupts[0] = 0;
+  Interrupts[1] = Device->Interrupt;
+  Interrupts[2] = 4;
+
+  Err  = fdt_begin_node(Fdt, Device->Name);
+  Err |= fdt_property(Fdt, "compatible", Device->Compatible, Device->CompatibleSize);
+  Err |= FixtureAddCells(Fdt, "reg", Reg, Cells);
+  if (Regions > 1) {
+    Err |= fdt_property(Fdt, "reg-names", RegNames, sizeof (RegNames));
+  }
+  Err |= FixtureAddCells(Fdt, "interrupts", Interrupts, ARRAY_SIZE (Interrupts));
+  Err |= fdt_property_string(Fdt, "status", Device->Enabled ? "okay" : "disabled");
+  Err |= fdt_property_u32(Fdt, "phandle", Phandle);
+  Err |= fdt_end_node(Fdt);
+
+  return Err;
+}
+
+/**
+  Add the nodes that describe the CPUs, their OPP tables and the thermal
+  zones.  Only a few of them have compatible strings or registers, but they
+  make up most of the nodes of a Tegra DTB.
+
+  @param Fdt      Device tree being built
+
+  @return 0 on success, or a libfdt error.
+**/
+STATIC
+INT32
+FixtureAddSystemNodes (
+  IN VOID  *Fdt
+) {
+  CHAR8   Name[32];
+  UINTN   Index;
+  UINTN   Entry;
+  UINT32  CpuId;
+  UINT64  Frequency;
+  INT32   Err;
+
+  Err  = fdt_begin_node(Fdt, "cpus");
+  Err |= fdt_property_u32(Fdt, "#address-cells", 1);
+  Err |= fdt_property_u32(Fdt, "#size-cells", 0);
+  for (Index = 0; Index < TEST_CPU_COUNT; Index++) {
+    CpuId = (UINT32)(((Index / 4) << 16) | ((Index % 4) << 8));
+    AsciiSPrint(Name, sizeof (Name), "cpu@%x", CpuId);
+    Err |= fdt_begin_node(Fdt, Name);
+    Err |= fdt_property_string(Fdt, "compatible", "arm,cortex-a78");
+    Err |= fdt_property_string(Fdt, "device_type", "cpu");
+    Err |= fdt_property_u32(Fdt, "reg", CpuId);
+    Err |= fdt_end_node(Fdt);
+  }
+  Err |= fdt_end_node(Fdt);
+
+  for (Index = 0; Index < TEST_OPP_TABLE_COUNT; Index++) {
+    AsciiSPrint(Name, sizeof (Name), "opp-table-cluster%u", (UINT32)Index);
+    Err |= fdt_begin_node(Fdt, Name);
+    Err |= fdt_property_string(Fdt, "compatible", "operating-points-v2");
+    for (Entry = 0; Entry < TEST_OPP_COUNT; Entry++) {
+      Frequency = MultU64x32 (Entry + 1, 115200000);
+      AsciiSPrint(Name, sizeof (Name), "opp-%lu", Frequency);
+      Err |= fdt_begin_node(Fdt, Name);
+      Err |= fdt_property_u64(Fdt, "opp-hz", Frequency);
+      Err |= fdt_property_u32(Fdt, "opp-peak-kBps", (UINT32)(Entry + 1) * 816000);
+      Err |= fdt_end_node(Fdt);
+    }
+    Err |= fdt_end_node(Fdt);
+  }
+
+  Err |= fdt_begin_node(Fdt, "thermal-zones");
+  for (Index = 0; Index < TEST_THERMAL_ZONE_COUNT; Index++) {
+    AsciiSPrint(Name, sizeof (Name), "zone%u-thermal", (UINT32)Index);
+    Err |= fdt_begin_node(Fdt, Name);
+    Err |= fdt_property_u32(Fdt, "polling-delay", 1000);
+    Err |= fdt_begin_node(Fdt, "trips");
+    for (Entry = 0; Entry < TEST_TRIP_COUNT; Entry++) {
+      AsciiSPrint(Name, sizeof (Name), "trip%u", (UINT32)Entry);
+      Err |= fdt_begin_node(Fdt, Name);
+      Err |= fdt_property_u32(Fdt, "temperature", 50000 + ((UINT32)Entry * 10000));
+      Err |= fdt_property_string(Fdt, "type", "passive");
+      Err |= fdt_end_node(Fdt);
+    }
+    Err |= fdt_end_node(Fdt);
+    Err |= fdt_end_node(Fdt);
+  }
+  Err |= fdt_end_node(Fdt);
+
+  return Err;
+}
+
+/**
+  Build the test device tree in mDeviceTree.
+
+  @return 0 on success, or a libfdt error.
+**/
+STATIC
+INT32
+BuildFixture (
+  VOID
+) {
+  STATIC CONST CHAR8  RootCompatible[] = "nvidia,p3737-0000+p3701-0000\0nvidia,tegra234";
+  STATIC CONST UINT32 BusRanges[] = { 0x0, 0x0, 0x0, 0x40000000 };
+  STATIC CONST UINT32 GicReg[] = { 0x0, 0xf400000, 0x0, 0x10000, 0x0, 0xf440000, 0x0, 0x200000 };
+  CONST TEST_BUS      *Bus;
+  UINTN               BusIndex;
+  UINTN               Index;
+  UINT32              Phandle;
+  INT32               Err;
+
+  Err  = fdt_create(mDeviceTree, TEST_DEVICE_TREE_SIZE);
+  Err |= fdt_finish_reservemap(mDeviceTree);
+  Err |= fdt_begin_node(mDeviceTree, "");
+  Err |= fdt_property(mDeviceTree, "compatible", RootCompatible, sizeof (RootCompatible));
+  Err |= fdt_property_u32(mDeviceTree, "#address-cells", 2);
+  Err |= fdt_property_u32(mDeviceTree, "#size-cells", 2);
+  Err |= fdt_property_u32(mDeviceTree, "interrupt-parent", TEST_GIC_PHANDLE);
+
+  Err |= FixtureAddSystemNodes(mDeviceTree);
+
+  Err |= fdt_begin_node(mDeviceTree, "interrupt-controller@f400000");
+  Err |= fdt_property_string(mDeviceTree, "compatible", "arm,gic-v3");
+  Err |= FixtureAddCells(mDeviceTree, "reg", GicReg, ARRAY_SIZE (GicReg));
+  Err |= fdt_property_u32(mDeviceTree, "#interrupt-cells", 3);
+  Err |= fdt_property(mDeviceTree, "interrupt-controller", NULL, 0);
+  Err |= fdt_property_u32(mDeviceTree, "phandle", TEST_GIC_PHANDLE);
+  Err |= fdt_end_node(mDeviceTree);
+
+  // The BPMP has neither registers nor interrupts
+  Err |= fdt_begin_node(mDeviceTree, "bpmp");
+  Err |= fdt_property_string(mDeviceTree, "compatible", "nvidia,tegra234-bpmp");
+  Err |= fdt_end_node(mDeviceTree);
+
+  Phandle = TEST_FIRST_DEVICE_PHANDLE;
+  for (BusIndex = 0; BusIndex < ARRAY_SIZE (mTestBuses); BusIndex++) {
+    Bus = &mTestBuses[BusIndex];
+    if (Bus->Path[0] != '\0') {
+      Err |= fdt_begin_node(mDeviceTree, Bus->Path + 1);
+      Err |= fdt_property_string(mDeviceTree, "compatible", "simple-bus");
+      Err |= fdt_property_u32(mDeviceTree, "#address-cells", Bus->AddressCells);
+      Err |= fdt_property_u32(mDeviceTree, "#size-cells", Bus->SizeCells);
+      Err |= FixtureAddCells(mDeviceTree, "ranges", BusRanges, ARRAY_SIZE (BusRanges));
+    }
+    for (Index = 0; Index < Bus->DeviceCount; Index++) {
+      Err |= FixtureAddDevice(mDeviceTree, Bus, &Bus->Devices[Index], Phandle++);
+    }
+    if (Bus->Path[0] != '\0') {
+      Err |= fdt_end_node(mDeviceTree);
+    }
+  }
+
+  Err |= fdt_end_node(mDeviceTree);
+  Err |= fdt_finish(mDeviceTree);
+
+  // Make the tree editable, with the rest of the buffer free
+  Err |= fdt_open_into(mDeviceTree, mDeviceTree, TEST_DEVICE_TREE_SIZE);
+
+  return Err;
+}
+
+/**
+  Get the node offset of a test device.
+
+  @param Bus      Bus the device is on
+  @param Device   Device
+
+  @return Node offset, or a negative libfdt error.
+**/
+STATIC
+INT32
+DeviceOffset (
+  IN CONST TEST_BUS     *Bus,
+  IN CONST TEST_DEVICE  *Device
+) {
+  CHAR8 Path[64];
+
+  AsciiSPrint(Path, sizeof (Path), "%a/%a", Bus->Path, Device->Name);
+  return fdt_path_offset(mDeviceTree, Path);
+}
+
+
+/**
+  Find the enabled nodes that match a compatible string by walking the
+  device tree with libfdt, the way DeviceTreeHelperLib did without its
+  node index.
+
+  @param Compatible     Compatible string
+  @param Offsets        Returns the offsets of the matching nodes
+  @param MaxOffsets     Size of Offsets
+
+  @return Number of matching nodes.
+**/
+STATIC
+UINT32
+ReferenceMatchingNodes (
+  IN  CONST CHAR8  *Compatible,
+  OUT UINT32       *Offsets,
+  IN  UINT32       MaxOffsets
+) {
+  CONST CHAR8 *Status;
+  INT32       Offset;
+  UINT32      Count;
+
+  Count = 0;
+  Offset = fdt_node_offset_by_compatible(mDeviceTree, -1, Compatible);
+  while (Offset >= 0) {
+    Status = fdt_getprop(mDeviceTree, Offset, "status", NULL);
+    if ((Status == NULL) || (AsciiStrCmp(Status, "okay") == 0)) {
+      if (Count < MaxOffsets) {
+        Offsets[Count] = (UINT32)Offset;
+      }
+      Count++;
+    }
+    Offset = fdt_node_offset_by_compatible(mDeviceTree, Offset, Compatible);
+  }
+
+  return Count;
+}
+
+/**
+  Get the number of register regions of a node by looking up the cell
+  sizes of its parent with libfdt, the way DeviceTreeHelperLib did without
+  its node index.
+
+  @param Offset     Offset of the node
+
+  @return Number of register regions, or 0 if they cannot be described.
+**/
+STATIC
+UINT32
+ReferenceRegisterCount (
+  IN INT32  Offset
+) {
+  INT32 AddressCells;
+  INT32 SizeCells;
+  INT32 PropertySize;
+
+  AddressCells = fdt_address_cells(mDeviceTree, fdt_parent_offset(mDeviceTree, Offset));
+  SizeCells = fdt_size_cells(mDeviceTree, fdt_parent_offset(mDeviceTree, Offset));
+  if ((AddressCells <= 0) || (AddressCells > 2) || (SizeCells <= 0) || (SizeCells > 2)) {
+    return 0;
+  }
+
+  if (fdt_getprop(mDeviceTree, Offset, "reg", &PropertySize) == NULL) {
+    return 0;
+  }
+
+  return PropertySize / ((AddressCells + SizeCells) * sizeof (UINT32));
+}
+
+/**
+  Query the test device tree the way drivers do: find the nodes of each
+  compatible string with a sizing and a filling call, get their registers
+  and interrupts, and look up every phandle.
+
+  @param UseHelpers   TRUE to use DeviceTreeHelperLib, FALSE to use the
+                      libfdt walks it replaces
+
+  @return Number of nodes, register regions, interrupts and phandles found.
+**/
+STATIC
+UINTN
+DriverQueries (
+  IN BOOLEAN  UseHelpers
+) {
+  NVIDIA_DEVICE_TREE_REGISTER_DATA   Registers[2];
+  NVIDIA_DEVICE_TREE_INTERRUPT_DATA  Interrupts[1];
+  UINT32                             Handles[32];
+  UINT32                             Count;
+  UINT32                             Number;
+  UINT32                             Node;
+  UINT32                             Handle;
+  UINT32                             Phandle;
+  UINTN                              Index;
+  UINTN                              Found;
+  INT32                              PropertySize;
+
+  Found = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mTestCompatibles); Index++) {
+    if (UseHelpers) {
+      Count = 0;
+      if (GetMatchingEnabledDeviceTreeNodes(mTestCompatibles[Index].Compatible, NULL, &Count) != EFI_BUFFER_TOO_SMALL) {
+        continue;
+      }
+      GetMatchingEnabledDeviceTreeNodes(mTestCompatibles[Index].Compatible, Handles, &Count);
+    } else {
+      Count = ReferenceMatchingNodes(mTestCompatibles[Index].Compatible, NULL, 0);
+      ReferenceMatchingNodes(mTestCompatibles[Index].Compatible, Handles, ARRAY_SIZE (Handles));
+    }
+
+    Count = MIN (Count, ARRAY_SIZE (Handles));
+    for (Node = 0; Node < Count; Node++) {
+      Found++;
+      if (UseHelpers) {
+        Number = ARRAY_SIZE (Registers);
+        if (!EFI_ERROR (GetDeviceTreeRegisters(Handles[Node], Registers, &Number))) {
+          Found += Number;
+        }
+        Number = ARRAY_SIZE (Interrupts);
+        if (!EFI_ERROR (GetDeviceTreeInterrupts(Handles[Node], Interrupts, &Number))) {
+          Found += Number;
+        }
+      } else {
+        Found += ReferenceRegisterCount((INT32)Handles[Node]);
+        if (fdt_getprop(mDeviceTree, (INT32)Handles[Node], "interrupts", &PropertySize) != NULL) {
+          Found += PropertySize / (3 * sizeof (UINT32));
+        }
+      }
+    }
+  }
+
+  for (Phandle = TEST_GIC_PHANDLE; Phandle < TEST_FIRST_DEVICE_PHANDLE + mDeviceCount; Phandle++) {
+    if (UseHelpers) {
+      if (!EFI_ERROR (GetDeviceTreeHandleByPhandle(Phandle, &Handle))) {
+        Found++;
+      }
+    } else if (fdt_node_offset_by_phandle(mDeviceTree, Phandle) >= 0) {
+      Found++;
+    }
+  }
+
+  return Found;
+}
+
+/**
+  Create the test device tree and make the helpers use it.
+
+  @param Context            Not used by this function
+
+  @retval UNIT_TEST_PASSED                      Setup finished successfully.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The device tree could not
+                                                be built.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+DeviceTreeTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  if (BuildFixture() != 0) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  SetDeviceTreePointer(mDeviceTree, TEST_DEVICE_TREE_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that compatible string queries return the enabled matching nodes in
+  device tree order, for both the sizing and the filling call.  The first
+  queries walk the device tree and the later ones use the node index.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CompatibleTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST TEST_COMPATIBLE_QUERY *Query;
+  UINT32                      Expected[32];
+  UINT32                      Handles[32];
+  UINT32                      Count;
+  UINTN                       Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mTestCompatibles); Index++) {
+    Query = &mTestCompatibles[Index];
+    UT_ASSERT_EQUAL(ReferenceMatchingNodes(Query->Compatible, Expected, ARRAY_SIZE (Expected)),
+                    Query->EnabledNodes);
+
+    Count = 0;
+    if (Query->EnabledNodes == 0) {
+      UT_ASSERT_STATUS_EQUAL(GetMatchingEnabledDeviceTreeNodes(Query->Compatible, NULL, &Count),
+                             EFI_NOT_FOUND);
+      UT_ASSERT_EQUAL(Count, 0);
+      continue;
+    }
+
+    UT_ASSERT_STATUS_EQUAL(GetMatchingEnabledDeviceTreeNodes(Query->Compatible, NULL, &Count),
+                           EFI_BUFFER_TOO_SMALL);
+    UT_ASSERT_EQUAL(Count, Query->EnabledNodes);
+    UT_ASSERT_NOT_EFI_ERROR(GetMatchingEnabledDeviceTreeNodes(Query->Compatible, Handles, &Count));
+    UT_ASSERT_EQUAL(Count, Query->EnabledNodes);
+    UT_ASSERT_MEM_EQUAL(Handles, Expected, Count * sizeof (UINT32));
+  }
+
+  Count = ARRAY_SIZE (Handles);
+  UT_ASSERT_NOT_EFI_ERROR(GetMatchingEnabledDeviceTreeNodes("nvidia,tegra194-i2c", Handles, &Count));
+  UT_ASSERT_EQUAL(Handles[0], (UINT32)fdt_path_offset(mDeviceTree, "/bus@0/i2c@3160000"));
+  UT_ASSERT_EQUAL(Handles[5], (UINT32)fdt_path_offset(mDeviceTree, "/bus@0/i2c@c250000"));
+
+  Count = 1;
+  UT_ASSERT_STATUS_EQUAL(GetMatchingEnabledDeviceTreeNodes("nvidia,tegra234-pcie", Handles, &Count),
+                         EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_EQUAL(Count, 3);
+  UT_ASSERT_EQUAL(Handles[0], (UINT32)fdt_path_offset(mDeviceTree, "/pcie@14100000"));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that every phandle resolves to its node and that unknown phandles
+  are not found.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+PhandleTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST TEST_BUS  *Bus;
+  UINTN           BusIndex;
+  UINTN           Index;
+  UINT32          Phandle;
+  UINT32          Handle;
+
+  UT_ASSERT_NOT_EFI_ERROR(GetDeviceTreeHandleByPhandle(TEST_GIC_PHANDLE, &Handle));
+  UT_ASSERT_EQUAL(Handle, (UINT32)fdt_path_offset(mDeviceTree, "/interrupt-controller@f400000"));
+
+  Phandle = TEST_FIRST_DEVICE_PHANDLE;
+  for (BusIndex = 0; BusIndex < ARRAY_SIZE (mTestBuses); BusIndex++) {
+    Bus = &mTestBuses[BusIndex];
+    for (Index = 0; Index < Bus->DeviceCount; Index++, Phandle++) {
+      UT_ASSERT_NOT_EFI_ERROR(GetDeviceTreeHandleByPhandle(Phandle, &Handle));
+      UT_ASSERT_EQUAL(Handle, (UINT32)DeviceOffset(Bus, &Bus->Devices[Index]));
+      UT_ASSERT_EQUAL(Handle, (UINT32)fdt_node_offset_by_phandle(mDeviceTree, Phandle));
+    }
+  }
+
+  UT_ASSERT_STATUS_EQUAL(GetDeviceTreeHandleByPhandle(Phandle, &Handle), EFI_NOT_FOUND);
+  UT_ASSERT_STATUS_EQUAL(GetDeviceTreeHandleByPhandle(0, &Handle), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL(GetDeviceTreeHandleByPhandle(MAX_UINT32, &Handle), EFI_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that registers are decoded with the cell sizes of each node's own
+  parent, and that interrupts are returned as SPIs.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+RegisterAndInterruptTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST TEST_BUS                     *Bus;
+  CONST TEST_DEVICE                  *Device;
+  NVIDIA_DEVICE_TREE_REGISTER_DATA   Registers[2];
+  NVIDIA_DEVICE_TREE_INTERRUPT_DATA  Interrupts[1];
+  UINTN                              BusIndex;
+  UINTN                              Index;
+  UINT32                             Handle;
+  UINT32                             Count;
+  UINT32                             ExpectedCount;
+
+  for (BusIndex = 0; BusIndex < ARRAY_SIZE (mTestBuses); BusIndex++) {
+    Bus = &mTestBuses[BusIndex];
+    for (Index = 0; Index < Bus->DeviceCount; Index++) {
+      Device = &Bus->Devices[Index];
+      Handle = (UINT32)DeviceOffset(Bus, Device);
+      ExpectedCount = (Device->Size[1] != 0) ? 2 : 1;
+
+      Count = 0;
+      UT_ASSERT_STATUS_EQUAL(GetDeviceTreeRegisters(Handle, NULL, &Count), EFI_BUFFER_TOO_SMALL);
+      UT_ASSERT_EQUAL(Count, ExpectedCount);
+      UT_ASSERT_NOT_EFI_ERROR(GetDeviceTreeRegisters(Handle, Registers, &Count));
+      UT_ASSERT_EQUAL(Count, ExpectedCount);
+      UT_ASSERT_EQUAL(Registers[0].BaseAddress, Device->Base[0]);
+      UT_ASSERT_EQUAL(Registers[0].Size, Device->Size[0]);
+      if (ExpectedCount == 2) {
+        UT_ASSERT_EQUAL(Registers[1].BaseAddress, Device->Base[1]);
+        UT_ASSERT_EQUAL(Registers[1].Size, Device->Size[1]);
+        UT_ASSERT_NOT_NULL(Registers[1].Name);
+        UT_ASSERT_EQUAL(AsciiStrCmp(Registers[1].Name, "extra"), 0);
+      } else {
+        UT_ASSERT_TRUE(Registers[0].Name == NULL);
+      }
+
+      Count = ARRAY_SIZE (Interrupts);
+      UT_ASSERT_NOT_EFI_ERROR(GetDeviceTreeInterrupts(Handle, Interrupts, &Count));
+      UT_ASSERT_EQUAL(Count, 1);
+      UT_ASSERT_EQUAL(Interrupts[0].Type, INTERRUPT_SPI_TYPE);
+      UT_ASSERT_EQUAL(Interrupts[0].Interrupt, Device->Interrupt);
+    }
+  }
+
+  // CPUs have no size cells, so their registers cannot be described
+  Handle = (UINT32)fdt_path_offset(mDeviceTree, "/cpus/cpu@10100");
+  Count = ARRAY_SIZE (Registers);
+  UT_ASSERT_STATUS_EQUAL(GetDeviceTreeRegisters(Handle, Registers, &Count), EFI_DEVICE_ERROR);
+
+  Handle = (UINT32)fdt_path_offset(mDeviceTree, "/bpmp");
+  Count = ARRAY_SIZE (Registers);
+  UT_ASSERT_STATUS_EQUAL(GetDeviceTreeRegisters(Handle, Registers, &Count), EFI_NOT_FOUND);
+  Count = ARRAY_SIZE (Interrupts);
+  UT_ASSERT_STATUS_EQUAL(GetDeviceTreeInterrupts(Handle, Interrupts, &Count), EFI_NOT_FOUND);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that the helpers follow changes to the device tree: edits that
+  change its size are picked up on their own, and in place edits once the
+  cache is invalidated.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+TreeChangeTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINT32  Handles[16];
+  UINT32  Count;
+  UINT32  Handle;
+  INT32   Offset;
+
+  // Make enough queries for the node index to be built
+  UT_ASSERT_EQUAL(DriverQueries(TRUE), DriverQueries(FALSE));
+
+  Count = ARRAY_SIZE (Handles);
+  UT_ASSERT_NOT_EFI_ERROR(GetMatchingEnabledDeviceTreeNodes("nvidia,tegra234-sdhci", Handles, &Count));
+  UT_ASSERT_EQUAL(Count, 1);
+
+  // Disable the enabled controller without changing the size of the tree
+  Offset = fdt_path_offset(mDeviceTree, "/bus@0/mmc@3460000");
+  UT_ASSERT_TRUE(Offset >= 0);
+  UT_ASSERT_EQUAL(fdt_setprop_inplace(mDeviceTree, Offset, "status", "fail", sizeof ("fail")), 0);
+  InvalidateDeviceTreeCache();
+  Count = ARRAY_SIZE (Handles);
+  UT_ASSERT_STATUS_EQUAL(GetMatchingEnabledDeviceTreeNodes("nvidia,tegra234-sdhci", Handles, &Count),
+                         EFI_NOT_FOUND);
+
+  // Enable the other controller, which shrinks the tree
+  Offset = fdt_path_offset(mDeviceTree, "/bus@0/mmc@3400000");
+  UT_ASSERT_TRUE(Offset >= 0);
+  UT_ASSERT_EQUAL(fdt_setprop_string(mDeviceTree, Offset, "status", "okay"), 0);
+  Count = ARRAY_SIZE (Handles);
+  UT_ASSERT_NOT_EFI_ERROR(GetMatchingEnabledDeviceTreeNodes("nvidia,tegra234-sdhci", Handles, &Count));
+  UT_ASSERT_EQUAL(Count, 1);
+  UT_ASSERT_EQUAL(Handles[0], (UINT32)fdt_path_offset(mDeviceTree, "/bus@0/mmc@3400000"));
+
+  // Add a node, which moves the nodes after it
+  Offset = fdt_add_subnode(mDeviceTree, fdt_path_offset(mDeviceTree, "/bus@0"), "i2c@3150000");
+  UT_ASSERT_TRUE(Offset >= 0);
+  UT_ASSERT_EQUAL(fdt_setprop_string(mDeviceTree, Offset, "compatible", "nvidia,tegra234-i2c"), 0);
+  UT_ASSERT_EQUAL(fdt_setprop_u32(mDeviceTree, Offset, "phandle", 0x1000), 0);
+  Count = ARRAY_SIZE (Handles);
+  UT_ASSERT_NOT_EFI_ERROR(GetMatchingEnabledDeviceTreeNodes("nvidia,tegra234-i2c", Handles, &Count));
+  UT_ASSERT_EQUAL(Count, 7);
+  UT_ASSERT_EQUAL(Handles[6], (UINT32)fdt_path_offset(mDeviceTree, "/bus@0/i2c@c250000"));
+  UT_ASSERT_NOT_EFI_ERROR(GetDeviceTreeHandleByPhandle(0x1000, &Handle));
+  UT_ASSERT_EQUAL(Handle, (UINT32)fdt_path_offset(mDeviceTree, "/bus@0/i2c@3150000"));
+  UT_ASSERT_NOT_EFI_ERROR(GetDeviceTreeHandleByPhandle(TEST_GIC_PHANDLE, &Handle));
+  UT_ASSERT_EQUAL(Handle, (UINT32)fdt_path_offset(mDeviceTree, "/interrupt-controller@f400000"));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Get the time of the host clock in microseconds.
+
+  @return Time in microseconds.
+**/
+STATIC
+UINT64
+HostTimeUs (
+  VOID
+) {
+  return ((UINT64)clock() * 1000000) / CLOCKS_PER_SEC;
+}
+
+/**
+  Benchmarks the helpers against the libfdt walks they replace, with the
+  queries drivers make at start of day.  Both must find the same results.
+  The times are logged and not checked, since they depend on the host.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINTN   Found;
+  UINTN   Index;
+  UINTN   Nodes;
+  INT32   Offset;
+  INT32   Depth;
+  UINT64  Start;
+  UINT64  FirstTime;
+  UINT64  HelperTime;
+  UINT64  WalkTime;
+
+  Nodes = 0;
+  Depth = 0;
+  for (Offset = 0; Offset >= 0; Offset = fdt_next_node(mDeviceTree, Offset, &Depth)) {
+    Nodes++;
+  }
+
+  // The first run includes the queries made before the node index is built
+  // and building it
+  InvalidateDeviceTreeCache();
+  Start = HostTimeUs();
+  Found = DriverQueries(TRUE);
+  FirstTime = HostTimeUs() - Start;
+  UT_ASSERT_EQUAL(Found, DriverQueries(FALSE));
+
+  Start = HostTimeUs();
+  for (Index = 0; Index < TEST_BENCHMARK_ITERATIONS; Index++) {
+    UT_ASSERT_EQUAL(DriverQueries(TRUE), Found);
+  }
+  HelperTime = HostTimeUs() - Start;
+
+  Start = HostTimeUs();
+  for (Index = 0; Index < TEST_BENCHMARK_ITERATIONS; Index++) {
+    UT_ASSERT_EQUAL(DriverQueries(FALSE), Found);
+  }
+  WalkTime = HostTimeUs() - Start;
+
+  UT_LOG_INFO("%u nodes, %u results per run, %u runs\n",
+              (UINT32)Nodes, (UINT32)Found, TEST_BENCHMARK_ITERATIONS);
+  UT_LOG_INFO("Helpers: first run %lu us, all runs %lu us\n", FirstTime, HelperTime);
+  UT_LOG_INFO("libfdt walks: all runs %lu us\n", WalkTime);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the device tree buffer.
+
+  @retval EFI_SUCCESS           Initialization succeeded.
+  @retval EFI_OUT_OF_RESOURCES  The allocation failed.
+**/
+STATIC
+EFI_STATUS
+InitTestData (
+  VOID
+) {
+  UINTN Index;
+
+  mDeviceTree = AllocateZeroPool(TEST_DEVICE_TREE_SIZE);
+  if (mDeviceTree == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mDeviceCount = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mTestBuses); Index++) {
+    mDeviceCount += mTestBuses[Index].DeviceCount;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Clean up the device tree buffer.
+**/
+STATIC
+VOID
+CleanUpTestData (
+  VOID
+) {
+  InvalidateDeviceTreeCache();
+
+  if (mDeviceTree != NULL) {
+    FreePool(mDeviceTree);
+    mDeviceTree = NULL;
+  }
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  DeviceTreeHelperLib and run the DeviceTreeHelperLib unit test.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+) {
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      HelperTestSuite;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitTestData();
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed to initialize test data. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Start setting up the test framework for running the tests.
+  Status = InitUnitTestFramework(
+    &Fw,
+    UNIT_TEST_APP_NAME,
+    gEfiCallerBaseName,
+    UNIT_TEST_APP_VERSION
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in InitUnitTestFramework. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Populate the Device Tree Helper Unit Test Suite.
+  Status = CreateUnitTestSuite(
+    &HelperTestSuite,
+    Fw,
+    "Device Tree Helper Tests",
+    "DeviceTreeHelperLib.HelperTestSuite",
+    NULL,
+    NULL
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in CreateUnitTestSuite for HelperTestSuite\n")
+    );
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // AddTestCase Args:
+  //  Suite | Description
+  //  Class Name | Function
+  //  Pre | Post | Context
+  AddTestCase(HelperTestSuite, "Compatible Test",
+              "CompatibleTest", CompatibleTest,
+              DeviceTreeTestSetup, NULL, NULL);
+  AddTestCase(HelperTestSuite, "Phandle Test",
+              "PhandleTest", PhandleTest,
+              DeviceTreeTestSetup, NULL, NULL);
+  AddTestCase(HelperTestSuite, "Register And Interrupt Test",
+              "RegisterAndInterruptTest", RegisterAndInterruptTest,
+              DeviceTreeTestSetup, NULL, NULL);
+  AddTestCase(HelperTestSuite, "Tree Change Test",
+              "TreeChangeTest", TreeChangeTest,
+              DeviceTreeTestSetup, NULL, NULL);
+  AddTestCase(HelperTestSuite, "Benchmark Test",
+              "BenchmarkTest", BenchmarkTest,
+              DeviceTreeTestSetup, NULL, NULL);
+
+  // Execute the tests.
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  CleanUpTestData();
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based
+  unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+BaseLibUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+) {
+  return UnitTestingEntry();
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+) {
+  return UnitTestingEntry ();
+}
@@ -39,31 +39,6 @@
 #define FMP_PROGRESS_VERIFY_IMAGES      ((mPcdFmpWriteVerifyImage) ? 30 : 0)
 #define FMP_PROGRESS_SETUP_REBOOT       5
 
-// last attempt status error codes
-enum {
-  LAS_ERROR_BAD_IMAGE_POINTER = LAST_ATTEMPT_STATUS_DEVICE_LIBRARY_MIN_ERROR_CODE_VALUE,
-  LAS_ERROR_INVALID_PACKAGE_HEADER,
-  LAS_ERROR_UNSUPPORTED_PACKAGE_TYPE,
-  LAS_ERROR_INVALID_PACKAGE_IMAGE_INFO_ARRAY,
-  LAS_ERROR_IMAGE_TOO_BIG,
-  LAS_ERROR_PACKAGE_SIZE_ERROR,
-  LAS_ERROR_NOT_UPDATABLE,
-  LAS_ERROR_IMAGE_NOT_IN_PACKAGE,
-  LAS_ERROR_MB1_INVALIDATE_ERROR,
-  LAS_ERROR_SINGLE_IMAGE_NOT_SUPPORTED,
-  LAS_ERROR_IMAGE_INDEX_MISSING,
-  LAS_ERROR_NO_PROTOCOL_FOR_IMAGE,
-  LAS_ERROR_IMAGE_ATTRIBUTES_ERROR,
-  LAS_ERROR_BCT_UPDATE_FAILED,
-  LAS_ERROR_WRITE_IMAGES_FAILED,
-  LAS_ERROR_MB1_WRITE_ERROR,
-  LAS_ERROR_VERIFY_IMAGES_FAILED,
-  LAS_ERROR_SET_SINGLE_IMAGE_FAILED,
-  LAS_ERROR_SETUP_REBOOT_FAILED,
-  LAS_ERROR_FMP_LIB_UNINITIALIZED,
-  LAS_ERROR_TN_SPEC_MISMATCH,
-};
-
 // special images that are not processed in the main loop
 STATIC CONST CHAR16 *SpecialImageNames[] = {
   L"BCT",
@@ -77,14 +52,19 @@ STATIC UINTN        mTotalBytesFlashed      = 0;
 STATIC UINTN        mTotalBytesToVerify     = 0;
 STATIC UINTN        mTotalBytesVerified     = 0;
 STATIC UINTN        mCurrentCompletion      = 0;
+STATIC UINTN        mTotalBytesWritten      = 0;
+STATIC UINTN        mTotalBytesSkipped      = 0;
 
 // module variables
 STATIC EFI_EVENT        mAddressChangeEvent         = NULL;
 STATIC EFI_EVENT        mExitBootServicesEvent      = NULL;
 STATIC BOOLEAN          mPcdFmpWriteVerifyImage     = FALSE;
 STATIC BOOLEAN          mPcdFmpSingleImageUpdate    = FALSE;
+STATIC BOOLEAN          mPcdFmpWriteSkipUnchanged   = FALSE;
 STATIC VOID             *mFmpDataBuffer             = NULL;
 STATIC UINTN            mFmpDataBufferSize          = 0;
+STATIC VOID             *mFmpCompareBuffer          = NULL;
+STATIC BOOLEAN          *mImageUnchanged            = NULL;
 STATIC BOOLEAN          mFmpLibInitialized          = FALSE;
 STATIC BOOLEAN          mIsProductionFused          = FALSE;
 STATIC UINT32           mActiveBootChain            = MAX_UINT32;
@@ -135,6 +115,36 @@ GetVersionInfo (
   return EFI_SUCCESS;
 }
 
+/**
+  Update FW update progress bar with the combined write and verify progress.
+  Images are verified as soon as they are written, so both counts advance
+  together from the same base completion.
+
+  @retval None
+
+**/
+STATIC
+VOID
+EFIAPI
+ImageWriteVerifyProgress (
+  VOID
+  )
+{
+  UINTN Completion;
+
+  Completion = mCurrentCompletion;
+  if (mTotalBytesToFlash != 0) {
+    Completion += (mTotalBytesFlashed * FMP_PROGRESS_WRITE_IMAGES) /
+      mTotalBytesToFlash;
+  }
+  if (mTotalBytesToVerify != 0) {
+    Completion += (mTotalBytesVerified * FMP_PROGRESS_VERIFY_IMAGES) /
+      mTotalBytesToVerify;
+  }
+
+  mProgress (Completion);
+}
+
 /**
   Increment image verify bytes complete and update FW update progress bar.
 
@@ -150,13 +160,8 @@ ImageVerifyProgress (
   IN  UINTN Bytes
   )
 {
-  UINTN VerifyCompletion;
-
   mTotalBytesVerified += Bytes;
-  VerifyCompletion = (mTotalBytesVerified * FMP_PROGRESS_VERIFY_IMAGES) /
-    mTotalBytesToVerify;
-
-  mProgress (mCurrentCompletion + VerifyCompletion);
+  ImageWriteVerifyProgress ();
 }
 
 /**
@@ -174,13 +179,8 @@ ImageWriteProgress (
   IN  UINTN Bytes
   )
 {
-  UINTN WriteCompletion;
-
   mTotalBytesFlashed += Bytes;
-  WriteCompletion = (mTotalBytesFlashed * FMP_PROGRESS_WRITE_IMAGES) /
-    mTotalBytesToFlash;
-
-  mProgress (mCurrentCompletion + WriteCompletion);
+  ImageWriteVerifyProgress ();
 }
 
 /**
@@ -293,7 +293,134 @@ FmpSetupReboot (
 }
 
 /**
-  Write a buffer to a FwImage.
+  Check if a chunk of a FwImage already contains the given data.  The chunk
+  is read back from the partition that a write with the same Flags would
+  target.  Any failure to read the chunk is treated as a mismatch so that
+  the chunk is written.
+
+  @param[in]  FwImageProtocol       FwImage protocol structure pointer
+  @param[in]  BlockSize             FwImage block size
+  @param[in]  Offset                Offset of the chunk in the FwImage
+  @param[in]  Bytes                 Number of bytes in the chunk
+  @param[in]  Data                  Data that is to be written to the chunk
+  @param[in]  Flags                 FwImage flags for the write.  See
+                                    NVIDIA_FW_IMAGE_PROTOCOL.Write()
+
+  @retval BOOLEAN                   TRUE if the chunk matches Data
+
+**/
+STATIC
+BOOLEAN
+EFIAPI
+ImageChunkIsUnchanged (
+  IN  NVIDIA_FW_IMAGE_PROTOCOL      *FwImageProtocol,
+  IN  UINT32                        BlockSize,
+  IN  UINTN                         Offset,
+  IN  UINTN                         Bytes,
+  IN  CONST UINT8                   *Data,
+  IN  UINTN                         Flags
+  )
+{
+  EFI_STATUS                        Status;
+  UINTN                             ReadFlags;
+  UINTN                             ReadSize;
+
+  if ((BlockSize == 0) || ((Offset % BlockSize) != 0)) {
+    return FALSE;
+  }
+
+  ReadSize = ALIGN_VALUE (Bytes, BlockSize);
+  if (ReadSize > FMP_WRITE_LOOP_SIZE) {
+    return FALSE;
+  }
+
+  // Write() targets the inactive partition unless a partition is forced
+  ReadFlags = Flags;
+  if ((Flags & (FW_IMAGE_RW_FLAG_FORCE_PARTITION_A |
+                FW_IMAGE_RW_FLAG_FORCE_PARTITION_B)) == 0) {
+    ReadFlags |= FW_IMAGE_RW_FLAG_READ_INACTIVE_IMAGE;
+  }
+
+  Status = FwImageProtocol->Read (FwImageProtocol,
+                                  Offset,
+                                  ReadSize,
+                                  mFmpCompareBuffer,
+                                  ReadFlags);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_VERBOSE, "%s: compare read at offset=%u failed: %r\n",
+            FwImageProtocol->ImageName, Offset, Status));
+    return FALSE;
+  }
+
+  return (CompareMem (mFmpCompareBuffer, Data, Bytes) == 0);
+}
+
+/**
+  Get the index of a FwImage in the FwImage protocol array.
+
+  @param[in]  FwImageProtocol       FwImage protocol structure pointer
+
+  @retval UINTN                     Index of the FwImage, or MAX_UINTN if
+                                    it is not in the array
+
+**/
+STATIC
+UINTN
+EFIAPI
+FwImageIndex (
+  IN  CONST NVIDIA_FW_IMAGE_PROTOCOL  *FwImageProtocol
+  )
+{
+  UINTN                             Index;
+  UINTN                             ImageCount;
+  NVIDIA_FW_IMAGE_PROTOCOL          **FwImageProtocolArray;
+
+  ImageCount            = FwImageGetCount ();
+  FwImageProtocolArray  = FwImageGetProtocolArray ();
+
+  for (Index = 0; Index < ImageCount; Index++) {
+    if (FwImageProtocolArray[Index] == FwImageProtocol) {
+      return Index;
+    }
+  }
+
+  return MAX_UINTN;
+}
+
+/**
+  Record whether every chunk of a FwImage was found unchanged and therefore
+  already read back and compared during the write.
+
+  @param[in]  FwImageProtocol       FwImage protocol structure pointer
+  @param[in]  Unchanged             TRUE if no chunk of the image was written
+
+  @retval None
+
+**/
+STATIC
+VOID
+EFIAPI
+SetImageUnchanged (
+  IN  CONST NVIDIA_FW_IMAGE_PROTOCOL  *FwImageProtocol,
+  IN  BOOLEAN                         Unchanged
+  )
+{
+  UINTN                             Index;
+
+  if (mImageUnchanged == NULL) {
+    return;
+  }
+
+  Index = FwImageIndex (FwImageProtocol);
+  if (Index != MAX_UINTN) {
+    mImageUnchanged[Index] = Unchanged;
+  }
+}
+
+/**
+  Write a buffer to a FwImage.  If PcdFmpWriteSkipUnchanged is TRUE, each
+  chunk is first compared with the current contents of the target partition
+  and only chunks that differ are written.
 
   @param[in]  FwImageProtocol       FwImage protocol structure pointer
   @param[in]  Bytes                 Number of bytes to write
@@ -318,23 +445,46 @@ WriteImageFromBuffer (
   EFI_STATUS                        Status;
   UINTN                             WriteOffset;
   UINTN                             BytesPerLoop;
+  BOOLEAN                           SkipUnchanged;
+  FW_IMAGE_ATTRIBUTES               ImageAttributes;
+  UINTN                             BytesSkipped;
 
   DEBUG ((DEBUG_VERBOSE, "Writing %s, bytes=%u\n",
           FwImageProtocol->ImageName, Bytes));
 
+  SkipUnchanged = mPcdFmpWriteSkipUnchanged && (mFmpCompareBuffer != NULL);
+  if (SkipUnchanged) {
+    Status = FwImageProtocol->GetAttributes (FwImageProtocol, &ImageAttributes);
+    if (EFI_ERROR (Status)) {
+      SkipUnchanged = FALSE;
+    }
+  }
+
+  Status        = EFI_SUCCESS;
   BytesPerLoop  = FMP_WRITE_LOOP_SIZE;
   WriteOffset   = 0;
+  BytesSkipped  = 0;
   while (Bytes > 0) {
     UINTN   WriteSize;
 
     WriteSize = (Bytes > BytesPerLoop) ? BytesPerLoop : Bytes;
-    Status = FwImageProtocol->Write (FwImageProtocol,
-                                     WriteOffset,
-                                     WriteSize,
-                                     DataBuffer + WriteOffset,
-                                     Flags);
-    if (EFI_ERROR (Status)) {
-      return Status;
+    if (SkipUnchanged &&
+        ImageChunkIsUnchanged (FwImageProtocol,
+                               ImageAttributes.BlockSize,
+                               WriteOffset,
+                               WriteSize,
+                               DataBuffer + WriteOffset,
+                               Flags)) {
+      BytesSkipped += WriteSize;
+    } else {
+      Status = FwImageProtocol->Write (FwImageProtocol,
+                                       WriteOffset,
+                                       WriteSize,
+                                       DataBuffer + WriteOffset,
+                                       Flags);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
     }
 
     WriteOffset += WriteSize;
@@ -342,6 +492,14 @@ WriteImageFromBuffer (
     ImageWriteProgress (WriteSize);
   }
 
+  mTotalBytesSkipped += BytesSkipped;
+  mTotalBytesWritten += WriteOffset - BytesSkipped;
+  SetImageUnchanged (FwImageProtocol,
+                     (WriteOffset == BytesSkipped) && (Flags == FW_IMAGE_RW_FLAG_NONE));
+
+  DEBUG ((DEBUG_INFO, "%s: wrote %u bytes, skipped %u unchanged bytes\n",
+          FwImageProtocol->ImageName, WriteOffset - BytesSkipped, BytesSkipped));
+
   return Status;
 }
 
@@ -399,66 +557,15 @@ WriteImage (
   return Status;
 }
 
-/**
-  Write FW package data to all FwImages except for special images.
-
-  @param[in]  Header                Pointer to the FW package header
-
-  @retval EFI_SUCCESS               The operation completed successfully
-  @retval Others                    An error occurred
-
-**/
-STATIC
-EFI_STATUS
-EFIAPI
-WriteRegularImages (
-  IN  CONST FW_PACKAGE_HEADER       *Header
-  )
-{
-  EFI_STATUS                        Status;
-  UINTN                             Index;
-  UINTN                             PkgImageIndex;
-  UINTN                             ImageCount;
-  NVIDIA_FW_IMAGE_PROTOCOL          **FwImageProtocolArray;
-
-  ImageCount            = FwImageGetCount ();
-  FwImageProtocolArray  = FwImageGetProtocolArray ();
-
-  // Write all images except special ones that are done later
-  for (Index = 0; Index < ImageCount; Index++) {
-    CONST CHAR16                *ImageName;
-    NVIDIA_FW_IMAGE_PROTOCOL    *FwImageProtocol;
-
-    FwImageProtocol = FwImageProtocolArray[Index];
-    ImageName = FwImageProtocol->ImageName;
-    if (IsSpecialImageName (ImageName)) {
-      continue;
-    }
-
-    Status = FwPackageGetImageIndex (Header,
-                                     ImageName,
-                                     mIsProductionFused,
-                                     &PkgImageIndex);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%s not found in package: %r\n", ImageName, Status));
-      return Status;
-    }
-
-    Status = WriteImage (Header,
-                         ImageName,
-                         FW_IMAGE_RW_FLAG_NONE);
-    if (EFI_ERROR (Status)) {
-      return Status;
-    }
-  }
-
-  return EFI_SUCCESS;
-}
-
 /**
   Verify that a FwImage matches its FW package data.  If PcdFmpWriteVerifyImage
   is FALSE, no verification is done and EFI_SUCCESS is returned.
 
+  The image is read back and compared in chunks of at most
+  FMP_WRITE_LOOP_SIZE bytes, so memory use does not depend on the image size.
+  An image whose every chunk was found unchanged while it was written has
+  already been read back and compared, and is not read again.
+
   @param[in]  Header                Pointer to the FW package header
   @param[in]  Name                  Name of the FwImage to verify
   @param[in]  Flags                 FwImage flags for the read.  See
@@ -485,6 +592,9 @@ VerifyImage (
   CONST FW_PACKAGE_IMAGE_INFO       *PkgImageInfo;
   UINTN                             ImageIndex;
   FW_IMAGE_ATTRIBUTES               ImageAttributes;
+  VOID                              *VerifyBuffer;
+  UINTN                             VerifyBufferMax;
+  UINTN                             Index;
 
   if (!mPcdFmpWriteVerifyImage) {
     return EFI_SUCCESS;
@@ -516,27 +626,47 @@ VerifyImage (
   DEBUG ((DEBUG_VERBOSE, "Verifying %s: PkgOffset=%d, Bytes=%d\n",
           Name, PkgImageInfo->Offset, PkgImageInfo->Bytes));
 
+  Index = FwImageIndex (FwImageProtocol);
+  if ((mImageUnchanged != NULL) && (Index != MAX_UINTN) &&
+      mImageUnchanged[Index] && (Flags == FW_IMAGE_RW_FLAG_READ_INACTIVE_IMAGE)) {
+    DEBUG ((DEBUG_INFO, "Image=%s unchanged, verified during write\n", Name));
+    ImageVerifyProgress (PkgImageInfo->Bytes);
+    return EFI_SUCCESS;
+  }
+
+  // Use the larger compare buffer when available to cut down on reads
+  if ((mFmpCompareBuffer != NULL) &&
+      (ImageAttributes.BlockSize != 0) &&
+      ((FMP_WRITE_LOOP_SIZE % ImageAttributes.BlockSize) == 0)) {
+    VerifyBuffer    = mFmpCompareBuffer;
+    VerifyBufferMax = FMP_WRITE_LOOP_SIZE;
+  } else {
+    VerifyBuffer    = mFmpDataBuffer;
+    VerifyBufferMax = mFmpDataBufferSize;
+  }
+
+  Status = EFI_SUCCESS;
   VerifyOffset = 0;
   Bytes = PkgImageInfo->Bytes;
   while (Bytes > 0) {
     UINTN   VerifySize;
     UINTN   VerifyBufferSize;
 
-    VerifySize = (Bytes > mFmpDataBufferSize) ? mFmpDataBufferSize : Bytes;
+    VerifySize = (Bytes > VerifyBufferMax) ? VerifyBufferMax : Bytes;
     VerifyBufferSize = ALIGN_VALUE (VerifySize, ImageAttributes.BlockSize);
-    ASSERT (VerifyBufferSize <= mFmpDataBufferSize);
+    ASSERT (VerifyBufferSize <= VerifyBufferMax);
 
     Status = FwImageProtocol->Read (FwImageProtocol,
                                     VerifyOffset,
                                     VerifyBufferSize,
-                                    mFmpDataBuffer,
+                                    VerifyBuffer,
                                     Flags);
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_ERROR, "Failed to read image=%s: %r\n", Name, Status));
       return Status;
     }
 
-    if (CompareMem (mFmpDataBuffer, DataBuffer + VerifyOffset, VerifySize) != 0) {
+    if (CompareMem (VerifyBuffer, DataBuffer + VerifyOffset, VerifySize) != 0) {
       DEBUG ((DEBUG_ERROR, "Image=%s failed verify near offset=%u\n",
               Name, VerifyOffset));
       return EFI_VOLUME_CORRUPTED;
@@ -551,11 +681,14 @@ VerifyImage (
 }
 
 /**
-  Verify that all FwImages (except BCT) match their FW package data. If
-  PcdFmpWriteVerifyImage is FALSE, no verification is done and EFI_SUCCESS
-  is returned.
+  Write FW package data to a FwImage's inactive partition and verify it
+  right away, so that a bad write is caught before any further images are
+  written.
 
   @param[in]  Header                Pointer to the FW package header
+  @param[in]  Name                  Name of the FwImage to write
+  @param[out] VerifyFailed          Set to TRUE if the write succeeded but
+                                    verification failed
 
   @retval EFI_SUCCESS               The operation completed successfully
   @retval Others                    An error occurred
@@ -564,8 +697,46 @@ VerifyImage (
 STATIC
 EFI_STATUS
 EFIAPI
-VerifyAllImages (
-  IN  CONST FW_PACKAGE_HEADER       *Header
+WriteAndVerifyImage (
+  IN  CONST FW_PACKAGE_HEADER       *Header,
+  IN  CONST CHAR16                  *Name,
+  OUT BOOLEAN                       *VerifyFailed
+  )
+{
+  EFI_STATUS                        Status;
+
+  *VerifyFailed = FALSE;
+
+  Status = WriteImage (Header, Name, FW_IMAGE_RW_FLAG_NONE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = VerifyImage (Header, Name, FW_IMAGE_RW_FLAG_READ_INACTIVE_IMAGE);
+  if (EFI_ERROR (Status)) {
+    *VerifyFailed = TRUE;
+  }
+
+  return Status;
+}
+
+/**
+  Write and verify FW package data for all FwImages except for special images.
+
+  @param[in]  Header                Pointer to the FW package header
+  @param[out] VerifyFailed          Set to TRUE if an image was written but
+                                    failed verification
+
+  @retval EFI_SUCCESS               The operation completed successfully
+  @retval Others                    An error occurred
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+WriteRegularImages (
+  IN  CONST FW_PACKAGE_HEADER       *Header,
+  OUT BOOLEAN                       *VerifyFailed
   )
 {
   EFI_STATUS                        Status;
@@ -574,20 +745,18 @@ VerifyAllImages (
   UINTN                             ImageCount;
   NVIDIA_FW_IMAGE_PROTOCOL          **FwImageProtocolArray;
 
-  if (!mPcdFmpWriteVerifyImage) {
-    return EFI_SUCCESS;
-  }
-
+  *VerifyFailed         = FALSE;
   ImageCount            = FwImageGetCount ();
   FwImageProtocolArray  = FwImageGetProtocolArray ();
 
+  // Write all images except special ones that are done later
   for (Index = 0; Index < ImageCount; Index++) {
     CONST CHAR16                *ImageName;
     NVIDIA_FW_IMAGE_PROTOCOL    *FwImageProtocol;
 
     FwImageProtocol = FwImageProtocolArray[Index];
     ImageName = FwImageProtocol->ImageName;
-    if (StrCmp (ImageName, L"BCT") == 0) {
+    if (IsSpecialImageName (ImageName)) {
       continue;
     }
 
@@ -600,9 +769,7 @@ VerifyAllImages (
       return Status;
     }
 
-    Status = VerifyImage (Header,
-                          ImageName,
-                          FW_IMAGE_RW_FLAG_READ_INACTIVE_IMAGE);
+    Status = WriteAndVerifyImage (Header, ImageName, VerifyFailed);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -1045,6 +1212,7 @@ FmpTegraSetImage (
 {
   CONST FW_PACKAGE_HEADER           *Header;
   EFI_STATUS                        Status;
+  BOOLEAN                           VerifyFailed;
 
   DEBUG ((DEBUG_INFO, "%a: Image=0x%p, ImageSize=%d Version=0x%x\n",
           __FUNCTION__, Image, ImageSize, CapsuleFwVersion));
@@ -1065,6 +1233,14 @@ FmpTegraSetImage (
   mTotalBytesFlashed        = 0;
   mTotalBytesVerified       = 0;
   mCurrentCompletion        = 0;
+  mTotalBytesWritten        = 0;
+  mTotalBytesSkipped        = 0;
+
+  // Reset record of images left unchanged by the writes of this update
+  if (mImageUnchanged != NULL) {
+    FreePool (mImageUnchanged);
+  }
+  mImageUnchanged = AllocateZeroPool (FwImageGetCount () * sizeof (BOOLEAN));
 
   // Ignore Progress function parameter since it is a null implementation
   // when UpdateCapsule() is the caller.  Use our UpdateProgress() instead.
@@ -1103,27 +1279,25 @@ FmpTegraSetImage (
     return EFI_ABORTED;
   }
 
-  Status = WriteRegularImages (Header);
+  // Each image is verified right after it is written so that a failure
+  // stops the update before the remaining images are written.
+  Status = WriteRegularImages (Header, &VerifyFailed);
   if (EFI_ERROR (Status)) {
-    *LastAttemptStatus = LAS_ERROR_WRITE_IMAGES_FAILED;
+    *LastAttemptStatus = (VerifyFailed) ? LAS_ERROR_VERIFY_IMAGES_FAILED :
+                                          LAS_ERROR_WRITE_IMAGES_FAILED;
     return EFI_ABORTED;
   }
 
-  Status = WriteImage (Header, L"mb1", FW_IMAGE_RW_FLAG_NONE);
+  // mb1 stays last so the inactive chain only becomes bootable once all
+  // other images are in place
+  Status = WriteAndVerifyImage (Header, L"mb1", &VerifyFailed);
   if (EFI_ERROR (Status)) {
-    *LastAttemptStatus = LAS_ERROR_MB1_WRITE_ERROR;
+    *LastAttemptStatus = (VerifyFailed) ? LAS_ERROR_VERIFY_IMAGES_FAILED :
+                                          LAS_ERROR_MB1_WRITE_ERROR;
     return EFI_ABORTED;
   }
 
-  SetImageProgress (FMP_PROGRESS_WRITE_IMAGES);
-
-  Status = VerifyAllImages (Header);
-  if (EFI_ERROR (Status)) {
-    *LastAttemptStatus = LAS_ERROR_VERIFY_IMAGES_FAILED;
-    return EFI_ABORTED;
-  }
-
-  SetImageProgress (FMP_PROGRESS_VERIFY_IMAGES);
+  SetImageProgress (FMP_PROGRESS_WRITE_IMAGES + FMP_PROGRESS_VERIFY_IMAGES);
 
   Status = FmpSetupReboot ();
   if (EFI_ERROR (Status)) {
@@ -1133,6 +1307,8 @@ FmpTegraSetImage (
 
 Done:
   SetImageProgress (FMP_PROGRESS_SETUP_REBOOT);
+  DEBUG ((DEBUG_INFO, "%a: bytes written=%u, unchanged bytes skipped=%u\n",
+          __FUNCTION__, mTotalBytesWritten, mTotalBytesSkipped));
   *LastAttemptStatus = LAST_ATTEMPT_STATUS_SUCCESS;
   DEBUG ((DEBUG_INFO, "%a: exit success\n", __FUNCTION__));
   return EFI_SUCCESS;
@@ -1159,6 +1335,7 @@ FmpDeviceLibConstructor (
 
   mPcdFmpWriteVerifyImage   = PcdGetBool (PcdFmpWriteVerifyImage);
   mPcdFmpSingleImageUpdate  = PcdGetBool (PcdFmpSingleImageUpdate);
+  mPcdFmpWriteSkipUnchanged = PcdGetBool (PcdFmpWriteSkipUnchanged);
 
   mFmpDataBufferSize = FMP_DATA_BUFFER_SIZE;
   mFmpDataBuffer = AllocateRuntimeZeroPool (mFmpDataBufferSize);
@@ -1168,6 +1345,14 @@ FmpDeviceLibConstructor (
     goto Done;
   }
 
+  // Without a compare buffer every chunk is simply written
+  if (mPcdFmpWriteSkipUnchanged) {
+    mFmpCompareBuffer = AllocateRuntimePool (FMP_WRITE_LOOP_SIZE);
+    if (mFmpCompareBuffer == NULL) {
+      DEBUG ((DEBUG_WARN, "%a: compare buffer alloc failed\n",  __FUNCTION__));
+    }
+  }
+
   Status = GetActiveBootChain (&mActiveBootChain);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "%a: Error getting active boot chain: %r\n",
@@ -1218,6 +1403,10 @@ Done:
       FreePool (mFmpDataBuffer);
       mFmpDataBuffer = NULL;
     }
+    if (mFmpCompareBuffer != NULL) {
+      FreePool (mFmpCompareBuffer);
+      mFmpCompareBuffer = NULL;
+    }
     if (mExitBootServicesEvent != NULL) {
       gBS->CloseEvent (mExitBootServicesEvent);
       mExitBootServicesEvent = NULL;
@@ -11,8 +11,34 @@
 #define __TEGRA_FMP_H__
 
 #include <Uefi/UefiBaseType.h>
+#include <LastAttemptStatus.h>
 #include <Protocol/FirmwareManagement.h>
 
+// last attempt status error codes
+enum {
+  LAS_ERROR_BAD_IMAGE_POINTER = LAST_ATTEMPT_STATUS_DEVICE_LIBRARY_MIN_ERROR_CODE_VALUE,
+  LAS_ERROR_INVALID_PACKAGE_HEADER,
+  LAS_ERROR_UNSUPPORTED_PACKAGE_TYPE,
+  LAS_ERROR_INVALID_PACKAGE_IMAGE_INFO_ARRAY,
+  LAS_ERROR_IMAGE_TOO_BIG,
+  LAS_ERROR_PACKAGE_SIZE_ERROR,
+  LAS_ERROR_NOT_UPDATABLE,
+  LAS_ERROR_IMAGE_NOT_IN_PACKAGE,
+  LAS_ERROR_MB1_INVALIDATE_ERROR,
+  LAS_ERROR_SINGLE_IMAGE_NOT_SUPPORTED,
+  LAS_ERROR_IMAGE_INDEX_MISSING,
+  LAS_ERROR_NO_PROTOCOL_FOR_IMAGE,
+  LAS_ERROR_IMAGE_ATTRIBUTES_ERROR,
+  LAS_ERROR_BCT_UPDATE_FAILED,
+  LAS_ERROR_WRITE_IMAGES_FAILED,
+  LAS_ERROR_MB1_WRITE_ERROR,
+  LAS_ERROR_VERIFY_IMAGES_FAILED,
+  LAS_ERROR_SET_SINGLE_IMAGE_FAILED,
+  LAS_ERROR_SETUP_REBOOT_FAILED,
+  LAS_ERROR_FMP_LIB_UNINITIALIZED,
+  LAS_ERROR_TN_SPEC_MISMATCH,
+};
+
 /**
   Get Tegra version number and/or string
 
@@ -0,0 +1,851 @@
+/** @file
+  Unit tests of the Tegra FmpDeviceLib. Runs capsule updates of a FW package
+  against simulated FW partitions and checks that every image is read back
+  and compared, including corruption on either side of a readback chunk
+  boundary, and that images are updated in order and the update stops at
+  the first failed write or verify.
+
+  Tests are run using a FwImage stub.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DisplayUpdateProgressStubLib.h>
+#include <Library/FmpDeviceLib.h>
+#include <Library/FwImageStubLib.h>
+#include <Library/FwPackageLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+#include <Protocol/BrBctUpdateProtocol.h>
+#include <Protocol/FirmwareManagementProgress.h>
+
+#include "../TegraFmp.h"
+
+#define UNIT_TEST_APP_NAME     "FmpDeviceLib Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "0.1"
+
+// Images are read back in chunks of this size
+#define READBACK_CHUNK_SIZE   SIZE_64KB
+
+#define TEST_PARTITION_SIZE   SIZE_256KB
+
+// Size of the start of mb1 that is erased before the other images are written
+#define MB1_INVALIDATE_SIZE   SIZE_4KB
+
+typedef struct {
+  CONST CHAR16  *Name;
+  UINTN         Bytes;
+  UINT32        BlockSize;
+} TEST_IMAGE;
+
+// FwImage order is the order regular images are written in.  The sizes
+// cover images that end on a chunk boundary, in a partial chunk and in a
+// partial block.
+STATIC CONST TEST_IMAGE mTestImages[] = {
+  { L"BCT",             SIZE_4KB,                          512       },
+  { L"mb1",             0x13000,                           512       },
+  { L"mb2",             (2 * READBACK_CHUNK_SIZE) + 0x300, 512       },
+  { L"bpmp-fw",         3 * READBACK_CHUNK_SIZE,           SIZE_4KB  },
+  { L"cpu-bootloader",  0x1F001,                           512       },
+  { L"secure-os",       0x8000,                            SIZE_64KB },
+};
+
+#define TEST_IMAGE_COUNT  (sizeof (mTestImages) / sizeof (mTestImages[0]))
+
+typedef struct {
+  CONST CHAR16  *Name;
+  UINTN         Offset;
+} TEST_CORRUPTION;
+
+// Corrupted bytes at the start and end of an image and on both sides of
+// each readback chunk boundary
+STATIC CONST TEST_CORRUPTION mTestCorruptions[] = {
+  { L"mb2",             0                                   },
+  { L"mb2",             READBACK_CHUNK_SIZE - 1             },
+  { L"mb2",             READBACK_CHUNK_SIZE                 },
+  { L"mb2",             (2 * READBACK_CHUNK_SIZE) - 1       },
+  { L"mb2",             2 * READBACK_CHUNK_SIZE             },
+  { L"mb2",             (2 * READBACK_CHUNK_SIZE) + 0x2FF   },
+  { L"bpmp-fw",         (3 * READBACK_CHUNK_SIZE) - 1       },
+  { L"cpu-bootloader",  0x1F000                             },
+  { L"secure-os",       0x7FFF                              },
+  { L"mb1",             0x12FFF                             },
+};
+
+#define TEST_CORRUPTION_COUNT (sizeof (mTestCorruptions) / sizeof (mTestCorruptions[0]))
+
+typedef struct {
+  CONST CHAR16  *Name;
+  UINTN         Offset;
+  BOOLEAN       Corrupt;
+  UINT32        LastAttemptStatus;
+} TEST_FAILURE;
+
+// Writes that fail, or bytes that are corrupted when written, and the last
+// attempt status each one must cause
+STATIC CONST TEST_FAILURE mTestFailures[] = {
+  { L"mb1",       0,                    FALSE,  LAS_ERROR_MB1_INVALIDATE_ERROR  },
+  { L"mb2",       0,                    FALSE,  LAS_ERROR_WRITE_IMAGES_FAILED   },
+  { L"mb2",       READBACK_CHUNK_SIZE,  FALSE,  LAS_ERROR_WRITE_IMAGES_FAILED   },
+  { L"bpmp-fw",   0,                    TRUE,   LAS_ERROR_VERIFY_IMAGES_FAILED  },
+  { L"secure-os", 0x7FFF,               FALSE,  LAS_ERROR_WRITE_IMAGES_FAILED   },
+  { L"secure-os", 0x7FFF,               TRUE,   LAS_ERROR_VERIFY_IMAGES_FAILED  },
+  { L"mb1",       0x12000,              FALSE,  LAS_ERROR_MB1_WRITE_ERROR       },
+  { L"mb1",       0x12000,              TRUE,   LAS_ERROR_VERIFY_IMAGES_FAILED  },
+};
+
+#define TEST_FAILURE_COUNT (sizeof (mTestFailures) / sizeof (mTestFailures[0]))
+
+// Used by UpdateProgress.c, normally provided by FmpDxe
+EDKII_FIRMWARE_MANAGEMENT_PROGRESS_PROTOCOL  mFmpProgress;
+
+STATIC EFI_BOOT_SERVICES              mBootServices;
+STATIC NVIDIA_BR_BCT_UPDATE_PROTOCOL  mBrBctUpdateProtocol;
+STATIC UINTN                          mBctUpdates;
+STATIC UINTN                          mBctUpdateOperation;
+STATIC UINT8                          mEvent;
+
+STATIC FW_PACKAGE_HEADER              *mPackage;
+STATIC UINTN                          mPackageSize;
+
+EFI_STATUS
+EFIAPI
+FmpDeviceLibConstructor (
+  IN  EFI_HANDLE        ImageHandle,
+  IN  EFI_SYSTEM_TABLE  *SystemTable
+  );
+
+/**
+  Stub of gBS->LocateProtocol that provides the BR-BCT update protocol.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+) {
+  if (CompareGuid(Protocol, &gNVIDIABrBctUpdateProtocolGuid)) {
+    *Interface = &mBrBctUpdateProtocol;
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Stub of gBS->CreateEventEx.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubCreateEventEx (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction OPTIONAL,
+  IN  CONST VOID        *NotifyContext OPTIONAL,
+  IN  CONST EFI_GUID    *EventGroup OPTIONAL,
+  OUT EFI_EVENT         *Event
+) {
+  *Event = &mEvent;
+  return EFI_SUCCESS;
+}
+
+/**
+  Stub of gBS->CloseEvent.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubCloseEvent (
+  IN EFI_EVENT  Event
+) {
+  return EFI_SUCCESS;
+}
+
+/**
+  Stub of gBS->SetWatchdogTimer.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubSetWatchdogTimer (
+  IN UINTN   Timeout,
+  IN UINT64  WatchdogCode,
+  IN UINTN   DataSize,
+  IN CHAR16  *WatchdogData OPTIONAL
+) {
+  return EFI_SUCCESS;
+}
+
+/**
+  Stub of the BR-BCT update. Counts the BCT updates and records how many
+  FwImage operations were issued before the BCT was updated.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubUpdateBct (
+  IN  CONST NVIDIA_BR_BCT_UPDATE_PROTOCOL   *This,
+  IN  UINTN                                 Bytes,
+  IN  CONST VOID                            *Buffer
+) {
+  mBctUpdates++;
+  mBctUpdateOperation = FwImageStubGetOperationCount();
+  return EFI_SUCCESS;
+}
+
+/**
+  Stub of the BR-BCT FW chain update.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StubUpdateFwChain (
+  IN  CONST NVIDIA_BR_BCT_UPDATE_PROTOCOL   *This,
+  IN  UINTN                                 NewFwChain
+) {
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the data of an image in the test package.
+
+  @param Name     Name of the image
+  @param Bytes    Returns the size of the image
+
+  @return Image data, or NULL if the image is not in the package.
+**/
+STATIC
+CONST UINT8 *
+PackageImageData (
+  IN  CONST CHAR16  *Name,
+  OUT UINTN         *Bytes
+) {
+  UINTN ImageIndex;
+
+  if (EFI_ERROR (FwPackageGetImageIndex(mPackage, Name, FALSE, &ImageIndex))) {
+    return NULL;
+  }
+
+  *Bytes = FwPackageImageInfoPtr(mPackage, ImageIndex)->Bytes;
+  return FwPackageImageDataPtr(mPackage, ImageIndex);
+}
+
+/**
+  Get the number of operations the last update issued to an image.
+
+  @param Name     Name of the image
+  @param Type     Operation type to count
+
+  @return Number of operations.
+**/
+STATIC
+UINTN
+CountOperations (
+  IN CONST CHAR16                  *Name,
+  IN FW_IMAGE_STUB_OPERATION_TYPE  Type
+) {
+  CONST FW_IMAGE_STUB_OPERATION *Operation;
+  UINTN                         Index;
+  UINTN                         Count;
+
+  Count = 0;
+  for (Index = 0; Index < FwImageStubGetOperationCount(); Index++) {
+    Operation = FwImageStubGetOperation(Index);
+    if ((Operation->Type == Type) && (StrCmp(Operation->ImageName, Name) == 0)) {
+      Count++;
+    }
+  }
+
+  return Count;
+}
+
+/**
+  Find the end of the run of operations issued to one image.
+
+  @param Name     Name of the image
+  @param First    Index of the first operation of the run
+
+  @return Index of the first operation after the run.
+**/
+STATIC
+UINTN
+ImageOperationsEnd (
+  IN CONST CHAR16  *Name,
+  IN UINTN         First
+) {
+  UINTN Index;
+
+  for (Index = First; Index < FwImageStubGetOperationCount(); Index++) {
+    if (StrCmp(FwImageStubGetOperation(Index)->ImageName, Name) != 0) {
+      break;
+    }
+  }
+
+  return Index;
+}
+
+/**
+  Check that an image is written and then read back in full by a run of
+  operations.
+
+  @param Name     Name of the image
+  @param First    Index of the first operation of the run
+  @param End      Index of the first operation after the run
+
+  @retval TRUE    The reads after the last write of the run cover the image.
+  @retval FALSE   The run has no write, or the image was not read back.
+**/
+STATIC
+BOOLEAN
+ImageWrittenAndVerified (
+  IN CONST CHAR16  *Name,
+  IN UINTN         First,
+  IN UINTN         End
+) {
+  UINTN Index;
+  UINTN LastWrite;
+  UINTN Bytes;
+  UINTN BytesRead;
+
+  if (PackageImageData(Name, &Bytes) == NULL) {
+    return FALSE;
+  }
+
+  LastWrite = MAX_UINTN;
+  for (Index = First; Index < End; Index++) {
+    if (FwImageStubGetOperation(Index)->Type == FwImageStubWrite) {
+      LastWrite = Index;
+    }
+  }
+  if (LastWrite == MAX_UINTN) {
+    return FALSE;
+  }
+
+  BytesRead = 0;
+  for (Index = LastWrite + 1; Index < End; Index++) {
+    BytesRead += FwImageStubGetOperation(Index)->Bytes;
+  }
+
+  return (BytesRead >= Bytes);
+}
+
+/**
+  Check and then apply the test package.
+
+  @param LastAttemptStatus  Returns the last attempt status of the update
+
+  @return Status returned by FmpDeviceSetImageWithStatus.
+**/
+STATIC
+EFI_STATUS
+RunUpdate (
+  OUT UINT32  *LastAttemptStatus
+) {
+  EFI_STATUS  Status;
+  UINT32      ImageUpdatable;
+
+  Status = FmpDeviceCheckImageWithStatus(mPackage,
+                                         mPackageSize,
+                                         &ImageUpdatable,
+                                         LastAttemptStatus);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  FwImageStubClearOperations();
+  mBctUpdates = 0;
+
+  return FmpDeviceSetImageWithStatus(mPackage,
+                                     mPackageSize,
+                                     NULL,
+                                     NULL,
+                                     0,
+                                     NULL,
+                                     LastAttemptStatus);
+}
+
+/**
+  Create empty partitions for every test image and reset the progress.
+
+  @param Context            Not used by this function
+
+  @retval UNIT_TEST_PASSED  Setup finished successfully.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FmpTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  DISPLAY_UPDATE_PROGRESS_STUB_STATE  Progress;
+  UINTN                               Index;
+
+  FwImageStubDestroy();
+  for (Index = 0; Index < TEST_IMAGE_COUNT; Index++) {
+    if (EFI_ERROR (FwImageStubAddImage(mTestImages[Index].Name,
+                                       TEST_PARTITION_SIZE,
+                                       mTestImages[Index].BlockSize))) {
+      return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+    }
+  }
+  DisplayUpdateProgressStubGetState(&Progress);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that an update writes every image to the inactive partitions only,
+  reads images back in chunks of at most READBACK_CHUNK_SIZE and reports
+  progress up to 100%.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+UpdateTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  DISPLAY_UPDATE_PROGRESS_STUB_STATE  Progress;
+  CONST FW_IMAGE_STUB_OPERATION       *Operation;
+  CONST UINT8                         *Data;
+  UINTN                               Bytes;
+  UINTN                               Index;
+  UINT32                              LastAttemptStatus;
+
+  UT_ASSERT_NOT_EFI_ERROR(RunUpdate(&LastAttemptStatus));
+  UT_ASSERT_EQUAL(LastAttemptStatus, LAST_ATTEMPT_STATUS_SUCCESS);
+  UT_ASSERT_EQUAL(mBctUpdates, 1);
+
+  for (Index = 1; Index < TEST_IMAGE_COUNT; Index++) {
+    Data = PackageImageData(mTestImages[Index].Name, &Bytes);
+    UT_ASSERT_NOT_NULL(Data);
+    UT_ASSERT_MEM_EQUAL(FwImageStubGetPartitionData(mTestImages[Index].Name, BOOT_CHAIN_B),
+                        Data,
+                        Bytes);
+    UT_ASSERT_TRUE(IsZeroBuffer(FwImageStubGetPartitionData(mTestImages[Index].Name, BOOT_CHAIN_A),
+                                TEST_PARTITION_SIZE));
+  }
+
+  for (Index = 0; Index < FwImageStubGetOperationCount(); Index++) {
+    Operation = FwImageStubGetOperation(Index);
+    UT_ASSERT_EQUAL(Operation->BootChain, BOOT_CHAIN_B);
+    if (Operation->Type == FwImageStubRead) {
+      UT_ASSERT_TRUE(Operation->Bytes <= READBACK_CHUNK_SIZE);
+    }
+  }
+
+  DisplayUpdateProgressStubGetState(&Progress);
+  UT_ASSERT_EQUAL(Progress.Completion, 100);
+  UT_ASSERT_FALSE(Progress.WentBackwards);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that repeating an update writes no regular image and reads each one
+  back only once, while the images are still checked against the package.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+UnchangedImageTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST CHAR16  *Name;
+  UINTN         Bytes;
+  UINTN         Index;
+  UINT32        LastAttemptStatus;
+
+  UT_ASSERT_NOT_EFI_ERROR(RunUpdate(&LastAttemptStatus));
+  UT_ASSERT_NOT_EFI_ERROR(RunUpdate(&LastAttemptStatus));
+  UT_ASSERT_EQUAL(LastAttemptStatus, LAST_ATTEMPT_STATUS_SUCCESS);
+
+  // mb1 is invalidated by every update so it is always rewritten
+  for (Index = 2; Index < TEST_IMAGE_COUNT; Index++) {
+    Name = mTestImages[Index].Name;
+    UT_ASSERT_NOT_NULL(PackageImageData(Name, &Bytes));
+    UT_ASSERT_EQUAL(CountOperations(Name, FwImageStubWrite), 0);
+    UT_ASSERT_EQUAL(CountOperations(Name, FwImageStubRead),
+                    (Bytes + READBACK_CHUNK_SIZE - 1) / READBACK_CHUNK_SIZE);
+  }
+  UT_ASSERT_NOT_EQUAL(CountOperations(L"mb1", FwImageStubWrite), 0);
+
+  // A changed image is written and read back again
+  FwImageStubGetPartitionData(L"bpmp-fw", BOOT_CHAIN_B)[READBACK_CHUNK_SIZE] ^= 1;
+  UT_ASSERT_NOT_EFI_ERROR(RunUpdate(&LastAttemptStatus));
+  UT_ASSERT_EQUAL(CountOperations(L"bpmp-fw", FwImageStubWrite), 1);
+  UT_ASSERT_EQUAL(CountOperations(L"bpmp-fw", FwImageStubRead), 6);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a byte corrupted while it was written fails the update, for
+  bytes on either side of each readback chunk boundary and at the ends of
+  images.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ChunkBoundaryCorruptionTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST TEST_CORRUPTION *Corruption;
+  UINTN                 Index;
+  UINT32                LastAttemptStatus;
+
+  for (Index = 0; Index < TEST_CORRUPTION_COUNT; Index++) {
+    Corruption = &mTestCorruptions[Index];
+    UT_ASSERT_EQUAL(FmpTestSetup(NULL), UNIT_TEST_PASSED);
+    FwImageStubSetWriteCorruption(Corruption->Name, Corruption->Offset);
+
+    UT_ASSERT_STATUS_EQUAL(RunUpdate(&LastAttemptStatus), EFI_ABORTED);
+    UT_ASSERT_EQUAL(LastAttemptStatus, LAS_ERROR_VERIFY_IMAGES_FAILED);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that the BCT is updated first, mb1 is invalidated before and written
+  last after the other images, and each regular image is written and then
+  verified before the next image in FwImage order is touched.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+OrderTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST FW_IMAGE_STUB_OPERATION *Operation;
+  CONST CHAR16                  *Name;
+  UINTN                         First;
+  UINTN                         End;
+  UINTN                         Index;
+  UINT32                        LastAttemptStatus;
+
+  UT_ASSERT_NOT_EFI_ERROR(RunUpdate(&LastAttemptStatus));
+  UT_ASSERT_EQUAL(LastAttemptStatus, LAST_ATTEMPT_STATUS_SUCCESS);
+  UT_ASSERT_EQUAL(mBctUpdates, 1);
+  UT_ASSERT_EQUAL(mBctUpdateOperation, 0);
+
+  // mb1 is invalidated before any other image is touched
+  End = ImageOperationsEnd(L"mb1", 0);
+  UT_ASSERT_NOT_EQUAL(End, 0);
+  Operation = FwImageStubGetOperation(End - 1);
+  UT_ASSERT_EQUAL(Operation->Type, FwImageStubWrite);
+  UT_ASSERT_EQUAL(Operation->Offset, 0);
+  UT_ASSERT_EQUAL(Operation->Bytes, MB1_INVALIDATE_SIZE);
+
+  // Regular images are done one at a time in FwImage order
+  for (Index = 2; Index < TEST_IMAGE_COUNT; Index++) {
+    Name = mTestImages[Index].Name;
+    First = End;
+    End = ImageOperationsEnd(Name, First);
+    UT_ASSERT_TRUE(ImageWrittenAndVerified(Name, First, End));
+  }
+
+  // mb1 is written last, and nothing is done after it
+  First = End;
+  End = ImageOperationsEnd(L"mb1", First);
+  UT_ASSERT_TRUE(ImageWrittenAndVerified(L"mb1", First, End));
+  UT_ASSERT_EQUAL(End, FwImageStubGetOperationCount());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a failed write or verify stops the update at the failing
+  image with the matching last attempt status, leaves the active boot
+  chain untouched and leaves mb1 invalidated when a regular image fails.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+InjectedFailureTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  CONST TEST_FAILURE            *Failure;
+  CONST FW_IMAGE_STUB_OPERATION *Operation;
+  CONST UINT8                   *Mb1;
+  UINTN                         Index;
+  UINTN                         ImageIndex;
+  UINTN                         Byte;
+  UINT32                        LastAttemptStatus;
+
+  for (Index = 0; Index < TEST_FAILURE_COUNT; Index++) {
+    Failure = &mTestFailures[Index];
+    UT_ASSERT_EQUAL(FmpTestSetup(NULL), UNIT_TEST_PASSED);
+    if (Failure->Corrupt) {
+      FwImageStubSetWriteCorruption(Failure->Name, Failure->Offset);
+    } else {
+      FwImageStubSetWriteFailure(Failure->Name, Failure->Offset, EFI_DEVICE_ERROR);
+    }
+
+    UT_ASSERT_STATUS_EQUAL(RunUpdate(&LastAttemptStatus), EFI_ABORTED);
+    UT_ASSERT_EQUAL(LastAttemptStatus, Failure->LastAttemptStatus);
+
+    // The failing write or the read back of the corrupted chunk is the last
+    // operation of the update
+    Operation = FwImageStubGetOperation(FwImageStubGetOperationCount() - 1);
+    UT_ASSERT_NOT_NULL(Operation);
+    UT_ASSERT_EQUAL(StrCmp(Operation->ImageName, Failure->Name), 0);
+    UT_ASSERT_EQUAL(Operation->Type,
+                    Failure->Corrupt ? FwImageStubRead : FwImageStubWrite);
+    UT_ASSERT_TRUE(Failure->Offset >= Operation->Offset);
+    UT_ASSERT_TRUE(Failure->Offset - Operation->Offset < Operation->Bytes);
+
+    for (ImageIndex = 0; ImageIndex < TEST_IMAGE_COUNT; ImageIndex++) {
+      UT_ASSERT_TRUE(IsZeroBuffer(FwImageStubGetPartitionData(mTestImages[ImageIndex].Name,
+                                                              BOOT_CHAIN_A),
+                                  TEST_PARTITION_SIZE));
+    }
+
+    if (StrCmp(Failure->Name, L"mb1") != 0) {
+      Mb1 = FwImageStubGetPartitionData(L"mb1", BOOT_CHAIN_B);
+      for (Byte = 0; Byte < MB1_INVALIDATE_SIZE; Byte++) {
+        UT_ASSERT_EQUAL(Mb1[Byte], 0xFF);
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the test package and the FmpDeviceLib.
+
+  @retval EFI_SUCCESS           Initialization succeeded.
+  @retval EFI_OUT_OF_RESOURCES  An allocation failed.
+**/
+STATIC
+EFI_STATUS
+InitTestData (
+  VOID
+) {
+  FW_PACKAGE_IMAGE_INFO *ImageInfo;
+  UINT8                 *Data;
+  UINTN                 Offset;
+  UINTN                 Index;
+  UINTN                 Byte;
+
+  mPackageSize = sizeof (FW_PACKAGE_HEADER) +
+                 (TEST_IMAGE_COUNT * sizeof (FW_PACKAGE_IMAGE_INFO));
+  for (Index = 0; Index < TEST_IMAGE_COUNT; Index++) {
+    mPackageSize += mTestImages[Index].Bytes;
+  }
+
+  mPackage = AllocateZeroPool(mPackageSize);
+  if (mPackage == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyMem(mPackage->Magic, FW_PACKAGE_MAGIC, FW_PACKAGE_MAGIC_SIZE);
+  mPackage->PackageSize = mPackageSize;
+  mPackage->HeaderSize = sizeof (FW_PACKAGE_HEADER);
+  mPackage->ImageCount = TEST_IMAGE_COUNT;
+  mPackage->Type = FW_PACKAGE_TYPE_FW;
+
+  ImageInfo = (FW_PACKAGE_IMAGE_INFO *)(mPackage + 1);
+  Offset = sizeof (FW_PACKAGE_HEADER) +
+           (TEST_IMAGE_COUNT * sizeof (FW_PACKAGE_IMAGE_INFO));
+  for (Index = 0; Index < TEST_IMAGE_COUNT; Index++, ImageInfo++) {
+    UnicodeStrToAsciiStrS(mTestImages[Index].Name,
+                          ImageInfo->Name,
+                          FW_PACKAGE_NAME_LENGTH);
+    ImageInfo->Offset = Offset;
+    ImageInfo->Bytes = mTestImages[Index].Bytes;
+    ImageInfo->UpdateMode = FW_PACKAGE_UPDATE_MODE_ALWAYS;
+
+    Data = (UINT8 *)mPackage + Offset;
+    for (Byte = 0; Byte < mTestImages[Index].Bytes; Byte++) {
+      Data[Byte] = (UINT8)((Byte * 7) + (Byte >> 8) + (Index * 0x35) + 1);
+    }
+    Offset += mTestImages[Index].Bytes;
+  }
+
+  mBrBctUpdateProtocol.UpdateBct = StubUpdateBct;
+  mBrBctUpdateProtocol.UpdateFwChain = StubUpdateFwChain;
+
+  mBootServices.LocateProtocol = StubLocateProtocol;
+  mBootServices.CreateEventEx = StubCreateEventEx;
+  mBootServices.CloseEvent = StubCloseEvent;
+  mBootServices.SetWatchdogTimer = StubSetWatchdogTimer;
+  gBS = &mBootServices;
+
+  return FmpDeviceLibConstructor(NULL, NULL);
+}
+
+/**
+  Clean up the test package and the FwImage stub.
+**/
+STATIC
+VOID
+CleanUpTestData (
+  VOID
+) {
+  FwImageStubDestroy();
+
+  if (mPackage != NULL) {
+    FreePool(mPackage);
+    mPackage = NULL;
+  }
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  FmpDeviceLib and run the FmpDeviceLib unit test.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+) {
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      UpdateTestSuite;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitTestData();
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed to initialize test data. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Start setting up the test framework for running the tests.
+  Status = InitUnitTestFramework(
+    &Fw,
+    UNIT_TEST_APP_NAME,
+    gEfiCallerBaseName,
+    UNIT_TEST_APP_VERSION
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in InitUnitTestFramework. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Populate the FMP Update Unit Test Suite.
+  Status = CreateUnitTestSuite(
+    &UpdateTestSuite,
+    Fw,
+    "FMP Update Tests",
+    "FmpDeviceLib.UpdateTestSuite",
+    NULL,
+    NULL
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in CreateUnitTestSuite for UpdateTestSuite\n")
+    );
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // AddTestCase Args:
+  //  Suite | Description
+  //  Class Name | Function
+  //  Pre | Post | Context
+  AddTestCase(UpdateTestSuite, "Update Test",
+              "UpdateTest", UpdateTest,
+              FmpTestSetup, NULL, NULL);
+  AddTestCase(UpdateTestSuite, "Unchanged Image Test",
+              "UnchangedImageTest", UnchangedImageTest,
+              FmpTestSetup, NULL, NULL);
+  AddTestCase(UpdateTestSuite, "Chunk Boundary Corruption Test",
+              "ChunkBoundaryCorruptionTest", ChunkBoundaryCorruptionTest,
+              FmpTestSetup, NULL, NULL);
+  AddTestCase(UpdateTestSuite, "Order Test",
+              "OrderTest", OrderTest,
+              FmpTestSetup, NULL, NULL);
+  AddTestCase(UpdateTestSuite, "Injected Failure Test",
+              "InjectedFailureTest", InjectedFailureTest,
+              FmpTestSetup, NULL, NULL);
+
+  // Execute the tests.
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  CleanUpTestData();
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based
+  unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+BaseLibUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+) {
+  return UnitTestingEntry();
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+) {
+  return UnitTestingEntry ();
+}
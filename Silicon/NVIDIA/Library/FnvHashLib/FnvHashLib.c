@@ -0,0 +1,44 @@
+/** @file
+
+  FnvHashLib provides FNV-1a hashing of strings for hash indexes
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/FnvHashLib.h>
+#include <Library/DebugLib.h>
+
+#define FNV_32_OFFSET_BASIS 2166136261U
+#define FNV_32_PRIME        16777619U
+
+/**
+  Calculates the 32-bit FNV-1a hash of a Null-terminated ASCII string.
+
+  The hash is not cryptographic, it is meant for hash indexes of path names,
+  compatible strings and the like.
+
+  @param[in]  String               A pointer to a Null-terminated ASCII string.
+
+  @return the 32-bit FNV-1a hash of the string.
+**/
+UINT32
+EFIAPI
+CalculateFnv1aHash32 (
+  IN CONST CHAR8  *String
+)
+{
+  UINT32 Hash;
+
+  ASSERT (String != NULL);
+
+  Hash = FNV_32_OFFSET_BASIS;
+  while (*String != '\0') {
+    Hash ^= (UINT8)*String++;
+    Hash *= FNV_32_PRIME;
+  }
+
+  return Hash;
+}
@@ -0,0 +1,109 @@
+/** @file
+
+Stub implementation of BootChainInfoLib for host based tests.
+
+Partition names use the T234 "A_" and "B_" boot chain prefixes.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BootChainInfoLib.h>
+#include <Library/PlatformResourceLib.h>
+
+#define BOOT_CHAIN_STUB_COUNT         2
+#define BOOT_CHAIN_STUB_PREFIX_LENGTH 2
+
+STATIC CONST CHAR16 *mBootChainPrefix[BOOT_CHAIN_STUB_COUNT] = {
+  L"A_",
+  L"B_",
+};
+
+/**
+  Retrieve Active Boot Chain Partition Name
+
+**/
+EFI_STATUS
+EFIAPI
+GetActivePartitionName (
+  IN  CONST CHAR16 *GeneralPartitionName,
+  OUT CHAR16       *ActivePartitionName
+) {
+  EFI_STATUS Status;
+  UINT32     BootChain;
+
+  Status = GetActiveBootChain (&BootChain);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return GetBootChainPartitionName (GeneralPartitionName,
+                                    BootChain,
+                                    ActivePartitionName);
+}
+
+/**
+  Get boot chain partition name from base partition name and boot chain index.
+
+**/
+EFI_STATUS
+EFIAPI
+GetBootChainPartitionName (
+  IN  CONST CHAR16      *BasePartitionName,
+  IN  UINTN             BootChain,
+  OUT CHAR16            *BootChainPartitionName
+) {
+  EFI_STATUS Status;
+
+  if ((BasePartitionName == NULL) || (BootChainPartitionName == NULL) ||
+      (BootChain >= BOOT_CHAIN_STUB_COUNT)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = StrCpyS (BootChainPartitionName,
+                    MAX_PARTITION_NAME_LEN,
+                    mBootChainPrefix[BootChain]);
+  if (!EFI_ERROR (Status)) {
+    Status = StrCatS (BootChainPartitionName,
+                      MAX_PARTITION_NAME_LEN,
+                      BasePartitionName);
+  }
+
+  return Status;
+}
+
+/**
+  Get base name and boot chain index from partition name
+
+**/
+EFI_STATUS
+EFIAPI
+GetPartitionBaseNameAndBootChain (
+  IN  CONST CHAR16      *PartitionName,
+  OUT CHAR16            *BaseName,
+  OUT UINTN             *BootChain
+) {
+  UINTN Index;
+
+  if ((PartitionName == NULL) || (BaseName == NULL) || (BootChain == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Index = 0; Index < BOOT_CHAIN_STUB_COUNT; Index++) {
+    if (StrnCmp (PartitionName,
+                 mBootChainPrefix[Index],
+                 BOOT_CHAIN_STUB_PREFIX_LENGTH) == 0) {
+      *BootChain = Index;
+      return StrCpyS (BaseName,
+                      MAX_PARTITION_NAME_LEN,
+                      PartitionName + BOOT_CHAIN_STUB_PREFIX_LENGTH);
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
@@ -0,0 +1,66 @@
+/** @file
+
+Stub implementation of DisplayUpdateProgressLib for host based tests.
+
+Nothing is displayed. The stub records the reported completion so tests can
+check how the progress of an update advanced.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/DisplayUpdateProgressLib.h>
+#include <Library/DisplayUpdateProgressStubLib.h>
+
+STATIC DISPLAY_UPDATE_PROGRESS_STUB_STATE mProgressStub = { 0, 0, FALSE };
+
+/**
+  Indicates the current completion progress of a firmware update.
+
+  @param[in] Completion  A value between 0 and 100 indicating the current
+                         completion progress of a firmware update.
+  @param[in] Color       Color of the progress indicator.  Ignored.
+
+  @retval EFI_SUCCESS            Progress was recorded.
+  @retval EFI_INVALID_PARAMETER  Completion is greater than 100%.
+**/
+EFI_STATUS
+EFIAPI
+DisplayUpdateProgress (
+  IN UINTN                                Completion,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  *Color        OPTIONAL
+) {
+  if (Completion > 100) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((mProgressStub.Updates != 0) && (Completion < mProgressStub.Completion)) {
+    mProgressStub.WentBackwards = TRUE;
+  }
+
+  mProgressStub.Completion = Completion;
+  mProgressStub.Updates++;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get and reset the progress recorded by the stub.
+
+  @param  State                 Progress reported since the last call.
+**/
+VOID
+EFIAPI
+DisplayUpdateProgressStubGetState (
+  OUT DISPLAY_UPDATE_PROGRESS_STUB_STATE  *State
+) {
+  *State = mProgressStub;
+
+  mProgressStub.Updates       = 0;
+  mProgressStub.Completion    = 0;
+  mProgressStub.WentBackwards = FALSE;
+}
@@ -0,0 +1,35 @@
+/** @file
+
+Stub implementation of DtPlatformDtbLoaderLib for host based tests.
+
+There is no platform DTB on the host, so tests provide their device tree
+with SetDeviceTreePointer() and loading one always fails.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/DtPlatformDtbLoaderLib.h>
+
+/**
+  Return a pool allocated copy of the DTB image that is appropriate for
+  booting the current platform via DT.
+
+  @param[out]   Dtb                   Pointer to the DTB copy
+  @param[out]   DtbSize               Size of the DTB copy
+
+  @retval       EFI_NOT_FOUND         No DTB is available on the host
+
+**/
+EFI_STATUS
+EFIAPI
+DtPlatformLoadDtb (
+  OUT   VOID  **Dtb,
+  OUT   UINTN *DtbSize
+) {
+  return EFI_NOT_FOUND;
+}
@@ -0,0 +1,277 @@
+/** @file
+
+Stub implementation of DxeServicesTableLib for host based tests.
+
+Only the GCD memory space descriptor services are provided.  The memory
+space map is a sorted array of ranges that covers the whole address space.
+Setting attributes splits the ranges at the ends of the affected range, and
+adjacent ranges that end up the same are merged again.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DxeServicesTableLib.h>
+#include <Library/DxeServicesTableStubLib.h>
+
+#define DXE_SERVICES_TABLE_STUB_CAPABILITIES \
+  (EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB)
+
+EFI_DXE_SERVICES  *gDS = NULL;
+
+STATIC EFI_DXE_SERVICES                 mDxeServices;
+STATIC EFI_GCD_MEMORY_SPACE_DESCRIPTOR  mRanges[DXE_SERVICES_TABLE_STUB_MAX_RANGES];
+STATIC UINTN                            mRangeCount = 0;
+STATIC UINTN                            mGetDescriptorCalls = 0;
+STATIC UINTN                            mSetAttributesCalls = 0;
+
+/**
+  Find the range that contains an address.
+
+  @param  Address       Address to look up.
+
+  @return Index of the range, or mRangeCount if no range contains Address.
+**/
+STATIC
+UINTN
+DxeServicesTableStubFindRange (
+  IN EFI_PHYSICAL_ADDRESS  Address
+) {
+  UINTN Index;
+
+  for (Index = 0; Index < mRangeCount; Index++) {
+    if ((Address >= mRanges[Index].BaseAddress) &&
+        (Address - mRanges[Index].BaseAddress < mRanges[Index].Length)) {
+      break;
+    }
+  }
+
+  return Index;
+}
+
+/**
+  Split the range that contains an address, so that a range starts at it.
+
+  @param  Address       Address to split at.
+
+  @retval EFI_SUCCESS           A range starts at Address, or no range
+                                contains it.
+  @retval EFI_OUT_OF_RESOURCES  The map is full.
+**/
+STATIC
+EFI_STATUS
+DxeServicesTableStubSplitRange (
+  IN EFI_PHYSICAL_ADDRESS  Address
+) {
+  UINTN Index;
+
+  Index = DxeServicesTableStubFindRange(Address);
+  if ((Index == mRangeCount) || (mRanges[Index].BaseAddress == Address)) {
+    return EFI_SUCCESS;
+  }
+
+  if (mRangeCount == DXE_SERVICES_TABLE_STUB_MAX_RANGES) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyMem(&mRanges[Index + 1], &mRanges[Index], (mRangeCount - Index) * sizeof (mRanges[0]));
+  mRangeCount++;
+
+  mRanges[Index + 1].BaseAddress = Address;
+  mRanges[Index + 1].Length = mRanges[Index].BaseAddress + mRanges[Index].Length - Address;
+  mRanges[Index].Length = Address - mRanges[Index].BaseAddress;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Merge adjacent ranges that have the same type, capabilities and
+  attributes.
+**/
+STATIC
+VOID
+DxeServicesTableStubMergeRanges (
+  VOID
+) {
+  UINTN Index;
+
+  Index = 1;
+  while (Index < mRangeCount) {
+    if ((mRanges[Index].GcdMemoryType == mRanges[Index - 1].GcdMemoryType) &&
+        (mRanges[Index].Capabilities == mRanges[Index - 1].Capabilities) &&
+        (mRanges[Index].Attributes == mRanges[Index - 1].Attributes)) {
+      mRanges[Index - 1].Length += mRanges[Index].Length;
+      CopyMem(&mRanges[Index], &mRanges[Index + 1], (mRangeCount - Index - 1) * sizeof (mRanges[0]));
+      mRangeCount--;
+    } else {
+      Index++;
+    }
+  }
+}
+
+/**
+  Stub of gDS->GetMemorySpaceDescriptor.
+
+  @param  BaseAddress   Address to look up.
+  @param  Descriptor    Descriptor of the range that contains BaseAddress.
+
+  @retval EFI_SUCCESS           The descriptor was returned.
+  @retval EFI_INVALID_PARAMETER Descriptor is NULL.
+  @retval EFI_NOT_FOUND         No range contains BaseAddress.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+DxeServicesTableStubGetMemorySpaceDescriptor (
+  IN  EFI_PHYSICAL_ADDRESS             BaseAddress,
+  OUT EFI_GCD_MEMORY_SPACE_DESCRIPTOR  *Descriptor
+) {
+  UINTN Index;
+
+  mGetDescriptorCalls++;
+
+  if (Descriptor == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Index = DxeServicesTableStubFindRange(BaseAddress);
+  if (Index == mRangeCount) {
+    return EFI_NOT_FOUND;
+  }
+
+  CopyMem(Descriptor, &mRanges[Index], sizeof (*Descriptor));
+  return EFI_SUCCESS;
+}
+
+/**
+  Stub of gDS->SetMemorySpaceAttributes.
+
+  @param  BaseAddress   Start of the range.
+  @param  Length        Length of the range.
+  @param  Attributes    New attributes of the range.
+
+  @retval EFI_SUCCESS           The attributes were set.
+  @retval EFI_INVALID_PARAMETER Length is 0 or the range wraps around.
+  @retval EFI_NOT_FOUND         Part of the range is not in the map.
+  @retval EFI_UNSUPPORTED       Part of the range lacks the capabilities for
+                                Attributes.
+  @retval EFI_OUT_OF_RESOURCES  The map is full.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+DxeServicesTableStubSetMemorySpaceAttributes (
+  IN EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN UINT64                Length,
+  IN UINT64                Attributes
+) {
+  EFI_PHYSICAL_ADDRESS  Last;
+  UINTN                 First;
+  UINTN                 Index;
+  EFI_STATUS            Status;
+
+  mSetAttributesCalls++;
+
+  if ((Length == 0) || (BaseAddress + Length - 1 < BaseAddress)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Last = BaseAddress + Length - 1;
+
+  First = DxeServicesTableStubFindRange(BaseAddress);
+  if ((First == mRangeCount) || (DxeServicesTableStubFindRange(Last) == mRangeCount)) {
+    return EFI_NOT_FOUND;
+  }
+
+  for (Index = First; (Index < mRangeCount) && (mRanges[Index].BaseAddress <= Last); Index++) {
+    if ((mRanges[Index].Capabilities & Attributes) != Attributes) {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  Status = DxeServicesTableStubSplitRange(BaseAddress);
+  if (!EFI_ERROR (Status) && (Last != MAX_UINT64)) {
+    Status = DxeServicesTableStubSplitRange(Last + 1);
+  }
+  if (EFI_ERROR (Status)) {
+    DxeServicesTableStubMergeRanges();
+    return Status;
+  }
+
+  for (Index = DxeServicesTableStubFindRange(BaseAddress);
+       (Index < mRangeCount) && (mRanges[Index].BaseAddress <= Last);
+       Index++) {
+    mRanges[Index].Attributes = Attributes;
+  }
+
+  DxeServicesTableStubMergeRanges();
+  return EFI_SUCCESS;
+}
+
+/**
+  Point gDS at the stub, reset the memory space map to a single range of
+  system memory and clear the call counts.  Must be called before gDS is
+  used.
+**/
+VOID
+EFIAPI
+DxeServicesTableStubReset (
+  VOID
+) {
+  ZeroMem(&mDxeServices, sizeof (mDxeServices));
+  mDxeServices.GetMemorySpaceDescriptor = DxeServicesTableStubGetMemorySpaceDescriptor;
+  mDxeServices.SetMemorySpaceAttributes = DxeServicesTableStubSetMemorySpaceAttributes;
+  gDS = &mDxeServices;
+
+  ZeroMem(mRanges, sizeof (mRanges));
+  mRanges[0].BaseAddress = 0;
+  mRanges[0].Length = MAX_UINT64;
+  mRanges[0].Capabilities = DXE_SERVICES_TABLE_STUB_CAPABILITIES;
+  mRanges[0].Attributes = EFI_MEMORY_WB;
+  mRanges[0].GcdMemoryType = EfiGcdMemoryTypeSystemMemory;
+  mRangeCount = 1;
+
+  mGetDescriptorCalls = 0;
+  mSetAttributesCalls = 0;
+}
+
+/**
+  Get the number of ranges in the memory space map.  Adjacent ranges with
+  the same capabilities and attributes are merged, so a map that had all of
+  its attribute changes undone has a single range.
+
+  @return Number of ranges.
+**/
+UINTN
+EFIAPI
+DxeServicesTableStubGetRangeCount (
+  VOID
+) {
+  return mRangeCount;
+}
+
+/**
+  Get the number of gDS calls made since the stub was last reset.
+
+  @param  GetDescriptorCalls    Number of GetMemorySpaceDescriptor() calls.
+  @param  SetAttributesCalls    Number of SetMemorySpaceAttributes() calls.
+**/
+VOID
+EFIAPI
+DxeServicesTableStubGetCallCounts (
+  OUT UINTN  *GetDescriptorCalls  OPTIONAL,
+  OUT UINTN  *SetAttributesCalls  OPTIONAL
+) {
+  if (GetDescriptorCalls != NULL) {
+    *GetDescriptorCalls = mGetDescriptorCalls;
+  }
+  if (SetAttributesCalls != NULL) {
+    *SetAttributesCalls = mSetAttributesCalls;
+  }
+}
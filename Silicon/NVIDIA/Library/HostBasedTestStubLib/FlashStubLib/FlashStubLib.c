@@ -101,6 +101,7 @@ ReadBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  PrivateData->IoCounts.Reads++;
   CopyMem(
     Buffer,
     (VOID *)(UINTN)(PrivateData->StartingAddr
@@ -176,6 +177,7 @@ WriteBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  PrivateData->IoCounts.Writes++;
   CopyMem(
     (VOID *)(UINTN)(PrivateData->StartingAddr
                       + MultU64x32 (Lba, PrivateData->Media.BlockSize)),
@@ -314,3 +316,31 @@ FlashStubDestroy (
 
   return EFI_SUCCESS;
 }
+
+/**
+  Get and reset the number of device operations issued to the flash stub.
+
+  @param  BlockIo               BlockIo protocol of the flash stub.
+  @param  IoCounts              Operations issued since the last call.
+
+  @retval EFI_SUCCESS           IoCounts was filled in.
+  @retval EFI_INVALID_PARAMETER BlockIo or IoCounts was NULL
+**/
+EFI_STATUS
+EFIAPI
+FlashStubGetIoCounts (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  OUT FLASH_STUB_IO_COUNTS   *IoCounts
+) {
+  FLASH_TEST_PRIVATE *FlashTestPrivate;
+
+  if (BlockIo == NULL || IoCounts == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  FlashTestPrivate = FLASH_TEST_PRIVATE_FROM_BLOCK_IO(BlockIo);
+  CopyMem(IoCounts, &FlashTestPrivate->IoCounts, sizeof(FLASH_STUB_IO_COUNTS));
+  ZeroMem(&FlashTestPrivate->IoCounts, sizeof(FLASH_STUB_IO_COUNTS));
+
+  return EFI_SUCCESS;
+}
@@ -14,6 +14,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Uefi.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/NorFlash.h>
+#include <Library/FlashStubLib.h>
 
 typedef struct {
   UINT32                  Signature;
@@ -21,6 +23,7 @@ typedef struct {
   EFI_BLOCK_IO_MEDIA      Media;
   UINT64                  StartingAddr;
   UINT64                  Size;
+  FLASH_STUB_IO_COUNTS    IoCounts;
 } FLASH_TEST_PRIVATE;
 
 #define DATA_BUFFER_BLOCK_NUM   (64)
@@ -29,4 +32,16 @@ typedef struct {
 
 #define FLASH_TEST_PRIVATE_FROM_BLOCK_IO(a)   CR (a, FLASH_TEST_PRIVATE, BlockIo, FLASH_TEST_PRIVATE_SIGNATURE)
 
+typedef struct {
+  UINT32                      Signature;
+  NVIDIA_NOR_FLASH_PROTOCOL   NorFlash;
+  NOR_FLASH_ATTRIBUTES        Attributes;
+  UINT8                       *Storage;
+  FLASH_STUB_IO_COUNTS        IoCounts;
+} NOR_FLASH_TEST_PRIVATE;
+
+#define NOR_FLASH_TEST_PRIVATE_SIGNATURE    SIGNATURE_32 ('N', 'F', 'S', 'T')
+
+#define NOR_FLASH_TEST_PRIVATE_FROM_NOR_FLASH(a)   CR (a, NOR_FLASH_TEST_PRIVATE, NorFlash, NOR_FLASH_TEST_PRIVATE_SIGNATURE)
+
 #endif
@@ -0,0 +1,270 @@
+/** @file
+
+Stub implementation of a NOR flash device.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Protocol/NorFlash.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/FlashStubLib.h>
+
+#include "FlashStubLibPrivate.h"
+
+/**
+  Get NOR Flash Attributes.
+
+  @param[in]  This                  Instance to protocol
+  @param[out] Attributes            Pointer to flash attributes
+
+  @retval EFI_SUCCESS               Operation successful.
+  @retval EFI_INVALID_PARAMETER     Attributes was NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubGetAttributes (
+  IN  NVIDIA_NOR_FLASH_PROTOCOL *This,
+  OUT NOR_FLASH_ATTRIBUTES      *Attributes
+) {
+  NOR_FLASH_TEST_PRIVATE  *PrivateData;
+
+  if (Attributes == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  PrivateData = NOR_FLASH_TEST_PRIVATE_FROM_NOR_FLASH (This);
+  CopyMem (Attributes, &PrivateData->Attributes, sizeof (NOR_FLASH_ATTRIBUTES));
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Read data from NOR Flash.
+
+  @param[in] This                  Instance to protocol
+  @param[in] Offset                Offset to read from
+  @param[in] Size                  Number of bytes to be read
+  @param[in] Buffer                Address to read data into
+
+  @retval EFI_SUCCESS              Operation successful.
+  @retval EFI_INVALID_PARAMETER    The range is outside of the device or
+                                   Buffer was NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubRead (
+  IN NVIDIA_NOR_FLASH_PROTOCOL *This,
+  IN UINT32                    Offset,
+  IN UINT32                    Size,
+  IN VOID                      *Buffer
+) {
+  NOR_FLASH_TEST_PRIVATE  *PrivateData;
+
+  PrivateData = NOR_FLASH_TEST_PRIVATE_FROM_NOR_FLASH (This);
+
+  if ((Buffer == NULL) ||
+      (((UINT64)Offset + Size) > PrivateData->Attributes.MemoryDensity)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  PrivateData->IoCounts.Reads++;
+  CopyMem (Buffer, PrivateData->Storage + Offset, Size);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write data to NOR Flash. Like a real device only bits that are set can be
+  cleared.
+
+  @param[in] This                  Instance to protocol
+  @param[in] Offset                Offset to write to
+  @param[in] Size                  Number of bytes to write
+  @param[in] Buffer                Address to write data from
+
+  @retval EFI_SUCCESS              Operation successful.
+  @retval EFI_INVALID_PARAMETER    The range is outside of the device or
+                                   Buffer was NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubWrite (
+  IN NVIDIA_NOR_FLASH_PROTOCOL *This,
+  IN UINT32                    Offset,
+  IN UINT32                    Size,
+  IN VOID                      *Buffer
+) {
+  NOR_FLASH_TEST_PRIVATE  *PrivateData;
+  UINT32                  Index;
+
+  PrivateData = NOR_FLASH_TEST_PRIVATE_FROM_NOR_FLASH (This);
+
+  if ((Buffer == NULL) ||
+      (((UINT64)Offset + Size) > PrivateData->Attributes.MemoryDensity)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  PrivateData->IoCounts.Writes++;
+  for (Index = 0; Index < Size; Index++) {
+    PrivateData->Storage[Offset + Index] &= ((UINT8 *)Buffer)[Index];
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Erase data from NOR Flash.
+
+  @param[in] This                  Instance to protocol
+  @param[in] Lba                   Logical block to start erasing from
+  @param[in] NumLba                Number of block to be erased
+
+  @retval EFI_SUCCESS              Operation successful.
+  @retval EFI_INVALID_PARAMETER    The blocks are outside of the device.
+
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubErase (
+  IN NVIDIA_NOR_FLASH_PROTOCOL *This,
+  IN UINT32                    Lba,
+  IN UINT32                    NumLba
+) {
+  NOR_FLASH_TEST_PRIVATE  *PrivateData;
+  UINT32                  BlockSize;
+
+  PrivateData = NOR_FLASH_TEST_PRIVATE_FROM_NOR_FLASH (This);
+  BlockSize = PrivateData->Attributes.BlockSize;
+
+  if (MultU64x32 ((UINT64)Lba + NumLba, BlockSize) >
+      PrivateData->Attributes.MemoryDensity) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  PrivateData->IoCounts.Erases++;
+  SetMem (
+    PrivateData->Storage + MultU64x32 (Lba, BlockSize),
+    MultU64x32 (NumLba, BlockSize),
+    0xFF
+  );
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Initialize the NOR Flash Stub.
+
+  Writes only clear bits, like a real NOR device, and erases set every
+  byte of the erased blocks to 0xFF.
+
+  @param  Buffer                Pointer to the starting address for the flash
+                                stub's memory.
+  @param  BufferSize            BufferSize of the flash stub.
+  @param  BlockSize             Erase block size of the flash stub.
+  @param  NorFlash              Pointer to the initialized NorFlash interface
+                                returned back to the user.
+
+  @retval EFI_SUCCESS           Initialization succeeded.
+  @retval EFI_OUT_OF_RESOURCES  Internal memory allocation failed.
+  @retval EFI_BAD_BUFFER_SIZE   BufferSize or BlockSize was 0,
+                                or if BufferSize was not a multiple of BlockSize
+  @retval EFI_INVALID_PARAMETER Buffer or NorFlash was NULL
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubInitialize (
+  IN  VOID                       *Buffer,
+  IN  UINTN                      BufferSize,
+  IN  UINT32                     BlockSize,
+  OUT NVIDIA_NOR_FLASH_PROTOCOL  **NorFlash
+) {
+  NOR_FLASH_TEST_PRIVATE *NorFlashTestPrivate;
+
+  if (Buffer == NULL || NorFlash == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (BufferSize == 0 || BlockSize == 0 || BufferSize % BlockSize != 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  NorFlashTestPrivate = AllocateZeroPool(sizeof(NOR_FLASH_TEST_PRIVATE));
+  if (NorFlashTestPrivate == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NorFlashTestPrivate->Signature = NOR_FLASH_TEST_PRIVATE_SIGNATURE;
+  NorFlashTestPrivate->NorFlash.GetAttributes = NorFlashStubGetAttributes;
+  NorFlashTestPrivate->NorFlash.Read = NorFlashStubRead;
+  NorFlashTestPrivate->NorFlash.Write = NorFlashStubWrite;
+  NorFlashTestPrivate->NorFlash.Erase = NorFlashStubErase;
+  NorFlashTestPrivate->Attributes.MemoryDensity = BufferSize;
+  NorFlashTestPrivate->Attributes.BlockSize = BlockSize;
+  NorFlashTestPrivate->Storage = Buffer;
+
+  *NorFlash = &NorFlashTestPrivate->NorFlash;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Clean up the space used by the NOR flash stub if necessary.
+
+  @param  NorFlash    NorFlash protocol of the flash stub.
+
+  @retval EFI_SUCCESS Clean up was successful.
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubDestroy (
+  IN NVIDIA_NOR_FLASH_PROTOCOL  *NorFlash
+) {
+  NOR_FLASH_TEST_PRIVATE *NorFlashTestPrivate;
+
+  NorFlashTestPrivate = NOR_FLASH_TEST_PRIVATE_FROM_NOR_FLASH(NorFlash);
+
+  if (NorFlashTestPrivate != NULL) {
+    FreePool(NorFlashTestPrivate);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get and reset the number of device operations issued to the NOR flash stub.
+
+  @param  NorFlash              NorFlash protocol of the flash stub.
+  @param  IoCounts              Operations issued since the last call.
+
+  @retval EFI_SUCCESS           IoCounts was filled in.
+  @retval EFI_INVALID_PARAMETER NorFlash or IoCounts was NULL
+**/
+EFI_STATUS
+EFIAPI
+NorFlashStubGetIoCounts (
+  IN  NVIDIA_NOR_FLASH_PROTOCOL  *NorFlash,
+  OUT FLASH_STUB_IO_COUNTS       *IoCounts
+) {
+  NOR_FLASH_TEST_PRIVATE *NorFlashTestPrivate;
+
+  if (NorFlash == NULL || IoCounts == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NorFlashTestPrivate = NOR_FLASH_TEST_PRIVATE_FROM_NOR_FLASH(NorFlash);
+  CopyMem (IoCounts, &NorFlashTestPrivate->IoCounts, sizeof (FLASH_STUB_IO_COUNTS));
+  ZeroMem (&NorFlashTestPrivate->IoCounts, sizeof (FLASH_STUB_IO_COUNTS));
+
+  return EFI_SUCCESS;
+}
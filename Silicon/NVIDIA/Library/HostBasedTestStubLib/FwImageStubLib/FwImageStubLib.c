@@ -0,0 +1,489 @@
+/** @file
+
+Stub implementation of FwImageLib for host based tests.
+
+Each image is backed by an A and a B partition in memory. Read() and Write()
+pick the partition from their flags the same way the FwPartition driver
+does for boot chain A being active.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/FwImageLib.h>
+#include <Library/FwImageStubLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#define FW_IMAGE_STUB_BOOT_CHAINS   2
+
+typedef struct {
+  NVIDIA_FW_IMAGE_PROTOCOL  Protocol;
+  CHAR16                    *Name;
+  UINTN                     Bytes;
+  UINT32                    BlockSize;
+  UINT8                     *Partition[FW_IMAGE_STUB_BOOT_CHAINS];
+  UINTN                     CorruptOffset;
+  UINTN                     FailOffset;
+  EFI_STATUS                FailStatus;
+} FW_IMAGE_STUB;
+
+STATIC FW_IMAGE_STUB            *mImages[FW_IMAGE_STUB_MAX_IMAGES];
+STATIC NVIDIA_FW_IMAGE_PROTOCOL *mProtocols[FW_IMAGE_STUB_MAX_IMAGES];
+STATIC UINTN                    mImageCount = 0;
+
+STATIC FW_IMAGE_STUB_OPERATION  mOperations[FW_IMAGE_STUB_MAX_OPERATIONS];
+STATIC UINTN                    mOperationCount = 0;
+
+/**
+  Find the stub of an image by name.
+
+  @param  Name      Name of the image.
+
+  @return Image stub, or NULL if the image does not exist.
+**/
+STATIC
+FW_IMAGE_STUB *
+FwImageStubFind (
+  IN CONST CHAR16  *Name
+) {
+  UINTN Index;
+
+  for (Index = 0; Index < mImageCount; Index++) {
+    if (StrCmp (mImages[Index]->Name, Name) == 0) {
+      return mImages[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Get the boot chain a Read() or Write() with the given flags accesses.
+
+  @param  Flags     FwImage flags of the operation.
+  @param  Type      Type of the operation.
+
+  @return BOOT_CHAIN_A or BOOT_CHAIN_B.
+**/
+STATIC
+UINTN
+FwImageStubBootChain (
+  IN UINTN                         Flags,
+  IN FW_IMAGE_STUB_OPERATION_TYPE  Type
+) {
+  UINTN InactiveBootChain;
+
+  InactiveBootChain = (FW_IMAGE_STUB_ACTIVE_BOOT_CHAIN == BOOT_CHAIN_A) ?
+                      BOOT_CHAIN_B : BOOT_CHAIN_A;
+
+  if ((Flags & FW_IMAGE_RW_FLAG_FORCE_PARTITION_A) != 0) {
+    return BOOT_CHAIN_A;
+  }
+  if ((Flags & FW_IMAGE_RW_FLAG_FORCE_PARTITION_B) != 0) {
+    return BOOT_CHAIN_B;
+  }
+  if ((Type == FwImageStubWrite) ||
+      ((Flags & FW_IMAGE_RW_FLAG_READ_INACTIVE_IMAGE) != 0)) {
+    return InactiveBootChain;
+  }
+
+  return FW_IMAGE_STUB_ACTIVE_BOOT_CHAIN;
+}
+
+/**
+  Add an operation to the operation log.
+
+  @param  Image     Image stub the operation was issued to.
+  @param  Type      Type of the operation.
+  @param  Offset    Offset of the operation.
+  @param  Bytes     Number of bytes of the operation.
+  @param  Flags     FwImage flags of the operation.
+  @param  BootChain Boot chain accessed by the operation.
+**/
+STATIC
+VOID
+FwImageStubLogOperation (
+  IN FW_IMAGE_STUB                 *Image,
+  IN FW_IMAGE_STUB_OPERATION_TYPE  Type,
+  IN UINT64                        Offset,
+  IN UINTN                         Bytes,
+  IN UINTN                         Flags,
+  IN UINTN                         BootChain
+) {
+  FW_IMAGE_STUB_OPERATION *Operation;
+
+  ASSERT (mOperationCount < FW_IMAGE_STUB_MAX_OPERATIONS);
+  if (mOperationCount >= FW_IMAGE_STUB_MAX_OPERATIONS) {
+    return;
+  }
+
+  Operation            = &mOperations[mOperationCount++];
+  Operation->ImageName = Image->Name;
+  Operation->Type      = Type;
+  Operation->Offset    = Offset;
+  Operation->Bytes     = Bytes;
+  Operation->Flags     = Flags;
+  Operation->BootChain = BootChain;
+}
+
+/**
+  Read data from an image stub.  See NVIDIA_FW_IMAGE_PROTOCOL.Read().
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FwImageStubReadImage (
+  IN  NVIDIA_FW_IMAGE_PROTOCOL  *This,
+  IN  UINT64                    Offset,
+  IN  UINTN                     Bytes,
+  OUT VOID                      *Buffer,
+  IN  UINTN                     Flags
+) {
+  FW_IMAGE_STUB *Image;
+  UINTN         BootChain;
+
+  Image     = BASE_CR (This, FW_IMAGE_STUB, Protocol);
+  BootChain = FwImageStubBootChain (Flags, FwImageStubRead);
+  FwImageStubLogOperation (Image, FwImageStubRead, Offset, Bytes, Flags, BootChain);
+
+  if ((Buffer == NULL) || ((Bytes % Image->BlockSize) != 0) ||
+      (Offset > Image->Bytes) || (Bytes > Image->Bytes - Offset)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem (Buffer, Image->Partition[BootChain] + Offset, Bytes);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write data to an image stub.  See NVIDIA_FW_IMAGE_PROTOCOL.Write().
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FwImageStubWriteImage (
+  IN  NVIDIA_FW_IMAGE_PROTOCOL  *This,
+  IN  UINT64                    Offset,
+  IN  UINTN                     Bytes,
+  IN  CONST VOID                *Buffer,
+  IN  UINTN                     Flags
+) {
+  FW_IMAGE_STUB *Image;
+  UINTN         BootChain;
+  UINT8         *Partition;
+
+  Image     = BASE_CR (This, FW_IMAGE_STUB, Protocol);
+  BootChain = FwImageStubBootChain (Flags, FwImageStubWrite);
+  FwImageStubLogOperation (Image, FwImageStubWrite, Offset, Bytes, Flags, BootChain);
+
+  if ((Buffer == NULL) || (Offset > Image->Bytes) ||
+      (Bytes > Image->Bytes - Offset)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Image->FailOffset >= Offset) && (Image->FailOffset - Offset < Bytes)) {
+    return Image->FailStatus;
+  }
+
+  Partition = Image->Partition[BootChain];
+  CopyMem (Partition + Offset, Buffer, Bytes);
+  if ((Image->CorruptOffset >= Offset) &&
+      (Image->CorruptOffset - Offset < Bytes)) {
+    Partition[Image->CorruptOffset] ^= 0xFF;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the attributes of an image stub.
+  See NVIDIA_FW_IMAGE_PROTOCOL.GetAttributes().
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FwImageStubGetAttributes (
+  IN  NVIDIA_FW_IMAGE_PROTOCOL  *This,
+  IN  FW_IMAGE_ATTRIBUTES       *Attributes
+) {
+  FW_IMAGE_STUB *Image;
+
+  if (Attributes == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Image                   = BASE_CR (This, FW_IMAGE_STUB, Protocol);
+  Attributes->Bytes       = Image->Bytes;
+  Attributes->BlockSize   = Image->BlockSize;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Add a FwImage to the stub.  Both partitions of the image are zero filled.
+  FwImageGetProtocolArray() returns the images in the order they were added.
+
+  @param  Name                  Name of the image.
+  @param  Bytes                 Size of each partition of the image.
+  @param  BlockSize             Block size of the image.
+
+  @retval EFI_SUCCESS           The image was added.
+  @retval EFI_OUT_OF_RESOURCES  The stub is full or an allocation failed.
+  @retval EFI_INVALID_PARAMETER Name was NULL, or Bytes or BlockSize was 0.
+**/
+EFI_STATUS
+EFIAPI
+FwImageStubAddImage (
+  IN CONST CHAR16  *Name,
+  IN UINTN         Bytes,
+  IN UINT32        BlockSize
+) {
+  FW_IMAGE_STUB *Image;
+  UINTN         BootChain;
+
+  if ((Name == NULL) || (Bytes == 0) || (BlockSize == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mImageCount >= FW_IMAGE_STUB_MAX_IMAGES) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Image = AllocateZeroPool (sizeof (FW_IMAGE_STUB));
+  if (Image == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Image->Name = AllocateCopyPool (StrSize (Name), Name);
+  for (BootChain = 0; BootChain < FW_IMAGE_STUB_BOOT_CHAINS; BootChain++) {
+    Image->Partition[BootChain] = AllocateZeroPool (Bytes);
+  }
+  if ((Image->Name == NULL) || (Image->Partition[BOOT_CHAIN_A] == NULL) ||
+      (Image->Partition[BOOT_CHAIN_B] == NULL)) {
+    for (BootChain = 0; BootChain < FW_IMAGE_STUB_BOOT_CHAINS; BootChain++) {
+      if (Image->Partition[BootChain] != NULL) {
+        FreePool (Image->Partition[BootChain]);
+      }
+    }
+    if (Image->Name != NULL) {
+      FreePool (Image->Name);
+    }
+    FreePool (Image);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Image->Protocol.ImageName     = Image->Name;
+  Image->Protocol.Read          = FwImageStubReadImage;
+  Image->Protocol.Write         = FwImageStubWriteImage;
+  Image->Protocol.GetAttributes = FwImageStubGetAttributes;
+  Image->Bytes                  = Bytes;
+  Image->BlockSize              = BlockSize;
+  Image->CorruptOffset          = MAX_UINTN;
+  Image->FailOffset             = MAX_UINTN;
+
+  mImages[mImageCount]    = Image;
+  mProtocols[mImageCount] = &Image->Protocol;
+  mImageCount++;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Remove all images from the stub and clear the operation log.
+**/
+VOID
+EFIAPI
+FwImageStubDestroy (
+  VOID
+) {
+  UINTN Index;
+  UINTN BootChain;
+
+  for (Index = 0; Index < mImageCount; Index++) {
+    for (BootChain = 0; BootChain < FW_IMAGE_STUB_BOOT_CHAINS; BootChain++) {
+      FreePool (mImages[Index]->Partition[BootChain]);
+    }
+    FreePool (mImages[Index]->Name);
+    FreePool (mImages[Index]);
+    mImages[Index]    = NULL;
+    mProtocols[Index] = NULL;
+  }
+
+  mImageCount = 0;
+  FwImageStubClearOperations ();
+}
+
+/**
+  Get the contents of one partition of an image.
+
+  @param  Name                  Name of the image.
+  @param  BootChain             BOOT_CHAIN_A or BOOT_CHAIN_B.
+
+  @return Partition contents, or NULL if the image does not exist.
+**/
+UINT8 *
+EFIAPI
+FwImageStubGetPartitionData (
+  IN CONST CHAR16  *Name,
+  IN UINTN         BootChain
+) {
+  FW_IMAGE_STUB *Image;
+
+  Image = FwImageStubFind (Name);
+  if ((Image == NULL) || (BootChain >= FW_IMAGE_STUB_BOOT_CHAINS)) {
+    return NULL;
+  }
+
+  return Image->Partition[BootChain];
+}
+
+/**
+  Corrupt the data written to an image.  The byte at Offset is stored
+  inverted by any later Write() that covers it, while Write() still
+  reports success.
+
+  @param  Name                  Name of the image.
+  @param  Offset                Offset of the byte to corrupt, or MAX_UINTN
+                                to stop corrupting the image.
+**/
+VOID
+EFIAPI
+FwImageStubSetWriteCorruption (
+  IN CONST CHAR16  *Name,
+  IN UINTN         Offset
+) {
+  FW_IMAGE_STUB *Image;
+
+  Image = FwImageStubFind (Name);
+  if (Image != NULL) {
+    Image->CorruptOffset = Offset;
+  }
+}
+
+/**
+  Fail the writes to an image.  Any later Write() that covers the byte at
+  Offset returns Status without changing the image.
+
+  @param  Name                  Name of the image.
+  @param  Offset                Offset of the byte whose writes fail, or
+                                MAX_UINTN to stop failing writes.
+  @param  Status                Error status for Write() to return.
+**/
+VOID
+EFIAPI
+FwImageStubSetWriteFailure (
+  IN CONST CHAR16  *Name,
+  IN UINTN         Offset,
+  IN EFI_STATUS    Status
+) {
+  FW_IMAGE_STUB *Image;
+
+  Image = FwImageStubFind (Name);
+  if (Image != NULL) {
+    Image->FailOffset = Offset;
+    Image->FailStatus = Status;
+  }
+}
+
+/**
+  Get the number of operations in the operation log.
+
+  @return Number of Read() and Write() calls since the log was cleared.
+**/
+UINTN
+EFIAPI
+FwImageStubGetOperationCount (
+  VOID
+) {
+  return mOperationCount;
+}
+
+/**
+  Get an operation from the operation log.
+
+  @param  Index                 Index of the operation.
+
+  @return Operation, or NULL if Index is past the end of the log.
+**/
+CONST FW_IMAGE_STUB_OPERATION *
+EFIAPI
+FwImageStubGetOperation (
+  IN UINTN  Index
+) {
+  if (Index >= mOperationCount) {
+    return NULL;
+  }
+
+  return &mOperations[Index];
+}
+
+/**
+  Clear the operation log.
+**/
+VOID
+EFIAPI
+FwImageStubClearOperations (
+  VOID
+) {
+  mOperationCount = 0;
+}
+
+/**
+  Find the NVIDIA_FW_IMAGE_PROTOCOL structure for the given image name.
+
+  @param[in]  Name              Image name
+
+  @retval NULL                  Image name not found
+  @retval non-NULL              Pointer to the image protocol structure
+
+**/
+NVIDIA_FW_IMAGE_PROTOCOL *
+EFIAPI
+FwImageFindProtocol (
+  CONST CHAR16  *Name
+) {
+  FW_IMAGE_STUB *Image;
+
+  Image = FwImageStubFind (Name);
+  if (Image == NULL) {
+    return NULL;
+  }
+
+  return &Image->Protocol;
+}
+
+/**
+  Get the number of NVIDIA_FW_IMAGE_PROTOCOL structures available.
+
+  @retval UINTN                 Number of protocol structures
+
+**/
+UINTN
+EFIAPI
+FwImageGetCount (
+  VOID
+) {
+  return mImageCount;
+}
+
+/**
+  Get a pointer to the first element of the NVIDIA_FW_IMAGE_PROTOCOL array.
+
+  @retval NVIDIA_FW_IMAGE_PROTOCOL     Pointer to first protocol structure
+
+**/
+NVIDIA_FW_IMAGE_PROTOCOL **
+EFIAPI
+FwImageGetProtocolArray (
+  VOID
+) {
+  return mProtocols;
+}
@@ -0,0 +1,47 @@
+/** @file
+
+Stub implementation of the boot chain functions of PlatformResourceLib for
+host based tests.
+
+The active boot chain is the one FwImageStubLib treats as active.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/FwImageStubLib.h>
+#include <Library/PlatformResourceLib.h>
+
+/**
+  Retrieve Active Boot Chain Information
+
+**/
+EFI_STATUS
+EFIAPI
+GetActiveBootChain (
+  OUT UINT32 *BootChain
+) {
+  if (BootChain == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *BootChain = FW_IMAGE_STUB_ACTIVE_BOOT_CHAIN;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Validate Active Boot Chain
+
+**/
+EFI_STATUS
+EFIAPI
+ValidateActiveBootChain (
+  VOID
+) {
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,528 @@
+/** @file
+
+Stub implementation of a QSPI controller with a SPI NOR device on CS0.
+
+Provides the IoLib MMIO accessors used by QspiControllerLib. PIO transfers
+are run when the PIO bit is set and DMA transfers when DMA is enabled, each
+shifting bytes through the simulated NOR device.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IoLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/QspiControllerStubLib.h>
+
+#include "../../QspiControllerLib/QspiControllerLibPrivate.h"
+
+#define QSPI_STUB_REGISTER_SPACE  0x200
+
+typedef struct {
+  UINT32                     Registers[QSPI_STUB_REGISTER_SPACE / sizeof (UINT32)];
+  UINT32                     TxFifo[MAX_FIFO_PACKETS];
+  UINTN                      TxCount;
+  UINT32                     RxFifo[MAX_FIFO_PACKETS];
+  UINTN                      RxHead;
+  UINTN                      RxCount;
+  UINT8                      *DmaHostAddress;
+  UINT32                     DmaSize;
+  BOOLEAN                    FailDma;
+  QSPI_STUB_TRANSFER_COUNTS  Counts;
+
+  // Simulated NOR device
+  UINT8                      *Flash;
+  UINTN                      FlashSize;
+  BOOLEAN                    Selected;
+  UINT8                      Opcode;
+  UINTN                      BytesShifted;
+  UINTN                      Address;
+} QSPI_CONTROLLER_STUB;
+
+STATIC QSPI_CONTROLLER_STUB *mQspiStub = NULL;
+
+/**
+  Shift one byte through the simulated NOR device.
+
+  @param  In        Byte shifted into the device.
+
+  @return Byte shifted out of the device.
+**/
+STATIC
+UINT8
+QspiStubShiftByte (
+  IN UINT8  In
+) {
+  UINT8 Out;
+
+  Out = 0xFF;
+  if (!mQspiStub->Selected) {
+    return Out;
+  }
+
+  if (mQspiStub->BytesShifted == 0) {
+    mQspiStub->Opcode = In;
+  } else if (mQspiStub->BytesShifted <= QSPI_STUB_ADDRESS_BYTES) {
+    mQspiStub->Address = (mQspiStub->Address << 8) | In;
+  } else if (mQspiStub->Address < mQspiStub->FlashSize) {
+    if (mQspiStub->Opcode == QSPI_STUB_CMD_READ) {
+      Out = mQspiStub->Flash[mQspiStub->Address];
+    } else if (mQspiStub->Opcode == QSPI_STUB_CMD_PAGE_PROGRAM) {
+      mQspiStub->Flash[mQspiStub->Address] &= In;
+    }
+    mQspiStub->Address++;
+  }
+  mQspiStub->BytesShifted++;
+
+  return Out;
+}
+
+/**
+  Get the number of bytes moved by the configured transaction.
+
+  @return Number of bytes.
+**/
+STATIC
+UINTN
+QspiStubTransactionBytes (
+  VOID
+) {
+  UINT32 Packets;
+  UINT32 PacketBits;
+
+  Packets = BitFieldRead32 (mQspiStub->Registers[QSPI_DMA_BLK_SIZE_0 / sizeof (UINT32)],
+                            QSPI_DMA_BLK_SIZE_0_BLOCK_SIZE_LSB,
+                            QSPI_DMA_BLK_SIZE_0_BLOCK_SIZE_MSB) + 1;
+  PacketBits = BitFieldRead32 (mQspiStub->Registers[QSPI_COMMAND_0 / sizeof (UINT32)],
+                               QSPI_COMMAND_0_BIT_LENGTH_LSB,
+                               QSPI_COMMAND_0_BIT_LENGTH_MSB) + 1;
+
+  return Packets * (PacketBits / 8);
+}
+
+/**
+  Mark the current transaction as complete.
+**/
+STATIC
+VOID
+QspiStubSetReady (
+  VOID
+) {
+  mQspiStub->Registers[QSPI_TRANSFER_STATUS_0 / sizeof (UINT32)] |= BIT30;
+}
+
+/**
+  Run a PIO transaction through the FIFOs.
+
+  @param  Command   Value of the command register.
+**/
+STATIC
+VOID
+QspiStubRunPio (
+  IN UINT32  Command
+) {
+  UINTN Bytes;
+  UINTN Index;
+  UINT8 Data;
+
+  mQspiStub->Counts.PioTransfers++;
+  Bytes = QspiStubTransactionBytes ();
+
+  // Packets are packed little endian into 32-bit FIFO entries
+  if ((Command & (1U << QSPI_COMMAND_0_TX_EN_BIT)) != 0) {
+    ASSERT (Bytes <= mQspiStub->TxCount * sizeof (UINT32));
+    for (Index = 0; Index < Bytes; Index++) {
+      Data = (UINT8)(mQspiStub->TxFifo[Index / sizeof (UINT32)] >> ((Index % sizeof (UINT32)) * 8));
+      QspiStubShiftByte (Data);
+    }
+    mQspiStub->TxCount = 0;
+  }
+
+  if ((Command & (1U << QSPI_COMMAND_0_RX_EN_BIT)) != 0) {
+    ASSERT (Bytes <= sizeof (mQspiStub->RxFifo));
+    ZeroMem (mQspiStub->RxFifo, sizeof (mQspiStub->RxFifo));
+    for (Index = 0; Index < Bytes; Index++) {
+      Data = QspiStubShiftByte (0xFF);
+      mQspiStub->RxFifo[Index / sizeof (UINT32)] |= (UINT32)Data << ((Index % sizeof (UINT32)) * 8);
+    }
+    mQspiStub->RxHead = 0;
+    mQspiStub->RxCount = (Bytes + sizeof (UINT32) - 1) / sizeof (UINT32);
+  }
+
+  QspiStubSetReady ();
+}
+
+/**
+  Run a DMA transaction to or from the DMA buffer.
+
+  @param  Command   Value of the command register.
+
+  @retval TRUE      The transaction completed.
+  @retval FALSE     The transaction stalled.
+**/
+STATIC
+BOOLEAN
+QspiStubRunDma (
+  IN UINT32  Command
+) {
+  UINT64 DeviceAddress;
+  UINTN  Bytes;
+  UINTN  Index;
+  UINT8  *Buffer;
+
+  mQspiStub->Counts.DmaTransfers++;
+  if (mQspiStub->FailDma) {
+    return FALSE;
+  }
+
+  DeviceAddress = LShiftU64 (mQspiStub->Registers[QSPI_DMA_HI_ADDRESS_0 / sizeof (UINT32)], 32) |
+                  mQspiStub->Registers[QSPI_DMA_MEM_ADDRESS_0 / sizeof (UINT32)];
+  Bytes = QspiStubTransactionBytes ();
+  if ((mQspiStub->DmaHostAddress == NULL) ||
+      (DeviceAddress < QSPI_STUB_DMA_DEVICE_ADDRESS) ||
+      ((DeviceAddress - QSPI_STUB_DMA_DEVICE_ADDRESS + Bytes) > mQspiStub->DmaSize)) {
+    DEBUG ((DEBUG_ERROR, "%a: DMA to invalid address 0x%lx\n", __FUNCTION__, DeviceAddress));
+    return FALSE;
+  }
+  Buffer = mQspiStub->DmaHostAddress + (DeviceAddress - QSPI_STUB_DMA_DEVICE_ADDRESS);
+
+  if ((Command & (1U << QSPI_COMMAND_0_TX_EN_BIT)) != 0) {
+    for (Index = 0; Index < Bytes; Index++) {
+      QspiStubShiftByte (Buffer[Index]);
+    }
+  } else if ((Command & (1U << QSPI_COMMAND_0_RX_EN_BIT)) != 0) {
+    for (Index = 0; Index < Bytes; Index++) {
+      Buffer[Index] = QspiStubShiftByte (0xFF);
+    }
+  }
+
+  QspiStubSetReady ();
+  return TRUE;
+}
+
+/**
+  Get the register index of an MMIO address.
+
+  @param  Address   MMIO address.
+
+  @return Register index.
+**/
+STATIC
+UINTN
+QspiStubRegisterIndex (
+  IN UINTN  Address
+) {
+  UINTN Offset;
+
+  ASSERT (mQspiStub != NULL);
+  Offset = Address - (UINTN)mQspiStub->Registers;
+  ASSERT (Offset < QSPI_STUB_REGISTER_SPACE);
+  ASSERT ((Offset % sizeof (UINT32)) == 0);
+
+  return Offset / sizeof (UINT32);
+}
+
+/**
+  Reads a 32-bit MMIO register.
+
+  @param  Address The MMIO register to read.
+
+  @return The value read.
+**/
+UINT32
+EFIAPI
+MmioRead32 (
+  IN UINTN  Address
+) {
+  UINTN  Index;
+  UINT32 Value;
+
+  Index = QspiStubRegisterIndex (Address);
+  switch (Index * sizeof (UINT32)) {
+    case QSPI_FIFO_STATUS_0:
+      Value = 0;
+      if (mQspiStub->RxCount == 0) {
+        Value |= 1 << QSPI_FIFO_STATUS_0_RX_FIFO_EMPTY_BIT;
+      }
+      if (mQspiStub->TxCount == 0) {
+        Value |= 1 << QSPI_FIFO_STATUS_0_TX_FIFO_EMPTY_BIT;
+      }
+      if (mQspiStub->TxCount == MAX_FIFO_PACKETS) {
+        Value |= 1 << QSPI_FIFO_STATUS_0_TX_FIFO_FULL_BIT;
+      }
+      return Value;
+
+    case QSPI_RX_FIFO_0:
+      if (mQspiStub->RxCount == 0) {
+        return 0;
+      }
+      Value = mQspiStub->RxFifo[mQspiStub->RxHead++];
+      mQspiStub->RxCount--;
+      return Value;
+
+    default:
+      return mQspiStub->Registers[Index];
+  }
+}
+
+/**
+  Writes a 32-bit MMIO register.
+
+  @param  Address The MMIO register to write.
+  @param  Value   The value to write to the MMIO register.
+
+  @return Value.
+**/
+UINT32
+EFIAPI
+MmioWrite32 (
+  IN UINTN   Address,
+  IN UINT32  Value
+) {
+  UINTN  Index;
+  UINT32 Old;
+
+  Index = QspiStubRegisterIndex (Address);
+  Old = mQspiStub->Registers[Index];
+  switch (Index * sizeof (UINT32)) {
+    case QSPI_COMMAND_0:
+      mQspiStub->Registers[Index] = Value;
+      // CS is active low, the device restarts on every new selection
+      if ((Value & (1U << QSPI_COMMAND_0_CS_SW_VAL_BIT)) == 0) {
+        if (!mQspiStub->Selected) {
+          mQspiStub->Selected = TRUE;
+          mQspiStub->BytesShifted = 0;
+          mQspiStub->Address = 0;
+        }
+      } else {
+        mQspiStub->Selected = FALSE;
+      }
+      if (((Old & (1U << QSPI_COMMAND_0_PIO_BIT)) == 0) &&
+          ((Value & (1U << QSPI_COMMAND_0_PIO_BIT)) != 0)) {
+        QspiStubRunPio (Value);
+        mQspiStub->Registers[Index] &= ~(UINT32)(1U << QSPI_COMMAND_0_PIO_BIT);
+      }
+      break;
+
+    case QSPI_TRANSFER_STATUS_0:
+      // Ready is write 1 to clear
+      if ((Value & BIT30) != 0) {
+        mQspiStub->Registers[Index] &= ~(UINT32)BIT30;
+      }
+      break;
+
+    case QSPI_FIFO_STATUS_0:
+      if ((Value & (1U << QSPI_FIFO_STATUS_0_TX_FIFO_FLUSH_BIT)) != 0) {
+        mQspiStub->TxCount = 0;
+      }
+      if ((Value & (1U << QSPI_FIFO_STATUS_0_RX_FIFO_FLUSH_BIT)) != 0) {
+        mQspiStub->RxCount = 0;
+      }
+      break;
+
+    case QSPI_DMA_CTL_0:
+      mQspiStub->Registers[Index] = Value;
+      if (((Old & (1U << QSPI_DMA_CTL_0_DMA_EN_BIT)) == 0) &&
+          ((Value & (1U << QSPI_DMA_CTL_0_DMA_EN_BIT)) != 0)) {
+        // Completed transfers clear DMA_EN, stalled ones leave it set
+        if (QspiStubRunDma (mQspiStub->Registers[QSPI_COMMAND_0 / sizeof (UINT32)])) {
+          mQspiStub->Registers[Index] &= ~(UINT32)(1U << QSPI_DMA_CTL_0_DMA_EN_BIT);
+        }
+      }
+      break;
+
+    case QSPI_TX_FIFO_0:
+      if (mQspiStub->TxCount < MAX_FIFO_PACKETS) {
+        mQspiStub->TxFifo[mQspiStub->TxCount++] = Value;
+      }
+      break;
+
+    default:
+      mQspiStub->Registers[Index] = Value;
+      break;
+  }
+
+  return Value;
+}
+
+/**
+  Reads a bit field in a 32-bit MMIO register.
+
+  @param  Address   The MMIO register to read.
+  @param  StartBit  The ordinal of the least significant bit in the bit field.
+  @param  EndBit    The ordinal of the most significant bit in the bit field.
+
+  @return The value read.
+**/
+UINT32
+EFIAPI
+MmioBitFieldRead32 (
+  IN UINTN  Address,
+  IN UINTN  StartBit,
+  IN UINTN  EndBit
+) {
+  return BitFieldRead32 (MmioRead32 (Address), StartBit, EndBit);
+}
+
+/**
+  Writes a bit field to a 32-bit MMIO register, preserving the other bits.
+
+  @param  Address   The MMIO register to write.
+  @param  StartBit  The ordinal of the least significant bit in the bit field.
+  @param  EndBit    The ordinal of the most significant bit in the bit field.
+  @param  Value     New value of the bit field.
+
+  @return The value written back to the MMIO register.
+**/
+UINT32
+EFIAPI
+MmioBitFieldWrite32 (
+  IN UINTN   Address,
+  IN UINTN   StartBit,
+  IN UINTN   EndBit,
+  IN UINT32  Value
+) {
+  return MmioWrite32 (Address, BitFieldWrite32 (MmioRead32 (Address), StartBit, EndBit, Value));
+}
+
+/**
+  Initialize the QSPI controller stub.
+
+  @param  Flash                 Storage of the simulated NOR device.
+  @param  FlashSize             Size of the simulated NOR device.
+  @param  QspiBaseAddress       Base address to pass to QspiControllerLib.
+
+  @retval EFI_SUCCESS           Initialization succeeded.
+  @retval EFI_OUT_OF_RESOURCES  Internal memory allocation failed.
+  @retval EFI_INVALID_PARAMETER Flash or QspiBaseAddress was NULL.
+**/
+EFI_STATUS
+EFIAPI
+QspiControllerStubInitialize (
+  IN  UINT8                 *Flash,
+  IN  UINTN                 FlashSize,
+  OUT EFI_PHYSICAL_ADDRESS  *QspiBaseAddress
+) {
+  if (Flash == NULL || QspiBaseAddress == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  mQspiStub = AllocateZeroPool (sizeof (QSPI_CONTROLLER_STUB));
+  if (mQspiStub == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mQspiStub->Flash = Flash;
+  mQspiStub->FlashSize = FlashSize;
+  mQspiStub->Registers[QSPI_COMMAND_0 / sizeof (UINT32)] = 1 << QSPI_COMMAND_0_CS_SW_VAL_BIT;
+
+  *QspiBaseAddress = (UINTN)mQspiStub->Registers;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Clean up the QSPI controller stub and its DMA buffer.
+**/
+VOID
+EFIAPI
+QspiControllerStubDestroy (
+  VOID
+) {
+  if (mQspiStub == NULL) {
+    return;
+  }
+
+  if (mQspiStub->DmaHostAddress != NULL) {
+    FreePool (mQspiStub->DmaHostAddress);
+  }
+  FreePool (mQspiStub);
+  mQspiStub = NULL;
+}
+
+/**
+  Allocate the DMA buffer of the QSPI controller stub.
+
+  The device address of the buffer is QSPI_STUB_DMA_DEVICE_ADDRESS, which
+  is above 4GB so that both DMA address registers are used. DMA to any
+  other address is treated as a bus error and never completes.
+
+  @param  Size                  Size of the DMA buffer.
+  @param  DmaBuffer             DMA buffer description to fill in.
+
+  @retval EFI_SUCCESS           DmaBuffer was filled in.
+  @retval EFI_OUT_OF_RESOURCES  The buffer could not be allocated.
+**/
+EFI_STATUS
+EFIAPI
+QspiControllerStubAllocateDmaBuffer (
+  IN  UINT32           Size,
+  OUT QSPI_DMA_BUFFER  *DmaBuffer
+) {
+  ASSERT (mQspiStub != NULL);
+
+  if (mQspiStub->DmaHostAddress != NULL) {
+    FreePool (mQspiStub->DmaHostAddress);
+  }
+
+  mQspiStub->DmaHostAddress = AllocatePool (Size);
+  if (mQspiStub->DmaHostAddress == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  mQspiStub->DmaSize = Size;
+
+  DmaBuffer->HostAddress = mQspiStub->DmaHostAddress;
+  DmaBuffer->DeviceAddress = QSPI_STUB_DMA_DEVICE_ADDRESS;
+  DmaBuffer->Size = Size;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Make DMA transfers started from now on stall and never complete.
+
+  @param  Fail                  TRUE to stall DMA transfers.
+**/
+VOID
+EFIAPI
+QspiControllerStubSetDmaFailure (
+  IN BOOLEAN  Fail
+) {
+  mQspiStub->FailDma = Fail;
+}
+
+/**
+  Read a controller register without side effects.
+
+  @param  Offset                Register offset.
+
+  @return Register value.
+**/
+UINT32
+EFIAPI
+QspiControllerStubGetRegister (
+  IN UINTN  Offset
+) {
+  return mQspiStub->Registers[Offset / sizeof (UINT32)];
+}
+
+/**
+  Get and reset the number of transfers started on the controller stub.
+
+  @param  Counts                Transfers started since the last call.
+**/
+VOID
+EFIAPI
+QspiControllerStubGetTransferCounts (
+  OUT QSPI_STUB_TRANSFER_COUNTS  *Counts
+) {
+  CopyMem (Counts, &mQspiStub->Counts, sizeof (QSPI_STUB_TRANSFER_COUNTS));
+  ZeroMem (&mQspiStub->Counts, sizeof (QSPI_STUB_TRANSFER_COUNTS));
+}
@@ -0,0 +1,143 @@
+/** @file
+
+Stub implementation of TimerLib for host based tests.
+
+Delays do not wait, they advance a simulated clock instead. The performance
+counter runs at 1GHz so counter ticks and nanoseconds are the same.
+
+Copyright (c) 2022, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/TimerLib.h>
+#include <Library/TimerStubLib.h>
+
+STATIC UINT64 mTimerStubTime = 0;
+
+/**
+  Stalls the CPU for at least the given number of microseconds.
+
+  @param  MicroSeconds  The minimum number of microseconds to delay.
+
+  @return MicroSeconds
+**/
+UINTN
+EFIAPI
+MicroSecondDelay (
+  IN UINTN  MicroSeconds
+) {
+  mTimerStubTime += (UINT64)MicroSeconds * 1000;
+  return MicroSeconds;
+}
+
+/**
+  Stalls the CPU for at least the given number of nanoseconds.
+
+  @param  NanoSeconds The minimum number of nanoseconds to delay.
+
+  @return NanoSeconds
+**/
+UINTN
+EFIAPI
+NanoSecondDelay (
+  IN UINTN  NanoSeconds
+) {
+  mTimerStubTime += NanoSeconds;
+  return NanoSeconds;
+}
+
+/**
+  Retrieves the current value of the performance counter.
+
+  @return The current value of the performance counter.
+**/
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+) {
+  return mTimerStubTime;
+}
+
+/**
+  Retrieves the 64-bit frequency in Hz and the range of performance counter
+  values.
+
+  @param  StartValue  The value the performance counter starts with.
+  @param  EndValue    The value that the performance counter ends with.
+
+  @return The frequency in Hz.
+**/
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64  *StartValue   OPTIONAL,
+  OUT UINT64  *EndValue     OPTIONAL
+) {
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+
+  if (EndValue != NULL) {
+    *EndValue = MAX_UINT64;
+  }
+
+  return 1000000000ULL;
+}
+
+/**
+  Converts elapsed ticks of performance counter to time in nanoseconds.
+
+  @param  Ticks     The number of elapsed ticks of running performance counter.
+
+  @return The elapsed time in nanoseconds.
+**/
+UINT64
+EFIAPI
+GetTimeInNanoSecond (
+  IN UINT64  Ticks
+) {
+  return Ticks;
+}
+
+/**
+  Get the simulated time, in nanoseconds, that has passed through delays
+  since the timer stub was last reset.
+
+  @return Simulated time in nanoseconds.
+**/
+UINT64
+EFIAPI
+TimerStubGetTime (
+  VOID
+) {
+  return mTimerStubTime;
+}
+
+/**
+  Advance the simulated time without a delay call, e.g. to model the
+  duration of a simulated device operation.
+
+  @param  NanoSeconds           Nanoseconds to advance the time by.
+**/
+VOID
+EFIAPI
+TimerStubAdvance (
+  IN UINT64  NanoSeconds
+) {
+  mTimerStubTime += NanoSeconds;
+}
+
+/**
+  Reset the simulated time to 0.
+**/
+VOID
+EFIAPI
+TimerStubReset (
+  VOID
+) {
+  mTimerStubTime = 0;
+}
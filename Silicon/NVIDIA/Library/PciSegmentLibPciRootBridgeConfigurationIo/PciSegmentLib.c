@@ -16,6 +16,13 @@
 NVIDIA_PCI_ROOT_BRIDGE_CONFIGURATION_IO_PROTOCOL   **mPciConfigurations     = NULL;
 UINTN                                              mNumberOfPciConfigurations = 0;
 
+//
+// (Segment, Bus) to protocol instance lookup table, indexed by
+// Segment * PCI_SEGMENT_LIB_BUSES_PER_SEGMENT + Bus
+//
+NVIDIA_PCI_ROOT_BRIDGE_CONFIGURATION_IO_PROTOCOL   **mPciBusTable           = NULL;
+UINTN                                              mNumberOfPciBusTableSegments = 0;
+
 /**
   The constructor function caches data of PCI Root Bridge I/O Protocol instances.
 
@@ -38,8 +45,10 @@ PciSegmentLibConstructor (
 {
   EFI_STATUS                           Status;
   UINTN                                Index;
+  UINTN                                Bus;
   UINTN                                HandleCount;
   EFI_HANDLE                           *HandleBuffer;
+  UINT32                               SegmentNumber;
 
   HandleCount        = 0;
   HandleBuffer       = NULL;
@@ -78,10 +87,38 @@ PciSegmentLibConstructor (
     if (EFI_ERROR (Status)) {
       return Status;
     }
+
+    if (mPciConfigurations[Index]->SegmentNumber < PCI_SEGMENT_LIB_MAX_TABLE_SEGMENTS) {
+      mNumberOfPciBusTableSegments = MAX (mNumberOfPciBusTableSegments,
+                                          mPciConfigurations[Index]->SegmentNumber + 1);
+    }
   }
 
   FreePool(HandleBuffer);
 
+  //
+  // Build the lookup table so accesses do not have to search the instances.
+  // Failing to allocate it is not fatal, the search is used instead.
+  //
+  if (mNumberOfPciBusTableSegments != 0) {
+    mPciBusTable = AllocateZeroPool (mNumberOfPciBusTableSegments *
+                                     PCI_SEGMENT_LIB_BUSES_PER_SEGMENT *
+                                     sizeof (NVIDIA_PCI_ROOT_BRIDGE_CONFIGURATION_IO_PROTOCOL *));
+    if (mPciBusTable == NULL) {
+      mNumberOfPciBusTableSegments = 0;
+    }
+  }
+
+  for (Index = 0; Index < mNumberOfPciConfigurations; Index++) {
+    SegmentNumber = mPciConfigurations[Index]->SegmentNumber;
+    if (SegmentNumber >= mNumberOfPciBusTableSegments) {
+      continue;
+    }
+    for (Bus = mPciConfigurations[Index]->MinBusNumber; Bus <= mPciConfigurations[Index]->MaxBusNumber; Bus++) {
+      mPciBusTable[SegmentNumber * PCI_SEGMENT_LIB_BUSES_PER_SEGMENT + Bus] = mPciConfigurations[Index];
+    }
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -105,6 +142,9 @@ PciSegmentLibDestructor (
   )
 {
   FreePool (mPciConfigurations);
+  if (mPciBusTable != NULL) {
+    FreePool (mPciBusTable);
+  }
 
   return EFI_SUCCESS;
 }
@@ -131,16 +171,21 @@ PciSegmentLibSearchForConfiguration (
   UINT64                             SegmentNumber;
   UINT64                             BusNumber;
 
+  SegmentNumber = RShiftU64 (Address, 32);
+  BusNumber     = ((UINTN)Address >> 20) & 0xFF;
+
+  if (SegmentNumber < mNumberOfPciBusTableSegments) {
+    return mPciBusTable[SegmentNumber * PCI_SEGMENT_LIB_BUSES_PER_SEGMENT + BusNumber];
+  }
+
   for (Index = 0; Index < mNumberOfPciConfigurations; Index++) {
     //
     // Matches segment number of address with the segment number of protocol instance.
     //
-    SegmentNumber = BitFieldRead64 (Address, 32, 63);
     if (SegmentNumber == mPciConfigurations[Index]->SegmentNumber) {
       //
       // Matches the bus number of address with bus number range of protocol instance.
       //
-      BusNumber = BitFieldRead64 (Address, 20, 27);
       if (BusNumber >= mPciConfigurations[Index]->MinBusNumber && BusNumber <= mPciConfigurations[Index]->MaxBusNumber) {
         return mPciConfigurations[Index];
       }
@@ -1316,6 +1361,8 @@ PciSegmentReadBuffer (
   )
 {
   UINTN                                ReturnValue;
+  NVIDIA_PCI_ROOT_BRIDGE_CONFIGURATION_IO_PROTOCOL *PciConfigurationIo;
+  UINT32                               Data;
 
   ASSERT_INVALID_PCI_SEGMENT_ADDRESS (StartAddress, 0);
   ASSERT (((StartAddress & 0xFFF) + Size) <= 0x1000);
@@ -1351,11 +1398,30 @@ PciSegmentReadBuffer (
     Buffer = (UINT16*)Buffer + 1;
   }
 
+  //
+  // The whole range is in a single function, so look up the protocol
+  // instance once for all of the double words.
+  //
+  PciConfigurationIo = NULL;
+  if (Size >= sizeof (UINT32)) {
+    PciConfigurationIo = PciSegmentLibSearchForConfiguration (StartAddress);
+    ASSERT (PciConfigurationIo != NULL);
+  }
+
   while (Size >= sizeof (UINT32)) {
     //
     // Read as many double words as possible
     //
-    WriteUnaligned32 (Buffer, PciSegmentRead32 (StartAddress));
+    Data = 0;
+    if (PciConfigurationIo != NULL) {
+      PciConfigurationIo->Read (
+                             PciConfigurationIo,
+                             NvidiaPciWidthUint32,
+                             PCI_TO_PCI_ROOT_BRIDGE_IO_ADDRESS (StartAddress),
+                             &Data
+                             );
+    }
+    WriteUnaligned32 (Buffer, Data);
     StartAddress += sizeof (UINT32);
     Size -= sizeof (UINT32);
     Buffer = (UINT32*)Buffer + 1;
@@ -1414,6 +1480,8 @@ PciSegmentWriteBuffer (
   )
 {
   UINTN                                ReturnValue;
+  NVIDIA_PCI_ROOT_BRIDGE_CONFIGURATION_IO_PROTOCOL *PciConfigurationIo;
+  UINT32                               Data;
 
   ASSERT_INVALID_PCI_SEGMENT_ADDRESS (StartAddress, 0);
   ASSERT (((StartAddress & 0xFFF) + Size) <= 0x1000);
@@ -1449,11 +1517,29 @@ PciSegmentWriteBuffer (
     Buffer = (UINT16*)Buffer + 1;
   }
 
+  //
+  // The whole range is in a single function, so look up the protocol
+  // instance once for all of the double words.
+  //
+  PciConfigurationIo = NULL;
+  if (Size >= sizeof (UINT32)) {
+    PciConfigurationIo = PciSegmentLibSearchForConfiguration (StartAddress);
+    ASSERT (PciConfigurationIo != NULL);
+  }
+
   while (Size >= sizeof (UINT32)) {
     //
     // Write as many double words as possible
     //
-    PciSegmentWrite32 (StartAddress, ReadUnaligned32 (Buffer));
+    Data = ReadUnaligned32 (Buffer);
+    if (PciConfigurationIo != NULL) {
+      PciConfigurationIo->Write (
+                             PciConfigurationIo,
+                             NvidiaPciWidthUint32,
+                             PCI_TO_PCI_ROOT_BRIDGE_IO_ADDRESS (StartAddress),
+                             &Data
+                             );
+    }
     StartAddress += sizeof (UINT32);
     Size -= sizeof (UINT32);
     Buffer = (UINT32*)Buffer + 1;
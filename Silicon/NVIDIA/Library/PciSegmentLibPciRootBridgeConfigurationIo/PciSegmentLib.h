@@ -40,4 +40,15 @@
 #define PCI_TO_PCI_ROOT_BRIDGE_IO_ADDRESS(A) \
   ((((UINT32)(A) << 4) & 0xff000000) | (((UINT32)(A) >> 4) & 0x00000700) | (((UINT32)(A) << 1) & 0x001f0000) | (LShiftU64((A) & 0xfff, 32)))
 
+///
+/// Number of buses in a PCI segment, one lookup table row per segment
+///
+#define PCI_SEGMENT_LIB_BUSES_PER_SEGMENT  256
+
+///
+/// Segments above this are not put in the lookup table and are found by
+/// searching the protocol instances instead
+///
+#define PCI_SEGMENT_LIB_MAX_TABLE_SEGMENTS 64
+
 #endif
@@ -11,6 +11,7 @@
 
 #include <PiDxe.h>
 
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/IoLib.h>
@@ -22,6 +23,12 @@
 
 BOOLEAN TimeOutMessage = FALSE;
 
+STATIC CONST UINT32 mInterfaceWidth[QspiBusWidthMax] = {
+  QSPI_COMMAND_0_INTERFACE_WIDTH_SINGLE,
+  QSPI_COMMAND_0_INTERFACE_WIDTH_DUAL,
+  QSPI_COMMAND_0_INTERFACE_WIDTH_QUAD
+};
+
 
 /**
   Flush QSPI Controller FIFO.
@@ -202,6 +209,42 @@ QspiWaitTransactionStatusReady (
 }
 
 
+/**
+  Wait for a DMA transaction to be ready.
+
+  Unlike PIO transactions, which are bounded by the FIFO size, a DMA
+  transaction that does not complete is given up on after QSPI_DMA_TIMEOUT
+  microseconds so the caller can recover the controller.
+
+  @param  QspiBaseAddress          Base Address for QSPI Controller in use.
+
+  @retval EFI_SUCCESS              Transaction status ready.
+  @retval EFI_TIMEOUT              Transaction status did not get ready.
+**/
+STATIC
+EFI_STATUS
+QspiWaitDmaTransactionReady (
+  IN EFI_PHYSICAL_ADDRESS QspiBaseAddress
+)
+{
+  UINT32 Timeout;
+
+  Timeout = 0;
+  // Wait for transaction status to be ready.
+  while (QSPI_TRANSFER_STATUS_0_RDY_NOT_READY == MmioBitFieldRead32 (QspiBaseAddress + QSPI_TRANSFER_STATUS_0,
+                                                                     QSPI_TRANSFER_STATUS_0_RDY_BIT,
+                                                                     QSPI_TRANSFER_STATUS_0_RDY_BIT)) {
+    if (Timeout == QSPI_DMA_TIMEOUT) {
+      DEBUG ((EFI_D_ERROR, "%a QSPI DMA Transaction Timed Out.\n", __FUNCTION__));
+      return EFI_TIMEOUT;
+    }
+    MicroSecondDelay (1);
+    Timeout++;
+  }
+  return EFI_SUCCESS;
+}
+
+
 /**
   Setup Wait Cycles
 
@@ -233,13 +276,15 @@ QspiPerformWaitCycleConfiguration (
   @param  QspiBaseAddress          Base Address for QSPI Controller in use.
   @param  PacketLen                Size of packets.
   @param  BlockLen                 Number of packets.
+  @param  BusWidth                 Number of data lines used for the transfer.
 **/
 STATIC
 VOID
 QspiPerformTransactionConfiguration (
   IN EFI_PHYSICAL_ADDRESS QspiBaseAddress,
   IN UINT32               PacketLen,
-  IN UINT32               BlockLen
+  IN UINT32               BlockLen,
+  IN QSPI_BUS_WIDTH       BusWidth
 )
 {
   // Select Single Data Rate mode.
@@ -247,11 +292,11 @@ QspiPerformTransactionConfiguration (
                        QSPI_COMMAND_0_SDR_DDR_SEL_BIT,
                        QSPI_COMMAND_0_SDR_DDR_SEL_BIT,
                        QSPI_COMMAND_0_SDR_DDR_SEL_SDR);
-  // Select single bit transfer mode.
+  // Select single, dual or quad bit transfer mode.
   MmioBitFieldWrite32 (QspiBaseAddress + QSPI_COMMAND_0,
                        QSPI_COMMAND_0_INTERFACE_WIDTH_LSB,
                        QSPI_COMMAND_0_INTERFACE_WIDTH_MSB,
-                       QSPI_COMMAND_0_INTERFACE_WIDTH_SINGLE);
+                       mInterfaceWidth[BusWidth]);
   // Configure unpacked mode.
   MmioBitFieldWrite32 (QspiBaseAddress + QSPI_COMMAND_0,
                        QSPI_COMMAND_0_PACKED_BIT,
@@ -280,6 +325,7 @@ QspiPerformTransactionConfiguration (
                                    received.
   @param  Len                      Number of packets.
   @param  PacketLen                Size of individual packet.
+  @param  BusWidth                 Number of data lines used for the transfer.
 
   @retval EFI_SUCCESS              Data received successfully.
   @retval Others                   Data reception failed.
@@ -290,7 +336,8 @@ QspiPerformReceive (
   IN EFI_PHYSICAL_ADDRESS   QspiBaseAddress,
   IN VOID                   *Buffer,
   IN UINT32                 Len,
-  IN UINT32                 PacketLen
+  IN UINT32                 PacketLen,
+  IN QSPI_BUS_WIDTH         BusWidth
 )
 {
   EFI_STATUS  Status;
@@ -304,7 +351,7 @@ QspiPerformReceive (
   // Clear transaction status
   QspiClearTransactionStatus (QspiBaseAddress);
   // Perform transaction packet width and size configuration
-  QspiPerformTransactionConfiguration (QspiBaseAddress, PacketLen, Len);
+  QspiPerformTransactionConfiguration (QspiBaseAddress, PacketLen, Len, BusWidth);
   // Enable RX
   MmioBitFieldWrite32 (QspiBaseAddress + QSPI_COMMAND_0,
                        QSPI_COMMAND_0_RX_EN_BIT,
@@ -370,6 +417,7 @@ QspiPerformReceive (
                                    be transmitted.
   @param  Len                      Number of packets.
   @param  PacketLen                Size of individual packet.
+  @param  BusWidth                 Number of data lines used for the transfer.
 
   @retval EFI_SUCCESS              Data transmitted successfully.
   @retval Others                   Data transmission failed.
@@ -380,7 +428,8 @@ QspiPerformTransmit (
   IN EFI_PHYSICAL_ADDRESS   QspiBaseAddress,
   IN VOID                   *Buffer,
   IN UINT32                 Len,
-  IN UINT32                 PacketLen
+  IN UINT32                 PacketLen,
+  IN QSPI_BUS_WIDTH         BusWidth
 )
 {
   EFI_STATUS  Status;
@@ -394,7 +443,7 @@ QspiPerformTransmit (
   // Clear transaction status
   QspiClearTransactionStatus (QspiBaseAddress);
   // Perform transaction packet width and size configuration
-  QspiPerformTransactionConfiguration (QspiBaseAddress, PacketLen, Len);
+  QspiPerformTransactionConfiguration (QspiBaseAddress, PacketLen, Len, BusWidth);
   // Enable TX
   MmioBitFieldWrite32 (QspiBaseAddress + QSPI_COMMAND_0,
                        QSPI_COMMAND_0_TX_EN_BIT,
@@ -450,6 +499,245 @@ QspiPerformTransmit (
 }
 
 
+/**
+  Transfer data over QSPI using DMA
+
+  Configure controller in TX or RX mode and start transaction in DMA mode
+  using the provided DMA buffer. Data is transferred as packed bytes so any
+  length up to the DMA buffer size can be used.
+
+  DMA and TX/RX are disabled again whether or not the transfer succeeds and
+  on failure both FIFOs are flushed, so that later transactions start from
+  a clean controller state.
+
+  @param  QspiBaseAddress          Base Address for QSPI Controller in use.
+  @param  Buffer                   Address of buffer containing data to be
+                                   transmitted or where data should be received.
+  @param  Len                      Number of bytes.
+  @param  BusWidth                 Number of data lines used for the transfer.
+  @param  DmaBuffer                DMA buffer used for the transfer.
+  @param  Transmit                 TRUE for Tx, FALSE for Rx.
+
+  @retval EFI_SUCCESS              Data transferred successfully.
+  @retval Others                   Data transfer failed.
+**/
+STATIC
+EFI_STATUS
+QspiPerformDmaTransfer (
+  IN EFI_PHYSICAL_ADDRESS   QspiBaseAddress,
+  IN VOID                   *Buffer,
+  IN UINT32                 Len,
+  IN QSPI_BUS_WIDTH         BusWidth,
+  IN QSPI_DMA_BUFFER        *DmaBuffer,
+  IN BOOLEAN                Transmit
+)
+{
+  EFI_STATUS  Status;
+  UINT32      DmaLen;
+  UINT32      Trigger;
+  UINT32      EnableBit;
+
+  if (Len > DmaBuffer->Size) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Transmit) {
+    CopyMem (DmaBuffer->HostAddress, Buffer, Len);
+    EnableBit = QSPI_COMMAND_0_TX_EN_BIT;
+  } else {
+    EnableBit = QSPI_COMMAND_0_RX_EN_BIT;
+  }
+
+  // Set FIFO trigger level based on the number of bytes moved by DMA.
+  DmaLen = ALIGN_VALUE (Len, sizeof (UINT32));
+  if ((DmaLen & 0xF) != 0) {
+    Trigger = QSPI_DMA_CTL_0_TRIG_1;
+  } else if (((DmaLen >> 4) & 0x1) != 0) {
+    Trigger = QSPI_DMA_CTL_0_TRIG_4;
+  } else {
+    Trigger = QSPI_DMA_CTL_0_TRIG_8;
+  }
+
+  // Clear transaction status
+  QspiClearTransactionStatus (QspiBaseAddress);
+  // Perform transaction packet width and size configuration
+  QspiPerformTransactionConfiguration (QspiBaseAddress, sizeof (UINT8), Len, BusWidth);
+  // Configure DMA address and trigger levels
+  MmioWrite32 (QspiBaseAddress + QSPI_DMA_MEM_ADDRESS_0, (UINT32)DmaBuffer->DeviceAddress);
+  MmioBitFieldWrite32 (QspiBaseAddress + QSPI_DMA_HI_ADDRESS_0,
+                       QSPI_DMA_HI_ADDRESS_0_LSB,
+                       QSPI_DMA_HI_ADDRESS_0_MSB,
+                       (UINT32)RShiftU64 (DmaBuffer->DeviceAddress, 32));
+  MmioBitFieldWrite32 (QspiBaseAddress + QSPI_DMA_CTL_0,
+                       QSPI_DMA_CTL_0_TX_TRIG_LSB,
+                       QSPI_DMA_CTL_0_TX_TRIG_MSB,
+                       Trigger);
+  MmioBitFieldWrite32 (QspiBaseAddress + QSPI_DMA_CTL_0,
+                       QSPI_DMA_CTL_0_RX_TRIG_LSB,
+                       QSPI_DMA_CTL_0_RX_TRIG_MSB,
+                       Trigger);
+  // Enable TX or RX
+  MmioBitFieldWrite32 (QspiBaseAddress + QSPI_COMMAND_0,
+                       EnableBit,
+                       EnableBit,
+                       1);
+  // Enable DMA transfer
+  MmioBitFieldWrite32 (QspiBaseAddress + QSPI_DMA_CTL_0,
+                       QSPI_DMA_CTL_0_DMA_EN_BIT,
+                       QSPI_DMA_CTL_0_DMA_EN_BIT,
+                       QSPI_DMA_CTL_0_DMA_EN_ENABLE);
+  // Wait for transaction to complete
+  Status = QspiWaitDmaTransactionReady (QspiBaseAddress);
+  // Disable DMA transfer
+  MmioBitFieldWrite32 (QspiBaseAddress + QSPI_DMA_CTL_0,
+                       QSPI_DMA_CTL_0_DMA_EN_BIT,
+                       QSPI_DMA_CTL_0_DMA_EN_BIT,
+                       QSPI_DMA_CTL_0_DMA_EN_DISABLE);
+  // Disable TX or RX
+  MmioBitFieldWrite32 (QspiBaseAddress + QSPI_COMMAND_0,
+                       EnableBit,
+                       EnableBit,
+                       0);
+  if (EFI_ERROR (Status)) {
+    // Drop whatever the aborted transfer left behind
+    QspiFlushFifo (QspiBaseAddress, TRUE);
+    QspiFlushFifo (QspiBaseAddress, FALSE);
+    QspiClearTransactionStatus (QspiBaseAddress);
+    return Status;
+  }
+
+  if (!Transmit) {
+    CopyMem (Buffer, DmaBuffer->HostAddress, Len);
+  }
+
+  DEBUG ((EFI_D_INFO, "QSPI DMA Data %a.\n", Transmit ? "Transmitted" : "Received"));
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Transmit a buffer over QSPI
+
+  Split the buffer into transactions that fit the FIFO or the DMA buffer
+  and transmit them using the requested bus width.
+
+  @param  QspiBaseAddress          Base Address for QSPI Controller in use.
+  @param  Buffer                   Address of buffer containing data to
+                                   be transmitted.
+  @param  Size                     Number of bytes to transmit.
+  @param  BusWidth                 Number of data lines used for the transfer.
+  @param  DmaBuffer                Optional DMA buffer. PIO only if NULL.
+
+  @retval EFI_SUCCESS              Data transmitted successfully.
+  @retval Others                   Data transmission failed.
+**/
+STATIC
+EFI_STATUS
+QspiTransmitBuffer (
+  IN EFI_PHYSICAL_ADDRESS   QspiBaseAddress,
+  IN UINT8                  *Buffer,
+  IN UINT32                 Size,
+  IN QSPI_BUS_WIDTH         BusWidth,
+  IN QSPI_DMA_BUFFER        *DmaBuffer OPTIONAL
+)
+{
+  EFI_STATUS Status;
+  UINT32     TransactionWidth;
+  UINT32     TransactionCount;
+  UINT32     DmaSize;
+
+  // Based on transmission buffer length, calculate packet width and packets in current transaction.
+  // Packet width can be 1B or 4B. Maximum number of packets in a single transaction can be 64.
+  // Transactions larger than the FIFO are moved through DMA when available.
+  while (Size > 0) {
+    if ((DmaBuffer != NULL) && (Size >= QSPI_DMA_MIN_TRANSFER_SIZE)) {
+      DmaSize = MIN (Size, DmaBuffer->Size);
+      DEBUG ((EFI_D_INFO, "QSPI Tx DMA Transaction: Size: %d.\n", DmaSize));
+      Status = QspiPerformDmaTransfer (QspiBaseAddress, Buffer, DmaSize, BusWidth, DmaBuffer, TRUE);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+      Buffer += DmaSize;
+      Size -= DmaSize;
+      continue;
+    }
+    TransactionWidth = (Size % sizeof (UINT32)) ? sizeof (UINT8) : sizeof (UINT32);
+    TransactionCount = MIN (MAX_FIFO_PACKETS, (Size / TransactionWidth));
+    DEBUG ((EFI_D_INFO, "QSPI Tx Transaction: Count: %d Width: %d.\n", TransactionCount, TransactionWidth));
+    Status = QspiPerformTransmit (QspiBaseAddress, Buffer, TransactionCount, TransactionWidth, BusWidth);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    Buffer += (TransactionWidth * TransactionCount);
+    Size -= (TransactionWidth * TransactionCount);
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Receive a buffer over QSPI
+
+  Split the buffer into transactions that fit the FIFO or the DMA buffer
+  and receive them using the requested bus width.
+
+  @param  QspiBaseAddress          Base Address for QSPI Controller in use.
+  @param  Buffer                   Address of buffer where data should be
+                                   received.
+  @param  Size                     Number of bytes to receive.
+  @param  BusWidth                 Number of data lines used for the transfer.
+  @param  DmaBuffer                Optional DMA buffer. PIO only if NULL.
+
+  @retval EFI_SUCCESS              Data received successfully.
+  @retval Others                   Data reception failed.
+**/
+STATIC
+EFI_STATUS
+QspiReceiveBuffer (
+  IN EFI_PHYSICAL_ADDRESS   QspiBaseAddress,
+  IN UINT8                  *Buffer,
+  IN UINT32                 Size,
+  IN QSPI_BUS_WIDTH         BusWidth,
+  IN QSPI_DMA_BUFFER        *DmaBuffer OPTIONAL
+)
+{
+  EFI_STATUS Status;
+  UINT32     TransactionWidth;
+  UINT32     TransactionCount;
+  UINT32     DmaSize;
+
+  // Based on reception buffer length, calculate packet width and packets in current transaction.
+  // Packet width can be 1B or 4B. Maximum number of packets in a single transaction can be 64.
+  // Transactions larger than the FIFO are moved through DMA when available.
+  while (Size > 0) {
+    if ((DmaBuffer != NULL) && (Size >= QSPI_DMA_MIN_TRANSFER_SIZE)) {
+      DmaSize = MIN (Size, DmaBuffer->Size);
+      DEBUG ((EFI_D_INFO, "QSPI Rx DMA Transaction: Size: %d.\n", DmaSize));
+      Status = QspiPerformDmaTransfer (QspiBaseAddress, Buffer, DmaSize, BusWidth, DmaBuffer, FALSE);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+      Buffer += DmaSize;
+      Size -= DmaSize;
+      continue;
+    }
+    TransactionWidth = (Size % sizeof (UINT32)) ? sizeof (UINT8) : sizeof (UINT32);
+    TransactionCount = MIN (MAX_FIFO_PACKETS, (Size / TransactionWidth));
+    DEBUG ((EFI_D_INFO, "QSPI Rx Transaction: Count: %d Width: %d.\n", TransactionCount, TransactionWidth));
+    Status = QspiPerformReceive (QspiBaseAddress, Buffer, TransactionCount, TransactionWidth, BusWidth);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    Buffer += (TransactionWidth * TransactionCount);
+    Size -= (TransactionWidth * TransactionCount);
+  }
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Initialize the QSPI Driver
 
@@ -522,45 +810,30 @@ QspiInitialize (
 
 
 /**
-  Perform Transaction
+  Run a transaction
 
-  Check transaction packet to be valid. For both Rx and Tx, calculate packet
-  width and count for each individual transaction and then process it.
-
-  QSPI transaction packet will have context for both TX as well as RX even
-  if we are doing either one and not both. Set the RX context correctly if
-  only TX needs to be done without any RX. Also, if RX or TX buffer addresses
-  are not NULL, their respective sizes cannot be 0.
+  Assert CS, run the TX and RX phases of the packet and release CS again,
+  also when one of the phases fails.
 
   @param  QspiBaseAddress          Base Address for QSPI Controller in use.
   @param  Packet                   QSPI transaction context
+  @param  DmaBuffer                Optional DMA buffer. PIO only if NULL.
 
   @retval EFI_SUCCESS              Transaction successful.
   @retval Others                   Transaction failed.
 **/
+STATIC
 EFI_STATUS
-QspiPerformTransaction (
+QspiRunTransaction (
   IN EFI_PHYSICAL_ADDRESS    QspiBaseAddress,
-  IN QSPI_TRANSACTION_PACKET *Packet
+  IN QSPI_TRANSACTION_PACKET *Packet,
+  IN QSPI_DMA_BUFFER         *DmaBuffer OPTIONAL
 )
 {
   EFI_STATUS Status;
   UINT8      *Buffer;
-  UINT32     TransactionWidth;
-  UINT32     TransactionCount;
-  UINT32     Count;
 
-  // Check for invalid buffer address and size combinations.
-  if (((Packet->TxBuf == NULL) &&
-       (Packet->TxLen != 0)) ||
-      ((Packet->TxBuf != NULL) &&
-       (Packet->TxLen == 0)) ||
-      ((Packet->RxBuf == NULL) &&
-       (Packet->RxLen != 0)) ||
-      ((Packet->RxBuf != NULL) &&
-       (Packet->RxLen == 0))) {
-    return EFI_INVALID_PARAMETER;
-  }
+  Status = EFI_SUCCESS;
 
   // Setup Wait Cycles.
   QspiPerformWaitCycleConfiguration(QspiBaseAddress, Packet->WaitCycles);
@@ -570,45 +843,110 @@ QspiPerformTransaction (
   if (Packet->TxBuf != NULL) {
     DEBUG ((EFI_D_INFO, "QSPI Tx Args: 0x%x %d.\n", Packet->TxBuf, Packet->TxLen));
     Buffer = Packet->TxBuf;
-    Count = Packet->TxLen;
-    // Based on transmission buffer length, calculate packet width and packets in current transaction.
-    // Packet width can be 1B or 4B. Maximum number of packets in a single transaction can be 64.
-    while (Count > 0) {
-      TransactionWidth = (Count % sizeof (UINT32)) ? sizeof (UINT8) : sizeof (UINT32);
-      TransactionCount = MIN (MAX_FIFO_PACKETS, (Count / TransactionWidth));
-      DEBUG ((EFI_D_INFO, "QSPI Tx Transaction: Count: %d Width: %d.\n", TransactionCount, TransactionWidth));
-      Status = QspiPerformTransmit (QspiBaseAddress, Buffer, TransactionCount, TransactionWidth);
+    // Transmit command phase, if any, with its own bus width.
+    if (Packet->CommandLen != 0) {
+      Status = QspiTransmitBuffer (QspiBaseAddress, Buffer, Packet->CommandLen, Packet->CommandWidth, DmaBuffer);
       if (EFI_ERROR (Status)) {
-        return Status;
+        goto Exit;
+      }
+    }
+    // Transmit address and data phase.
+    if (Packet->TxLen > Packet->CommandLen) {
+      Status = QspiTransmitBuffer (QspiBaseAddress,
+                                   Buffer + Packet->CommandLen,
+                                   Packet->TxLen - Packet->CommandLen,
+                                   Packet->TxWidth,
+                                   DmaBuffer);
+      if (EFI_ERROR (Status)) {
+        goto Exit;
       }
-      Buffer += (TransactionWidth * TransactionCount);
-      Count -= (TransactionWidth * TransactionCount);
     }
   }
   // If reception buffer address valid, start reception
   if (Packet->RxBuf != NULL) {
     DEBUG ((EFI_D_INFO, "QSPI Rx Args: 0x%x %d.\n", Packet->RxBuf, Packet->RxLen));
-    Buffer = Packet->RxBuf;
-    Count = Packet->RxLen;
-    // Based on reception buffer length, calculate packet width and packets in current transaction.
-    // Packet width can be 1B or 4B. Maximum number of packets in a single transaction can be 64.
-    while (Count > 0) {
-      TransactionWidth = (Count % sizeof (UINT32)) ? sizeof (UINT8) : sizeof (UINT32);
-      TransactionCount = MIN (MAX_FIFO_PACKETS, (Count / TransactionWidth));
-      DEBUG ((EFI_D_INFO, "QSPI Rx Transaction: Count: %d Width: %d.\n", TransactionCount, TransactionWidth));
-      Status = QspiPerformReceive (QspiBaseAddress, Buffer, TransactionCount, TransactionWidth);
-      if (EFI_ERROR (Status)) {
-        return Status;
-      }
-      Buffer += (TransactionWidth * TransactionCount);
-      Count -= (TransactionWidth * TransactionCount);
+    Status = QspiReceiveBuffer (QspiBaseAddress, Packet->RxBuf, Packet->RxLen, Packet->RxWidth, DmaBuffer);
+    if (EFI_ERROR (Status)) {
+      goto Exit;
     }
   }
+
+Exit:
   // Disable CS
   QspiConfigureCS(QspiBaseAddress, FALSE);
 
   // Wait for the controller to clear state before starting next transaction.
   MicroSecondDelay (TIMEOUT);
 
-  return EFI_SUCCESS;
+  return Status;
+}
+
+
+/**
+  Perform Transaction
+
+  Check transaction packet to be valid. For both Rx and Tx, calculate packet
+  width and count for each individual transaction and then process it.
+
+  QSPI transaction packet will have context for both TX as well as RX even
+  if we are doing either one and not both. Set the RX context correctly if
+  only TX needs to be done without any RX. Also, if RX or TX buffer addresses
+  are not NULL, their respective sizes cannot be 0.
+
+  The command portion of the TX buffer, the rest of the TX buffer and the RX
+  buffer can each use a different bus width to support multi I/O transfers.
+
+  If a DMA buffer is provided, large transfers are done through DMA using
+  that buffer while short phases such as commands still use PIO. A
+  transaction that only receives data through DMA is retried using PIO if it
+  fails, transactions that transmit data through DMA are not retried as the
+  slave may already have acted on part of the data.
+
+  @param  QspiBaseAddress          Base Address for QSPI Controller in use.
+  @param  Packet                   QSPI transaction context
+  @param  DmaBuffer                Optional DMA buffer. PIO only if NULL.
+
+  @retval EFI_SUCCESS              Transaction successful.
+  @retval Others                   Transaction failed.
+**/
+EFI_STATUS
+QspiPerformTransaction (
+  IN EFI_PHYSICAL_ADDRESS    QspiBaseAddress,
+  IN QSPI_TRANSACTION_PACKET *Packet,
+  IN QSPI_DMA_BUFFER         *DmaBuffer OPTIONAL
+)
+{
+  EFI_STATUS Status;
+
+  // Check for invalid buffer address and size combinations.
+  if (((Packet->TxBuf == NULL) &&
+       (Packet->TxLen != 0)) ||
+      ((Packet->TxBuf != NULL) &&
+       (Packet->TxLen == 0)) ||
+      ((Packet->RxBuf == NULL) &&
+       (Packet->RxLen != 0)) ||
+      ((Packet->RxBuf != NULL) &&
+       (Packet->RxLen == 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Check for invalid bus width and command length combinations.
+  if ((Packet->CommandWidth >= QspiBusWidthMax) ||
+      (Packet->TxWidth >= QspiBusWidthMax) ||
+      (Packet->RxWidth >= QspiBusWidthMax) ||
+      (Packet->CommandLen > Packet->TxLen)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = QspiRunTransaction (QspiBaseAddress, Packet, DmaBuffer);
+  if (EFI_ERROR (Status) &&
+      (DmaBuffer != NULL) &&
+      (Packet->RxLen >= QSPI_DMA_MIN_TRANSFER_SIZE) &&
+      (Packet->CommandLen < QSPI_DMA_MIN_TRANSFER_SIZE) &&
+      ((Packet->TxLen - Packet->CommandLen) < QSPI_DMA_MIN_TRANSFER_SIZE)) {
+    DEBUG ((EFI_D_ERROR, "%a QSPI DMA Receive Failed: %r. Retrying With PIO.\n", __FUNCTION__, Status));
+    Status = QspiRunTransaction (QspiBaseAddress, Packet, NULL);
+  }
+
+  return Status;
 }
@@ -52,6 +52,8 @@
 #define QSPI_COMMAND_0_TX_EN_ENABLE           1
 #define QSPI_COMMAND_0_SDR_DDR_SEL_SDR        0
 #define QSPI_COMMAND_0_INTERFACE_WIDTH_SINGLE 0
+#define QSPI_COMMAND_0_INTERFACE_WIDTH_DUAL   1
+#define QSPI_COMMAND_0_INTERFACE_WIDTH_QUAD   2
 #define QSPI_COMMAND_0_PACKED_ENABLE          1
 
 
@@ -65,12 +67,36 @@
 #define QSPI_TRANSFER_STATUS_0_RDY_NOT_READY 0
 
 
+#define QSPI_DMA_CTL_0                       0x20
+
+#define QSPI_DMA_CTL_0_DMA_EN_BIT            31
+#define QSPI_DMA_CTL_0_RX_TRIG_MSB           20
+#define QSPI_DMA_CTL_0_RX_TRIG_LSB           19
+#define QSPI_DMA_CTL_0_TX_TRIG_MSB           16
+#define QSPI_DMA_CTL_0_TX_TRIG_LSB           15
+
+#define QSPI_DMA_CTL_0_DMA_EN_ENABLE         1
+#define QSPI_DMA_CTL_0_DMA_EN_DISABLE        0
+#define QSPI_DMA_CTL_0_TRIG_1                0
+#define QSPI_DMA_CTL_0_TRIG_4                1
+#define QSPI_DMA_CTL_0_TRIG_8                2
+
+
 #define QSPI_DMA_BLK_SIZE_0                  0x24
 
 #define QSPI_DMA_BLK_SIZE_0_BLOCK_SIZE_MSB   27
 #define QSPI_DMA_BLK_SIZE_0_BLOCK_SIZE_LSB   0
 
 
+#define QSPI_DMA_MEM_ADDRESS_0               0x1D8
+
+
+#define QSPI_DMA_HI_ADDRESS_0                0x1DC
+
+#define QSPI_DMA_HI_ADDRESS_0_MSB            7
+#define QSPI_DMA_HI_ADDRESS_0_LSB            0
+
+
 #define QSPI_FIFO_STATUS_0                   0x14
 
 #define QSPI_FIFO_STATUS_0_RX_FIFO_FLUSH_BIT 15
@@ -97,5 +123,12 @@
 
 #define MAX_FIFO_PACKETS                     64
 
+// Microseconds to wait for a DMA transaction before aborting it.
+#define QSPI_DMA_TIMEOUT                     1000000
+
+// Transfers of at least this many bytes are done through DMA when a DMA
+// buffer is available. Anything smaller fits the FIFO and uses PIO.
+#define QSPI_DMA_MIN_TRANSFER_SIZE           (MAX_FIFO_PACKETS * sizeof (UINT32))
+
 
 #endif
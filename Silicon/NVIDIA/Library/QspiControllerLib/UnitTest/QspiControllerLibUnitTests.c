@@ -0,0 +1,484 @@
+/** @file
+  Unit tests of the QSPI controller library. Checks that PIO and DMA
+  transfers move the same bytes and that a failed DMA transfer leaves
+  the controller usable.
+
+  Tests are run using a QSPI controller stub.
+
+  Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/QspiControllerLib.h>
+#include <Library/QspiControllerStubLib.h>
+
+#include "../QspiControllerLibPrivate.h"
+
+#define UNIT_TEST_APP_NAME     "QspiControllerLib Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "0.1"
+
+#define FLASH_SIZE        SIZE_64KB
+#define DMA_BUFFER_SIZE   SIZE_4KB
+#define COMMAND_SIZE      (1 + QSPI_STUB_ADDRESS_BYTES)
+
+// Two full DMA buffers followed by a tail too short for DMA that is not a
+// multiple of 4 bytes, so every transfer path is used.
+#define TRANSFER_OFFSET   0x123
+#define TRANSFER_SIZE     ((2 * DMA_BUFFER_SIZE) + 203)
+
+STATIC EFI_PHYSICAL_ADDRESS QspiBase;
+STATIC QSPI_DMA_BUFFER      DmaBuffer;
+STATIC UINT8                *TestFlash;
+STATIC UINT8                *ExpectedFlash;
+STATIC UINT8                *TestBuffer;
+STATIC UINT8                *ReadBuffer;
+
+/**
+  Issue a read of the simulated NOR device.
+
+  @param Offset   Flash offset to read from
+  @param Size     Number of bytes to read
+  @param Buffer   Buffer to read into
+  @param Dma      TRUE to allow DMA, FALSE for PIO only
+
+  @return Status returned by QspiPerformTransaction.
+**/
+STATIC
+EFI_STATUS
+ReadFlash (
+  IN UINT32   Offset,
+  IN UINT32   Size,
+  IN UINT8    *Buffer,
+  IN BOOLEAN  Dma
+) {
+  UINT8                   Command[COMMAND_SIZE];
+  QSPI_TRANSACTION_PACKET Packet;
+
+  Command[0] = QSPI_STUB_CMD_READ;
+  Command[1] = (UINT8)(Offset >> 16);
+  Command[2] = (UINT8)(Offset >> 8);
+  Command[3] = (UINT8)Offset;
+
+  ZeroMem(&Packet, sizeof(Packet));
+  Packet.TxBuf = Command;
+  Packet.TxLen = sizeof(Command);
+  Packet.CommandLen = 1;
+  Packet.RxBuf = Buffer;
+  Packet.RxLen = Size;
+
+  return QspiPerformTransaction(QspiBase, &Packet, Dma ? &DmaBuffer : NULL);
+}
+
+/**
+  Issue a program of the simulated NOR device. TestBuffer holds the data
+  after room for the command.
+
+  @param Offset   Flash offset to program
+  @param Size     Number of data bytes to program
+  @param Dma      TRUE to allow DMA, FALSE for PIO only
+
+  @return Status returned by QspiPerformTransaction.
+**/
+STATIC
+EFI_STATUS
+ProgramFlash (
+  IN UINT32   Offset,
+  IN UINT32   Size,
+  IN BOOLEAN  Dma
+) {
+  QSPI_TRANSACTION_PACKET Packet;
+
+  TestBuffer[0] = QSPI_STUB_CMD_PAGE_PROGRAM;
+  TestBuffer[1] = (UINT8)(Offset >> 16);
+  TestBuffer[2] = (UINT8)(Offset >> 8);
+  TestBuffer[3] = (UINT8)Offset;
+
+  ZeroMem(&Packet, sizeof(Packet));
+  Packet.TxBuf = TestBuffer;
+  Packet.TxLen = COMMAND_SIZE + Size;
+  Packet.CommandLen = 1;
+
+  return QspiPerformTransaction(QspiBase, &Packet, Dma ? &DmaBuffer : NULL);
+}
+
+/**
+  Get the transfers started since the last call.
+
+  @return Pointer to a static QSPI_STUB_TRANSFER_COUNTS.
+**/
+STATIC
+QSPI_STUB_TRANSFER_COUNTS *
+GetTransferCounts (
+  VOID
+) {
+  STATIC QSPI_STUB_TRANSFER_COUNTS Counts;
+
+  QspiControllerStubGetTransferCounts(&Counts);
+  return &Counts;
+}
+
+/**
+  Check that the controller is idle: DMA, PIO, TX and RX disabled, CS
+  released and both FIFOs empty.
+
+  @retval TRUE    The controller is idle.
+  @retval FALSE   The controller is not idle.
+**/
+STATIC
+BOOLEAN
+ControllerIsIdle (
+  VOID
+) {
+  UINT32 Command;
+  UINT32 DmaCtl;
+  UINT32 FifoStatus;
+
+  Command = QspiControllerStubGetRegister(QSPI_COMMAND_0);
+  DmaCtl = QspiControllerStubGetRegister(QSPI_DMA_CTL_0);
+  FifoStatus = MmioRead32((UINTN)QspiBase + QSPI_FIFO_STATUS_0);
+
+  return (BitFieldRead32(DmaCtl, QSPI_DMA_CTL_0_DMA_EN_BIT, QSPI_DMA_CTL_0_DMA_EN_BIT) == QSPI_DMA_CTL_0_DMA_EN_DISABLE) &&
+         (BitFieldRead32(Command, QSPI_COMMAND_0_PIO_BIT, QSPI_COMMAND_0_PIO_BIT) == QSPI_COMMAND_0_PIO_DIS) &&
+         (BitFieldRead32(Command, QSPI_COMMAND_0_TX_EN_BIT, QSPI_COMMAND_0_TX_EN_BIT) == QSPI_COMMAND_0_TX_EN_DISABLE) &&
+         (BitFieldRead32(Command, QSPI_COMMAND_0_RX_EN_BIT, QSPI_COMMAND_0_RX_EN_BIT) == QSPI_COMMAND_0_RX_EN_DISABLE) &&
+         (BitFieldRead32(Command, QSPI_COMMAND_0_CS_SW_VAL_BIT, QSPI_COMMAND_0_CS_SW_VAL_BIT) == QSPI_COMMAND_0_CS_SW_VAL_HIGH) &&
+         (BitFieldRead32(FifoStatus, QSPI_FIFO_STATUS_0_TX_FIFO_EMPTY_BIT, QSPI_FIFO_STATUS_0_TX_FIFO_EMPTY_BIT) == QSPI_FIFO_STATUS_0_FIFO_EMPTY) &&
+         (BitFieldRead32(FifoStatus, QSPI_FIFO_STATUS_0_RX_FIFO_EMPTY_BIT, QSPI_FIFO_STATUS_0_RX_FIFO_EMPTY_BIT) == QSPI_FIFO_STATUS_0_FIFO_EMPTY);
+}
+
+/**
+  Fill the flash with a pattern and the test buffer with program data.
+
+  @param Context            Not used by this function
+
+  @retval UNIT_TEST_PASSED  Setup finished successfully.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+QspiTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UINTN Index;
+
+  for (Index = 0; Index < FLASH_SIZE; Index++) {
+    TestFlash[Index] = (UINT8)((Index * 7) ^ (Index >> 8));
+  }
+  for (Index = 0; Index < TRANSFER_SIZE; Index++) {
+    TestBuffer[COMMAND_SIZE + Index] = (UINT8)(Index * 13);
+  }
+  QspiControllerStubSetDmaFailure(FALSE);
+  GetTransferCounts();
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a read returns the flash contents through both PIO and DMA.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ReadPioDmaMatchTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  UT_ASSERT_NOT_EFI_ERROR(ReadFlash(TRANSFER_OFFSET, TRANSFER_SIZE, ReadBuffer, FALSE));
+  UT_ASSERT_EQUAL(GetTransferCounts()->DmaTransfers, 0);
+  UT_ASSERT_MEM_EQUAL(ReadBuffer, TestFlash + TRANSFER_OFFSET, TRANSFER_SIZE);
+
+  SetMem(ReadBuffer, TRANSFER_SIZE, 0);
+  UT_ASSERT_NOT_EFI_ERROR(ReadFlash(TRANSFER_OFFSET, TRANSFER_SIZE, ReadBuffer, TRUE));
+  UT_ASSERT_EQUAL(GetTransferCounts()->DmaTransfers, 2);
+  UT_ASSERT_MEM_EQUAL(ReadBuffer, TestFlash + TRANSFER_OFFSET, TRANSFER_SIZE);
+  UT_ASSERT_TRUE(ControllerIsIdle());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a program writes the same bytes through both PIO and DMA.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ProgramPioDmaMatchTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  SetMem(TestFlash, FLASH_SIZE, 0xFF);
+  UT_ASSERT_NOT_EFI_ERROR(ProgramFlash(TRANSFER_OFFSET, TRANSFER_SIZE, FALSE));
+  UT_ASSERT_EQUAL(GetTransferCounts()->DmaTransfers, 0);
+  UT_ASSERT_MEM_EQUAL(TestFlash + TRANSFER_OFFSET, TestBuffer + COMMAND_SIZE, TRANSFER_SIZE);
+  CopyMem(ExpectedFlash, TestFlash, FLASH_SIZE);
+
+  SetMem(TestFlash, FLASH_SIZE, 0xFF);
+  UT_ASSERT_NOT_EFI_ERROR(ProgramFlash(TRANSFER_OFFSET, TRANSFER_SIZE, TRUE));
+  UT_ASSERT_NOT_EQUAL(GetTransferCounts()->DmaTransfers, 0);
+  UT_ASSERT_MEM_EQUAL(TestFlash, ExpectedFlash, FLASH_SIZE);
+  UT_ASSERT_TRUE(ControllerIsIdle());
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a read whose DMA transfer stalls leaves the controller idle
+  and is completed through PIO instead.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+DmaReadFailureTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  QSPI_STUB_TRANSFER_COUNTS *Counts;
+
+  QspiControllerStubSetDmaFailure(TRUE);
+  UT_ASSERT_NOT_EFI_ERROR(ReadFlash(TRANSFER_OFFSET, TRANSFER_SIZE, ReadBuffer, TRUE));
+  Counts = GetTransferCounts();
+  UT_ASSERT_EQUAL(Counts->DmaTransfers, 1);
+  UT_ASSERT_NOT_EQUAL(Counts->PioTransfers, 0);
+  UT_ASSERT_MEM_EQUAL(ReadBuffer, TestFlash + TRANSFER_OFFSET, TRANSFER_SIZE);
+  UT_ASSERT_TRUE(ControllerIsIdle());
+
+  // DMA works again once the controller stops stalling
+  QspiControllerStubSetDmaFailure(FALSE);
+  SetMem(ReadBuffer, TRANSFER_SIZE, 0);
+  UT_ASSERT_NOT_EFI_ERROR(ReadFlash(0, TRANSFER_SIZE, ReadBuffer, TRUE));
+  UT_ASSERT_EQUAL(GetTransferCounts()->DmaTransfers, 2);
+  UT_ASSERT_MEM_EQUAL(ReadBuffer, TestFlash, TRANSFER_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Tests that a program whose DMA transfer stalls fails without a retry and
+  leaves the controller usable.
+
+  @param Context                      Not used by this function
+
+  @retval UNIT_TEST_PASSED            All assertions passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED An assertion failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+DmaProgramFailureTest (
+  IN UNIT_TEST_CONTEXT  Context
+) {
+  QspiControllerStubSetDmaFailure(TRUE);
+  UT_ASSERT_STATUS_EQUAL(ProgramFlash(TRANSFER_OFFSET, TRANSFER_SIZE, TRUE), EFI_TIMEOUT);
+  UT_ASSERT_EQUAL(GetTransferCounts()->DmaTransfers, 1);
+  UT_ASSERT_TRUE(ControllerIsIdle());
+
+  QspiControllerStubSetDmaFailure(FALSE);
+  UT_ASSERT_NOT_EFI_ERROR(ReadFlash(TRANSFER_OFFSET, TRANSFER_SIZE, ReadBuffer, FALSE));
+  UT_ASSERT_MEM_EQUAL(ReadBuffer, TestFlash + TRANSFER_OFFSET, TRANSFER_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initializes data that will be used for the QSPI tests.
+
+  Allocates the flash storage and test buffers and sets up the controller
+  stub and its DMA buffer.
+
+  @retval EFI_SUCCESS           Test data initialized.
+  @retval Others                Test data could not be initialized.
+**/
+STATIC
+EFI_STATUS
+InitTestData (
+  VOID
+) {
+  EFI_STATUS Status;
+
+  TestFlash = AllocatePool(FLASH_SIZE);
+  ExpectedFlash = AllocatePool(FLASH_SIZE);
+  TestBuffer = AllocatePool(COMMAND_SIZE + TRANSFER_SIZE);
+  ReadBuffer = AllocatePool(TRANSFER_SIZE);
+  if (TestFlash == NULL || ExpectedFlash == NULL || TestBuffer == NULL || ReadBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = QspiControllerStubInitialize(TestFlash, FLASH_SIZE, &QspiBase);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Status = QspiControllerStubAllocateDmaBuffer(DMA_BUFFER_SIZE, &DmaBuffer);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  return QspiInitialize(QspiBase);
+}
+
+/**
+  Cleans up the data used by the QSPI tests.
+**/
+STATIC
+VOID
+CleanUpTestData (
+  VOID
+) {
+  QspiControllerStubDestroy();
+
+  if (TestFlash != NULL) {
+    FreePool(TestFlash);
+  }
+
+  if (ExpectedFlash != NULL) {
+    FreePool(ExpectedFlash);
+  }
+
+  if (TestBuffer != NULL) {
+    FreePool(TestBuffer);
+  }
+
+  if (ReadBuffer != NULL) {
+    FreePool(ReadBuffer);
+  }
+}
+
+/**
+  Initialze the unit test framework, suite, and unit tests for the
+  QSPI controller library and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+) {
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      TransferTestSuite;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitTestData();
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed to initialize test data. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Start setting up the test framework for running the tests.
+  Status = InitUnitTestFramework(
+    &Fw,
+    UNIT_TEST_APP_NAME,
+    gEfiCallerBaseName,
+    UNIT_TEST_APP_VERSION
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in InitUnitTestFramework. Status = %r\n",
+      Status)
+    );
+    goto EXIT;
+  }
+
+  // Populate the QSPI Transfer Unit Test Suite.
+  Status = CreateUnitTestSuite(
+    &TransferTestSuite,
+    Fw,
+    "QSPI Transfer Tests",
+    "QspiControllerLib.TransferTestSuite",
+    NULL,
+    NULL
+  );
+  if (EFI_ERROR (Status)) {
+    DEBUG(
+      (DEBUG_ERROR,
+      "Failed in CreateUnitTestSuite for TransferTestSuite\n")
+    );
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // AddTestCase Args:
+  //  Suite | Description
+  //  Class Name | Function
+  //  Pre | Post | Context
+  AddTestCase(TransferTestSuite, "PIO and DMA Read Match Test",
+              "ReadPioDmaMatchTest", ReadPioDmaMatchTest,
+              QspiTestSetup, NULL, NULL);
+  AddTestCase(TransferTestSuite, "PIO and DMA Program Match Test",
+              "ProgramPioDmaMatchTest", ProgramPioDmaMatchTest,
+              QspiTestSetup, NULL, NULL);
+  AddTestCase(TransferTestSuite, "DMA Read Failure Test",
+              "DmaReadFailureTest", DmaReadFailureTest,
+              QspiTestSetup, NULL, NULL);
+  AddTestCase(TransferTestSuite, "DMA Program Failure Test",
+              "DmaProgramFailureTest", DmaProgramFailureTest,
+              QspiTestSetup, NULL, NULL);
+
+  // Execute the tests.
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  CleanUpTestData();
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based
+  unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+BaseLibUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+) {
+  return UnitTestingEntry();
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+) {
+  return UnitTestingEntry ();
+}
@@ -825,6 +825,7 @@ UpdateSdhciInfo ()
   EFI_STATUS                                    Status;
   UINT32                                        NumberOfSdhciPorts;
   UINT32                                        *SdhciHandles;
+  EFI_ACPI_DESCRIPTION_HEADER                   **Devices;
   NVIDIA_DEVICE_TREE_REGISTER_DATA              RegisterData;
   NVIDIA_DEVICE_TREE_INTERRUPT_DATA             InterruptData;
   UINT32                                        Size;
@@ -852,6 +853,14 @@ UpdateSdhciInfo ()
     return EFI_OUT_OF_RESOURCES;
   }
 
+  // Each device is appended from its own copy of the patched template so
+  // that the whole set can be added to the table at once.
+  Devices = (EFI_ACPI_DESCRIPTION_HEADER **)AllocateZeroPool (sizeof (EFI_ACPI_DESCRIPTION_HEADER *) * NumberOfSdhciPorts);
+  if (Devices == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
   Status = GetMatchingEnabledDeviceTreeNodes ("nvidia,tegra194-sdhci", SdhciHandles, &NumberOfSdhciPorts);
   if (EFI_ERROR (Status)) {
     goto ErrorExit;
@@ -967,14 +976,31 @@ UpdateSdhciInfo ()
       goto ErrorExit;
     }
 
-    Status = GenerationProtocol->AppendDevice(GenerationProtocol, (EFI_ACPI_DESCRIPTION_HEADER *)sdctemplate_aml_code);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a: Failed to append device %a\n", __FUNCTION__, SdcPathString));
+    Devices[Index] = (EFI_ACPI_DESCRIPTION_HEADER *)AllocateCopyPool (
+                                                      ((EFI_ACPI_DESCRIPTION_HEADER *)sdctemplate_aml_code)->Length,
+                                                      sdctemplate_aml_code
+                                                      );
+    if (Devices[Index] == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
       goto ErrorExit;
     }
   }
 
+  Status = GenerationProtocol->AppendDevices(GenerationProtocol, Devices, NumberOfSdhciPorts);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to append SDHCI devices\n", __FUNCTION__));
+  }
+
 ErrorExit:
+  if (Devices != NULL) {
+    for (Index = 0; Index < NumberOfSdhciPorts; Index++) {
+      if (Devices[Index] != NULL) {
+        FreePool (Devices[Index]);
+      }
+    }
+    FreePool (Devices);
+  }
+
   if (SdhciHandles != NULL) {
     FreePool (SdhciHandles);
   }
@@ -995,6 +1021,7 @@ UpdateI2cInfo ()
   EFI_STATUS                                    Status;
   UINT32                                        NumberOfI2cPorts;
   UINT32                                        *I2cHandles;
+  EFI_ACPI_DESCRIPTION_HEADER                   **Devices;
   NVIDIA_DEVICE_TREE_REGISTER_DATA              RegisterData;
   NVIDIA_DEVICE_TREE_INTERRUPT_DATA             InterruptData;
   UINT32                                        Size;
@@ -1018,6 +1045,14 @@ UpdateI2cInfo ()
     return EFI_OUT_OF_RESOURCES;
   }
 
+  // Each device is appended from its own copy of the patched template so
+  // that the whole set can be added to the table at once.
+  Devices = (EFI_ACPI_DESCRIPTION_HEADER **)AllocateZeroPool (sizeof (EFI_ACPI_DESCRIPTION_HEADER *) * NumberOfI2cPorts);
+  if (Devices == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
   Status = GetMatchingEnabledDeviceTreeNodes ("nvidia,tegra194-i2c", I2cHandles, &NumberOfI2cPorts);
   if (EFI_ERROR (Status)) {
     goto ErrorExit;
@@ -1116,14 +1151,31 @@ UpdateI2cInfo ()
       goto ErrorExit;
     }
 
-    Status = GenerationProtocol->AppendDevice(GenerationProtocol, (EFI_ACPI_DESCRIPTION_HEADER *)i2ctemplate_aml_code);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a: Failed to append device %a\n", __FUNCTION__, I2cPathString));
+    Devices[Index] = (EFI_ACPI_DESCRIPTION_HEADER *)AllocateCopyPool (
+                                                      ((EFI_ACPI_DESCRIPTION_HEADER *)i2ctemplate_aml_code)->Length,
+                                                      i2ctemplate_aml_code
+                                                      );
+    if (Devices[Index] == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
       goto ErrorExit;
     }
   }
 
+  Status = GenerationProtocol->AppendDevices(GenerationProtocol, Devices, NumberOfI2cPorts);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed to append I2C devices\n", __FUNCTION__));
+  }
+
 ErrorExit:
+  if (Devices != NULL) {
+    for (Index = 0; Index < NumberOfI2cPorts; Index++) {
+      if (Devices[Index] != NULL) {
+        FreePool (Devices[Index]);
+      }
+    }
+    FreePool (Devices);
+  }
+
   if (I2cHandles != NULL) {
     FreePool (I2cHandles);
   }
@@ -1726,7 +1778,20 @@ ConfigurationManagerDataDxeInitialize (
     return Status;
   }
 
+  // Patch the AML tables in a single transaction so that the checksum of
+  // each modified table is only recomputed once.
+  Status = PatchProtocol->BeginTransaction (PatchProtocol);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Status = InitializePlatformRepository ();
+  if (EFI_ERROR (Status)) {
+    PatchProtocol->CommitTransaction (PatchProtocol);
+    return Status;
+  }
+
+  Status = PatchProtocol->CommitTransaction (PatchProtocol);
   if (EFI_ERROR (Status)) {
     return Status;
   }